@@ -0,0 +1,1007 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+//micro-benchmark suite
+//generates synthetic netCDF files with the netCDF API and times the explorer loading and display code on them
+//results are written as JSON, so that runs of different builds can be compared
+//usage:
+//netcdf-bench [--dir dir] [--sizes 1,16,256] [--shapes grid,groups,attributes,strings] [--repeat 3] [--output results.json]
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include "netcdf_explorer.hpp"
+#if defined(__linux__)
+#include <malloc.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//bench_file_t
+//description of one synthetic file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class bench_file_t
+{
+public:
+  bench_file_t(const std::string &shape, bool netcdf4, bool chunked, bool deflate, size_t size_mb) :
+    m_shape(shape),
+    m_netcdf4(netcdf4),
+    m_chunked(chunked),
+    m_deflate(deflate),
+    m_size_mb(size_mb)
+  {
+  }
+  std::string name() const
+  {
+    char str[256];
+    snprintf(str, sizeof(str), "%s_%s_%s_%s_%zumb", m_shape.c_str(), m_netcdf4 ? "nc4" : "classic",
+      m_chunked ? "chunked" : "contiguous", m_deflate ? "deflate" : "raw", m_size_mb);
+    return str;
+  }
+  std::string m_shape; // grid, groups, attributes or strings
+  bool m_netcdf4; // netCDF-4 or classic format
+  bool m_chunked; // chunked or contiguous storage
+  bool m_deflate; // deflate level 1 with shuffle, or raw
+  size_t m_size_mb; // approximate size of the data variable
+  std::string m_file_name;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//bench_result_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class bench_result_t
+{
+public:
+  bench_result_t(const bench_file_t &file, const std::string &metric, double value, const std::string &unit) :
+    m_file(file),
+    m_metric(metric),
+    m_value(value),
+    m_unit(unit)
+  {
+  }
+  bench_file_t m_file;
+  std::string m_metric;
+  double m_value;
+  std::string m_unit;
+};
+
+static std::vector<bench_result_t> results;
+static int nbr_repeat = 3;
+
+//grid shape: float var(time, lat, lon), one 1 MB layer per time step
+static const size_t grid_lat = 512;
+static const size_t grid_lon = 512;
+//groups shape: number of groups, each with a small variable and two attributes
+static const int nbr_groups = 1000;
+//attributes shape: number of global attributes, and of attributes of one variable
+static const int nbr_attributes = 10000;
+//strings shape: string var(row, col), 16 character strings, 64 rows of 1024 strings per MB
+static const size_t strings_col = 1024;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//check
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void check(int ret, const char *what)
+{
+  if(ret != NC_NOERR)
+  {
+    fprintf(stderr, "%s: %s\n", what, nc_strerror(ret));
+    exit(1);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//generate
+//writes one time layer at a time, so that files of tens of GB can be generated in bounded memory
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void generate(const bench_file_t &file)
+{
+  int nc_id;
+  int mode = NC_CLOBBER;
+  if(file.m_netcdf4)
+  {
+    mode |= NC_NETCDF4;
+  }
+  check(nc_create(file.m_file_name.c_str(), mode, &nc_id), "nc_create");
+
+  if(file.m_shape == "grid")
+  {
+    int dim_ids[3];
+    int var_id;
+    int crd_ids[3];
+    size_t nbr_time = std::max<size_t>(1, file.m_size_mb * 1024 * 1024 / (grid_lat * grid_lon * sizeof(float)));
+    //fixed size time dimension, since contiguous storage cannot have an unlimited dimension
+    check(nc_def_dim(nc_id, "time", nbr_time, &dim_ids[0]), "nc_def_dim");
+    check(nc_def_dim(nc_id, "lat", grid_lat, &dim_ids[1]), "nc_def_dim");
+    check(nc_def_dim(nc_id, "lon", grid_lon, &dim_ids[2]), "nc_def_dim");
+    check(nc_def_var(nc_id, "time", NC_DOUBLE, 1, &dim_ids[0], &crd_ids[0]), "nc_def_var");
+    check(nc_def_var(nc_id, "lat", NC_DOUBLE, 1, &dim_ids[1], &crd_ids[1]), "nc_def_var");
+    check(nc_def_var(nc_id, "lon", NC_DOUBLE, 1, &dim_ids[2], &crd_ids[2]), "nc_def_var");
+    check(nc_def_var(nc_id, "var", NC_FLOAT, 3, dim_ids, &var_id), "nc_def_var");
+    check(nc_put_att_text(nc_id, var_id, "units", 1, "K"), "nc_put_att_text");
+    if(file.m_netcdf4)
+    {
+      size_t chunk[3] = { 1, grid_lat, grid_lon };
+      if(file.m_chunked)
+      {
+        chunk[1] = 128;
+        chunk[2] = 128;
+      }
+      check(nc_def_var_chunking(nc_id, var_id, file.m_chunked || file.m_deflate ? NC_CHUNKED : NC_CONTIGUOUS, chunk), "nc_def_var_chunking");
+      if(file.m_deflate)
+      {
+        check(nc_def_var_deflate(nc_id, var_id, 1, 1, 1), "nc_def_var_deflate");
+      }
+    }
+    check(nc_enddef(nc_id), "nc_enddef");
+
+    std::vector<double> crd(std::max(grid_lat, grid_lon));
+    size_t start[3] = { 0, 0, 0 };
+    size_t count[3] = { 1, grid_lat, grid_lon };
+    for(size_t idx = 0; idx < grid_lat; idx++) crd[idx] = -90.0 + 180.0 * idx / (grid_lat - 1);
+    check(nc_put_vara_double(nc_id, crd_ids[1], &start[1], &count[1], &crd[0]), "nc_put_vara_double");
+    for(size_t idx = 0; idx < grid_lon; idx++) crd[idx] = 360.0 * idx / grid_lon;
+    check(nc_put_vara_double(nc_id, crd_ids[2], &start[2], &count[2], &crd[0]), "nc_put_vara_double");
+
+    //smooth field, so that deflate behaves like on real data
+    std::vector<float> layer(grid_lat * grid_lon);
+    for(size_t idx_tim = 0; idx_tim < nbr_time; idx_tim++)
+    {
+      for(size_t idx_lat = 0; idx_lat < grid_lat; idx_lat++)
+      {
+        for(size_t idx_lon = 0; idx_lon < grid_lon; idx_lon++)
+        {
+          layer[idx_lat * grid_lon + idx_lon] = (float)(273.15 + 30.0 * sin(idx_lat * 0.01 + idx_tim * 0.1) * cos(idx_lon * 0.02));
+        }
+      }
+      double tim = (double)idx_tim;
+      start[0] = idx_tim;
+      check(nc_put_vara_double(nc_id, crd_ids[0], &start[0], &count[0], &tim), "nc_put_vara_double");
+      check(nc_put_vara_float(nc_id, var_id, start, count, &layer[0]), "nc_put_vara_float");
+    }
+  }
+  else if(file.m_shape == "groups")
+  {
+    std::vector<float> buf(64, 1.0f);
+    for(int idx_grp = 0; idx_grp < nbr_groups; idx_grp++)
+    {
+      char grp_nm[NC_MAX_NAME + 1];
+      int grp_id;
+      int dim_id;
+      int var_id;
+      size_t start = 0;
+      size_t count = buf.size();
+      snprintf(grp_nm, sizeof(grp_nm), "g%d", idx_grp);
+      check(nc_def_grp(nc_id, grp_nm, &grp_id), "nc_def_grp");
+      check(nc_def_dim(grp_id, "x", buf.size(), &dim_id), "nc_def_dim");
+      check(nc_def_var(grp_id, "var", NC_FLOAT, 1, &dim_id, &var_id), "nc_def_var");
+      check(nc_put_att_text(grp_id, var_id, "units", 1, "K"), "nc_put_att_text");
+      check(nc_put_att_text(grp_id, var_id, "long_name", 8, "variable"), "nc_put_att_text");
+      check(nc_put_vara_float(grp_id, var_id, &start, &count, &buf[0]), "nc_put_vara_float");
+    }
+  }
+  else if(file.m_shape == "attributes")
+  {
+    int dim_id;
+    int var_id;
+    check(nc_def_dim(nc_id, "x", 16, &dim_id), "nc_def_dim");
+    check(nc_def_var(nc_id, "var", NC_FLOAT, 1, &dim_id, &var_id), "nc_def_var");
+    for(int idx_att = 0; idx_att < nbr_attributes; idx_att++)
+    {
+      char att_nm[NC_MAX_NAME + 1];
+      double val = idx_att;
+      snprintf(att_nm, sizeof(att_nm), "att_%d", idx_att);
+      check(nc_put_att_text(nc_id, NC_GLOBAL, att_nm, strlen(att_nm), att_nm), "nc_put_att_text");
+      check(nc_put_att_double(nc_id, var_id, att_nm, NC_DOUBLE, 1, &val), "nc_put_att_double");
+    }
+  }
+
+  else if(file.m_shape == "strings")
+  {
+    int dim_ids[2];
+    int var_id;
+    size_t nbr_row = std::max<size_t>(1, file.m_size_mb * 64);
+    check(nc_def_dim(nc_id, "row", nbr_row, &dim_ids[0]), "nc_def_dim");
+    check(nc_def_dim(nc_id, "col", strings_col, &dim_ids[1]), "nc_def_dim");
+    check(nc_def_var(nc_id, "var", NC_STRING, 2, dim_ids, &var_id), "nc_def_var");
+    check(nc_enddef(nc_id), "nc_enddef");
+
+    std::vector<std::string> row(strings_col);
+    std::vector<const char*> ptr(strings_col);
+    size_t start[2] = { 0, 0 };
+    size_t count[2] = { 1, strings_col };
+    for(size_t idx_row = 0; idx_row < nbr_row; idx_row++)
+    {
+      for(size_t idx_col = 0; idx_col < strings_col; idx_col++)
+      {
+        char str[32];
+        snprintf(str, sizeof(str), "str_%011zu", idx_row * strings_col + idx_col);
+        row[idx_col] = str;
+        ptr[idx_col] = row[idx_col].c_str();
+      }
+      start[0] = idx_row;
+      check(nc_put_vara_string(nc_id, var_id, start, count, &ptr[0]), "nc_put_vara_string");
+    }
+  }
+
+  check(nc_close(nc_id), "nc_close");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//add_result
+//keeps the minimum of the repeats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void add_result(const bench_file_t &file, const std::string &metric, const std::vector<double> &values, const std::string &unit)
+{
+  if(values.empty())
+  {
+    return;
+  }
+  double val = *std::min_element(values.begin(), values.end());
+  results.push_back(bench_result_t(file, metric, val, unit));
+  fprintf(stderr, "%-45s %-24s %12.3f %s\n", file.name().c_str(), metric.c_str(), val, unit.c_str());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//scan
+//nc_open and meta_scan into a new metadata store
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static meta_store_t* scan(const bench_file_t &file, double *time_open, double *time_scan)
+{
+  QElapsedTimer timer;
+  int nc_id;
+  timer.start();
+  check(nc_open(file.m_file_name.c_str(), NC_NOWRITE, &nc_id), "nc_open");
+  *time_open = timer.nsecsElapsed() / 1.0e6;
+  meta_store_t *store = new meta_store_t(file.m_file_name);
+  timer.start();
+  check(meta_scan(store, nc_id), "meta_scan");
+  *time_scan = timer.nsecsElapsed() / 1.0e6;
+  nc_close(nc_id);
+  return store;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//heap_used
+//bytes allocated with malloc and new, 0 if unknown
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t heap_used()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+  return (unsigned int)mallinfo().uordblks;
+#else
+  return 0;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//run
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void run(const bench_file_t &file, MainWindow *window, size_t max_load_mb)
+{
+  QElapsedTimer timer;
+  std::vector<double> time_open;
+  std::vector<double> time_scan;
+  std::vector<double> time_read_file;
+  std::vector<double> time_load_item;
+  std::vector<double> time_load_variable;
+  std::vector<double> time_data;
+  std::vector<double> time_header;
+  std::vector<double> time_frame_view;
+  std::vector<double> time_frame_direct;
+  std::vector<double> time_layer;
+  std::vector<double> time_child_open;
+  std::vector<double> time_layer_io;
+  std::vector<double> time_layer_back;
+  std::vector<double> time_layer_back_cache;
+  std::vector<double> ratio_cache;
+  std::vector<double> time_tree_meta;
+  std::vector<double> bytes_tree_meta;
+  std::vector<double> time_index_query;
+  std::vector<double> rate_diff;
+  std::vector<double> rate_expr;
+  std::vector<double> rate_reduce;
+  std::vector<double> rate_chunk_netcdf;
+  std::vector<double> rate_chunk_parallel;
+  std::map<int, std::vector<double> > rate_reader_read;
+  std::map<int, std::vector<double> > rate_reader_reduce;
+  std::vector<double> rate_pyramid;
+  std::vector<double> time_sort;
+  std::vector<double> rate_remote;
+  std::vector<double> rate_remote_zlib;
+  std::vector<double> ratio_remote_zlib;
+  pool_stats_t pool_start = pool_stats();
+
+  for(int idx_rpt = 0; idx_rpt < nbr_repeat; idx_rpt++)
+  {
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //metadata scan; tree memory and build time: the metadata store and the tree model
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    double tim_open;
+    double tim_scan;
+    size_t heap = heap_used();
+    meta_store_t *store = scan(file, &tim_open, &tim_scan);
+    time_open.push_back(tim_open);
+    time_scan.push_back(tim_scan);
+    timer.start();
+    FileTreeModel *tree_model = new FileTreeModel(NULL);
+    tree_model->add_file(store);
+    time_tree_meta.push_back(tim_scan + timer.nsecsElapsed() / 1.0e6);
+    if(heap != 0)
+    {
+      //signed: frees by other threads during the build can take the heap below where it was
+      bytes_tree_meta.push_back(((double)heap_used() - (double)heap) / (1024.0 * 1024.0));
+    }
+
+    //search: substring through trigrams, short substring, exact attribute value
+    const char *query[] = { "att_12", "x", "units=K", "var:va" };
+    std::vector<std::vector<char> > keep;
+    timer.start();
+    for(int idx_qry = 0; idx_qry < 4; idx_qry++)
+    {
+      tree_model->search(query[idx_qry], keep);
+    }
+    time_index_query.push_back(timer.nsecsElapsed() / 1.0e6 / 4);
+
+    //read_file runs on the I/O thread, the tree is built when its result is delivered
+    timer.start();
+    window->read_file(file.m_file_name.c_str());
+    IoScheduler::instance()->wait_idle();
+    QCoreApplication::sendPostedEvents();
+    time_read_file.push_back(timer.nsecsElapsed() / 1.0e6);
+    window->close_files();
+
+    ItemData *item_data = tree_model->find_variable(file.m_shape == "groups" ? "/g0/var" : "var");
+    if(item_data == NULL || file.m_size_mb > max_load_mb)
+    {
+      delete tree_model;
+      continue;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //load_variable, without coordinate variables
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    int nc_id;
+    int grp_id;
+    int var_id;
+    size_t buf_sz = 1;
+    for(size_t idx_dmn = 0; idx_dmn < item_data->m_ncdata->m_dim.size(); idx_dmn++)
+    {
+      buf_sz *= item_data->m_ncdata->m_dim[idx_dmn];
+    }
+    check(nc_open(file.m_file_name.c_str(), NC_NOWRITE, &nc_id), "nc_open");
+    check(inq_grp_id(nc_id, item_data->m_grp_nm_fll, &grp_id), "inq_grp_id");
+    check(nc_inq_varid(grp_id, item_data->m_item_nm.c_str(), &var_id), "nc_inq_varid");
+    timer.start();
+    buffer_t buf = load_variable(grp_id, var_id, item_data->m_ncdata->m_nc_type, buf_sz);
+    time_load_variable.push_back(timer.nsecsElapsed() / 1.0e6);
+
+    //permutation of all the cells as one column, as a click on a column header
+    if(diff_type(item_data->m_ncdata->m_nc_type) && buf_sz <= (size_t)INT_MAX)
+    {
+      std::vector<int> index;
+      timer.start();
+      sort_index(buf.data(), item_data->m_ncdata->m_nc_type, buf_sz, 1, false, 0, sort_ascending, sort_filter_t(), &index);
+      time_sort.push_back(timer.nsecsElapsed() / 1.0e6);
+    }
+    buf.reset();
+    nc_close(nc_id);
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //load_item, with coordinate variables
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    timer.start();
+    load_item(item_data);
+    time_load_item.push_back(timer.nsecsElapsed() / 1.0e6);
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //opening the window, then TableModel::data and TableModel::headerData per cell
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    timer.start();
+    ChildWindowTable *child = new ChildWindowTable(NULL, item_data);
+    time_child_open.push_back(timer.nsecsElapsed() / 1.0e6);
+    TableModel *model = child->model();
+    int nbr_rows = std::min(model->rowCount(), 1000);
+    int nbr_cols = std::min(model->columnCount(), 1000);
+    size_t nbr_chars = 0;
+    timer.start();
+    for(int idx_row = 0; idx_row < nbr_rows; idx_row++)
+    {
+      for(int idx_col = 0; idx_col < nbr_cols; idx_col++)
+      {
+        nbr_chars += model->data(model->index(idx_row, idx_col)).toString().size();
+      }
+    }
+    time_data.push_back(timer.nsecsElapsed() / (double)(nbr_rows * nbr_cols));
+
+    timer.start();
+    for(int idx_row = 0; idx_row < nbr_rows; idx_row++)
+    {
+      nbr_chars += model->headerData(idx_row, Qt::Vertical).toString().size();
+    }
+    for(int idx_col = 0; idx_col < nbr_cols; idx_col++)
+    {
+      nbr_chars += model->headerData(idx_col, Qt::Horizontal).toString().size();
+    }
+    time_header.push_back(timer.nsecsElapsed() / (double)(nbr_rows + nbr_cols));
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //one frame of a 4K window of small cells, painted by QTableView through data() and the item
+    //delegate, then directly from the buffers
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    {
+      TableView *view = child->table();
+      view->verticalHeader()->setDefaultSectionSize(16);
+      view->horizontalHeader()->setDefaultSectionSize(64);
+      child->setAttribute(Qt::WA_DontShowOnScreen);
+      child->resize(3840, 2160);
+      child->show();
+      QCoreApplication::processEvents();
+      QImage image(view->viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+      for(int direct = 0; direct < 2; direct++)
+      {
+        view->set_direct_paint(direct != 0);
+        view->viewport()->render(&image);
+        timer.start();
+        for(int idx = 0; idx < 10; idx++)
+        {
+          view->viewport()->render(&image);
+        }
+        (direct ? time_frame_direct : time_frame_view).push_back(timer.nsecsElapsed() / 1.0e6 / 10);
+      }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //layer switching: next layer, then format one screen of cells
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(child->m_layer.size())
+    {
+      int nbr_layers = std::min<int>((int)item_data->m_ncdata->m_dim[0] - 1, 100);
+      timer.start();
+      for(int idx_lyr = 0; idx_lyr < nbr_layers; idx_lyr++)
+      {
+        QMetaObject::invokeMethod(child, "next_layer", Qt::DirectConnection, Q_ARG(int, 0));
+        for(int idx_row = 0; idx_row < std::min(nbr_rows, 50); idx_row++)
+        {
+          for(int idx_col = 0; idx_col < std::min(nbr_cols, 20); idx_col++)
+          {
+            nbr_chars += model->data(model->index(idx_row, idx_col)).toString().size();
+          }
+        }
+      }
+      if(nbr_layers > 0)
+      {
+        time_layer.push_back(timer.nsecsElapsed() / 1.0e6 / nbr_layers);
+      }
+    }
+
+    delete child;
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //layer switching through the I/O scheduler: the table reads tiles of the layer
+    //and prefetches the neighbour layers, as in the GUI
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    item_data->m_ncdata->m_buf.reset();
+    if(item_data->m_ncdata->m_dim.size() >= 3 && TableModel::use_tiles(item_data->m_ncdata))
+    {
+      child = new ChildWindowTable(NULL, item_data);
+      model = child->model();
+      int nbr_layers = std::min<int>((int)item_data->m_ncdata->m_dim[0] - 1, 100);
+      IoScheduler::instance()->wait_idle();
+      QCoreApplication::sendPostedEvents();
+      timer.start();
+      for(int idx_lyr = 0; idx_lyr < nbr_layers; idx_lyr++)
+      {
+        QMetaObject::invokeMethod(child, "next_layer", Qt::DirectConnection, Q_ARG(int, 0));
+        IoScheduler::instance()->wait_idle();
+        QCoreApplication::sendPostedEvents();
+        for(int idx_row = 0; idx_row < std::min(nbr_rows, 50); idx_row++)
+        {
+          for(int idx_col = 0; idx_col < std::min(nbr_cols, 20); idx_col++)
+          {
+            nbr_chars += model->data(model->index(idx_row, idx_col)).toString().size();
+          }
+        }
+      }
+      if(nbr_layers > 0)
+      {
+        time_layer_io.push_back(timer.nsecsElapsed() / 1.0e6 / nbr_layers);
+      }
+
+      //back over the same layers: the layers left behind were dropped by the table, and are served
+      //from the compressed tier; then, with the tier off, forward and back again, read from the file
+      for(int idx_cache = 0; idx_cache < 2 && nbr_layers > 1; idx_cache++)
+      {
+        if(idx_cache == 1)
+        {
+          cache_set_limit(0);
+          for(int idx_lyr = 0; idx_lyr < nbr_layers; idx_lyr++)
+          {
+            QMetaObject::invokeMethod(child, "next_layer", Qt::DirectConnection, Q_ARG(int, 0));
+            IoScheduler::instance()->wait_idle();
+            QCoreApplication::sendPostedEvents();
+          }
+        }
+        else
+        {
+          cache_stats_t cache = cache_stats();
+          ratio_cache.push_back(cache.ratio());
+        }
+        timer.start();
+        for(int idx_lyr = 0; idx_lyr < nbr_layers; idx_lyr++)
+        {
+          QMetaObject::invokeMethod(child, "previous_layer", Qt::DirectConnection, Q_ARG(int, 0));
+          IoScheduler::instance()->wait_idle();
+          QCoreApplication::sendPostedEvents();
+          for(int idx_row = 0; idx_row < std::min(nbr_rows, 50); idx_row++)
+          {
+            for(int idx_col = 0; idx_col < std::min(nbr_cols, 20); idx_col++)
+            {
+              nbr_chars += model->data(model->index(idx_row, idx_col)).toString().size();
+            }
+          }
+        }
+        (idx_cache == 0 ? time_layer_back_cache : time_layer_back).push_back(timer.nsecsElapsed() / 1.0e6 / nbr_layers);
+      }
+      cache_set_limit(cache_default_limit);
+      delete child;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //diff statistics of the variable against itself, read through the I/O thread as in the GUI
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(diff_type(item_data->m_ncdata->m_nc_type))
+    {
+      std::shared_ptr<slab_source_t> source = make_slab_source(item_data);
+      std::atomic<bool> cancel(false);
+      diff_stats_t stats;
+      timer.start();
+      diff_stream(source.get(), source.get(), 0, [](const std::function<void()> &job)
+      {
+        IoScheduler::instance()->execute(job, io_background);
+      }, cancel, std::function<void(const diff_stats_t&, double)>(), &stats);
+      double sec = timer.nsecsElapsed() / 1.0e9;
+      if(sec > 0)
+      {
+        rate_diff.push_back(2.0 * buf_sz * get_type_size(item_data->m_ncdata->m_nc_type) / (1024.0 * 1024.0) / sec);
+      }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //derived variable of the variable, read whole through the I/O thread
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(diff_type(item_data->m_ncdata->m_nc_type))
+    {
+      std::shared_ptr<expr_t> expr(new expr_t);
+      std::string error;
+      std::vector<expr_operand_t> operands(1);
+      operands[0].m_source = make_slab_source(item_data);
+      for(size_t idx_dmn = 0; idx_dmn < item_data->m_ncdata->m_dim.size(); idx_dmn++)
+      {
+        operands[0].m_dim_nm.push_back(std::to_string(idx_dmn));
+      }
+      expr->parse("sqrt(abs(v)) * 2 + v * v - 1", &error);
+      if(expr->bind(operands, &error) == NC_NOERR)
+      {
+        expr_slab_source_t source(expr);
+        const std::vector<size_t> &dim = source.dim();
+        timer.start();
+        IoScheduler::instance()->execute([&source, &dim]()
+        {
+          source.read(std::vector<size_t>(dim.size(), 0), dim);
+        }, io_background);
+        double sec = timer.nsecsElapsed() / 1.0e9;
+        if(sec > 0)
+        {
+          rate_expr.push_back(buf_sz * sizeof(double) / (1024.0 * 1024.0) / sec);
+        }
+      }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //mean along the first dimension, read through the I/O thread as in the GUI
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(diff_type(item_data->m_ncdata->m_nc_type) && !item_data->m_ncdata->m_dim.empty())
+    {
+      std::shared_ptr<slab_source_t> source = make_slab_source(item_data);
+      std::atomic<bool> cancel(false);
+      std::vector<double> result;
+      timer.start();
+      reduce_stream(source.get(), 0, reduce_mean, [](const std::function<void()> &job)
+      {
+        IoScheduler::instance()->execute(job, io_background);
+      }, cancel, std::function<void(double)>(), &result);
+      double sec = timer.nsecsElapsed() / 1.0e9;
+      if(sec > 0)
+      {
+        rate_reduce.push_back(buf_sz * get_type_size(item_data->m_ncdata->m_nc_type) / (1024.0 * 1024.0) / sec);
+      }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //whole variable read on the I/O thread by netCDF, then by parallel chunk decompression;
+    //the file is closed before each read so that no chunk cache is warm
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(file.m_netcdf4 && file.m_deflate && item_data->m_ncdata->m_nc_type != NC_STRING)
+    {
+      const std::vector<size_t> &dim = item_data->m_ncdata->m_dim;
+      nc_slab_source_t source(item_data->m_file_name, item_data->m_grp_nm_fll, item_data->m_item_nm,
+        item_data->m_ncdata->m_nc_type, dim);
+      for(int idx_par = 0; idx_par < 2; idx_par++)
+      {
+        size_t bytes = 0;
+        chunk_set_parallel(idx_par == 1);
+        timer.start();
+        IoScheduler::instance()->execute([&source, &dim, &file, &bytes]()
+        {
+          io_close(file.m_file_name);
+          bytes = source.read(std::vector<size_t>(dim.size(), 0), dim).size();
+        }, io_background);
+        double sec = timer.nsecsElapsed() / 1.0e9;
+        if(sec > 0 && bytes > 0)
+        {
+          (idx_par == 1 ? rate_chunk_parallel : rate_chunk_netcdf).push_back(bytes / (1024.0 * 1024.0) / sec);
+        }
+      }
+      chunk_set_parallel(true);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //scaling of the reader processes: whole variable read and mean along the first dimension,
+    //in this process (1), then split among 2, 4... processes up to one per core; the chunks are
+    //decompressed by netCDF, so that the curve is of the processes only
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(file.m_shape == "grid")
+    {
+      const std::vector<size_t> &dim = item_data->m_ncdata->m_dim;
+      std::shared_ptr<slab_source_t> source = make_slab_source(item_data);
+      int nbr_max = std::max(2, QThread::idealThreadCount());
+      std::vector<int> nbr_proc(1, 1);
+      while(nbr_proc.back() < nbr_max)
+      {
+        nbr_proc.push_back(std::min(nbr_proc.back() * 2, nbr_max));
+      }
+      chunk_set_parallel(false);
+      for(size_t idx_prc = 0; idx_prc < nbr_proc.size(); idx_prc++)
+      {
+        int nbr = nbr_proc[idx_prc];
+        reader_set_processes(nbr > 1 ? nbr : 0);
+        size_t bytes = 0;
+        timer.start();
+        IoScheduler::instance()->execute([&source, &dim, &file, &bytes]()
+        {
+          io_close(file.m_file_name);
+          bytes = source->read(std::vector<size_t>(dim.size(), 0), dim).size();
+        }, io_background);
+        double sec = timer.nsecsElapsed() / 1.0e9;
+        if(sec > 0 && bytes > 0)
+        {
+          rate_reader_read[nbr].push_back(bytes / (1024.0 * 1024.0) / sec);
+        }
+
+        std::atomic<bool> cancel(false);
+        std::vector<double> result;
+        timer.start();
+        int status = reduce_stream(source.get(), 0, reduce_mean, [](const std::function<void()> &job)
+        {
+          IoScheduler::instance()->execute(job, io_background);
+        }, cancel, std::function<void(double)>(), &result);
+        sec = timer.nsecsElapsed() / 1.0e9;
+        if(status == NC_NOERR && sec > 0)
+        {
+          rate_reader_reduce[nbr].push_back(buf_sz * get_type_size(item_data->m_ncdata->m_nc_type) / (1024.0 * 1024.0) / sec);
+        }
+      }
+      reader_set_processes(0);
+      chunk_set_parallel(true);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //overview pyramid of a grid, to a sidecar of its own removed after
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(diff_type(item_data->m_ncdata->m_nc_type) && item_data->m_ncdata->m_dim.size() >= 2)
+    {
+      std::shared_ptr<slab_source_t> source = make_slab_source(item_data);
+      std::string key = pyramid_key(item_data->m_file_name, item_data->m_grp_nm_fll, item_data->m_item_nm) + "\nbench";
+      std::atomic<bool> cancel(false);
+      timer.start();
+      int status = pyramid_build(source.get(), key, [](const std::function<void()> &job)
+      {
+        IoScheduler::instance()->execute(job, io_background);
+      }, cancel, std::function<void(double)>());
+      double sec = timer.nsecsElapsed() / 1.0e9;
+      if(status == NC_NOERR && sec > 0)
+      {
+        rate_pyramid.push_back(buf_sz * get_type_size(item_data->m_ncdata->m_nc_type) / (1024.0 * 1024.0) / sec);
+      }
+      QFile::remove(QString::fromUtf8(pyramid_path(key).c_str()));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //layers of the first dimension from a server on localhost, served by the event loop of this
+    //thread; the client on the I/O thread sends all the requests before reading the replies
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(!item_data->m_ncdata->m_dim.empty() && item_data->m_ncdata->m_nc_type != NC_STRING)
+    {
+      RemoteServer server;
+      if(server.listen(0))
+      {
+        std::string url = "ncx://localhost:" + std::to_string(server.port())
+          + QFileInfo(QString::fromUtf8(file.m_file_name.c_str())).absoluteFilePath().toStdString();
+        const std::vector<size_t> &dim = item_data->m_ncdata->m_dim;
+        remote_slab_source_t source(url, item_data->m_grp_nm_fll, item_data->m_item_nm, item_data->m_ncdata->m_nc_type, dim);
+        for(int idx_cmp = 0; idx_cmp < 2; idx_cmp++)
+        {
+          double bytes = 0;
+          double bytes_wire = 0;
+          bool done = false;
+          remote_set_compress(idx_cmp == 1);
+          timer.start();
+          IoScheduler::instance()->run_job([&source, &dim, &url, &bytes, &bytes_wire]()
+          {
+            remote_connection_t *connection = remote_connection(url);
+            std::vector<unsigned int> ids;
+            std::vector<size_t> start(dim.size(), 0);
+            std::vector<size_t> count(dim);
+            count[0] = 1;
+            for(size_t idx_rec = 0; idx_rec < dim[0]; idx_rec++)
+            {
+              start[0] = idx_rec;
+              ids.push_back(connection->send(remote_slab, source.slab_request(start, count)));
+            }
+            for(size_t idx = 0; idx < ids.size(); idx++)
+            {
+              QByteArray reply;
+              if(connection->receive(ids[idx], &reply) == NC_NOERR)
+              {
+                bytes += reply.size();
+              }
+            }
+            bytes_wire = connection->bytes_received();
+            remote_close_all();
+          }, io_background, NULL, [&done](io_request_t *)
+          {
+            done = true;
+          });
+          while(!done)
+          {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+          }
+          double sec = timer.nsecsElapsed() / 1.0e9;
+          if(sec > 0 && bytes > 0)
+          {
+            (idx_cmp == 1 ? rate_remote_zlib : rate_remote).push_back(bytes / (1024.0 * 1024.0) / sec);
+          }
+          if(idx_cmp == 1 && bytes > 0)
+          {
+            ratio_remote_zlib.push_back(bytes_wire / bytes);
+          }
+        }
+        remote_set_compress(true);
+      }
+    }
+
+    delete tree_model;
+  }
+
+  add_result(file, "nc_open", time_open, "ms");
+  add_result(file, "meta_scan", time_scan, "ms");
+  add_result(file, "tree_build_meta", time_tree_meta, "ms");
+  add_result(file, "tree_bytes_meta", bytes_tree_meta, "MB");
+  add_result(file, "index_query", time_index_query, "ms");
+  add_result(file, "read_file", time_read_file, "ms");
+  add_result(file, "load_variable", time_load_variable, "ms");
+  add_result(file, "load_item", time_load_item, "ms");
+  add_result(file, "TableModel::data", time_data, "ns/cell");
+  add_result(file, "TableModel::headerData", time_header, "ns/cell");
+  add_result(file, "table_frame_qtableview", time_frame_view, "ms");
+  add_result(file, "table_frame_direct", time_frame_direct, "ms");
+  add_result(file, "child_window_open", time_child_open, "ms");
+  add_result(file, "layer_switch", time_layer, "ms");
+  add_result(file, "layer_switch_io", time_layer_io, "ms");
+  add_result(file, "layer_switch_back", time_layer_back, "ms");
+  add_result(file, "layer_switch_back_cache", time_layer_back_cache, "ms");
+  add_result(file, "cache_ratio", ratio_cache, "ratio");
+  add_result(file, "diff_stream", rate_diff, "MB/s");
+  add_result(file, "expr_eval", rate_expr, "MB/s");
+  add_result(file, "reduce_stream", rate_reduce, "MB/s");
+  add_result(file, "chunk_read_netcdf", rate_chunk_netcdf, "MB/s");
+  add_result(file, "chunk_read_parallel", rate_chunk_parallel, "MB/s");
+  for(std::map<int, std::vector<double> >::iterator it = rate_reader_read.begin(); it != rate_reader_read.end(); ++it)
+  {
+    add_result(file, "reader_read_" + std::to_string(it->first) + "p", it->second, "MB/s");
+  }
+  for(std::map<int, std::vector<double> >::iterator it = rate_reader_reduce.begin(); it != rate_reader_reduce.end(); ++it)
+  {
+    add_result(file, "reader_reduce_" + std::to_string(it->first) + "p", it->second, "MB/s");
+  }
+  add_result(file, "pyramid_build", rate_pyramid, "MB/s");
+  add_result(file, "sort_index", time_sort, "ms");
+  add_result(file, "remote_slab", rate_remote, "MB/s");
+  add_result(file, "remote_slab_zlib", rate_remote_zlib, "MB/s");
+  add_result(file, "remote_zlib_wire", ratio_remote_zlib, "ratio");
+
+  //buffer pool over all the repeats of this file
+  pool_stats_t pool_end = pool_stats();
+  size_t nbr_request = pool_end.m_nbr_request - pool_start.m_nbr_request;
+  if(nbr_request > 0)
+  {
+    add_result(file, "pool_hit_rate", std::vector<double>(1, (double)(pool_end.m_nbr_hit - pool_start.m_nbr_hit) / nbr_request), "ratio");
+    add_result(file, "pool_bytes_held", std::vector<double>(1, pool_end.m_bytes_held / (1024.0 * 1024.0)), "MB");
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//write_json
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void write_json(FILE *fp)
+{
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"netcdf\": \"%s\",\n", QString(nc_inq_libvers()).split(' ').at(0).toLatin1().data());
+  fprintf(fp, "  \"qt\": \"%s\",\n", qVersion());
+  fprintf(fp, "  \"repeat\": %d,\n", nbr_repeat);
+  fprintf(fp, "  \"results\": [\n");
+  for(size_t idx = 0; idx < results.size(); idx++)
+  {
+    const bench_result_t &res = results[idx];
+    fprintf(fp, "    {\"file\": \"%s\", \"shape\": \"%s\", \"format\": \"%s\", \"layout\": \"%s\", \"deflate\": %s, \"size_mb\": %zu, "
+      "\"metric\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}%s\n",
+      res.m_file.name().c_str(),
+      res.m_file.m_shape.c_str(),
+      res.m_file.m_netcdf4 ? "netcdf4" : "classic",
+      res.m_file.m_chunked ? "chunked" : "contiguous",
+      res.m_file.m_deflate ? "true" : "false",
+      res.m_file.m_size_mb,
+      res.m_metric.c_str(),
+      res.m_value,
+      res.m_unit.c_str(),
+      idx + 1 < results.size() ? "," : "");
+  }
+  fprintf(fp, "  ]\n");
+  fprintf(fp, "}\n");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//main
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+  Q_INIT_RESOURCE(netcdf_explorer);
+
+  //the reader processes of the scaling runs are this binary
+  if(argc == 2 && strcmp(argv[1], "--reader") == 0)
+  {
+    return reader_serve();
+  }
+
+  //the table models need widgets, but not a display
+  if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+  QCoreApplication::setApplicationName("netcdf-bench");
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  parser.addOption(QCommandLineOption("dir", "Directory for the generated files.", "dir", QDir::tempPath()));
+  parser.addOption(QCommandLineOption("sizes", "Comma separated sizes in MB of the grid and strings variables.", "sizes", "1,16,128"));
+  parser.addOption(QCommandLineOption("shapes", "Comma separated shapes: grid, groups, attributes, strings.", "shapes", "grid,groups,attributes"));
+  parser.addOption(QCommandLineOption("repeat", "Number of repeats; the minimum is reported.", "repeat", "3"));
+  parser.addOption(QCommandLineOption("max-load-mb", "Do not load or display variables larger than this.", "mb", "2048"));
+  parser.addOption(QCommandLineOption("output", "JSON output file (default stdout).", "file"));
+  parser.addOption(QCommandLineOption("keep", "Keep the generated files."));
+  parser.process(app);
+
+  nbr_repeat = std::max(1, parser.value("repeat").toInt());
+  size_t max_load_mb = parser.value("max-load-mb").toULongLong();
+  QStringList sizes = parser.value("sizes").split(',');
+  QStringList shapes = parser.value("shapes").split(',');
+  QDir dir(parser.value("dir"));
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //file matrix: classic vs netCDF4, contiguous vs chunked, deflated vs raw
+  //chunking and deflate are netCDF-4 only; groups and strings are netCDF-4 only
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  std::vector<bench_file_t> files;
+  for(int idx_shp = 0; idx_shp < shapes.size(); idx_shp++)
+  {
+    std::string shape = shapes.at(idx_shp).trimmed().toLatin1().data();
+    if(shape == "grid")
+    {
+      for(int idx_sz = 0; idx_sz < sizes.size(); idx_sz++)
+      {
+        size_t size_mb = sizes.at(idx_sz).toULongLong();
+        files.push_back(bench_file_t(shape, false, false, false, size_mb));
+        files.push_back(bench_file_t(shape, true, false, false, size_mb));
+        files.push_back(bench_file_t(shape, true, true, false, size_mb));
+        files.push_back(bench_file_t(shape, true, true, true, size_mb));
+      }
+    }
+    else if(shape == "groups")
+    {
+      files.push_back(bench_file_t(shape, true, false, false, 0));
+    }
+    else if(shape == "strings")
+    {
+      //NC_STRING is netCDF-4 only
+      for(int idx_sz = 0; idx_sz < sizes.size(); idx_sz++)
+      {
+        files.push_back(bench_file_t(shape, true, false, false, sizes.at(idx_sz).toULongLong()));
+      }
+    }
+    else if(shape == "attributes")
+    {
+      files.push_back(bench_file_t(shape, false, false, false, 0));
+      files.push_back(bench_file_t(shape, true, false, false, 0));
+    }
+    else
+    {
+      fprintf(stderr, "unknown shape %s\n", shape.c_str());
+      return 1;
+    }
+  }
+
+  MainWindow window;
+  for(size_t idx_fl = 0; idx_fl < files.size(); idx_fl++)
+  {
+    bench_file_t &file = files[idx_fl];
+    file.m_file_name = dir.absoluteFilePath(QString(file.name().c_str()) + ".nc").toLatin1().data();
+    QElapsedTimer timer;
+    timer.start();
+    generate(file);
+    fprintf(stderr, "generated %s in %.1f s\n", file.m_file_name.c_str(), timer.elapsed() / 1000.0);
+    run(file, &window, max_load_mb);
+    if(!parser.isSet("keep"))
+    {
+      QFile::remove(file.m_file_name.c_str());
+    }
+  }
+
+  FILE *fp = stdout;
+  if(parser.isSet("output"))
+  {
+    fp = fopen(parser.value("output").toLatin1().data(), "w");
+    if(fp == NULL)
+    {
+      fprintf(stderr, "cannot write %s\n", parser.value("output").toLatin1().data());
+      return 1;
+    }
+  }
+  write_json(fp);
+  if(fp != stdout)
+  {
+    fclose(fp);
+  }
+  IoScheduler::instance()->stop();
+  return 0;
+}
@@ -0,0 +1,42 @@
+TARGET = "netcdf-bench"
+QT += network
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+CONFIG += c++11 console
+CONFIG -= app_bundle
+DEFINES += NETCDF_EXPLORER_NO_MAIN
+HEADERS = netcdf_explorer.hpp netcdf_trace.hpp netcdf_string.hpp netcdf_buffer.hpp netcdf_io.hpp netcdf_meta.hpp netcdf_index.hpp netcdf_series.hpp netcdf_diff.hpp netcdf_expr.hpp netcdf_reduce.hpp netcdf_pyramid.hpp netcdf_sort.hpp netcdf_layout.hpp netcdf_remote.hpp netcdf_time.hpp netcdf_subset.hpp netcdf_chunk.hpp netcdf_reader.hpp netcdf_cache.hpp
+SOURCES = netcdf_bench.cpp netcdf_explorer.cpp netcdf_cli.cpp netcdf_trace.cpp netcdf_string.cpp netcdf_buffer.cpp netcdf_io.cpp netcdf_meta.cpp netcdf_index.cpp netcdf_series.cpp netcdf_diff.cpp netcdf_expr.cpp netcdf_reduce.cpp netcdf_pyramid.cpp netcdf_sort.cpp netcdf_layout.cpp netcdf_remote.cpp netcdf_time.cpp netcdf_subset.cpp netcdf_chunk.cpp netcdf_reader.cpp netcdf_cache.cpp
+RESOURCES = netcdf_explorer.qrc
+
+unix:!macx {
+ LIBS +=  -lnetcdf
+}
+
+#parallel decompression of chunks: qmake CONFIG+=hdf5 [CONFIG+=zstd]
+hdf5 {
+ DEFINES += HAVE_HDF5
+ unix:!macx {
+  LIBS += -lhdf5 -lz
+ }
+}
+
+zstd {
+ DEFINES += HAVE_ZSTD
+ LIBS += -lzstd
+}
+
+macx: {
+ INCLUDEPATH += /usr/local/include
+ LIBS += /usr/local/lib/libnetcdf.a
+ LIBS += /usr/local/lib/libhdf5.a
+ LIBS += /usr/local/lib/libhdf5_hl.a
+ LIBS += /usr/local/lib/libsz.a
+ LIBS += -lcurl -lz
+}
+
+win32 {
+ DEFINES += _CRT_SECURE_NO_WARNINGS
+ DEFINES += _CRT_NONSTDC_NO_DEPRECATE
+ INCLUDEPATH += 
+ LIBS += 
+}
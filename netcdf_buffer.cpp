@@ -0,0 +1,256 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QMutex>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "netcdf_buffer.hpp"
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+//alignment of all buffers
+static const size_t line_sz = 64;
+//size and alignment of large buffers
+static const size_t huge_sz = 2 * 1024 * 1024;
+//smallest size class 2^6, largest power of two class 2^20
+static const int min_class = 6;
+static const int max_class = 20;
+//a large buffer may be reused for a request down to 3/4 of its size
+static const size_t large_slack = 4;
+
+static QMutex mutex;
+static std::vector<void*> free_small[max_class + 1];
+static std::multimap<size_t, void*> free_large;
+static pool_stats_t stats;
+static size_t bytes_limit = 256 * 1024 * 1024;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sys_alloc
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* sys_alloc(size_t cap, size_t align)
+{
+  void *ptr = NULL;
+#if defined(_WIN32)
+  ptr = _aligned_malloc(cap, align);
+#else
+  if(posix_memalign(&ptr, align, cap) != 0)
+  {
+    return NULL;
+  }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if(align == huge_sz)
+  {
+    madvise(ptr, cap, MADV_HUGEPAGE);
+  }
+#endif
+#endif
+  return ptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sys_free
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void sys_free(void *ptr)
+{
+#if defined(_WIN32)
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_class
+//size class of a small size, the smallest power of two not less than size
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int get_class(size_t size)
+{
+  int cls = min_class;
+  while(((size_t)1 << cls) < size)
+  {
+    cls++;
+  }
+  return cls;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pool_alloc
+//returns a buffer of at least size bytes (at least one byte), and its capacity in cap
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* pool_alloc(size_t size, size_t *cap)
+{
+  void *ptr = NULL;
+  QMutexLocker locker(&mutex);
+  stats.m_nbr_request++;
+
+  if(size <= ((size_t)1 << max_class))
+  {
+    int cls = get_class(size);
+    *cap = (size_t)1 << cls;
+    if(!free_small[cls].empty())
+    {
+      ptr = free_small[cls].back();
+      free_small[cls].pop_back();
+    }
+  }
+  else
+  {
+    *cap = (size + huge_sz - 1) / huge_sz * huge_sz;
+    std::multimap<size_t, void*>::iterator it = free_large.lower_bound(*cap);
+    if(it != free_large.end() && it->first - *cap <= it->first / large_slack)
+    {
+      *cap = it->first;
+      ptr = it->second;
+      free_large.erase(it);
+    }
+  }
+
+  if(ptr != NULL)
+  {
+    stats.m_nbr_hit++;
+    stats.m_bytes_held -= *cap;
+  }
+  else
+  {
+    locker.unlock();
+    ptr = sys_alloc(*cap, *cap >= huge_sz ? huge_sz : line_sz);
+    locker.relock();
+    if(ptr == NULL)
+    {
+      *cap = 0;
+      return NULL;
+    }
+  }
+  stats.m_bytes_used += *cap;
+  return ptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pool_free
+//keeps the buffer in its free list while the bytes held are under the limit
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pool_free(void *ptr, size_t cap)
+{
+  if(ptr == NULL)
+  {
+    return;
+  }
+  QMutexLocker locker(&mutex);
+  stats.m_bytes_used -= cap;
+  if(stats.m_bytes_held + cap <= bytes_limit)
+  {
+    stats.m_bytes_held += cap;
+    if(cap <= ((size_t)1 << max_class))
+    {
+      free_small[get_class(cap)].push_back(ptr);
+    }
+    else
+    {
+      free_large.insert(std::make_pair(cap, ptr));
+    }
+    return;
+  }
+  locker.unlock();
+  sys_free(ptr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pool_stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+pool_stats_t pool_stats()
+{
+  QMutexLocker locker(&mutex);
+  pool_stats_t sts = stats;
+  sts.m_bytes_limit = bytes_limit;
+  return sts;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pool_set_limit
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pool_set_limit(size_t bytes)
+{
+  {
+    QMutexLocker locker(&mutex);
+    bytes_limit = bytes;
+  }
+  if(pool_stats().m_bytes_held > bytes)
+  {
+    pool_trim();
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pool_trim
+//returns all the held buffers to the system
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pool_trim()
+{
+  std::vector<void*> ptrs;
+  {
+    QMutexLocker locker(&mutex);
+    for(int cls = min_class; cls <= max_class; cls++)
+    {
+      ptrs.insert(ptrs.end(), free_small[cls].begin(), free_small[cls].end());
+      free_small[cls].clear();
+    }
+    for(std::multimap<size_t, void*>::iterator it = free_large.begin(); it != free_large.end(); ++it)
+    {
+      ptrs.push_back(it->second);
+    }
+    free_large.clear();
+    stats.m_bytes_held = 0;
+  }
+  for(size_t idx = 0; idx < ptrs.size(); idx++)
+  {
+    sys_free(ptrs[idx]);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//buffer_t::resize
+//keeps the contents up to the smaller size; grows in place while within the size class
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void buffer_t::resize(size_t size)
+{
+  if(m_ptr != NULL && size <= m_cap)
+  {
+    m_size = size;
+    return;
+  }
+  size_t cap;
+  void *ptr = pool_alloc(size, &cap);
+  if(ptr != NULL && m_ptr != NULL)
+  {
+    memcpy(ptr, m_ptr, std::min(m_size, size));
+  }
+  reset();
+  m_ptr = ptr;
+  m_size = ptr ? size : 0;
+  m_cap = cap;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//buffer_t::reset
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void buffer_t::reset()
+{
+  pool_free(m_ptr, m_cap);
+  m_ptr = NULL;
+  m_size = 0;
+  m_cap = 0;
+}
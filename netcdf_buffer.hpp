@@ -0,0 +1,121 @@
+#ifndef NETCDF_BUFFER_H
+#define NETCDF_BUFFER_H
+
+#include <cstddef>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//buffer pool
+//data buffers come from size classes, so that closing and opening layers reuses memory
+//small sizes are powers of two from 64 bytes; from 2 MB sizes are multiples of 2 MB, aligned to 2 MB
+//and advised for transparent huge pages; all buffers are 64 byte aligned (one cache line, AVX-512)
+//freed buffers are kept up to a limit of bytes held, then returned to the system
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class pool_stats_t
+{
+public:
+  pool_stats_t() :
+    m_nbr_request(0),
+    m_nbr_hit(0),
+    m_bytes_held(0),
+    m_bytes_used(0),
+    m_bytes_limit(0)
+  {
+  }
+  double hit_rate() const
+  {
+    return m_nbr_request ? (double)m_nbr_hit / m_nbr_request : 0.0;
+  }
+  size_t m_nbr_request; // allocations
+  size_t m_nbr_hit; // allocations served from a free list
+  size_t m_bytes_held; // bytes in free lists
+  size_t m_bytes_used; // bytes in buffers in use
+  size_t m_bytes_limit; // maximum bytes held
+};
+
+void* pool_alloc(size_t size, size_t *cap);
+void pool_free(void *ptr, size_t cap);
+pool_stats_t pool_stats();
+void pool_set_limit(size_t bytes);
+void pool_trim();
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//buffer_t
+//typed view of one pooled buffer; movable, not copyable, returned to the pool at destruction
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class buffer_t
+{
+public:
+  buffer_t() :
+    m_ptr(NULL),
+    m_size(0),
+    m_cap(0)
+  {
+  }
+  explicit buffer_t(size_t size)
+  {
+    m_ptr = pool_alloc(size, &m_cap);
+    m_size = m_ptr ? size : 0;
+  }
+  buffer_t(buffer_t &&buf) :
+    m_ptr(buf.m_ptr),
+    m_size(buf.m_size),
+    m_cap(buf.m_cap)
+  {
+    buf.m_ptr = NULL;
+    buf.m_size = 0;
+    buf.m_cap = 0;
+  }
+  buffer_t& operator=(buffer_t &&buf)
+  {
+    if(this != &buf)
+    {
+      reset();
+      m_ptr = buf.m_ptr;
+      m_size = buf.m_size;
+      m_cap = buf.m_cap;
+      buf.m_ptr = NULL;
+      buf.m_size = 0;
+      buf.m_cap = 0;
+    }
+    return *this;
+  }
+  ~buffer_t()
+  {
+    reset();
+  }
+  buffer_t(const buffer_t&) = delete;
+  buffer_t& operator=(const buffer_t&) = delete;
+
+  void* data() const
+  {
+    return m_ptr;
+  }
+  template <typename T>
+  T* as() const
+  {
+    return static_cast<T*> (m_ptr);
+  }
+  size_t size() const
+  {
+    return m_size;
+  }
+  size_t capacity() const
+  {
+    return m_cap;
+  }
+  bool empty() const
+  {
+    return m_ptr == NULL;
+  }
+  void resize(size_t size);
+  void reset();
+
+private:
+  void *m_ptr;
+  size_t m_size; // bytes requested
+  size_t m_cap; // bytes of the size class
+};
+
+#endif
@@ -0,0 +1,430 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QByteArray>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "netcdf_cache.hpp"
+#include "netcdf_trace.hpp"
+
+class cache_entry_t
+{
+public:
+  cache_entry_t() :
+    m_nc_typ(NC_NAT),
+    m_size(0),
+    m_seq(0)
+  {
+  }
+  buffer_t m_buf; // decoded bytes while queued for compression
+  QByteArray m_data; // compressed bytes once compressed; both empty while being compressed
+  nc_type m_nc_typ;
+  size_t m_size; // decoded bytes
+  size_t m_seq; // put number, to tell a slab put again while it was compressed
+  std::list<std::string>::iterator m_order;
+};
+
+static std::mutex mutex;
+static std::map<std::string, cache_entry_t> entries;
+static std::list<std::string> order; // keys, oldest first
+static std::deque<std::string> queue; // keys to compress
+static size_t bytes_queued = 0; // decoded bytes of the queued slabs
+static size_t nbr_seq = 0;
+static std::thread worker;
+static bool worker_running = false;
+static cache_stats_t stats;
+static size_t bytes_limit = cache_default_limit;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_elem_size
+//size of an element of the types held, 0 for others
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t get_elem_size(nc_type nc_typ)
+{
+  switch(nc_typ)
+  {
+  case NC_BYTE:
+  case NC_UBYTE:
+  case NC_CHAR:
+    return 1;
+  case NC_SHORT:
+  case NC_USHORT:
+    return 2;
+  case NC_INT:
+  case NC_UINT:
+  case NC_FLOAT:
+    return 4;
+  case NC_INT64:
+  case NC_UINT64:
+  case NC_DOUBLE:
+    return 8;
+  }
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//compress
+//byte i of every element to plane i, then zlib level 1; the high bytes of the elements of a smooth
+//field (sign, exponent, leading digits) are alike, and a plane of them compresses to little
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static QByteArray compress(const buffer_t &buf, size_t elem_sz)
+{
+  if(buf.size() > INT_MAX)
+  {
+    return QByteArray();
+  }
+  const unsigned char *src = buf.as<unsigned char>();
+  buffer_t shf;
+  if(elem_sz > 1)
+  {
+    shf = buffer_t(buf.size());
+    if(shf.empty())
+    {
+      return QByteArray();
+    }
+    size_t nbr = buf.size() / elem_sz;
+    unsigned char *dst = shf.as<unsigned char>();
+    for(size_t idx_byt = 0; idx_byt < elem_sz; idx_byt++)
+    {
+      unsigned char *plane = dst + idx_byt * nbr;
+      for(size_t idx = 0; idx < nbr; idx++)
+      {
+        plane[idx] = src[idx * elem_sz + idx_byt];
+      }
+    }
+    memcpy(dst + nbr * elem_sz, src + nbr * elem_sz, buf.size() - nbr * elem_sz);
+    src = dst;
+  }
+  return qCompress(src, (int)buf.size(), 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//decompress
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool decompress(const QByteArray &data, size_t size, size_t elem_sz, buffer_t *buf)
+{
+  QByteArray raw = qUncompress(data);
+  if((size_t)raw.size() != size)
+  {
+    return false;
+  }
+  *buf = buffer_t(size);
+  if(buf->empty())
+  {
+    return false;
+  }
+  const unsigned char *src = reinterpret_cast<const unsigned char*> (raw.constData());
+  unsigned char *dst = buf->as<unsigned char>();
+  if(elem_sz <= 1)
+  {
+    memcpy(dst, src, size);
+    return true;
+  }
+  size_t nbr = size / elem_sz;
+  for(size_t idx_byt = 0; idx_byt < elem_sz; idx_byt++)
+  {
+    const unsigned char *plane = src + idx_byt * nbr;
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      dst[idx * elem_sz + idx_byt] = plane[idx];
+    }
+  }
+  memcpy(dst + nbr * elem_sz, src + nbr * elem_sz, size - nbr * elem_sz);
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//erase_entry
+//with the mutex locked
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void erase_entry(std::map<std::string, cache_entry_t>::iterator it)
+{
+  cache_entry_t &entry = it->second;
+  if(!entry.m_buf.empty())
+  {
+    bytes_queued -= entry.m_size;
+  }
+  if(!entry.m_data.isEmpty())
+  {
+    stats.m_nbr_slab--;
+    stats.m_bytes_raw -= entry.m_size;
+    stats.m_bytes -= entry.m_data.size();
+  }
+  order.erase(entry.m_order);
+  entries.erase(it);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//evict
+//drops the oldest compressed slabs over the limit; with the mutex locked
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void evict()
+{
+  for(std::list<std::string>::iterator it = order.begin(); it != order.end() && stats.m_bytes > bytes_limit;)
+  {
+    std::map<std::string, cache_entry_t>::iterator it_ent = entries.find(*it++);
+    if(!it_ent->second.m_data.isEmpty())
+    {
+      erase_entry(it_ent);
+      stats.m_nbr_evict++;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//compress_queued
+//the background thread; compresses the queued slabs, then exits
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void compress_queued()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while(!queue.empty())
+  {
+    std::map<std::string, cache_entry_t>::iterator it = entries.find(queue.front());
+    queue.pop_front();
+    if(it == entries.end() || it->second.m_buf.empty())
+    {
+      continue;
+    }
+    std::string key = it->first;
+    buffer_t buf = std::move(it->second.m_buf);
+    size_t elem_sz = get_elem_size(it->second.m_nc_typ);
+    size_t seq = it->second.m_seq;
+    bytes_queued -= buf.size();
+    lock.unlock();
+
+    QByteArray data;
+    {
+      trace_t trace("cache_compress", NULL, buf.size());
+      data = compress(buf, elem_sz);
+    }
+    buf.reset();
+
+    lock.lock();
+    it = entries.find(key);
+    if(it == entries.end() || it->second.m_seq != seq)
+    {
+      continue;
+    }
+    if(data.isEmpty())
+    {
+      erase_entry(it);
+      continue;
+    }
+    it->second.m_data = data;
+    stats.m_nbr_put++;
+    stats.m_nbr_slab++;
+    stats.m_bytes_raw += it->second.m_size;
+    stats.m_bytes += data.size();
+    evict();
+  }
+  worker_running = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_set_limit
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void cache_set_limit(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bytes_limit = bytes;
+  evict();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+cache_stats_t cache_stats()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  cache_stats_t cache = stats;
+  cache.m_bytes_limit = bytes_limit;
+  return cache;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string cache_key(const std::string &source_key, const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  std::string key = source_key;
+  for(size_t idx_dmn = 0; idx_dmn < start.size(); idx_dmn++)
+  {
+    key += '\n' + std::to_string(start[idx_dmn]) + ',' + std::to_string(count[idx_dmn]);
+  }
+  return key;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_count_tile
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void cache_count_tile(bool hit)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(hit)
+  {
+    stats.m_nbr_tile_hit++;
+  }
+  else
+  {
+    stats.m_nbr_tile_miss++;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_put
+//a slab is queued while the queue holds less than the limit of decoded bytes, else dropped
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void cache_put(const std::string &key, nc_type nc_typ, buffer_t &&buf)
+{
+  if(buf.empty() || get_elem_size(nc_typ) == 0)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::string, cache_entry_t>::iterator it = entries.find(key);
+  if(it != entries.end())
+  {
+    erase_entry(it);
+  }
+  if(bytes_queued + buf.size() > bytes_limit)
+  {
+    return;
+  }
+  cache_entry_t &entry = entries[key];
+  entry.m_nc_typ = nc_typ;
+  entry.m_size = buf.size();
+  entry.m_seq = ++nbr_seq;
+  entry.m_buf = std::move(buf);
+  entry.m_order = order.insert(order.end(), key);
+  bytes_queued += entry.m_size;
+  queue.push_back(key);
+
+  if(!worker_running)
+  {
+    //a worker that ran has left the loop and does not lock again
+    if(worker.joinable())
+    {
+      worker.join();
+    }
+    worker_running = true;
+    worker = std::thread(compress_queued);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_has
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool cache_has(const std::string &key)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::string, cache_entry_t>::iterator it = entries.find(key);
+  return it != entries.end() && (!it->second.m_buf.empty() || !it->second.m_data.isEmpty());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_get
+//a slab being compressed is not held yet, and is read again from its source
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool cache_get(const std::string &key, buffer_t *buf)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  std::map<std::string, cache_entry_t>::iterator it = entries.find(key);
+  if(it == entries.end() || (it->second.m_buf.empty() && it->second.m_data.isEmpty()))
+  {
+    stats.m_nbr_miss++;
+    return false;
+  }
+  if(!it->second.m_buf.empty())
+  {
+    *buf = std::move(it->second.m_buf);
+    bytes_queued -= it->second.m_size;
+    erase_entry(it);
+    stats.m_nbr_hit++;
+    return true;
+  }
+  QByteArray data = it->second.m_data;
+  size_t size = it->second.m_size;
+  size_t elem_sz = get_elem_size(it->second.m_nc_typ);
+  erase_entry(it);
+  lock.unlock();
+
+  bool done;
+  {
+    trace_t trace("cache_decompress", NULL, size);
+    done = decompress(data, size, elem_sz, buf);
+  }
+  lock.lock();
+  if(done)
+  {
+    stats.m_nbr_hit++;
+  }
+  else
+  {
+    stats.m_nbr_miss++;
+    buf->reset();
+  }
+  return done;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_close
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void cache_close(const std::string &file_name)
+{
+  std::string prefix = file_name + '\n';
+  std::lock_guard<std::mutex> lock(mutex);
+  for(std::map<std::string, cache_entry_t>::iterator it = entries.begin(); it != entries.end();)
+  {
+    if(it->first.compare(0, prefix.size(), prefix) == 0)
+    {
+      erase_entry(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cache_close_all
+//drops all slabs and waits for the background thread
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void cache_close_all()
+{
+  std::thread done;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    while(!entries.empty())
+    {
+      erase_entry(entries.begin());
+    }
+    done = std::move(worker);
+  }
+  if(done.joinable())
+  {
+    done.join();
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef NETCDF_CACHE_H
+#define NETCDF_CACHE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//compressed slab cache
+//second tier behind the decoded tiles of the tables (first tier): the tiles of a layer a table drops
+//are handed here, compressed by a background thread (byte shuffle of elements of more than one byte,
+//then zlib at its fastest level) and held up to a limit of compressed bytes, oldest dropped first;
+//a slab read by the I/O thread is served from here when its box is held, decompressed on that thread,
+//and leaves this tier for the first one; NC_STRING and user types are not held
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//compressed bytes held by default
+static const size_t cache_default_limit = (size_t)128 << 20;
+
+class cache_stats_t
+{
+public:
+  cache_stats_t() :
+    m_nbr_tile_hit(0),
+    m_nbr_tile_miss(0),
+    m_nbr_hit(0),
+    m_nbr_miss(0),
+    m_nbr_put(0),
+    m_nbr_evict(0),
+    m_nbr_slab(0),
+    m_bytes_raw(0),
+    m_bytes(0),
+    m_bytes_limit(0)
+  {
+  }
+  double tile_hit_rate() const
+  {
+    return m_nbr_tile_hit + m_nbr_tile_miss ? (double)m_nbr_tile_hit / (m_nbr_tile_hit + m_nbr_tile_miss) : 0.0;
+  }
+  double hit_rate() const
+  {
+    return m_nbr_hit + m_nbr_miss ? (double)m_nbr_hit / (m_nbr_hit + m_nbr_miss) : 0.0;
+  }
+  double ratio() const
+  {
+    return m_bytes ? (double)m_bytes_raw / m_bytes : 0.0;
+  }
+  size_t m_nbr_tile_hit; // tile requests of tables served by their decoded tiles (first tier)
+  size_t m_nbr_tile_miss; // tile requests of tables sent to the I/O thread
+  size_t m_nbr_hit; // slab reads served compressed (second tier)
+  size_t m_nbr_miss; // slab reads from their source
+  size_t m_nbr_put; // slabs compressed
+  size_t m_nbr_evict; // compressed slabs dropped for the limit
+  size_t m_nbr_slab; // slabs held compressed
+  size_t m_bytes_raw; // decoded bytes of the slabs held compressed
+  size_t m_bytes; // compressed bytes held
+  size_t m_bytes_limit; // maximum compressed bytes held
+};
+
+//0 holds nothing
+void cache_set_limit(size_t bytes);
+cache_stats_t cache_stats();
+
+//key of the box start/count of a slab source of key source_key
+std::string cache_key(const std::string &source_key, const std::vector<size_t> &start, const std::vector<size_t> &count);
+
+//a tile request of a table, for the stats of the first tier
+void cache_count_tile(bool hit);
+
+//hands a decoded slab to the tier; it is compressed in the background
+void cache_put(const std::string &key, nc_type nc_typ, buffer_t &&buf);
+
+//true if the slab is held (compressed or still queued), without taking it
+bool cache_has(const std::string &key);
+
+//takes the slab out of the tier, decompressed into buf; false if it is not held
+bool cache_get(const std::string &key, buffer_t *buf);
+
+//drops the slabs of the sources of a file (keys that start with its name and a newline), when it was
+//rewritten; records appended leave the slabs held as they are
+void cache_close(const std::string &file_name);
+void cache_close_all();
+
+#endif
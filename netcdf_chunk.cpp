@@ -0,0 +1,585 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#ifdef HAVE_HDF5
+#include <hdf5.h>
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "netcdf_chunk.hpp"
+#include "netcdf_trace.hpp"
+
+static std::atomic<bool> chunk_parallel(true);
+static std::mutex stats_mutex;
+static chunk_stats_t stats;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//chunk_set_parallel
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void chunk_set_parallel(bool parallel)
+{
+  chunk_parallel = parallel;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//chunk_stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+chunk_stats_t chunk_stats()
+{
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  return stats;
+}
+
+#ifdef HAVE_HDF5
+
+//registered ID of the zstd filter
+static const unsigned int chunk_filter_zstd = 32015;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//chunk_var_t
+//what the reads of a variable need from its dataset; m_dset is negative if it is not a dataset of an
+//HDF5 file (netCDF-3 files, variables renamed by netCDF-4)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class chunk_var_t
+{
+public:
+  chunk_var_t() :
+    m_dset(-1),
+    m_filtered(false),
+    m_usable(false),
+    m_type_sz(0)
+  {
+  }
+  hid_t m_dset;
+  bool m_filtered; // chunked with filters
+  bool m_usable; // filters known, type in the byte order of the machine
+  size_t m_type_sz;
+  std::vector<size_t> m_chunk;
+  std::vector<unsigned int> m_filter; // in the order they were applied at writing
+  std::vector<char> m_fill; // one element
+};
+
+//chunk_slot_t::m_state
+enum chunk_state_t
+{
+  chunk_pending,
+  chunk_stored,
+  chunk_missing // never written, reads as the fill value
+};
+
+class chunk_slot_t
+{
+public:
+  chunk_slot_t() :
+    m_state(chunk_pending),
+    m_mask(0)
+  {
+  }
+  int m_state; // chunk_state_t
+  unsigned int m_mask; // filters skipped at writing
+  std::vector<char> m_raw;
+};
+
+//used on the I/O thread only
+static std::map<std::string, hid_t> h5_files;
+static std::map<std::string, chunk_var_t> h5_vars; // by file, group and variable name
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//h5_open
+//HDF5 ID of a file, opened on first use; negative, and kept so, if it is not an HDF5 file
+//netCDF has the file open too: a weak close degree lets both close it in any order
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static hid_t h5_open(const std::string &file_name)
+{
+  std::map<std::string, hid_t>::iterator it = h5_files.find(file_name);
+  if(it != h5_files.end())
+  {
+    return it->second;
+  }
+  trace_t trace("H5Fopen", file_name.c_str());
+  hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+  hid_t file_id = -1;
+  H5E_BEGIN_TRY
+  {
+    if(H5Pset_fclose_degree(fapl, H5F_CLOSE_WEAK) >= 0)
+    {
+      file_id = H5Fopen(file_name.c_str(), H5F_ACC_RDONLY, fapl);
+    }
+  }
+  H5E_END_TRY;
+  H5Pclose(fapl);
+  h5_files[file_name] = file_id;
+  return file_id;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//h5_var
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static chunk_var_t* h5_var(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm,
+  nc_type nc_typ)
+{
+  std::string key = file_name + '\n' + grp_nm_fll + '\n' + var_nm;
+  std::map<std::string, chunk_var_t>::iterator it = h5_vars.find(key);
+  if(it != h5_vars.end())
+  {
+    return &it->second;
+  }
+  chunk_var_t *var = &h5_vars[key];
+  hid_t file_id = h5_open(file_name);
+  if(file_id < 0)
+  {
+    return var;
+  }
+  std::string path = (grp_nm_fll == "/" ? std::string() : grp_nm_fll) + "/" + var_nm;
+  H5E_BEGIN_TRY
+  {
+    var->m_dset = H5Dopen2(file_id, path.c_str(), H5P_DEFAULT);
+  }
+  H5E_END_TRY;
+  if(var->m_dset < 0)
+  {
+    return var;
+  }
+
+  hid_t dcpl = H5Dget_create_plist(var->m_dset);
+  hid_t type = H5Dget_type(var->m_dset);
+  hid_t space = H5Dget_space(var->m_dset);
+  hid_t native = type < 0 ? -1 : H5Tget_native_type(type, H5T_DIR_ASCEND);
+  int rank = space < 0 ? -1 : H5Sget_simple_extent_ndims(space);
+  if(dcpl >= 0 && rank > 0 && H5Pget_layout(dcpl) == H5D_CHUNKED)
+  {
+    int nbr_filter = H5Pget_nfilters(dcpl);
+    var->m_filtered = nbr_filter > 0;
+    var->m_usable = var->m_filtered && nc_typ >= NC_BYTE && nc_typ < NC_STRING
+      && native >= 0 && H5Tequal(type, native) > 0;
+    for(int idx = 0; idx < nbr_filter && var->m_usable; idx++)
+    {
+      unsigned int flags;
+      size_t nbr_cd = 0;
+      H5Z_filter_t filter = H5Pget_filter2(dcpl, (unsigned int)idx, &flags, &nbr_cd, NULL, 0, NULL, NULL);
+      var->m_usable = filter == H5Z_FILTER_DEFLATE || filter == H5Z_FILTER_SHUFFLE;
+#ifdef HAVE_ZSTD
+      var->m_usable = var->m_usable || filter == (H5Z_filter_t)chunk_filter_zstd;
+#endif
+      var->m_filter.push_back((unsigned int)filter);
+    }
+    std::vector<hsize_t> chunk(rank);
+    var->m_usable = var->m_usable && H5Pget_chunk(dcpl, rank, chunk.data()) == rank;
+    var->m_chunk.assign(chunk.begin(), chunk.end());
+    var->m_type_sz = var->m_usable ? H5Tget_size(native) : 0;
+    var->m_fill.assign(var->m_type_sz, 0);
+    if(var->m_usable && H5Pget_fill_value(dcpl, native, var->m_fill.data()) < 0)
+    {
+      std::fill(var->m_fill.begin(), var->m_fill.end(), 0);
+    }
+  }
+  if(native >= 0)
+  {
+    H5Tclose(native);
+  }
+  if(space >= 0)
+  {
+    H5Sclose(space);
+  }
+  if(type >= 0)
+  {
+    H5Tclose(type);
+  }
+  if(dcpl >= 0)
+  {
+    H5Pclose(dcpl);
+  }
+  return var;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//unshuffle
+//the shuffle filter stores byte 0 of all elements, then byte 1, ...; a tail shorter than an element
+//is left as is
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void unshuffle(const std::vector<char> &src, std::vector<char> &dst, size_t type_sz)
+{
+  dst.resize(src.size());
+  size_t nbr = src.size() / type_sz;
+  for(size_t idx_byt = 0; idx_byt < type_sz; idx_byt++)
+  {
+    const char *in = src.data() + idx_byt * nbr;
+    char *out = dst.data() + idx_byt;
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      out[idx * type_sz] = in[idx];
+    }
+  }
+  memcpy(dst.data() + nbr * type_sz, src.data() + nbr * type_sz, src.size() - nbr * type_sz);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//decode_chunk
+//undoes the filters not skipped by the mask, last applied first; false unless raw ends with the
+//chunk_sz bytes of the chunk
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool decode_chunk(const chunk_var_t &var, unsigned int mask, size_t chunk_sz,
+  std::vector<char> &raw, std::vector<char> &tmp)
+{
+  for(size_t idx = var.m_filter.size(); idx-- > 0;)
+  {
+    if(mask & (1u << idx))
+    {
+      continue;
+    }
+    switch(var.m_filter[idx])
+    {
+    case H5Z_FILTER_DEFLATE:
+      {
+        tmp.resize(chunk_sz);
+        uLongf len = (uLongf)chunk_sz;
+        if(uncompress(reinterpret_cast<Bytef*> (tmp.data()), &len,
+          reinterpret_cast<const Bytef*> (raw.data()), (uLong)raw.size()) != Z_OK)
+        {
+          return false;
+        }
+        tmp.resize(len);
+      }
+      break;
+    case H5Z_FILTER_SHUFFLE:
+      unshuffle(raw, tmp, var.m_type_sz);
+      break;
+#ifdef HAVE_ZSTD
+    case chunk_filter_zstd:
+      {
+        tmp.resize(chunk_sz);
+        size_t len = ZSTD_decompress(tmp.data(), chunk_sz, raw.data(), raw.size());
+        if(ZSTD_isError(len))
+        {
+          return false;
+        }
+        tmp.resize(len);
+      }
+      break;
+#endif
+    default:
+      return false;
+    }
+    raw.swap(tmp);
+  }
+  return raw.size() == chunk_sz;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//scatter_chunk
+//copies the part of a chunk at origin that is in the box start/count, by runs of the last dimension;
+//every element is the fill value if chunk is NULL
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void scatter_chunk(char *buf, const std::vector<size_t> &start, const std::vector<size_t> &count,
+  const char *chunk, const std::vector<size_t> &origin, const chunk_var_t &var)
+{
+  size_t nbr_dmn = count.size();
+  size_t type_sz = var.m_type_sz;
+  std::vector<size_t> lo(nbr_dmn);
+  std::vector<size_t> hi(nbr_dmn);
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    lo[idx_dmn] = std::max(start[idx_dmn], origin[idx_dmn]);
+    hi[idx_dmn] = std::min(start[idx_dmn] + count[idx_dmn], origin[idx_dmn] + var.m_chunk[idx_dmn]);
+    if(lo[idx_dmn] >= hi[idx_dmn])
+    {
+      return;
+    }
+  }
+  size_t run = hi[nbr_dmn - 1] - lo[nbr_dmn - 1];
+  std::vector<size_t> idx(lo);
+  for(;;)
+  {
+    size_t off_dst = 0;
+    size_t off_src = 0;
+    for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      off_dst = off_dst * count[idx_dmn] + idx[idx_dmn] - start[idx_dmn];
+      off_src = off_src * var.m_chunk[idx_dmn] + idx[idx_dmn] - origin[idx_dmn];
+    }
+    char *dst = buf + off_dst * type_sz;
+    if(chunk != NULL)
+    {
+      memcpy(dst, chunk + off_src * type_sz, run * type_sz);
+    }
+    else
+    {
+      for(size_t idx_elm = 0; idx_elm < run; idx_elm++)
+      {
+        memcpy(dst + idx_elm * type_sz, var.m_fill.data(), type_sz);
+      }
+    }
+    size_t idx_dmn = nbr_dmn - 1;
+    while(idx_dmn-- > 0)
+    {
+      if(++idx[idx_dmn] < hi[idx_dmn])
+      {
+        break;
+      }
+      idx[idx_dmn] = lo[idx_dmn];
+    }
+    if(idx_dmn == (size_t)-1)
+    {
+      return;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//chunk_read
+//this thread reads the raw chunks in order, since HDF5 is not thread-safe; the workers take the chunks
+//in the same order, wait for each to be read, decode it and copy it into the box, which overlaps the
+//reads with the decoding; the chunks of a box own disjoint parts of it
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int chunk_read(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm,
+  nc_type nc_typ, const std::vector<size_t> &start, const std::vector<size_t> &count, buffer_t *buf)
+{
+  if(!chunk_parallel || count.empty())
+  {
+    return NC2_ERR;
+  }
+  chunk_var_t *var = h5_var(file_name, grp_nm_fll, var_nm, nc_typ);
+  if(var->m_dset < 0 || !var->m_filtered)
+  {
+    return NC2_ERR;
+  }
+  if(!var->m_usable || var->m_chunk.size() != count.size())
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats.m_nbr_fallback++;
+    return NC2_ERR;
+  }
+
+  //chunks over the box, in row-major order
+  size_t nbr_dmn = count.size();
+  std::vector<size_t> first(nbr_dmn);
+  std::vector<size_t> nbr_per_dmn(nbr_dmn);
+  size_t nbr_chunk = 1;
+  size_t nbr_elm = 1;
+  size_t chunk_sz = var->m_type_sz;
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    if(count[idx_dmn] == 0 || var->m_chunk[idx_dmn] == 0)
+    {
+      return NC2_ERR;
+    }
+    first[idx_dmn] = start[idx_dmn] / var->m_chunk[idx_dmn];
+    nbr_per_dmn[idx_dmn] = (start[idx_dmn] + count[idx_dmn] - 1) / var->m_chunk[idx_dmn] - first[idx_dmn] + 1;
+    nbr_chunk *= nbr_per_dmn[idx_dmn];
+    nbr_elm *= count[idx_dmn];
+    chunk_sz *= var->m_chunk[idx_dmn];
+  }
+  //with one core the decoding has nothing to overlap with, and netCDF saves a copy
+  size_t nbr_thread = std::min<size_t>(std::thread::hardware_concurrency(), nbr_chunk);
+  if(nbr_chunk < chunk_min_parallel || nbr_thread < 2)
+  {
+    return NC2_ERR;
+  }
+  buffer_t out(nbr_elm * var->m_type_sz);
+  if(out.empty())
+  {
+    return NC2_ERR;
+  }
+
+  std::vector<chunk_slot_t> slot(nbr_chunk);
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+
+  auto origin_of = [&](size_t idx_chunk, std::vector<size_t> &origin)
+  {
+    for(size_t idx_dmn = nbr_dmn; idx_dmn-- > 0;)
+    {
+      origin[idx_dmn] = (first[idx_dmn] + idx_chunk % nbr_per_dmn[idx_dmn]) * var->m_chunk[idx_dmn];
+      idx_chunk /= nbr_per_dmn[idx_dmn];
+    }
+  };
+
+  auto worker = [&]()
+  {
+    std::vector<char> raw;
+    std::vector<char> tmp;
+    std::vector<size_t> origin(nbr_dmn);
+    for(size_t idx_chunk = next++; idx_chunk < nbr_chunk && !failed; idx_chunk = next++)
+    {
+      int state;
+      unsigned int mask;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return slot[idx_chunk].m_state != chunk_pending || failed; });
+        state = slot[idx_chunk].m_state;
+        mask = slot[idx_chunk].m_mask;
+        raw.swap(slot[idx_chunk].m_raw);
+      }
+      if(failed)
+      {
+        return;
+      }
+      origin_of(idx_chunk, origin);
+      if(state == chunk_missing)
+      {
+        scatter_chunk(out.as<char>(), start, count, NULL, origin, *var);
+        continue;
+      }
+      trace_t trace("chunk_decode", var_nm.c_str(), chunk_sz);
+      if(!decode_chunk(*var, mask, chunk_sz, raw, tmp))
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+        cond.notify_all();
+        return;
+      }
+      scatter_chunk(out.as<char>(), start, count, raw.data(), origin, *var);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    threads.push_back(std::thread(worker));
+  }
+
+  size_t bytes_raw = 0;
+  std::vector<size_t> origin(nbr_dmn);
+  std::vector<hsize_t> offset(nbr_dmn);
+  for(size_t idx_chunk = 0; idx_chunk < nbr_chunk && !failed; idx_chunk++)
+  {
+    origin_of(idx_chunk, origin);
+    offset.assign(origin.begin(), origin.end());
+    //a chunk never written has no address
+    unsigned int mask = 0;
+    haddr_t addr = HADDR_UNDEF;
+    hsize_t nbr_byt = 0;
+    herr_t status;
+    H5E_BEGIN_TRY
+    {
+      status = H5Dget_chunk_info_by_coord(var->m_dset, offset.data(), &mask, &addr, &nbr_byt);
+    }
+    H5E_END_TRY;
+    if(addr == HADDR_UNDEF)
+    {
+      nbr_byt = 0;
+    }
+    std::vector<char> raw;
+    if(status >= 0 && nbr_byt)
+    {
+      uint32_t mask_read = 0;
+      trace_t trace("H5Dread_chunk", var_nm.c_str(), (size_t)nbr_byt);
+      raw.resize((size_t)nbr_byt);
+      H5E_BEGIN_TRY
+      {
+        status = H5Dread_chunk(var->m_dset, H5P_DEFAULT, offset.data(), &mask_read, raw.data());
+      }
+      H5E_END_TRY;
+      mask = mask_read;
+      bytes_raw += (size_t)nbr_byt;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if(status < 0)
+    {
+      failed = true;
+    }
+    else
+    {
+      slot[idx_chunk].m_raw.swap(raw);
+      slot[idx_chunk].m_mask = mask;
+      slot[idx_chunk].m_state = nbr_byt ? chunk_stored : chunk_missing;
+    }
+    cond.notify_all();
+  }
+  for(size_t idx_thread = 0; idx_thread < threads.size(); idx_thread++)
+  {
+    threads[idx_thread].join();
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  if(failed)
+  {
+    stats.m_nbr_fallback++;
+    return NC2_ERR;
+  }
+  stats.m_nbr_read++;
+  stats.m_nbr_chunk += nbr_chunk;
+  stats.m_bytes_raw += bytes_raw;
+  stats.m_bytes += nbr_chunk * chunk_sz;
+  *buf = std::move(out);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//chunk_close
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void chunk_close(const std::string &file_name)
+{
+  std::string prefix = file_name + '\n';
+  std::map<std::string, chunk_var_t>::iterator it = h5_vars.lower_bound(prefix);
+  while(it != h5_vars.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+  {
+    if(it->second.m_dset >= 0)
+    {
+      H5Dclose(it->second.m_dset);
+    }
+    h5_vars.erase(it++);
+  }
+  std::map<std::string, hid_t>::iterator it_file = h5_files.find(file_name);
+  if(it_file == h5_files.end())
+  {
+    return;
+  }
+  if(it_file->second >= 0)
+  {
+    H5Fclose(it_file->second);
+  }
+  h5_files.erase(it_file);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//chunk_close_all
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void chunk_close_all()
+{
+  while(!h5_files.empty())
+  {
+    chunk_close(h5_files.begin()->first);
+  }
+}
+
+#else
+
+int chunk_read(const std::string &, const std::string &, const std::string &, nc_type,
+  const std::vector<size_t> &, const std::vector<size_t> &, buffer_t *)
+{
+  return NC2_ERR;
+}
+
+void chunk_close(const std::string &)
+{
+}
+
+void chunk_close_all()
+{
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef NETCDF_CHUNK_H
+#define NETCDF_CHUNK_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//parallel chunk reads
+//netCDF decompresses the chunks of a hyperslab one after the other on the calling thread; a box of
+//a compressed variable of a netCDF-4 file is read here as raw chunks (HDF5 direct chunk read, on the
+//I/O thread), while worker threads decompress the chunks already read and copy them into the box
+//deflate and shuffle are decoded, and zstd when built with HAVE_ZSTD; a variable with another filter,
+//not in the byte order of the machine, or any read or decode error, is left to netCDF
+//needs HAVE_HDF5 (qmake CONFIG+=hdf5); without it every read is left to netCDF
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//boxes over fewer chunks are left to netCDF, whose chunk cache serves the tiles of the same chunks;
+//so are all boxes on a machine with one core
+static const size_t chunk_min_parallel = 4;
+
+class chunk_stats_t
+{
+public:
+  chunk_stats_t() :
+    m_nbr_read(0),
+    m_nbr_fallback(0),
+    m_nbr_chunk(0),
+    m_bytes_raw(0),
+    m_bytes(0)
+  {
+  }
+  size_t m_nbr_read; // boxes read by chunks
+  size_t m_nbr_fallback; // boxes of compressed variables left to netCDF
+  size_t m_nbr_chunk; // chunks decompressed
+  size_t m_bytes_raw; // compressed bytes read
+  size_t m_bytes; // bytes decompressed
+};
+
+//reads of compressed boxes on the netCDF path only when false (for comparisons)
+void chunk_set_parallel(bool parallel);
+chunk_stats_t chunk_stats();
+
+//the box start/count of a variable; NC2_ERR if the box must be read by netCDF instead
+//I/O thread only, like the netCDF calls
+int chunk_read(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm,
+  nc_type nc_typ, const std::vector<size_t> &start, const std::vector<size_t> &count, buffer_t *buf);
+
+//closes the HDF5 handles of a file, with io_close
+void chunk_close(const std::string &file_name);
+void chunk_close_all();
+
+#endif
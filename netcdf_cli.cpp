@@ -0,0 +1,404 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+//headless command line mode
+//netcdf-explorer --dump var [--slab 0,0,:,:] [--format csv] file.nc
+//netcdf-explorer --stats var [--slab 0,:,:] file.nc
+//netcdf-explorer --bench [--dump var] file.nc
+//netcdf-explorer --serve 7010
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include "netcdf_explorer.hpp"
+
+#if QT_VERSION >= 0x050000
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//parse_slab
+//one token per dimension, comma separated
+//':' whole dimension, 'i' one index, 'a:b' indices a to b-1, 'a:b:s' indices a to b-1 with stride s
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool parse_slab(const QString &spec, const std::vector<size_t> &dim,
+  std::vector<size_t> &start, std::vector<size_t> &count, std::vector<ptrdiff_t> &stride)
+{
+  QStringList tokens = spec.split(',');
+  if((size_t)tokens.size() != dim.size())
+  {
+    fprintf(stderr, "slab has %d dimensions, variable has %d\n", tokens.size(), (int)dim.size());
+    return false;
+  }
+
+  for(size_t idx_dmn = 0; idx_dmn < dim.size(); idx_dmn++)
+  {
+    QStringList range = tokens.at(idx_dmn).trimmed().split(':');
+    size_t beg = 0;
+    size_t end = dim[idx_dmn];
+    ptrdiff_t srd = 1;
+    bool ok = true;
+
+    if(range.size() == 1)
+    {
+      beg = range.at(0).toULongLong(&ok);
+      end = beg + 1;
+    }
+    else if(range.size() <= 3)
+    {
+      if(!range.at(0).isEmpty())
+      {
+        beg = range.at(0).toULongLong(&ok);
+      }
+      if(ok && !range.at(1).isEmpty())
+      {
+        end = range.at(1).toULongLong(&ok);
+      }
+      if(ok && range.size() == 3 && !range.at(2).isEmpty())
+      {
+        srd = range.at(2).toLongLong(&ok);
+      }
+    }
+    else
+    {
+      ok = false;
+    }
+
+    if(!ok || srd < 1 || beg >= end || end > dim[idx_dmn])
+    {
+      fprintf(stderr, "invalid slab range '%s' for dimension %d of size %zu\n",
+        tokens.at(idx_dmn).toLatin1().data(), (int)idx_dmn, dim[idx_dmn]);
+      return false;
+    }
+
+    start.push_back(beg);
+    count.push_back((end - beg + srd - 1) / srd);
+    stride.push_back(srd);
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//dump
+//print the buffer as rows of the last dimension
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void dump(const ncdata_t *ncdata, bool csv)
+{
+  char str[1024];
+  size_t nbr_cols = 1;
+  size_t nbr_elm = 1;
+  for(size_t idx_dmn = 0; idx_dmn < ncdata->m_dim.size(); idx_dmn++)
+  {
+    nbr_elm *= ncdata->m_dim[idx_dmn];
+  }
+  if(ncdata->m_dim.size())
+  {
+    nbr_cols = ncdata->m_dim.back();
+  }
+
+  //NC_CHAR is displayed as one string per row
+  const char sep = (ncdata->m_nc_type == NC_CHAR) ? '\0' : (csv ? ',' : ' ');
+
+  for(size_t idx = 0; idx < nbr_elm; idx++)
+  {
+    format_value(str, sizeof(str), ncdata->m_nc_type, ncdata->m_buf.data(), idx);
+    if(csv && ncdata->m_nc_type == NC_STRING)
+    {
+      fputc('"', stdout);
+      fputs(str, stdout);
+      fputc('"', stdout);
+    }
+    else
+    {
+      fputs(str, stdout);
+    }
+    if((idx + 1) % nbr_cols == 0)
+    {
+      fputc('\n', stdout);
+    }
+    else if(sep)
+    {
+      fputc(sep, stdout);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//stats
+//print count, minimum, maximum, mean and standard deviation, ignoring fill values and NaN
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int stats(const ncdata_t *ncdata, bool has_fill, double fill)
+{
+  size_t nbr_elm = 1;
+  size_t nbr_vld = 0;
+  double min = DBL_MAX;
+  double max = -DBL_MAX;
+  double mean = 0;
+  double m2 = 0;
+
+  if(ncdata->m_nc_type == NC_CHAR || ncdata->m_nc_type == NC_STRING)
+  {
+    fprintf(stderr, "statistics are not defined for text variable %s\n", ncdata->m_name.c_str());
+    return 1;
+  }
+
+  for(size_t idx_dmn = 0; idx_dmn < ncdata->m_dim.size(); idx_dmn++)
+  {
+    nbr_elm *= ncdata->m_dim[idx_dmn];
+  }
+
+  for(size_t idx = 0; idx < nbr_elm; idx++)
+  {
+    double val = get_double(ncdata->m_nc_type, ncdata->m_buf.data(), idx);
+    if(std::isnan(val) || (has_fill && val == fill))
+    {
+      continue;
+    }
+    //Welford running mean and variance
+    nbr_vld++;
+    double dlt = val - mean;
+    mean += dlt / nbr_vld;
+    m2 += dlt * (val - mean);
+    if(val < min) min = val;
+    if(val > max) max = val;
+  }
+
+  printf("variable,%s\n", ncdata->m_name.c_str());
+  printf("count,%zu\n", nbr_elm);
+  printf("valid,%zu\n", nbr_vld);
+  if(nbr_vld)
+  {
+    printf("min,%.12g\n", min);
+    printf("max,%.12g\n", max);
+    printf("mean,%.12g\n", mean);
+    printf("std,%.12g\n", sqrt(m2 / nbr_vld));
+  }
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//run_headless
+//uses the same iteration and loading functions as the GUI; timings are printed to stderr
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int run_headless(const QCommandLineParser &parser)
+{
+  QElapsedTimer timer;
+  int nc_id;
+  int grp_id;
+  int var_id;
+  int ret = 0;
+  bool bench = parser.isSet("bench");
+  const QStringList args = parser.positionalArguments();
+
+  if(parser.isSet("serve"))
+  {
+    int port = parser.value("serve").toInt();
+    if(port <= 0 || port > 65535)
+    {
+      fprintf(stderr, "invalid port %s\n", parser.value("serve").toLatin1().data());
+      return 1;
+    }
+    return remote_serve((unsigned short)port);
+  }
+
+  if(args.size() != 1)
+  {
+    fprintf(stderr, "headless mode needs one file\n");
+    return 1;
+  }
+
+  std::string file_name = args.at(0).toLatin1().data();
+  std::string var_nm;
+  if(parser.isSet("dump"))
+  {
+    var_nm = parser.value("dump").toLatin1().data();
+  }
+  else if(parser.isSet("stats"))
+  {
+    var_nm = parser.value("stats").toLatin1().data();
+  }
+
+  QString format = parser.value("format");
+  if(format != "csv" && format != "text")
+  {
+    fprintf(stderr, "unknown format %s\n", format.toLatin1().data());
+    return 1;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //open
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  timer.start();
+  if(nc_open(file_name.c_str(), NC_NOWRITE, &nc_id) != NC_NOERR)
+  {
+    fprintf(stderr, "cannot open %s\n", file_name.c_str());
+    return 1;
+  }
+  qint64 time_open = timer.nsecsElapsed();
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //metadata scan
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  FileTreeModel tree_model(NULL);
+  meta_store_t *store = new meta_store_t(file_name);
+
+  timer.start();
+  if(meta_scan(store, nc_id) != NC_NOERR)
+  {
+    fprintf(stderr, "cannot read the metadata of %s\n", file_name.c_str());
+    delete store;
+    nc_close(nc_id);
+    return 1;
+  }
+  tree_model.add_file(store);
+  qint64 time_scan = timer.nsecsElapsed();
+  qint64 time_read = 0;
+  qint64 time_format = 0;
+  size_t nbr_byt = 0;
+
+  if(!var_nm.empty())
+  {
+    ItemData *item_data = tree_model.find_variable(var_nm);
+    if(item_data == NULL)
+    {
+      fprintf(stderr, "variable %s not found\n", var_nm.c_str());
+      ret = 1;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //slab read
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    ncdata_t *ncdata = NULL;
+    bool has_fill = false;
+    double fill = 0;
+    if(item_data != NULL)
+    {
+      if(inq_grp_id(nc_id, item_data->m_grp_nm_fll, &grp_id) != NC_NOERR
+        || nc_inq_varid(grp_id, item_data->m_item_nm.c_str(), &var_id) != NC_NOERR)
+      {
+        fprintf(stderr, "cannot find variable %s\n", var_nm.c_str());
+        ret = 1;
+      }
+      else
+      {
+        has_fill = (nc_get_att_double(grp_id, var_id, "_FillValue", &fill) == NC_NOERR);
+      }
+    }
+
+    if(ret == 0)
+    {
+      timer.start();
+      if(parser.isSet("slab"))
+      {
+        std::vector<size_t> start;
+        std::vector<size_t> count;
+        std::vector<ptrdiff_t> stride;
+        if(parse_slab(parser.value("slab"), item_data->m_ncdata->m_dim, start, count, stride))
+        {
+          ncdata = new ncdata_t(item_data->m_item_nm.c_str(), item_data->m_ncdata->m_nc_type, count);
+          ncdata->store(load_variable_slab(grp_id, var_id, ncdata->m_nc_type, start, count, stride));
+        }
+        else
+        {
+          ret = 1;
+        }
+      }
+      else
+      {
+        if(load_item(item_data) == NC_NOERR)
+        {
+          ncdata = item_data->m_ncdata;
+        }
+      }
+      time_read = timer.nsecsElapsed();
+
+      //a failed read, or a buffer shorter than the variable
+      if(ncdata != NULL)
+      {
+        size_t nbr_elm = 1;
+        for(size_t idx_dmn = 0; idx_dmn < ncdata->m_dim.size(); idx_dmn++)
+        {
+          nbr_elm *= ncdata->m_dim[idx_dmn];
+        }
+        if(ncdata->m_buf.empty() || ncdata->m_buf.size() < nbr_elm * get_type_size(ncdata->m_nc_type))
+        {
+          if(ncdata != item_data->m_ncdata)
+          {
+            delete ncdata;
+          }
+          ncdata = NULL;
+        }
+      }
+      if(ncdata == NULL && ret == 0)
+      {
+        fprintf(stderr, "cannot read variable %s\n", var_nm.c_str());
+        ret = 1;
+      }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //formatting
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    if(ncdata != NULL)
+    {
+      size_t nbr_elm = 1;
+      for(size_t idx_dmn = 0; idx_dmn < ncdata->m_dim.size(); idx_dmn++)
+      {
+        nbr_elm *= ncdata->m_dim[idx_dmn];
+      }
+      nc_type typ = ncdata->m_nc_type;
+      size_t sz_typ = 0;
+      if(nc_inq_type(nc_id, typ, NULL, &sz_typ) == NC_NOERR)
+      {
+        nbr_byt = nbr_elm * sz_typ;
+      }
+
+      timer.start();
+      if(parser.isSet("dump"))
+      {
+        dump(ncdata, format == "csv");
+      }
+      else
+      {
+        ret = stats(ncdata, has_fill, fill);
+      }
+      fflush(stdout);
+      time_format = timer.nsecsElapsed();
+
+      if(ncdata != item_data->m_ncdata)
+      {
+        delete ncdata;
+      }
+    }
+  }
+
+  if(nc_close(nc_id) != NC_NOERR)
+  {
+
+  }
+
+  if(bench)
+  {
+    fprintf(stderr, "open_ms=%.3f\n", time_open / 1.0e6);
+    fprintf(stderr, "scan_ms=%.3f\n", time_scan / 1.0e6);
+    fprintf(stderr, "read_ms=%.3f\n", time_read / 1.0e6);
+    fprintf(stderr, "format_ms=%.3f\n", time_format / 1.0e6);
+    fprintf(stderr, "read_bytes=%zu\n", nbr_byt);
+    pool_stats_t pool = pool_stats();
+    fprintf(stderr, "pool_hit_rate=%.3f\n", pool.hit_rate());
+    fprintf(stderr, "pool_bytes_used=%zu\n", pool.m_bytes_used);
+    fprintf(stderr, "pool_bytes_held=%zu\n", pool.m_bytes_held);
+  }
+
+  return ret;
+}
+
+#endif
@@ -0,0 +1,408 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#include "netcdf_explorer.hpp"
+#include "netcdf_diff.hpp"
+#include "netcdf_trace.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DIFF_SSE2
+#endif
+
+//cells per chunk of the streaming pass, per variable
+static const size_t diff_chunk_cells = (size_t)1 << 19;
+
+//cells converted at a time by each thread, to stay in cache
+static const size_t diff_block_cells = 4096;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_stats_t::merge
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void diff_stats_t::merge(const diff_stats_t &stats)
+{
+  m_nbr += stats.m_nbr;
+  m_nbr_valid += stats.m_nbr_valid;
+  m_nbr_mismatch += stats.m_nbr_mismatch;
+  m_max_abs = std::max(m_max_abs, stats.m_max_abs);
+  m_sum_sq += stats.m_sum_sq;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_type
+//numeric types that can be compared
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool diff_type(nc_type nc_typ)
+{
+  return nc_typ != NC_CHAR && nc_typ != NC_STRING && get_type_size(nc_typ) > 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//convert
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+static void convert(const void *src, size_t nbr, double *dst)
+{
+  const T *buf = static_cast<const T*> (src);
+  for(size_t idx = 0; idx < nbr; idx++)
+  {
+    dst[idx] = (double)buf[idx];
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_to_double
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void diff_to_double(const void *src, nc_type nc_typ, size_t nbr, double *dst)
+{
+  switch(nc_typ)
+  {
+  case NC_FLOAT:
+    convert<float>(src, nbr, dst);
+    break;
+  case NC_DOUBLE:
+    memcpy(dst, src, nbr * sizeof(double));
+    break;
+  case NC_INT:
+    convert<int>(src, nbr, dst);
+    break;
+  case NC_SHORT:
+    convert<short>(src, nbr, dst);
+    break;
+  case NC_BYTE:
+    convert<signed char>(src, nbr, dst);
+    break;
+  case NC_UBYTE:
+    convert<unsigned char>(src, nbr, dst);
+    break;
+  case NC_USHORT:
+    convert<unsigned short>(src, nbr, dst);
+    break;
+  case NC_UINT:
+    convert<unsigned int>(src, nbr, dst);
+    break;
+  case NC_INT64:
+    convert<long long>(src, nbr, dst);
+    break;
+  case NC_UINT64:
+    convert<unsigned long long>(src, nbr, dst);
+    break;
+  default:
+    memset(dst, 0, nbr * sizeof(double));
+    break;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_fill_to_nan
+//cells of the _FillValue become NaN, so that they are skipped like cells with no number
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void diff_fill_to_nan(double *x, size_t nbr, double fill)
+{
+  for(size_t idx = 0; idx < nbr; idx++)
+  {
+    if(x[idx] == fill)
+    {
+      x[idx] = std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_kernel
+//dst = A - B, or (A - B) / |B|
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void diff_kernel(const double *a, const double *b, double *dst, size_t nbr, int mode)
+{
+  size_t idx = 0;
+#ifdef DIFF_SSE2
+  const __m128d mask_abs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+  if(mode == diff_relative)
+  {
+    for(; idx + 2 <= nbr; idx += 2)
+    {
+      __m128d va = _mm_loadu_pd(a + idx);
+      __m128d vb = _mm_loadu_pd(b + idx);
+      _mm_storeu_pd(dst + idx, _mm_div_pd(_mm_sub_pd(va, vb), _mm_and_pd(vb, mask_abs)));
+    }
+  }
+  else
+  {
+    for(; idx + 2 <= nbr; idx += 2)
+    {
+      _mm_storeu_pd(dst + idx, _mm_sub_pd(_mm_loadu_pd(a + idx), _mm_loadu_pd(b + idx)));
+    }
+  }
+#endif
+  for(; idx < nbr; idx++)
+  {
+    dst[idx] = mode == diff_relative ? (a[idx] - b[idx]) / std::fabs(b[idx]) : a[idx] - b[idx];
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_accumulate
+//statistics of A - B added to stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void diff_accumulate(const double *a, const double *b, size_t nbr, double tol, diff_stats_t *stats)
+{
+  size_t idx = 0;
+  size_t nbr_valid = 0;
+  size_t nbr_mismatch = 0;
+  double max_abs = stats->m_max_abs;
+  double sum_sq = 0;
+#ifdef DIFF_SSE2
+  static const int nbr_bits[4] = { 0, 1, 1, 2 };
+  const __m128d mask_abs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+  const __m128d vtol = _mm_set1_pd(tol);
+  __m128d vmax = _mm_set1_pd(max_abs);
+  __m128d vsum = _mm_setzero_pd();
+  for(; idx + 2 <= nbr; idx += 2)
+  {
+    __m128d va = _mm_loadu_pd(a + idx);
+    __m128d vb = _mm_loadu_pd(b + idx);
+    __m128d nan_a = _mm_cmpunord_pd(va, va);
+    __m128d nan_b = _mm_cmpunord_pd(vb, vb);
+    __m128d nan_any = _mm_or_pd(nan_a, nan_b);
+    __m128d vabs = _mm_andnot_pd(nan_any, _mm_and_pd(_mm_sub_pd(va, vb), mask_abs));
+    vmax = _mm_max_pd(vmax, vabs);
+    vsum = _mm_add_pd(vsum, _mm_mul_pd(vabs, vabs));
+    __m128d mismatch = _mm_or_pd(_mm_cmpgt_pd(vabs, vtol), _mm_xor_pd(nan_a, nan_b));
+    nbr_mismatch += nbr_bits[_mm_movemask_pd(mismatch)];
+    nbr_valid += 2 - nbr_bits[_mm_movemask_pd(nan_any)];
+  }
+  double lane[2];
+  _mm_storeu_pd(lane, vmax);
+  max_abs = std::max(lane[0], lane[1]);
+  _mm_storeu_pd(lane, vsum);
+  sum_sq = lane[0] + lane[1];
+#endif
+  for(; idx < nbr; idx++)
+  {
+    bool nan_a = a[idx] != a[idx];
+    bool nan_b = b[idx] != b[idx];
+    if(nan_a || nan_b)
+    {
+      nbr_mismatch += (nan_a != nan_b);
+      continue;
+    }
+    double abs = std::fabs(a[idx] - b[idx]);
+    max_abs = std::max(max_abs, abs);
+    sum_sq += abs * abs;
+    nbr_mismatch += (abs > tol);
+    nbr_valid++;
+  }
+  stats->m_nbr += nbr;
+  stats->m_nbr_valid += nbr_valid;
+  stats->m_nbr_mismatch += nbr_mismatch;
+  stats->m_max_abs = max_abs;
+  stats->m_sum_sq += sum_sq;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_slab_source_t::read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t diff_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  size_t nbr = 1;
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
+  {
+    nbr *= count[idx_dmn];
+  }
+  buffer_t buf_a = m_source_a->read(start, count);
+  buffer_t buf_b = m_source_b->read(start, count);
+  if(buf_a.size() != nbr * get_type_size(m_source_a->type()) || buf_b.size() != nbr * get_type_size(m_source_b->type()))
+  {
+    return buffer_t();
+  }
+
+  //A converted in place in the result, B in a temporary unless already double with no _FillValue;
+  //fill cells become NaN so that they show as no number, as in the statistics
+  double fill_a = 0;
+  double fill_b = 0;
+  bool has_fill_a = m_source_a->fill_value(&fill_a);
+  bool has_fill_b = m_source_b->fill_value(&fill_b);
+  buffer_t buf(nbr * sizeof(double));
+  buffer_t tmp_b;
+  const double *b = buf_b.as<double>();
+  diff_to_double(buf_a.data(), m_source_a->type(), nbr, buf.as<double>());
+  if(has_fill_a)
+  {
+    diff_fill_to_nan(buf.as<double>(), nbr, fill_a);
+  }
+  if(m_source_b->type() != NC_DOUBLE || has_fill_b)
+  {
+    tmp_b = buffer_t(nbr * sizeof(double));
+    diff_to_double(buf_b.data(), m_source_b->type(), nbr, tmp_b.as<double>());
+    if(has_fill_b)
+    {
+      diff_fill_to_nan(tmp_b.as<double>(), nbr, fill_b);
+    }
+    b = tmp_b.as<double>();
+  }
+  diff_kernel(buf.as<double>(), b, buf.as<double>(), nbr, m_mode);
+  return buf;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_fill_t
+//the _FillValue of A and of B; their cells are compared as NaN
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class diff_fill_t
+{
+public:
+  diff_fill_t() :
+    m_has_a(false),
+    m_has_b(false),
+    m_a(0),
+    m_b(0)
+  {
+  }
+  bool m_has_a;
+  bool m_has_b;
+  double m_a;
+  double m_b;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//compare_part
+//statistics of cells first to first + nbr of two buffers, by blocks converted to double
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void compare_part(const void *buf_a, nc_type type_a, const void *buf_b, nc_type type_b,
+  size_t first, size_t nbr, double tol, const diff_fill_t &fill, diff_stats_t *stats)
+{
+  bool cvt_a = type_a != NC_DOUBLE || fill.m_has_a;
+  bool cvt_b = type_b != NC_DOUBLE || fill.m_has_b;
+  std::vector<double> blk_a(cvt_a ? diff_block_cells : 0);
+  std::vector<double> blk_b(cvt_b ? diff_block_cells : 0);
+  size_t sz_a = get_type_size(type_a);
+  size_t sz_b = get_type_size(type_b);
+  for(size_t idx = first; idx < first + nbr; idx += diff_block_cells)
+  {
+    size_t nbr_blk = std::min(diff_block_cells, first + nbr - idx);
+    const char *src_a = static_cast<const char*> (buf_a) + idx * sz_a;
+    const char *src_b = static_cast<const char*> (buf_b) + idx * sz_b;
+    const double *a = reinterpret_cast<const double*> (src_a);
+    const double *b = reinterpret_cast<const double*> (src_b);
+    if(cvt_a)
+    {
+      diff_to_double(src_a, type_a, nbr_blk, &blk_a[0]);
+      if(fill.m_has_a)
+      {
+        diff_fill_to_nan(&blk_a[0], nbr_blk, fill.m_a);
+      }
+      a = &blk_a[0];
+    }
+    if(cvt_b)
+    {
+      diff_to_double(src_b, type_b, nbr_blk, &blk_b[0]);
+      if(fill.m_has_b)
+      {
+        diff_fill_to_nan(&blk_b[0], nbr_blk, fill.m_b);
+      }
+      b = &blk_b[0];
+    }
+    diff_accumulate(a, b, nbr_blk, tol, stats);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//compare_chunk
+//one part per thread, statistics merged in order
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void compare_chunk(const void *buf_a, nc_type type_a, const void *buf_b, nc_type type_b,
+  size_t nbr, double tol, const diff_fill_t &fill, diff_stats_t *stats)
+{
+  size_t nbr_thread = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), nbr / (16 * diff_block_cells)));
+  size_t part = (nbr + nbr_thread - 1) / nbr_thread;
+  std::vector<diff_stats_t> part_stats(nbr_thread);
+  std::vector<std::thread> threads;
+  for(size_t idx_thread = 1; idx_thread < nbr_thread; idx_thread++)
+  {
+    size_t first = idx_thread * part;
+    size_t nbr_part = first < nbr ? std::min(part, nbr - first) : 0;
+    threads.push_back(std::thread(compare_part, buf_a, type_a, buf_b, type_b, first, nbr_part, tol, std::cref(fill),
+      &part_stats[idx_thread]));
+  }
+  compare_part(buf_a, type_a, buf_b, type_b, 0, std::min(part, nbr), tol, fill, &part_stats[0]);
+  for(size_t idx_thread = 0; idx_thread < threads.size(); idx_thread++)
+  {
+    threads[idx_thread].join();
+  }
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    stats->merge(part_stats[idx_thread]);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_stream
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int diff_stream(slab_source_t *source_a, slab_source_t *source_b, double tol, const diff_io_t &io,
+  const std::atomic<bool> &cancel, const std::function<void(const diff_stats_t&, double)> &progress, diff_stats_t *stats)
+{
+  trace_t trace("diff_stream", source_a->key().c_str());
+  const std::vector<size_t> &dim = source_a->dim();
+  nc_type type_a = source_a->type();
+  nc_type type_b = source_b->type();
+  if(dim != source_b->dim() || !diff_type(type_a) || !diff_type(type_b))
+  {
+    return NC2_ERR;
+  }
+
+  //chunks of records of the first dimension
+  size_t nbr_rec = dim.empty() ? 1 : dim[0];
+  if(nbr_rec == 0)
+  {
+    return NC_NOERR;
+  }
+  size_t rec_cells = 1;
+  for(size_t idx_dmn = 1; idx_dmn < dim.size(); idx_dmn++)
+  {
+    rec_cells *= dim[idx_dmn];
+  }
+  size_t rec_chunk = std::max<size_t>(1, diff_chunk_cells / std::max<size_t>(1, rec_cells));
+  size_t nbr_chunk = (nbr_rec + rec_chunk - 1) / rec_chunk;
+  diff_fill_t fill;
+  io([&]()
+  {
+    fill.m_has_a = source_a->fill_value(&fill.m_a);
+    fill.m_has_b = source_b->fill_value(&fill.m_b);
+  });
+
+  std::vector<slab_source_t*> sources;
+  sources.push_back(source_a);
+  sources.push_back(source_b);
+  return slab_stream(sources, nbr_chunk, io, cancel, [&](size_t idx_chunk, std::vector<size_t> *start, std::vector<size_t> *count)
+  {
+    if(!dim.empty())
+    {
+      (*start)[0] = idx_chunk * rec_chunk;
+      (*count)[0] = std::min(rec_chunk, nbr_rec - (*start)[0]);
+    }
+  }, [&](size_t idx_chunk, const std::vector<size_t> &, const std::vector<size_t> &count, const std::vector<buffer_t> &buf)
+  {
+    size_t nbr = (dim.empty() ? 1 : count[0]) * rec_cells;
+    compare_chunk(buf[0].data(), type_a, buf[1].data(), type_b, nbr, tol, fill, stats);
+    if(progress)
+    {
+      progress(*stats, (double)std::min((idx_chunk + 1) * rec_chunk, nbr_rec) / nbr_rec);
+    }
+    return true;
+  });
+}
@@ -0,0 +1,106 @@
+#ifndef NETCDF_DIFF_H
+#define NETCDF_DIFF_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_io.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//difference of two variables
+//two variables of the same shape, from one file or two, compared cell by cell: A - B for the cells on
+//screen, tile by tile; summary statistics of the whole variables by a streaming pass that reads both
+//by chunks of records, so that neither is ever whole in memory
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum diff_mode_t
+{
+  diff_absolute, // A - B
+  diff_relative // (A - B) / |B|
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_stats_t
+//cells where A or B is NaN are not in the maximum and RMS; they mismatch unless both are NaN; in
+//diff_stream, cells of the _FillValue of A or B count as NaN
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class diff_stats_t
+{
+public:
+  diff_stats_t() :
+    m_nbr(0),
+    m_nbr_valid(0),
+    m_nbr_mismatch(0),
+    m_max_abs(0),
+    m_sum_sq(0)
+  {
+  }
+  void merge(const diff_stats_t &stats);
+  double rms() const
+  {
+    return m_nbr_valid ? std::sqrt(m_sum_sq / m_nbr_valid) : 0;
+  }
+  size_t m_nbr; // cells compared
+  size_t m_nbr_valid; // cells where A and B are numbers
+  size_t m_nbr_mismatch; // cells where |A - B| > tolerance
+  double m_max_abs; // maximum of |A - B|
+  double m_sum_sq; // sum of (A - B)^2
+};
+
+void diff_to_double(const void *src, nc_type nc_typ, size_t nbr, double *dst);
+void diff_fill_to_nan(double *x, size_t nbr, double fill);
+void diff_kernel(const double *a, const double *b, double *dst, size_t nbr, int mode);
+void diff_accumulate(const double *a, const double *b, size_t nbr, double tol, diff_stats_t *stats);
+bool diff_type(nc_type nc_typ);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_slab_source_t
+//the NC_DOUBLE difference of two sources of the same shape
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class diff_slab_source_t : public slab_source_t
+{
+public:
+  diff_slab_source_t(const std::shared_ptr<slab_source_t> &source_a, const std::shared_ptr<slab_source_t> &source_b, int mode) :
+    m_source_a(source_a),
+    m_source_b(source_b),
+    m_mode(mode)
+  {
+  }
+  nc_type type() const
+  {
+    return NC_DOUBLE;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_source_a->dim();
+  }
+  std::string key() const
+  {
+    return std::string(m_mode == diff_relative ? "reldiff\n" : "diff\n") + m_source_a->key() + '\n' + m_source_b->key();
+  }
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+  std::shared_ptr<slab_source_t> m_source_a;
+  std::shared_ptr<slab_source_t> m_source_b;
+  int m_mode; // diff_mode_t
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//diff_stream
+//statistics of A - B over the whole variables; reads go through io (the I/O thread in the GUI), by
+//chunks of about 4 MB of cells, the next chunk read while the current one is compared in parallel
+//progress gets the statistics so far and the fraction done; stops with NC2_ERR when cancel is set
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef slab_io_t diff_io_t;
+
+int diff_stream(slab_source_t *source_a, slab_source_t *source_b, double tol, const diff_io_t &io,
+  const std::atomic<bool> &cancel, const std::function<void(const diff_stats_t&, double)> &progress, diff_stats_t *stats);
+
+#endif
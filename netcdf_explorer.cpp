@@ -6,21 +6,47 @@
 #include <QApplication>
 #include <QMetaType>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <cmath>
 #include <vector>
 #include <algorithm>
+#include <set>
+#include <functional>
 #include "netcdf_explorer.hpp"
+#include "netcdf_trace.hpp"
 
 const char* get_format(const nc_type typ);
 static const char app_name[] = "netCDF Explorer";
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 //main
+//NETCDF_EXPLORER_NO_MAIN is defined by other targets that link this file (netcdf_bench.pro)
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#ifndef NETCDF_EXPLORER_NO_MAIN
 int main(int argc, char *argv[])
 {
   Q_INIT_RESOURCE(netcdf_explorer);
-  QApplication app(argc, argv);
+  //a process of the reader pool of another netcdf-explorer
+  if(argc == 2 && strcmp(argv[1], "--reader") == 0)
+  {
+    return reader_serve();
+  }
+  bool headless = false;
+#if QT_VERSION >= 0x050000
+  //headless mode does not create widgets, so it must not need a display either
+  for(int idx = 1; idx < argc; idx++)
+  {
+    if(strncmp(argv[idx], "--dump", 6) == 0 || strncmp(argv[idx], "--stats", 7) == 0 || strcmp(argv[idx], "--bench") == 0
+      || strncmp(argv[idx], "--serve", 7) == 0)
+    {
+      headless = true;
+    }
+  }
+#endif
+  QScopedPointer<QCoreApplication> app(headless ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
   QCoreApplication::setApplicationVersion("1.1");
   QCoreApplication::setApplicationName("netCDF Explorer");
 #if QT_VERSION >= 0x050000
@@ -28,12 +54,37 @@ int main(int argc, char *argv[])
   parser.addHelpOption();
   parser.addVersionOption();
   parser.addPositionalArgument("file", "The file to open.");
-  parser.process(app);
+  parser.addOption(QCommandLineOption("dump", "Print the values of variable <var> (headless).", "var"));
+  parser.addOption(QCommandLineOption("stats", "Print statistics of variable <var> (headless).", "var"));
+  parser.addOption(QCommandLineOption("slab", "Hyperslab for --dump/--stats, comma separated per dimension: ':' all, 'i' one index, 'a:b' or 'a:b:s' indices a to b-1.", "slab"));
+  parser.addOption(QCommandLineOption("format", "Output format for --dump: csv or text (default).", "format", "text"));
+  parser.addOption(QCommandLineOption("bench", "Print timings of open, metadata scan, slab read and formatting (headless)."));
+  parser.addOption(QCommandLineOption("serve", "Serve the files of this host to the GUI on localhost port <port> (headless).", "port"));
+  parser.addOption(QCommandLineOption("trace", "Record the netCDF calls and save them as a Chrome trace to <file> at exit.", "file"));
+  parser.process(*app);
   const QStringList args = parser.positionalArguments();
+  QString trace_file = parser.value("trace");
+  if(!trace_file.isEmpty())
+  {
+    trace_enable(true);
+  }
+  if(headless)
+  {
+    int ret = run_headless(parser);
+    if(!trace_file.isEmpty())
+    {
+      trace_save(trace_file.toLatin1().data());
+    }
+    return ret;
+  }
 #endif
 
   MainWindow window;
 #if QT_VERSION >= 0x050000
+  if(!trace_file.isEmpty())
+  {
+    window.set_trace_checked();
+  }
   if(args.size())
   {
     QString file_name = args.at(0);
@@ -41,128 +92,16 @@ int main(int argc, char *argv[])
   }
 #endif
   window.showMaximized();
-  return app.exec();
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-//ncdata_t
-//ncdata_t is an abstraction to store in memory information for both: 1) netCDF variables. 2) netCDF attributes
-//1) netCDF variables
-//a netCDF variable has a name, a netCDF type, data buffer, and an array of dimensions
-//these are defined in iteration of the file
-//the data buffer is stored on per load variable from tree using netCDF API from item input
-//2) netCDF attributes
-//a netCDF attribute has a name, a netCDF type, data buffer, and a size
-//Variables may be multidimensional. Attributes are all either scalars(single-valued) or vectors(a single, fixed dimension)
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-class ncdata_t
-{
-public:
-  ncdata_t(const char* name, nc_type nc_typ, const std::vector<size_t> &dim) :
-    m_name(name),
-    m_nc_type(nc_typ),
-    m_buf(NULL),
-    m_dim(dim)
-  {
-  }
-  ~ncdata_t()
-  {
-    switch(m_nc_type)
-    {
-    case NC_STRING:
-      if(m_buf)
-      {
-        char **buf_string = NULL;
-        size_t idx_buf = 0;
-        buf_string = static_cast<char**> (m_buf);
-        if(m_dim.size())
-        {
-          for(size_t idx_dmn = 0; idx_dmn < m_dim.size(); idx_dmn++)
-          {
-            for(size_t idx_sz = 0; idx_sz < m_dim[idx_dmn]; idx_sz++)
-            {
-              free(buf_string[idx_buf]);
-              idx_buf++;
-            }
-          }
-        }
-        else
-        {
-          free(*buf_string);
-        }
-        free(static_cast<char**>(buf_string));
-      }
-      break;
-    default:
-      free(m_buf);
-    }
-  }
-  void store(void *buf)
-  {
-    m_buf = buf;
-  }
-  std::string m_name;
-  nc_type m_nc_type;
-  void *m_buf;
-  std::vector<size_t> m_dim;
-};
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-//ItemData
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-class ItemData
-{
-public:
-  enum ItemKind
-  {
-    Root,
-    Group,
-    Variable,
-    Attribute
-  };
-
-  ItemData(ItemKind kind, const std::string& file_name, const std::string& grp_nm_fll, const std::string& item_nm,
-    ItemData *item_data_prn, ncdata_t *ncdata) :
-    m_file_name(file_name),
-    m_grp_nm_fll(grp_nm_fll),
-    m_item_nm(item_nm),
-    m_kind(kind),
-    m_item_data_prn(item_data_prn),
-    m_ncdata(ncdata)
-  {
-  }
-  ~ItemData()
+  int ret = app->exec();
+#if QT_VERSION >= 0x050000
+  if(!trace_file.isEmpty())
   {
-    delete m_ncdata;
-    for(size_t idx_dmn = 0; idx_dmn < m_ncvar_crd.size(); idx_dmn++)
-    {
-      delete m_ncvar_crd[idx_dmn];
-    }
+    trace_save(trace_file.toLatin1().data());
   }
-  std::string m_file_name;  // (Root/Variable/Group/Attribute) file name
-  std::string m_grp_nm_fll; // (Group) full name of group
-  std::string m_item_nm; // (Root/Variable/Group/Attribute ) item name to display on tree
-  ItemKind m_kind; // (Root/Variable/Group/Attribute) type of item 
-  std::vector<std::string> m_var_nms; // (Group) list of variables if item is group (filled in file iteration)
-  ItemData *m_item_data_prn; //  (Variable/Group) item data of the parent group (to get list of variables in group)
-  ncdata_t *m_ncdata; // (Variable, Attribute) netCDF variable/attribute to display
-  std::vector<ncdata_t *> m_ncvar_crd; // (Variable) optional coordinate variables for variable
-};
-
-Q_DECLARE_METATYPE(ItemData*);
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-//get_item_data
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-ItemData* get_item_data(QTreeWidgetItem *item)
-{
-  QVariant data = item->data(0, Qt::UserRole);
-  ItemData *item_data = data.value<ItemData*>();
-  return item_data;
+#endif
+  return ret;
 }
+#endif
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 //MainWindow::MainWindow
@@ -185,6 +124,29 @@ MainWindow::MainWindow()
 
   statusBar()->showMessage(tr("Ready"));
 
+  //progress of a reduction, shown while it runs
+  m_job_thread = NULL;
+  m_job_progress = new QProgressBar(this);
+  m_job_progress->setRange(0, 100);
+  m_job_progress->setMaximumWidth(200);
+  m_job_progress->hide();
+  m_job_cancel = new QToolButton(this);
+  m_job_cancel->setText(tr("Cancel"));
+  m_job_cancel->hide();
+  connect(m_job_cancel, SIGNAL(clicked()), this, SLOT(cancel_job()));
+  statusBar()->addPermanentWidget(m_job_progress);
+  statusBar()->addPermanentWidget(m_job_cancel);
+  m_job_timer = new QTimer(this);
+  connect(m_job_timer, SIGNAL(timeout()), this, SLOT(show_job_progress()));
+
+  //open files are watched; the records appended are read a second after the last change
+  m_watcher = new QFileSystemWatcher(this);
+  connect(m_watcher, SIGNAL(fileChanged(const QString &)), this, SLOT(file_changed(const QString &)));
+  m_refresh_timer = new QTimer(this);
+  m_refresh_timer->setSingleShot(true);
+  m_refresh_timer->setInterval(1000);
+  connect(m_refresh_timer, SIGNAL(timeout()), this, SLOT(refresh_files()));
+
   ///////////////////////////////////////////////////////////////////////////////////////
   //dock for tree
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -199,10 +161,35 @@ MainWindow::MainWindow()
   m_tree = new FileTreeWidget();
   m_tree->setHeaderHidden(1);
   m_tree->set_main_window(this);
+
+  //search box above the tree, filters as the user types
+  m_search = new QLineEdit;
+  m_search->setPlaceholderText(tr("Search: name, var:, dim:, att:, val:, name=value"));
+  connect(m_search, SIGNAL(textChanged(const QString &)), this, SLOT(search(const QString &)));
+  QWidget *tree_widget = new QWidget;
+  QVBoxLayout *tree_layout = new QVBoxLayout(tree_widget);
+  tree_layout->setContentsMargins(0, 0, 0, 0);
+  tree_layout->addWidget(m_search);
+  tree_layout->addWidget(m_tree);
+
   //add dock
-  m_tree_dock->setWidget(m_tree);
+  m_tree_dock->setWidget(tree_widget);
   addDockWidget(Qt::LeftDockWidgetArea, m_tree_dock);
 
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //dock for the storage layout of the current variable, below the tree
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  m_layout_id = 0;
+  m_layout_dock = new QDockWidget(tr("Storage"), this);
+  m_layout_dock->setFeatures(QDockWidget::DockWidgetClosable);
+  m_layout_text = new QPlainTextEdit;
+  m_layout_text->setReadOnly(true);
+  m_layout_text->setLineWrapMode(QPlainTextEdit::NoWrap);
+  m_layout_dock->setWidget(m_layout_text);
+  addDockWidget(Qt::LeftDockWidgetArea, m_layout_dock);
+  splitDockWidget(m_tree_dock, m_layout_dock, Qt::Vertical);
+
   ///////////////////////////////////////////////////////////////////////////////////////
   //actions
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -226,6 +213,31 @@ MainWindow::MainWindow()
   m_action_opendap->setStatusTip(tr("Open a OpenDap URL file"));
   connect(m_action_opendap, SIGNAL(triggered()), this, SLOT(open_dap()));
 
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //open_remote
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  m_action_open_remote = new QAction(tr("Open &Remote..."), this);
+  m_action_open_remote->setStatusTip(tr("Open a file of a netcdf-explorer server"));
+  connect(m_action_open_remote, SIGNAL(triggered()), this, SLOT(open_remote()));
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //open_series
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  m_action_open_series = new QAction(tr("Open &Series..."), this);
+  m_action_open_series->setStatusTip(tr("Open files split along time as one dataset"));
+  connect(m_action_open_series, SIGNAL(triggered()), this, SLOT(open_series()));
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //refresh
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  m_action_refresh = new QAction(tr("&Refresh"), this);
+  m_action_refresh->setShortcut(QKeySequence::Refresh);
+  m_action_refresh->setStatusTip(tr("Read the records appended to the open files"));
+  connect(m_action_refresh, SIGNAL(triggered()), this, SLOT(refresh_all()));
+
   ///////////////////////////////////////////////////////////////////////////////////////
   //exit
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -255,6 +267,36 @@ MainWindow::MainWindow()
   m_action_about->setStatusTip(tr("Show the application's About box"));
   connect(m_action_about, SIGNAL(triggered()), this, SLOT(about()));
 
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //performance tracing
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  m_action_trace_enable = new QAction(tr("&Enable tracing"), this);
+  m_action_trace_enable->setCheckable(true);
+  m_action_trace_enable->setStatusTip(tr("Record the netCDF calls and the table painting"));
+  connect(m_action_trace_enable, SIGNAL(toggled(bool)), this, SLOT(enable_trace(bool)));
+
+  m_action_trace_save = new QAction(tr("&Save trace..."), this);
+  m_action_trace_save->setStatusTip(tr("Save the recorded events as a Chrome trace file"));
+  connect(m_action_trace_save, SIGNAL(triggered()), this, SLOT(save_trace()));
+
+  m_action_trace_clear = new QAction(tr("&Clear trace"), this);
+  m_action_trace_clear->setStatusTip(tr("Discard the recorded events"));
+  connect(m_action_trace_clear, SIGNAL(triggered()), this, SLOT(clear_trace()));
+
+  m_action_memory = new QAction(tr("&Memory..."), this);
+  m_action_memory->setStatusTip(tr("Show the data buffer pool statistics"));
+  connect(m_action_memory, SIGNAL(triggered()), this, SLOT(show_memory()));
+
+  m_action_io = new QAction(tr("&I/O queue..."), this);
+  m_action_io->setStatusTip(tr("Show the I/O scheduler queue statistics"));
+  connect(m_action_io, SIGNAL(triggered()), this, SLOT(show_io()));
+
+  m_action_readers = new QAction(tr("&Reader processes"), this);
+  m_action_readers->setCheckable(true);
+  m_action_readers->setStatusTip(tr("Split large reads of local files among one reader process per core"));
+  connect(m_action_readers, SIGNAL(toggled(bool)), this, SLOT(enable_readers(bool)));
+
   ///////////////////////////////////////////////////////////////////////////////////////
   //recent files
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -273,6 +315,9 @@ MainWindow::MainWindow()
   m_menu_file = menuBar()->addMenu(tr("&File"));
   m_menu_file->addAction(m_action_open);
   m_menu_file->addAction(m_action_opendap);
+  m_menu_file->addAction(m_action_open_remote);
+  m_menu_file->addAction(m_action_open_series);
+  m_menu_file->addAction(m_action_refresh);
   m_action_separator_recent = m_menu_file->addSeparator();
   for(int i = 0; i < max_recent_files; ++i)
     m_menu_file->addAction(m_action_recent_file[i]);
@@ -282,8 +327,18 @@ MainWindow::MainWindow()
   m_menu_windows = menuBar()->addMenu(tr("&Window"));
   m_menu_windows->addAction(m_action_tile);
   m_menu_windows->addAction(m_action_close_all);
+  m_menu_windows->addSeparator();
+  m_menu_windows->addAction(m_layout_dock->toggleViewAction());
 
   m_menu_help = menuBar()->addMenu(tr("&Help"));
+  m_menu_performance = m_menu_help->addMenu(tr("&Performance"));
+  m_menu_performance->addAction(m_action_trace_enable);
+  m_menu_performance->addAction(m_action_trace_save);
+  m_menu_performance->addAction(m_action_trace_clear);
+  m_menu_performance->addSeparator();
+  m_menu_performance->addAction(m_action_memory);
+  m_menu_performance->addAction(m_action_io);
+  m_menu_performance->addAction(m_action_readers);
   m_menu_help->addAction(m_action_about);
 
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -304,6 +359,7 @@ MainWindow::MainWindow()
   QSettings settings("space", "netcdf_explorer");
   m_sl_recent_files = settings.value("recentFiles").toStringList();
   update_recent_file_actions();
+  m_action_readers->setChecked(settings.value("io/reader_processes", false).toBool());
 
   ///////////////////////////////////////////////////////////////////////////////////////
   //icons
@@ -313,6 +369,7 @@ MainWindow::MainWindow()
   m_icon_group = QIcon(":/images/folder.png");
   m_icon_dataset = QIcon(":/images/matrix.png");
   m_icon_attribute = QIcon(":/images/document.png");
+  m_tree->tree_model()->set_icons(m_icon_group, m_icon_dataset, m_icon_attribute);
 
   ///////////////////////////////////////////////////////////////////////////////////////
   //set main window icon
@@ -332,6 +389,147 @@ void MainWindow::about()
     tr("(c) 2015-2016 Pedro Vicente -- Space Research Software LLC\n\n"));
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::enable_trace
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::enable_trace(bool enable)
+{
+  trace_enable(enable);
+  statusBar()->showMessage(enable ? tr("Tracing on") : tr("Tracing off"));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::save_trace
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::save_trace()
+{
+  QString file_name = QFileDialog::getSaveFileName(this,
+    tr("Save Trace"), "trace.json",
+    tr("Chrome trace files (*.json);;All files (*.*)"));
+
+  if(file_name.isEmpty())
+    return;
+
+  if(!trace_save(file_name.toLatin1().data()))
+  {
+    QMessageBox::warning(this, tr("Save Trace"), tr("Cannot write %1").arg(file_name));
+    return;
+  }
+  statusBar()->showMessage(tr("Saved %1 events to %2").arg((qulonglong)trace_size()).arg(file_name));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::clear_trace
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::clear_trace()
+{
+  trace_clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::show_memory
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::show_memory()
+{
+  pool_stats_t pool = pool_stats();
+  QString str = tr("Allocations: %1\nHit rate: %2 %\nIn use: %3 MB\nHeld: %4 MB (limit %5 MB)\nMetadata: %6 MB")
+    .arg((qulonglong)pool.m_nbr_request)
+    .arg(pool.hit_rate() * 100.0, 0, 'f', 1)
+    .arg(pool.m_bytes_used / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg(pool.m_bytes_held / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg(pool.m_bytes_limit / (1024.0 * 1024.0), 0, 'f', 0)
+    .arg(m_tree->tree_model()->bytes() / (1024.0 * 1024.0), 0, 'f', 1);
+  cache_stats_t cache = cache_stats();
+  str += tr("\n\nTile tier (decoded): %1 % of %2 requests\nCompressed tier: %3 % of %4 reads\n"
+    "Compressed: %5 slabs, %6 MB for %7 MB (%8x, limit %9 MB), %10 evicted")
+    .arg(cache.tile_hit_rate() * 100.0, 0, 'f', 1)
+    .arg((qulonglong)(cache.m_nbr_tile_hit + cache.m_nbr_tile_miss))
+    .arg(cache.hit_rate() * 100.0, 0, 'f', 1)
+    .arg((qulonglong)(cache.m_nbr_hit + cache.m_nbr_miss))
+    .arg((qulonglong)cache.m_nbr_slab)
+    .arg(cache.m_bytes / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg(cache.m_bytes_raw / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg(cache.ratio(), 0, 'f', 1)
+    .arg(cache.m_bytes_limit / (1024.0 * 1024.0), 0, 'f', 0)
+    .arg((qulonglong)cache.m_nbr_evict);
+  QMessageBox::information(this, tr("Memory"), str);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::show_io
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::show_io()
+{
+  const char *name[io_nbr_priority] = { "visible", "layer", "prefetch", "background" };
+  io_stats_t io = IoScheduler::instance()->stats();
+  QString str = tr("Served: %1\nCancelled: %2\nMerged: %3\nMaximum depth: %4\n")
+    .arg((qulonglong)io.m_nbr_done)
+    .arg((qulonglong)io.m_nbr_cancelled)
+    .arg((qulonglong)io.m_nbr_merged)
+    .arg((qulonglong)io.m_depth_max);
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    double wait_ms = io.m_nbr_wait[idx] ? io.m_wait_ns[idx] / 1.0e6 / io.m_nbr_wait[idx] : 0.0;
+    str += tr("\n%1: queued %2, served %3, wait %4 ms (max %5 ms)")
+      .arg(name[idx])
+      .arg((qulonglong)io.m_depth[idx])
+      .arg((qulonglong)io.m_nbr_wait[idx])
+      .arg(wait_ms, 0, 'f', 2)
+      .arg(io.m_wait_ns_max[idx] / 1.0e6, 0, 'f', 2);
+  }
+  chunk_stats_t chunk = chunk_stats();
+  str += tr("\n\nChunks decompressed in parallel: %1 in %2 reads, %3 MB from %4 MB read, %5 reads left to netCDF")
+    .arg((qulonglong)chunk.m_nbr_chunk)
+    .arg((qulonglong)chunk.m_nbr_read)
+    .arg(chunk.m_bytes / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg(chunk.m_bytes_raw / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg((qulonglong)chunk.m_nbr_fallback);
+  reader_stats_t reader = reader_stats();
+  str += tr("\nReader processes: %1 running, %2 reads in %3 parts, %4 MB, %5 reads failed over to this process")
+    .arg((qulonglong)reader.m_nbr_process)
+    .arg((qulonglong)reader.m_nbr_read)
+    .arg((qulonglong)reader.m_nbr_part)
+    .arg(reader.m_bytes / (1024.0 * 1024.0), 0, 'f', 1)
+    .arg((qulonglong)reader.m_nbr_fallback);
+  QMessageBox::information(this, tr("I/O queue"), str);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::enable_readers
+//the processes are started by the I/O thread at its next read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::enable_readers(bool enable)
+{
+  int nbr = enable ? std::max(2, QThread::idealThreadCount()) : 0;
+  reader_set_processes(nbr);
+  QSettings settings("space", "netcdf_explorer");
+  settings.setValue("io/reader_processes", enable);
+  statusBar()->showMessage(enable ? tr("%1 reader processes").arg(nbr) : tr("Reader processes off"));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::search
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::search(const QString &text)
+{
+  QElapsedTimer timer;
+  timer.start();
+  size_t nbr_found = m_tree->search(text);
+  if(text.trimmed().isEmpty())
+  {
+    statusBar()->showMessage(tr("Ready"));
+    return;
+  }
+  statusBar()->showMessage(tr("%1 found in %2 ms").arg((qulonglong)nbr_found).arg(timer.nsecsElapsed() / 1.0e6, 0, 'f', 2));
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 //MainWindow::closeEvent
 /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -340,16 +538,26 @@ void MainWindow::closeEvent(QCloseEvent *eve)
 {
   QSettings settings("space", "netcdf_explorer");
   settings.setValue("recentFiles", m_sl_recent_files);
+  if(m_job_thread != NULL)
+  {
+    m_job_thread->m_cancel = true;
+  }
+  IoScheduler::instance()->stop();
+  if(m_job_thread != NULL)
+  {
+    m_job_thread->wait();
+  }
   eve->accept();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 //is_url
+//OPeNDAP URL, or file of a remote server; neither is a local file
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool is_url(QString file_name)
 {
-  bool isurl = (file_name.left(4) == "http");
+  bool isurl = (file_name.left(4) == "http") || is_remote(file_name.toStdString());
   return isurl;
 }
 
@@ -445,10 +653,7 @@ void MainWindow::open_file()
   if(file_name.isEmpty())
     return;
 
-  if(this->read_file(file_name) == NC_NOERR)
-  {
-    this->set_current_file(file_name);
-  }
+  this->read_file(file_name);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -464,10 +669,41 @@ void MainWindow::open_dap()
   if(QDialog::Accepted == dlg.exec())
   {
     QString file_name = dlg.textValue();
-    if(this->read_file(file_name) == NC_NOERR)
-    {
-      this->set_current_file(file_name);
-    }
+    this->read_file(file_name);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::open_remote
+//a file of a server started with --serve, on this host or through an SSH tunnel
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::open_remote()
+{
+  QInputDialog dlg(this);
+  dlg.setInputMode(QInputDialog::TextInput);
+  dlg.setLabelText(QString("Server file (ncx://localhost:%1/data/file.nc)").arg(remote_port));
+  dlg.setTextValue(QString("ncx://localhost:%1/").arg(remote_port));
+  dlg.resize(QSize(400, 60));
+  if(QDialog::Accepted == dlg.exec())
+  {
+    this->read_file(dlg.textValue());
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::open_series
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::open_series()
+{
+  QInputDialog dlg(this);
+  dlg.setInputMode(QInputDialog::TextInput);
+  dlg.setLabelText("Files (glob such as /data/tas_*.nc) or NcML file");
+  dlg.resize(QSize(400, 60));
+  if(QDialog::Accepted == dlg.exec())
+  {
+    this->read_series(dlg.textValue());
   }
 }
 
@@ -491,12 +727,7 @@ void MainWindow::open_recent_file()
 int MainWindow::read_file(QString file_name)
 {
   QByteArray ba;
-  int nc_id;
-  std::string path;
   std::string str_file_name;
-  QString name;
-  int index;
-  int len;
 
   //convert QString to char*
   ba = file_name.toLatin1();
@@ -504,337 +735,658 @@ int MainWindow::read_file(QString file_name)
   //convert to std::string
   str_file_name = ba.data();
 
-  if(nc_open(str_file_name.c_str(), NC_NOWRITE, &nc_id) != NC_NOERR)
+  //metadata scan on the I/O thread; the tree is built when it is done
+  meta_store_t *store = new meta_store_t(str_file_name);
+  std::shared_ptr<int> status(new int(NC_NOERR));
+  IoScheduler::instance()->run_job([str_file_name, store, status]()
   {
-    qDebug() << str_file_name.c_str();
-    return NC2_ERR;
-  }
-
-  //group item
-  ItemData *item_data_grp = new ItemData(ItemData::Group,
-    str_file_name,
-    "/",
-    "/",
-    (ItemData*)NULL,
-    (ncdata_t*)NULL);
-
-  //add root
-  QTreeWidgetItem *root_item = new QTreeWidgetItem(m_tree);
-  index = file_name.lastIndexOf(QChar('/'));
-  len = file_name.length();
-  name = file_name.right(len - index - 1);
-  root_item->setText(0, name);
-  root_item->setIcon(0, m_icon_group);
-  QVariant data;
-  data.setValue(item_data_grp);
-  root_item->setData(0, Qt::UserRole, data);
+    int nc_id;
+    if(is_remote(str_file_name))
+    {
+      *status = remote_meta_read(str_file_name, store);
+      return;
+    }
+    if(NC_TRACE("nc_open", str_file_name.c_str(), 0, nc_open(str_file_name.c_str(), NC_NOWRITE, &nc_id)) != NC_NOERR)
+    {
+      *status = NC2_ERR;
+      return;
+    }
+    if(meta_scan(store, nc_id) != NC_NOERR)
+    {
+      *status = NC2_ERR;
+    }
+    if(NC_TRACE("nc_close", NULL, 0, nc_close(nc_id)) != NC_NOERR)
+    {
 
-  if(iterate(str_file_name, nc_id, root_item) != NC_NOERR)
+    }
+  }, io_visible, this, [this, file_name, store, status](io_request_t *)
   {
+    if(*status != NC_NOERR)
+    {
+      delete store;
+      statusBar()->showMessage(tr("Cannot open %1").arg(file_name));
+      return;
+    }
+    add_file(store);
+    set_current_file(file_name);
+  });
 
-  }
-
-  if(nc_close(nc_id) != NC_NOERR)
-  {
+  return NC_NOERR;
+}
 
-  }
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::read_series
+//a file series: member files and their number of records, then the metadata scan of the first file
+///////////////////////////////////////////////////////////////////////////////////////
 
+int MainWindow::read_series(QString spec)
+{
+  std::string str_spec = spec.toStdString();
+  std::shared_ptr<series_t> series(new series_t);
+  series->m_name = str_spec;
+  std::shared_ptr<meta_store_t*> store(new meta_store_t*(NULL));
+  IoScheduler::instance()->run_job([str_spec, series, store]()
+  {
+    std::vector<std::string> files;
+    std::string dim_nm;
+    int nc_id;
+    if(series_list(str_spec, files, dim_nm) != NC_NOERR)
+    {
+      return;
+    }
+    if(series_open(series.get(), files, dim_nm) != NC_NOERR)
+    {
+      return;
+    }
+    if(series->open(0, &nc_id) != NC_NOERR)
+    {
+      return;
+    }
+    *store = new meta_store_t(files[0]);
+    if(meta_scan(*store, nc_id) != NC_NOERR)
+    {
+      delete *store;
+      *store = NULL;
+      return;
+    }
+    series_apply(*series, *store);
+    (*store)->m_series = series;
+  }, io_visible, this, [this, spec, series, store](io_request_t *)
+  {
+    if(*store == NULL)
+    {
+      statusBar()->showMessage(tr("Cannot open series %1").arg(spec));
+      return;
+    }
+    add_file(*store);
+    statusBar()->showMessage(tr("Series of %1 files, %2 records along %3").arg(series->size())
+      .arg(series->records()).arg(QString::fromStdString(series->m_dim_nm)));
+  });
 
   return NC_NOERR;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//MainWindow::iterate
+//MainWindow::add_file
+//add the tree of a scanned file; the tree model owns the store
 ///////////////////////////////////////////////////////////////////////////////////////
 
-int MainWindow::iterate(const std::string& file_name, const int grp_id, QTreeWidgetItem *tree_item_parent)
+void MainWindow::add_file(meta_store_t *store)
 {
-  char grp_nm[NC_MAX_NAME + 1]; // group name 
-  char var_nm[NC_MAX_NAME + 1]; // variable name 
-  char *grp_nm_fll = NULL; // group full name 
-  int nbr_att; // number of attributes 
-  int nbr_dmn_grp; // number of dimensions for group 
-  int nbr_var; // number of variables 
-  int nbr_grp; // number of sub-groups in this group 
-  int nbr_dmn_var; // number of dimensions for variable 
-  nc_type var_typ; // netCDF type 
-  int *grp_ids; // sub-group IDs array
-  size_t grp_nm_lng; //lenght of full group name
-  int var_dimid[NC_MAX_VAR_DIMS]; // dimensions for variable
-  size_t dmn_sz[NC_MAX_VAR_DIMS]; // dimensions for variable sizes
-  char dmn_nm_var[NC_MAX_NAME + 1]; //dimension name
+  m_tree->add_file(store);
+  QString file_name = QString::fromUtf8(store->m_file_name.c_str());
+  if(!store->m_series && !store->m_source && !is_url(file_name))
+  {
+    m_watcher->addPath(file_name);
+  }
+}
 
-  //get item data (of parent item), to store a list of variable names 
-  ItemData *item_data_prn = get_item_data(tree_item_parent);
-  assert(item_data_prn->m_kind == ItemData::Group || item_data_prn->m_kind == ItemData::Root);
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::close_files
+//removes all the files from the tree, with their metadata; the tables must be closed first
+///////////////////////////////////////////////////////////////////////////////////////
 
-  // get full name of (parent) group
-  if(nc_inq_grpname_full(grp_id, &grp_nm_lng, NULL) != NC_NOERR)
+void MainWindow::close_files()
+{
+  m_tree->clear_files();
+  QStringList files = m_watcher->files();
+  for(int idx = 0; idx < files.size(); idx++)
   {
-
+    m_watcher->removePath(files[idx]);
   }
+  m_refresh_pending.clear();
+}
 
-  grp_nm_fll = new char[grp_nm_lng + 1];
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::file_changed
+///////////////////////////////////////////////////////////////////////////////////////
 
-  if(nc_inq_grpname_full(grp_id, &grp_nm_lng, grp_nm_fll) != NC_NOERR)
+void MainWindow::file_changed(const QString &path)
+{
+  if(!m_refresh_pending.contains(path))
   {
-
+    m_refresh_pending.append(path);
   }
+  m_refresh_timer->start();
+}
 
-  if(nc_inq(grp_id, &nbr_dmn_grp, &nbr_var, &nbr_att, (int *)NULL) != NC_NOERR)
-  {
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::refresh_all
+//files on file systems that do not report changes are refreshed by hand
+///////////////////////////////////////////////////////////////////////////////////////
 
+void MainWindow::refresh_all()
+{
+  QStringList files = m_watcher->files();
+  for(int idx = 0; idx < files.size(); idx++)
+  {
+    if(!m_refresh_pending.contains(files[idx]))
+    {
+      m_refresh_pending.append(files[idx]);
+    }
   }
+  refresh_files();
+}
 
-  ///////////////////////////////////////////////////////////////////////////////////////
-  //populate group attribues
-  ///////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::refresh_files
+//a file is refreshed once at a time; changes during its refresh wait for the next
+///////////////////////////////////////////////////////////////////////////////////////
 
-  for(int idx_att = 0; idx_att < nbr_att; idx_att++)
+void MainWindow::refresh_files()
+{
+  QStringList pending;
+  for(int idx = 0; idx < m_refresh_pending.size(); idx++)
   {
-    char attr_name[255];
-    nc_type attr_typ;
-    size_t size_attr;
-
-    if(nc_inq_attname(grp_id, NC_GLOBAL, idx_att, attr_name) != NC_NOERR)
+    const QString &file_name = m_refresh_pending[idx];
+    if(m_refresh_busy.contains(file_name))
     {
-
+      pending.append(file_name);
+      continue;
     }
-
-    if(nc_inq_att(grp_id, NC_GLOBAL, attr_name, &attr_typ, &size_attr) != NC_NOERR)
+    //a file replaced by a rename is no longer watched
+    if(!m_watcher->files().contains(file_name) && QFileInfo(file_name).exists())
     {
-
+      m_watcher->addPath(file_name);
     }
-
-    //store a ncdata_t 
-    std::vector<size_t> dim_attr;
-    dim_attr.push_back(size_attr);
-    ncdata_t *ncattr = new ncdata_t(attr_name, attr_typ, dim_attr);
-    dim_attr.clear();
-
-    //set item data
-    ItemData *item_data = new ItemData(ItemData::Attribute,
-      file_name,
-      grp_nm_fll,
-      attr_name,
-      item_data_prn, //parent for attribute is the goup item data (
-      ncattr);
-
-    //store an empty coordinate variable for grid variable compability (print indices in table headers)
-    item_data->m_ncvar_crd.push_back(NULL);
-
-    //append item to group item
-    QTreeWidgetItem *item_attr = new QTreeWidgetItem(tree_item_parent);
-    item_attr->setText(0, attr_name);
-    item_attr->setIcon(0, m_icon_attribute);
-    QVariant data_attr;
-    data_attr.setValue(item_data);
-    item_attr->setData(0, Qt::UserRole, data_attr);
-
+    refresh_file(file_name);
+  }
+  m_refresh_pending = pending;
+  if(!m_refresh_pending.isEmpty())
+  {
+    m_refresh_timer->start();
   }
+}
 
-  ///////////////////////////////////////////////////////////////////////////////////////
-  //populate variables
-  ///////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::refresh_file
+//records appended to an open file: the file is opened again on the I/O thread, the dimensions that
+//grew are found from the store, and only the new records of the opened variables are read; the store,
+//the variables and their tables are then extended in place, keeping the layers and tiles read
+///////////////////////////////////////////////////////////////////////////////////////
 
-  for(int idx_var = 0; idx_var < nbr_var; idx_var++)
+void MainWindow::refresh_file(const QString &file_name)
+{
+  FileTreeModel *tree_model = m_tree->tree_model();
+  meta_store_t *store = tree_model->find_store(file_name.toStdString());
+  if(store == NULL)
   {
-    std::vector<size_t> dim; //dimensions for each variable 
-
-    if(nc_inq_var(grp_id, idx_var, var_nm, &var_typ, &nbr_dmn_var, var_dimid, &nbr_att) != NC_NOERR)
+    return;
+  }
+  std::string str_file_name = store->m_file_name;
+  std::vector<ItemData*> items = tree_model->opened_variables(store);
+  std::shared_ptr<std::vector<std::pair<size_t, size_t> > > grown(new std::vector<std::pair<size_t, size_t> >);
+  std::shared_ptr<std::vector<item_growth_t> > growth(new std::vector<item_growth_t>(items.size()));
+  std::shared_ptr<int> status(new int(NC_NOERR));
+  m_refresh_busy.append(file_name);
+  IoScheduler::instance()->run_job([str_file_name, store, items, grown, growth, status]()
+  {
+    int nc_id;
+    io_close(str_file_name);
+    if(io_open(str_file_name, &nc_id) != NC_NOERR || meta_grow(store, nc_id, grown.get()) != NC_NOERR)
     {
-
+      //rewritten: the slabs held compressed are not its data anymore
+      cache_close(str_file_name);
+      *status = NC2_ERR;
+      return;
     }
-
-    //store variable name in parent group item (for coordinate variables detection)
-    item_data_prn->m_var_nms.push_back(var_nm);
-
-    //get dimensions
-    for(int idx_dmn = 0; idx_dmn < nbr_dmn_var; idx_dmn++)
+    for(size_t idx = 0; idx < items.size() && !grown->empty(); idx++)
     {
-      //dimensions belong to groups
-      if(nc_inq_dim(grp_id, var_dimid[idx_dmn], dmn_nm_var, &dmn_sz[idx_dmn]) != NC_NOERR)
+      if(grow_item(nc_id, items[idx], &(*growth)[idx]) != NC_NOERR)
       {
-
+        *status = NC2_ERR;
+        return;
       }
+    }
+  }, io_visible, this, [this, file_name, store, grown, growth, status](io_request_t *)
+  {
+    m_refresh_busy.removeAll(file_name);
+    if(*status != NC_NOERR)
+    {
+      statusBar()->showMessage(tr("%1 was rewritten; open it again to see its changes").arg(file_name));
+      return;
+    }
 
-      //store dimension 
-      dim.push_back(dmn_sz[idx_dmn]);
+    //tiles of the file whose read failed are read again
+    QList<QMdiSubWindow *> windows = m_mdi_area->subWindowList();
+    for(int idx_wnd = 0; idx_wnd < windows.size(); idx_wnd++)
+    {
+      ChildWindow *window = qobject_cast<ChildWindow *>(windows[idx_wnd]->widget());
+      if(window != NULL && window->model() != NULL && window->model()->m_item_data->m_file_name == store->m_file_name)
+      {
+        window->model()->reload_failed();
+      }
+    }
+    if(grown->empty())
+    {
+      return;
+    }
+    for(size_t idx = 0; idx < grown->size(); idx++)
+    {
+      store->m_dim[(*grown)[idx].first] = (*grown)[idx].second;
+    }
+    for(size_t idx = 0; idx < growth->size(); idx++)
+    {
+      item_growth_t &item_growth = (*growth)[idx];
+      if(item_growth.m_item_data == NULL)
+      {
+        continue;
+      }
+      //a sort may be reading the buffers that are extended
+      std::vector<ChildWindow *> tables;
+      for(int idx_wnd = 0; idx_wnd < windows.size(); idx_wnd++)
+      {
+        ChildWindow *window = qobject_cast<ChildWindow *>(windows[idx_wnd]->widget());
+        if(window != NULL && window->model() != NULL && window->model()->m_item_data == item_growth.m_item_data)
+        {
+          window->model()->wait_sort();
+          tables.push_back(window);
+        }
+      }
+      std::vector<size_t> dim_old = item_growth.m_item_data->m_ncdata->m_dim;
+      apply_growth(&item_growth);
+      for(size_t idx_tbl = 0; idx_tbl < tables.size(); idx_tbl++)
+      {
+        tables[idx_tbl]->grow(dim_old);
+      }
     }
+    statusBar()->showMessage(tr("%1: records appended").arg(last_component(file_name)), 5000);
+  });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::TableView
+//direct paint is a setting, changed from the toolbar of a table
+///////////////////////////////////////////////////////////////////////////////////////
 
-    //store a ncdata_t 
-    ncdata_t *ncvar = new ncdata_t(var_nm, var_typ, dim);
+TableView::TableView(QWidget *parent) : QTableView(parent)
+{
+  QSettings settings("space", "netcdf_explorer");
+  m_direct = settings.value("table/direct_paint", false).toBool();
+}
 
-    //set item data
-    ItemData *item_data_var = new ItemData(ItemData::Variable,
-      file_name,
-      grp_nm_fll,
-      var_nm,
-      item_data_prn,
-      ncvar);
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::set_direct_paint
+///////////////////////////////////////////////////////////////////////////////////////
 
-    //append item
-    QTreeWidgetItem *item_var = new QTreeWidgetItem(tree_item_parent);
-    item_var->setText(0, var_nm);
-    item_var->setIcon(0, m_icon_dataset);
-    QVariant data_var;
-    data_var.setValue(item_data_var);
-    item_var->setData(0, Qt::UserRole, data_var);
+void TableView::set_direct_paint(bool direct)
+{
+  m_direct = direct;
+  viewport()->update();
+}
 
-    ///////////////////////////////////////////////////////////////////////////////////////
-    //populate variable attribues
-    ///////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::paintEvent
+///////////////////////////////////////////////////////////////////////////////////////
+
+void TableView::paintEvent(QPaintEvent *eve)
+{
+  trace_t trace("QTableView::paintEvent");
+  if(m_direct && dynamic_cast<TableModel*> (model()) != NULL)
+  {
+    paint_cells(eve);
+    return;
+  }
+  QTableView::paintEvent(eve);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::paint_cells
+//the cells of the rectangle to paint; the glyphs and advances of the ASCII characters are looked up once
+//per font; cells with other characters (NC_STRING, NC_CHAR) are drawn as text, cells not read yet are
+//left empty until their tile arrives
+///////////////////////////////////////////////////////////////////////////////////////
+
+void TableView::paint_cells(QPaintEvent *eve)
+{
+  TableModel *model = static_cast<TableModel*> (this->model());
+  QPainter painter(viewport());
+  const QRect rect = eve->rect();
+  const QPalette &pal = palette();
+  painter.fillRect(rect, pal.base());
+  int row_first = rowAt(rect.top());
+  int col_first = columnAt(rect.left());
+  if(row_first < 0 || col_first < 0)
+  {
+    return;
+  }
+  int row_last = rowAt(rect.bottom());
+  int col_last = columnAt(rect.right());
+  row_last = row_last < 0 ? model->rowCount() - 1 : row_last;
+  col_last = col_last < 0 ? model->columnCount() - 1 : col_last;
 
-    for(int idx_att = 0; idx_att < nbr_att; idx_att++)
+  if(!m_raw_font.isValid() || m_glyph_font != font())
+  {
+    m_glyph_font = font();
+    m_raw_font = QRawFont::fromFont(m_glyph_font);
+    QChar chr[128];
+    QPointF advance[128];
+    for(int idx = 0; idx < 128; idx++)
     {
-      char attr_name[255];
-      nc_type attr_typ;
-      size_t size_attr;
+      chr[idx] = QChar(idx);
+    }
+    int nbr_glyph = 128;
+    m_raw_font.glyphIndexesForChars(chr, 128, m_glyph, &nbr_glyph);
+    m_raw_font.advancesForGlyphIndexes(m_glyph, advance, 128);
+    for(int idx = 0; idx < 128; idx++)
+    {
+      m_advance[idx] = advance[idx].x();
+    }
+  }
 
-      if(nc_inq_attname(grp_id, idx_var, idx_att, attr_name) != NC_NOERR)
+  //text from the left, centered vertically, as the item delegate
+  const int margin = style()->pixelMetric(QStyle::PM_FocusFrameHMargin, 0, this) + 1;
+  QFontMetrics metrics(font());
+  QItemSelectionModel *selection = selectionModel();
+  char str[256];
+  for(int idx = 0; idx < 2; idx++)
+  {
+    m_run_glyph[idx].resize(0);
+    m_run_pos[idx].resize(0);
+  }
+  for(int row = row_first; row <= row_last; row++)
+  {
+    int y = rowViewportPosition(row);
+    int h = rowHeight(row);
+    qreal baseline = y + (h + metrics.ascent() - metrics.descent()) / 2;
+    for(int col = col_first; col <= col_last; col++)
+    {
+      int x = columnViewportPosition(col);
+      int w = columnWidth(col);
+      int selected = selection != NULL && selection->isSelected(model->index(row, col)) ? 1 : 0;
+      if(selected)
       {
-
+        painter.fillRect(x, y, w, h, pal.highlight());
       }
-
-      if(nc_inq_att(grp_id, idx_var, attr_name, &attr_typ, &size_attr) != NC_NOERR)
+      int len = model->cell_text(row, col, str, sizeof(str));
+      bool ascii = true;
+      for(int idx = 0; idx < len && ascii; idx++)
       {
-
+        ascii = str[idx] >= ' ' && (unsigned char)str[idx] < 128;
+      }
+      if(!ascii)
+      {
+        painter.setPen(pal.color(selected ? QPalette::HighlightedText : QPalette::Text));
+        painter.drawText(QRect(x + margin, y, w - 2 * margin, h), Qt::AlignLeft | Qt::AlignVCenter, QString::fromUtf8(str, len));
+        continue;
+      }
+      //glyphs that do not fit the cell are cut
+      qreal pen = x + margin;
+      qreal end = x + w - margin;
+      for(int idx = 0; idx < len; idx++)
+      {
+        unsigned char chr = str[idx];
+        if(pen + m_advance[chr] > end)
+        {
+          break;
+        }
+        m_run_glyph[selected].append(m_glyph[chr]);
+        m_run_pos[selected].append(QPointF(pen, baseline));
+        pen += m_advance[chr];
       }
-
-      //store a ncdata_t 
-      std::vector<size_t> dim_attr;
-      dim_attr.push_back(size_attr);
-      ncdata_t *ncattr = new ncdata_t(attr_name, attr_typ, dim_attr);
-      dim_attr.clear();
-
-      //set item data
-      ItemData *item_data = new ItemData(ItemData::Attribute,
-        file_name,
-        grp_nm_fll,
-        attr_name,
-        item_data_var, //parent for attribute is the variable item data (contains variable name)
-        ncattr);
-
-      //store an empty coordinate variable for grid variable compability (print indices in table headers)
-      item_data->m_ncvar_crd.push_back(NULL);
-
-      //append item to variable item
-      QTreeWidgetItem *item_attr = new QTreeWidgetItem(item_var);
-      item_attr->setText(0, attr_name);
-      item_attr->setIcon(0, m_icon_attribute);
-      QVariant data_attr;
-      data_attr.setValue(item_data);
-      item_attr->setData(0, Qt::UserRole, data_attr);
     }
   }
-
-  if(nc_inq_grps(grp_id, &nbr_grp, (int *)NULL) != NC_NOERR)
+  for(int idx = 0; idx < 2; idx++)
   {
+    if(m_run_glyph[idx].isEmpty())
+    {
+      continue;
+    }
+    QGlyphRun run;
+    run.setRawFont(m_raw_font);
+    run.setGlyphIndexes(m_run_glyph[idx]);
+    run.setPositions(m_run_pos[idx]);
+    painter.setPen(pal.color(idx ? QPalette::HighlightedText : QPalette::Text));
+    painter.drawGlyphRun(QPointF(0, 0), run);
+  }
 
+  //grid lines at the right and bottom of the cells, and the current cell
+  if(showGrid())
+  {
+    int x_end = columnViewportPosition(col_last) + columnWidth(col_last) - 1;
+    int y_end = rowViewportPosition(row_last) + rowHeight(row_last) - 1;
+    painter.setPen(QPen(QColor(static_cast<QRgb> (style()->styleHint(QStyle::SH_Table_GridLineColor, 0, this))), 0, gridStyle()));
+    for(int row = row_first; row <= row_last; row++)
+    {
+      int y = rowViewportPosition(row) + rowHeight(row) - 1;
+      painter.drawLine(rect.left(), y, x_end, y);
+    }
+    for(int col = col_first; col <= col_last; col++)
+    {
+      int x = columnViewportPosition(col) + columnWidth(col) - 1;
+      painter.drawLine(x, rect.top(), x, y_end);
+    }
+  }
+  QModelIndex current = currentIndex();
+  if(current.isValid() && hasFocus())
+  {
+    painter.setPen(QPen(pal.color(QPalette::Text), 0, Qt::DotLine));
+    painter.drawRect(visualRect(current).adjusted(0, 0, -2, -2));
   }
+}
 
-  grp_ids = new int[nbr_grp];
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::keyPressEvent
+///////////////////////////////////////////////////////////////////////////////////////
 
-  if(nc_inq_grps(grp_id, &nbr_grp, grp_ids) != NC_NOERR)
+void TableView::keyPressEvent(QKeyEvent *eve)
+{
+  if(eve->matches(QKeySequence::Copy))
   {
-
+    copy_selection();
+    return;
   }
+  QTableView::keyPressEvent(eve);
+}
 
-  ///////////////////////////////////////////////////////////////////////////////////////
-  //populate groups
-  ///////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::copy_selection
+//the cells in the box of the selection, the ones not selected empty; cells not read yet are requested and
+//copied empty
+///////////////////////////////////////////////////////////////////////////////////////
 
-  for(int idx_grp = 0; idx_grp < nbr_grp; idx_grp++)
+void TableView::copy_selection()
+{
+  TableModel *model = dynamic_cast<TableModel*> (this->model());
+  if(model == NULL || selectionModel() == NULL || !selectionModel()->hasSelection())
   {
-    if(nc_inq_grpname(grp_ids[idx_grp], grp_nm) != NC_NOERR)
-    {
+    return;
+  }
+  const QItemSelection selection = selectionModel()->selection();
+  int top = INT_MAX;
+  int left = INT_MAX;
+  int bottom = -1;
+  int right = -1;
+  for(int idx = 0; idx < selection.size(); idx++)
+  {
+    top = std::min(top, selection.at(idx).top());
+    left = std::min(left, selection.at(idx).left());
+    bottom = std::max(bottom, selection.at(idx).bottom());
+    right = std::max(right, selection.at(idx).right());
+  }
+  QMainWindow *window = model->m_widget;
+  if((double)(bottom - top + 1) * (right - left + 1) > (double)(1 << 22))
+  {
+    window->statusBar()->showMessage(tr("Too many cells to copy"));
+    return;
+  }
 
+  std::string text;
+  char str[256];
+  size_t nbr_missing = 0;
+  for(int row = top; row <= bottom; row++)
+  {
+    for(int col = left; col <= right; col++)
+    {
+      if(selection.contains(model->index(row, col)))
+      {
+        int len = model->cell_text(row, col, str, sizeof(str));
+        if(len < 0)
+        {
+          nbr_missing++;
+        }
+        text.append(str, std::max(0, len));
+      }
+      text += col < right ? '\t' : '\n';
     }
+  }
+  QApplication::clipboard()->setText(QString::fromUtf8(text.c_str(), (int)text.size()));
+  if(nbr_missing)
+  {
+    window->statusBar()->showMessage(tr("%1 cells not read yet were copied empty").arg((qulonglong)nbr_missing));
+  }
+}
 
-    //group item
-    ItemData *item_data_grp = new ItemData(ItemData::Group,
-      file_name,
-      grp_nm_fll,
-      grp_nm,
-      item_data_prn,
-      (ncdata_t*)NULL);
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::scrollContentsBy
+//tell the model which rows are on screen, so that reads of rows scrolled away are dropped
+///////////////////////////////////////////////////////////////////////////////////////
 
-    //group item
-    QTreeWidgetItem *item_grp = new QTreeWidgetItem(tree_item_parent);
-    item_grp->setText(0, grp_nm);
-    item_grp->setIcon(0, m_icon_group);
-    QVariant data;
-    data.setValue(item_data_grp);
-    item_grp->setData(0, Qt::UserRole, data);
+void TableView::scrollContentsBy(int dx, int dy)
+{
+  QTableView::scrollContentsBy(dx, dy);
+  if(dy != 0)
+  {
+    view_rows();
+  }
+}
 
-    if(iterate(file_name, grp_ids[idx_grp], item_grp) != NC_NOERR)
-    {
+///////////////////////////////////////////////////////////////////////////////////////
+//TableView::view_rows
+///////////////////////////////////////////////////////////////////////////////////////
 
-    }
+void TableView::view_rows()
+{
+  TableModel *model = dynamic_cast<TableModel*> (this->model());
+  if(model != NULL)
+  {
+    int row_first = rowAt(0);
+    int row_last = rowAt(viewport()->height() - 1);
+    model->view_rows(row_first, row_last < 0 ? model->rowCount() - 1 : row_last);
   }
+}
 
-  delete[] grp_ids;
-  delete[] grp_nm_fll;
+///////////////////////////////////////////////////////////////////////////////////////
+//TablePager::TablePager
+///////////////////////////////////////////////////////////////////////////////////////
 
-  return NC_NOERR;
+TablePager::TablePager(QWidget *parent, TableView *table, TableModel *model) : QWidget(parent),
+m_table(table),
+m_model(model)
+{
+  m_model->m_pager = this;
+  m_bar = new QScrollBar(Qt::Vertical, this);
+  connect(m_bar, SIGNAL(valueChanged(int)), this, SLOT(page_moved(int)));
+  m_bar_go = new QWidget(this);
+  m_label = new QLabel(m_bar_go);
+  m_edit = new QLineEdit(m_bar_go);
+  m_edit->setPlaceholderText(tr("Go to row"));
+  connect(m_edit, SIGNAL(returnPressed()), this, SLOT(go_to_row()));
+  QHBoxLayout *layout_go = new QHBoxLayout(m_bar_go);
+  layout_go->setContentsMargins(0, 0, 0, 0);
+  layout_go->addWidget(m_label);
+  layout_go->addStretch();
+  layout_go->addWidget(m_edit);
+
+  QGridLayout *layout = new QGridLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->setSpacing(0);
+  layout->addWidget(m_bar_go, 0, 0, 1, 2);
+  layout->addWidget(m_table, 1, 0);
+  layout->addWidget(m_bar, 1, 1);
+  update_range();
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-//TableModel
-/////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////
+//TablePager::page_step
+//rows per step of the bar: half the window
+///////////////////////////////////////////////////////////////////////////////////////
 
-class TableModel : public QAbstractTableModel
+size_t TablePager::page_step() const
 {
-public:
-  TableModel(QObject *parent, ItemData *item_data);
-  int rowCount(const QModelIndex &parent = QModelIndex()) const;
-  int columnCount(const QModelIndex &parent = QModelIndex()) const;
-  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
-  //display custom header data
-  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+  return std::max<size_t>(1, m_model->rowCount() / 2);
+}
 
-  ChildWindow* m_widget; //get layers in toolbar
-  int m_nbr_rows;   // number of rows
-  int m_nbr_cols;   // number of columns
-  void data_changed(); //update table view when change of layer
+///////////////////////////////////////////////////////////////////////////////////////
+//TablePager::update_range
+//the pager is hidden while the model shows all the rows
+///////////////////////////////////////////////////////////////////////////////////////
 
-  ItemData *m_item_data; // the tree item that generated this grid
-  ncdata_t *m_ncdata; // netCDF data to display (convenience pointer to data in ItemData)
-  int m_dim_rows;   // choose rows (convenience duplicate to data in ItemData)
-  int m_dim_cols;   // choose columns (convenience duplicate to data in ItemData)
-  std::vector<ncdata_t *> m_ncvar_crd; // optional coordinate variables for variable (convenience duplicate to data in ItemData)
-};
+void TablePager::update_range()
+{
+  size_t nbr_shown = m_model->rows_shown();
+  size_t nbr_win = m_model->rowCount();
+  bool paged = nbr_shown > nbr_win;
+  m_bar->setVisible(paged);
+  m_bar_go->setVisible(paged);
+  if(!paged)
+  {
+    return;
+  }
+  size_t step = page_step();
+  m_bar->blockSignals(true);
+  m_bar->setRange(0, (int)((nbr_shown - nbr_win + step - 1) / step));
+  m_bar->setPageStep(2);
+  m_bar->setValue((int)((m_model->m_row_first + step - 1) / step));
+  m_bar->blockSignals(false);
+  m_label->setText(tr("Rows %1 to %2 of %3").arg((qulonglong)m_model->m_row_first + 1)
+    .arg((qulonglong)(m_model->m_row_first + nbr_win)).arg((qulonglong)nbr_shown));
+}
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-//ChildWindowTable
-//model/view
-/////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////
+//TablePager::page_moved
+///////////////////////////////////////////////////////////////////////////////////////
 
-class ChildWindowTable : public ChildWindow
+void TablePager::page_moved(int value)
 {
-public:
-  ChildWindowTable(QWidget *parent, ItemData *item_data) :
-    ChildWindow(parent, item_data)
-  {
-    //each new table widget has its own model
-    m_model = new TableModel(this, item_data);
-    m_model->m_widget = this;
-    m_table = new QTableView(this);
-    m_table->setModel(m_model);
+  m_model->move_window((size_t)value * page_step());
+  m_table->view_rows();
+}
 
-    //set default row height
-    QHeaderView *verticalHeader = m_table->verticalHeader();
-#if QT_VERSION >= 0x050000
-    verticalHeader->sectionResizeMode(QHeaderView::Fixed);
-#else
-    verticalHeader->setResizeMode(QHeaderView::Fixed);
-#endif
-    verticalHeader->setDefaultSectionSize(24);
-    setCentralWidget(m_table);
+///////////////////////////////////////////////////////////////////////////////////////
+//TablePager::go_to_row
+//position in the rows shown, from 1; the window is centered on it where possible
+///////////////////////////////////////////////////////////////////////////////////////
+
+void TablePager::go_to_row()
+{
+  bool ok = false;
+  qulonglong pos = m_edit->text().trimmed().toULongLong(&ok);
+  size_t nbr_shown = m_model->rows_shown();
+  if(!ok || pos < 1 || pos > nbr_shown)
+  {
+    m_edit->selectAll();
+    return;
   }
-private:
-  QTableView *m_table;
-};
+  size_t row = (size_t)pos - 1;
+  size_t half = m_model->rowCount() / 2;
+  m_model->move_window(row > half ? row - half : 0);
+  int column = m_table->currentIndex().isValid() ? m_table->currentIndex().column() : 0;
+  QModelIndex index = m_model->index((int)(row - m_model->m_row_first), column);
+  m_table->setCurrentIndex(index);
+  m_table->scrollTo(index, QAbstractItemView::PositionAtCenter);
+  m_table->view_rows();
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //MainWindow::add_table
@@ -848,896 +1400,3971 @@ void MainWindow::add_table(ItemData *item_data)
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//ChildWindow::ChildWindow
+//MainWindow::add_diff
+//the coordinate variables of A and B are loaded on the I/O thread; the diff of variables of less
+//than two dimensions is computed there whole, others are read by tiles
 ///////////////////////////////////////////////////////////////////////////////////////
 
-ChildWindow::ChildWindow(QWidget *parent, ItemData *item_data) :
-QMainWindow(parent),
-m_ncdata(item_data->m_ncdata)
+void MainWindow::add_diff(ItemData *item_a, ItemData *item_b, int mode)
 {
-  QString str;
-  str.sprintf(" : %s", item_data->m_item_nm.c_str());
-  this->setWindowTitle(last_component(item_data->m_file_name.c_str()) + str);
+  std::vector<size_t> dim = item_a->m_ncdata->m_dim;
+  std::string name = item_a->m_item_nm + " - " + item_b->m_item_nm;
+  if(mode == diff_relative)
+  {
+    name = "(" + name + ") / |" + item_b->m_item_nm + "|";
+  }
+  ItemData *item_data = new ItemData(ItemData::Variable, item_a->m_file_name, item_a->m_grp_nm_fll, name,
+    item_a->m_item_data_prn, new ncdata_t(name.c_str(), NC_DOUBLE, dim));
+  std::shared_ptr<diff_slab_source_t> source(new diff_slab_source_t(make_slab_source(item_a), make_slab_source(item_b), mode));
+  bool load_data = !TableModel::use_tiles(item_data->m_ncdata);
+  IoScheduler::instance()->run_job([item_a, item_b, item_data, source, load_data, dim]()
+  {
+    load_item(item_a, false);
+    load_item(item_b, false);
+    if(load_data)
+    {
+      item_data->m_ncdata->store(source->read(std::vector<size_t>(dim.size(), 0), dim));
+    }
+  }, io_visible, this, [this, item_a, item_data, source](io_request_t *)
+  {
+    item_data->m_ncvar_crd = item_a->m_ncvar_crd;
+    ChildWindowDiff *window = new ChildWindowDiff(this, item_data, source);
+    m_mdi_area->addSubWindow(window);
+    window->show();
+  });
+}
 
-  float *buf_float = NULL;
-  double *buf_double = NULL;
-  int *buf_int = NULL;
-  short *buf_short = NULL;
-  signed char *buf_byte = NULL;
-  unsigned char *buf_ubyte = NULL;
-  unsigned short *buf_ushort = NULL;
-  unsigned int *buf_uint = NULL;
-  long long *buf_int64 = NULL;
-  unsigned long long *buf_uint64 = NULL;
+///////////////////////////////////////////////////////////////////////////////////////
+//subset_item
+//the ranges are resolved on the coordinate variables of the variable, loaded first; the data is read
+//in one strided read (one nc_get_vars call for a local file) if at most subset_max_load, else the
+//table reads it by tiles; returns an error message, empty if none
+///////////////////////////////////////////////////////////////////////////////////////
 
-  //currently selected layers for dimensions greater than two are the first layer
-  if(m_ncdata->m_dim.size() > 2)
+static std::string subset_item(ItemData *item_data, const std::vector<std::string> &range,
+  const std::vector<std::string> &dim_nm, ItemData *item_subset)
+{
+  const std::vector<size_t> &dim = item_data->m_ncdata->m_dim;
+  std::vector<size_t> start(dim.size());
+  std::vector<size_t> count(dim.size());
+  std::vector<ptrdiff_t> stride(dim.size());
+  std::string error;
+  load_item(item_data, false);
+  for(size_t idx_dmn = 0; idx_dmn < dim.size(); idx_dmn++)
   {
-    for(size_t idx_dmn = 0; idx_dmn < m_ncdata->m_dim.size() - 2; idx_dmn++)
+    const ncdata_t *crd = idx_dmn < item_data->m_ncvar_crd.size() ? item_data->m_ncvar_crd[idx_dmn] : NULL;
+    if(!subset_parse(range[idx_dmn], dim[idx_dmn], crd, &start[idx_dmn], &count[idx_dmn], &stride[idx_dmn], &error))
     {
-      m_layer.push_back(0);
+      return dim_nm[idx_dmn] + ": " + error;
     }
   }
+  for(size_t idx_dmn = 0; idx_dmn < dim.size(); idx_dmn++)
+  {
+    const ncdata_t *crd = idx_dmn < item_data->m_ncvar_crd.size() ? item_data->m_ncvar_crd[idx_dmn] : NULL;
+    item_subset->m_ncvar_crd.push_back(subset_crd(crd, dim_nm[idx_dmn], start[idx_dmn], count[idx_dmn], stride[idx_dmn]));
+  }
+  item_subset->m_source.reset(new subset_slab_source_t(make_slab_source(item_data), start, count, stride));
+  item_subset->m_ncdata->m_dim = count;
 
-  QSignalMapper *signal_mapper_next = NULL;
-  QSignalMapper *signal_mapper_previous = NULL;
-  QSignalMapper *signal_mapper_combo = NULL;
-  //data has layers
-  if(item_data->m_ncdata->m_dim.size() > 2)
+  size_t buf_sz = get_type_size(item_data->m_ncdata->m_nc_type);
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
   {
-    m_tool_bar = addToolBar(tr("Layers"));
-    signal_mapper_next = new QSignalMapper(this);
-    signal_mapper_previous = new QSignalMapper(this);
-    signal_mapper_combo = new QSignalMapper(this);
-    connect(signal_mapper_next, SIGNAL(mapped(int)), this, SLOT(next_layer(int)));
-    connect(signal_mapper_previous, SIGNAL(mapped(int)), this, SLOT(previous_layer(int)));
-    connect(signal_mapper_combo, SIGNAL(mapped(int)), this, SLOT(combo_layer(int)));
+    buf_sz *= count[idx_dmn];
+  }
+  if(buf_sz <= subset_max_load || !TableModel::use_tiles(item_subset->m_ncdata))
+  {
+    buffer_t buf = item_subset->m_source->read(std::vector<size_t>(count.size(), 0), count);
+    if(buf.empty() && buf_sz > 0)
+    {
+      return "read error";
+    }
+    item_subset->m_ncdata->store(std::move(buf));
   }
+  return std::string();
+}
 
-  //number of dimensions above a two-dimensional dataset
-  for(size_t idx_dmn = 0; idx_dmn < m_layer.size(); idx_dmn++)
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::add_subset
+//table of a hyperslab of a variable, a variable of its own owned by its window
+///////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::add_subset(ItemData *item_data, const std::vector<std::string> &range, const std::vector<std::string> &dim_nm)
+{
+  std::string name = item_data->m_item_nm + "[";
+  for(size_t idx_dmn = 0; idx_dmn < range.size(); idx_dmn++)
   {
-    ///////////////////////////////////////////////////////////////////////////////////////
-    //next layer
-    ///////////////////////////////////////////////////////////////////////////////////////
+    name += (idx_dmn ? ", " : "") + (range[idx_dmn].empty() ? std::string(":") : range[idx_dmn]);
+  }
+  name += "]";
+  ItemData *item_subset = new ItemData(ItemData::Variable, item_data->m_file_name, item_data->m_grp_nm_fll, name,
+    item_data->m_item_data_prn, new ncdata_t(name.c_str(), item_data->m_ncdata->m_nc_type, item_data->m_ncdata->m_dim));
+  std::shared_ptr<std::string> error(new std::string);
+  IoScheduler::instance()->run_job([item_data, range, dim_nm, item_subset, error]()
+  {
+    *error = subset_item(item_data, range, dim_nm, item_subset);
+  }, io_visible, this, [this, item_subset, error](io_request_t *)
+  {
+    if(!error->empty())
+    {
+      statusBar()->showMessage(tr("Cannot open subset: %1").arg(QString::fromUtf8(error->c_str())));
+      delete item_subset;
+      return;
+    }
+    ChildWindowSubset *window = new ChildWindowSubset(this, item_subset);
+    m_mdi_area->addSubWindow(window);
+    window->show();
+  });
+}
 
-    QAction *action_next  = new QAction(tr("&Next layer..."), this);
-    action_next->setIcon(QIcon(":/images/right.png"));
-    action_next->setStatusTip(tr("Next layer"));
-    connect(action_next, SIGNAL(triggered()), signal_mapper_next, SLOT(map()));
-    signal_mapper_next->setMapping(action_next, idx_dmn);
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::start_job
+//one job runs at a time, its progress and a cancel button in the status bar
+///////////////////////////////////////////////////////////////////////////////////////
 
-    ///////////////////////////////////////////////////////////////////////////////////////
-    //previous layer
-    ///////////////////////////////////////////////////////////////////////////////////////
+void MainWindow::start_job(JobThread *thread, const QString &message)
+{
+  m_job_thread = thread;
+  connect(m_job_thread, SIGNAL(finished()), this, SLOT(job_finished()));
+  m_job_progress->setValue(0);
+  m_job_progress->show();
+  m_job_cancel->show();
+  m_job_timer->start(250);
+  statusBar()->showMessage(message);
+  m_job_thread->start();
+}
 
-    QAction *action_previous = new QAction(tr("&Previous layer..."), this);
-    action_previous->setIcon(QIcon(":/images/left.png"));
-    action_previous->setStatusTip(tr("Previous layer"));
-    connect(action_previous, SIGNAL(triggered()), signal_mapper_previous, SLOT(map()));
-    signal_mapper_previous->setMapping(action_previous, idx_dmn);
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::show_job_progress
+///////////////////////////////////////////////////////////////////////////////////////
 
-    ///////////////////////////////////////////////////////////////////////////////////////
-    //add to toolbar
-    ///////////////////////////////////////////////////////////////////////////////////////
+void MainWindow::show_job_progress()
+{
+  if(m_job_thread != NULL)
+  {
+    m_job_progress->setValue((int)(100 * m_job_thread->progress()));
+  }
+}
 
-    m_tool_bar->addAction(action_next);
-    m_tool_bar->addAction(action_previous);
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::cancel_job
+///////////////////////////////////////////////////////////////////////////////////////
 
-    ///////////////////////////////////////////////////////////////////////////////////////
-    //add combo box with layers, fill with possible coordinate variables and store combo in vector 
-    ///////////////////////////////////////////////////////////////////////////////////////
+void MainWindow::cancel_job()
+{
+  if(m_job_thread != NULL)
+  {
+    m_job_thread->m_cancel = true;
+  }
+}
 
-    QComboBox *combo = new QComboBox;
-    QFont font = combo->font();
-    font.setPointSize(9);
-    combo->setFont(font);
-    QStringList list;
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::job_finished
+///////////////////////////////////////////////////////////////////////////////////////
 
-    //coordinate variable exists
-    if(item_data->m_ncvar_crd[idx_dmn] != NULL)
-    {
-      void *buf = item_data->m_ncvar_crd[idx_dmn]->m_buf;
-      size_t size = item_data->m_ncdata->m_dim[idx_dmn];
-      switch(item_data->m_ncvar_crd[idx_dmn]->m_nc_type)
-      {
-      case NC_FLOAT:
-        buf_float = static_cast<float*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_FLOAT), buf_float[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_DOUBLE:
-        buf_double = static_cast<double*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_DOUBLE), buf_double[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_INT:
-        buf_int = static_cast<int*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_INT), buf_int[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_SHORT:
-        buf_short = static_cast<short*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_SHORT), buf_short[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_BYTE:
-        buf_byte = static_cast<signed char*>  (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_BYTE), buf_byte[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_UBYTE:
-        buf_ubyte = static_cast<unsigned char*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_UBYTE), buf_ubyte[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_USHORT:
-        buf_ushort = static_cast<unsigned short*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_USHORT), buf_ushort[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_UINT:
-        buf_uint = static_cast<unsigned int*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_UINT), buf_uint[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_INT64:
-        buf_int64 = static_cast<long long*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_INT64), buf_int64[idx]);
-          list.append(str);
-        }
-        break;
-      case NC_UINT64:
-        buf_uint64 = static_cast<unsigned long long*> (buf);
-        for(size_t idx = 0; idx < size; idx++)
-        {
-          str.sprintf(get_format(NC_UINT64), buf_uint64[idx]);
-          list.append(str);
-        }
-        break;
-      } //switch
+void MainWindow::job_finished()
+{
+  JobThread *thread = m_job_thread;
+  m_job_thread = NULL;
+  m_job_timer->stop();
+  m_job_progress->hide();
+  m_job_cancel->hide();
+  if(ReduceThread *reduce_thread = dynamic_cast<ReduceThread*>(thread))
+  {
+    reduce_finished(reduce_thread);
+  }
+  else if(PyramidThread *pyramid_thread = dynamic_cast<PyramidThread*>(thread))
+  {
+    pyramid_finished(pyramid_thread);
+  }
+  thread->deleteLater();
+}
 
-    }
-    else
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::add_reduce
+//a reduction computed before is added to the tree at once
+///////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::add_reduce(ItemData *item_data, size_t dmn, int op, const std::vector<std::string> &dim_nm)
+{
+  if(m_job_thread != NULL)
+  {
+    statusBar()->showMessage(tr("A computation is running"));
+    return;
+  }
+  ReduceThread *thread = new ReduceThread(this, item_data, dmn, op, dim_nm);
+  std::string key = reduce_key(make_slab_source(item_data).get(), dmn, op);
+  std::shared_ptr<const std::vector<double> > result = reduce_cache_find(key);
+  if(result)
+  {
+    thread->m_result = result;
+    thread->m_cached = true;
+    reduce_finished(thread);
+    delete thread;
+    return;
+  }
+  start_job(thread, tr("Computing %1 of %2 over %3...").arg(reduce_name(op))
+    .arg(QString::fromUtf8(item_data->m_item_nm.c_str())).arg(QString::fromUtf8(dim_nm[dmn].c_str())));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::reduce_finished
+//the result is cached and added to the tree as a variable of the dimensions left
+///////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::reduce_finished(ReduceThread *thread)
+{
+  if(thread->m_status != NC_NOERR || !thread->m_result)
+  {
+    statusBar()->showMessage(thread->m_cancel ? tr("Reduction cancelled") : tr("Reduction failed"));
+    return;
+  }
+
+  ItemData *item_data = thread->m_item_data;
+  std::shared_ptr<slab_source_t> source = make_slab_source(item_data);
+  std::string key = reduce_key(source.get(), thread->m_dmn, thread->m_op);
+  if(!thread->m_cached)
+  {
+    reduce_cache_add(key, thread->m_result);
+  }
+  std::vector<size_t> dim;
+  std::vector<size_t> crd_dmn;
+  std::vector<std::string> dim_nm;
+  for(size_t idx_dmn = 0; idx_dmn < source->dim().size(); idx_dmn++)
+  {
+    if(idx_dmn != thread->m_dmn)
     {
-      for(unsigned int idx = 0; idx < item_data->m_ncdata->m_dim[idx_dmn]; idx++)
-      {
-        str.sprintf("%u", idx + 1);
-        list.append(str);
-      }
+      dim.push_back(source->dim()[idx_dmn]);
+      crd_dmn.push_back(idx_dmn);
+      dim_nm.push_back(thread->m_dim_nm[idx_dmn]);
     }
+  }
+  std::string var_nm = std::string(reduce_name(thread->m_op)) + "(" + item_data->m_item_nm + ", " + thread->m_dim_nm[thread->m_dmn] + ")";
+  m_tree->tree_model()->add_virtual(var_nm, var_nm, item_data, crd_dmn, dim_nm,
+    std::shared_ptr<slab_source_t>(new reduce_slab_source_t(key, dim, thread->m_result)));
+  statusBar()->showMessage(tr("Added %1").arg(QString::fromUtf8(var_nm.c_str())));
+}
 
-    combo->addItems(list);
-    connect(combo, SIGNAL(currentIndexChanged(int)), signal_mapper_combo, SLOT(map()));
-    signal_mapper_combo->setMapping(combo, idx_dmn);
-    m_tool_bar->addWidget(combo);
-    m_vec_combo.push_back(combo);
+///////////////////////////////////////////////////////////////////////////////////////
+//ReduceThread::run
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ReduceThread::run()
+{
+  std::shared_ptr<slab_source_t> source = make_slab_source(m_item_data);
+  std::shared_ptr<std::vector<double> > result(new std::vector<double>);
+  if(dynamic_cast<remote_slab_source_t*>(source.get()) != NULL)
+  {
+    //the server reduces its file, and sends the result only
+    m_status = remote_reduce_read(m_item_data->m_file_name, m_item_data->m_grp_nm_fll, m_item_data->m_item_nm,
+      source->type(), source->dim(), m_dmn, m_op, m_cancel, result.get());
+    if(m_status == NC_NOERR)
+    {
+      m_result = result;
+    }
+    return;
+  }
+  m_status = reduce_stream(source.get(), m_dmn, m_op, [](const std::function<void()> &job)
+  {
+    IoScheduler::instance()->execute(job, io_background);
+  }, m_cancel, [this](double progress)
+  {
+    m_progress = progress;
+  }, result.get());
+  if(m_status == NC_NOERR)
+  {
+    m_result = result;
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//ChildWindow::previous_layer
+//MainWindow::add_overview
+//the pyramid of the variable is built the first time, then read from its sidecar
 ///////////////////////////////////////////////////////////////////////////////////////
 
-void ChildWindow::previous_layer(int idx_layer)
+void MainWindow::add_overview(ItemData *item_data, const std::vector<std::string> &dim_nm)
 {
-  m_layer[idx_layer]--;
-  if(m_layer[idx_layer] < 0)
+  std::string key = pyramid_key(item_data->m_file_name, item_data->m_grp_nm_fll, item_data->m_item_nm);
+  pyramid_t pyramid;
+  if(pyramid_open(key, item_data->m_ncdata->m_dim, &pyramid) == NC_NOERR)
   {
-    m_layer[idx_layer] = 0;
+    show_overview(item_data, pyramid, dim_nm);
     return;
   }
-  QComboBox *combo = m_vec_combo.at(idx_layer);
-  combo->setCurrentIndex(m_layer[idx_layer]);
-  update();
+  if(m_job_thread != NULL)
+  {
+    statusBar()->showMessage(tr("A computation is running"));
+    return;
+  }
+  start_job(new PyramidThread(this, item_data, key, dim_nm),
+    tr("Building overview of %1...").arg(QString::fromUtf8(item_data->m_item_nm.c_str())));
+}
 
-  m_model->data_changed();
+///////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::pyramid_finished
+///////////////////////////////////////////////////////////////////////////////////////
 
+void MainWindow::pyramid_finished(PyramidThread *thread)
+{
+  pyramid_t pyramid;
+  if(thread->m_status != NC_NOERR || pyramid_open(thread->m_key, thread->m_item_data->m_ncdata->m_dim, &pyramid) != NC_NOERR)
+  {
+    statusBar()->showMessage(thread->m_cancel ? tr("Overview cancelled") : tr("Overview failed"));
+    return;
+  }
+  statusBar()->clearMessage();
+  show_overview(thread->m_item_data, pyramid, thread->m_dim_nm);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//ChildWindow::next_layer
+//MainWindow::show_overview
+//asks for the level and the statistic; the level added is a variable of the same dimensions
+//with the last two downsampled, the first level that fits a 1024x1024 table by default
 ///////////////////////////////////////////////////////////////////////////////////////
 
-void ChildWindow::next_layer(int idx_layer)
+void MainWindow::show_overview(ItemData *item_data, const pyramid_t &pyramid, const std::vector<std::string> &dim_nm)
 {
-  m_layer[idx_layer]++;
-  if((size_t)m_layer[idx_layer] >= m_ncdata->m_dim[idx_layer])
+  QDialog dlg(this);
+  dlg.setWindowTitle(tr("Overview of %1").arg(QString::fromUtf8(item_data->m_item_nm.c_str())));
+  QComboBox *combo_lvl = new QComboBox(&dlg);
+  int idx_dft = (int)pyramid.nbr_level() - 1;
+  for(size_t idx_lvl = 0; idx_lvl < pyramid.nbr_level(); idx_lvl++)
+  {
+    combo_lvl->addItem(tr("1/%1: %2 x %3").arg((qulonglong)1 << (idx_lvl + 1))
+      .arg((qulonglong)pyramid.m_rows[idx_lvl]).arg((qulonglong)pyramid.m_cols[idx_lvl]));
+    if(idx_dft == (int)pyramid.nbr_level() - 1 && pyramid.m_rows[idx_lvl] <= 1024 && pyramid.m_cols[idx_lvl] <= 1024)
+    {
+      idx_dft = (int)idx_lvl;
+    }
+  }
+  combo_lvl->setCurrentIndex(idx_dft);
+  QComboBox *combo_stat = new QComboBox(&dlg);
+  combo_stat->addItem("mean", pyramid_mean);
+  combo_stat->addItem("min", pyramid_min);
+  combo_stat->addItem("max", pyramid_max);
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dlg);
+  connect(buttons, SIGNAL(accepted()), &dlg, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), &dlg, SLOT(reject()));
+  QFormLayout *layout = new QFormLayout(&dlg);
+  layout->addRow(tr("Level"), combo_lvl);
+  layout->addRow(tr("Statistic"), combo_stat);
+  layout->addRow(buttons);
+  if(QDialog::Accepted != dlg.exec())
   {
-    m_layer[idx_layer] = m_ncdata->m_dim[idx_layer] - 1;
     return;
   }
-  QComboBox *combo = m_vec_combo.at(idx_layer);
-  combo->setCurrentIndex(m_layer[idx_layer]);
-  update();
 
-  m_model->data_changed();
+  //the leading dimensions keep their coordinate variables; the downsampled ones have none
+  size_t idx_lvl = combo_lvl->currentIndex();
+  int stat = combo_stat->itemData(combo_stat->currentIndex()).toInt();
+  std::vector<size_t> crd_dmn;
+  for(size_t idx_dmn = 0; idx_dmn < dim_nm.size(); idx_dmn++)
+  {
+    crd_dmn.push_back(idx_dmn + 2 < dim_nm.size() ? idx_dmn : (size_t)-1);
+  }
+  std::string title = item_data->m_item_nm + " [1/" + std::to_string((unsigned long long)1 << (idx_lvl + 1)) + " "
+    + combo_stat->currentText().toStdString() + "]";
+  m_tree->tree_model()->add_virtual(title, item_data->m_item_nm, item_data, crd_dmn, dim_nm,
+    std::shared_ptr<slab_source_t>(new pyramid_slab_source_t(pyramid, idx_lvl, stat)));
+  statusBar()->showMessage(tr("Added %1").arg(QString::fromUtf8(title.c_str())));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//MainWindow::show_layout
+//storage layout of a variable of the tree, or clears the panel for NULL; read on the I/O thread, from
+//the first file of a series; only the result of the last variable selected is shown
+//the size on disk of filtered variables is estimated with the compression of the whole file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainWindow::show_layout(const meta_store_t *store, unsigned int idx, const std::vector<std::string> &dim_nm)
+{
+  if(m_layout_id != 0)
+  {
+    IoScheduler::instance()->cancel(m_layout_id);
+    m_layout_id = 0;
+  }
+  if(store == NULL)
+  {
+    m_layout_text->clear();
+    return;
+  }
+  QString file_name = QString::fromUtf8(store->m_file_name.c_str());
+  if(store->m_source)
+  {
+    m_layout_text->setPlainText(tr("Derived variable: computed when read, not stored"));
+    return;
+  }
+  if(is_url(file_name))
+  {
+    m_layout_text->setPlainText(tr("Remote variable: the storage layout is not available"));
+    return;
+  }
 
+  double ratio = 1;
+  double data_bytes = store->data_bytes();
+  if(data_bytes > 0)
+  {
+    double file_bytes = (double)QFileInfo(file_name).size() * (store->m_series ? (double)store->m_series->size() : 1);
+    ratio = std::min(1.0, file_bytes / data_bytes);
+  }
+  std::string file_nm = store->m_file_name;
+  std::string grp_nm_fll = store->group(idx);
+  std::string var_nm = store->name(idx);
+  nc_type nc_typ = store->item(idx).m_nc_type;
+  std::shared_ptr<layout_t> layout(new layout_t);
+  std::shared_ptr<int> status(new int(NC2_ERR));
+  m_layout_text->setPlainText(tr("Reading the storage layout..."));
+  m_layout_id = IoScheduler::instance()->run_job([file_nm, grp_nm_fll, var_nm, nc_typ, layout, status]()
+  {
+    int nc_id;
+    int grp_id;
+    int var_id;
+    int nbr_dmn;
+    if(io_open(file_nm, &nc_id) != NC_NOERR || inq_grp_id(nc_id, grp_nm_fll, &grp_id) != NC_NOERR)
+    {
+      return;
+    }
+    if(NC_TRACE("nc_inq_varid", var_nm.c_str(), 0, nc_inq_varid(grp_id, var_nm.c_str(), &var_id)) != NC_NOERR)
+    {
+      return;
+    }
+    if(NC_TRACE("nc_inq_varndims", var_nm.c_str(), 0, nc_inq_varndims(grp_id, var_id, &nbr_dmn)) != NC_NOERR)
+    {
+      return;
+    }
+    //dimensions of the file itself, not of the series
+    std::vector<int> dim_id(std::max(1, nbr_dmn));
+    std::vector<size_t> dim(nbr_dmn);
+    if(NC_TRACE("nc_inq_vardimid", var_nm.c_str(), 0, nc_inq_vardimid(grp_id, var_id, dim_id.data())) != NC_NOERR)
+    {
+      return;
+    }
+    for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      if(NC_TRACE("nc_inq_dimlen", NULL, 0, nc_inq_dimlen(grp_id, dim_id[idx_dmn], &dim[idx_dmn])) != NC_NOERR)
+      {
+        return;
+      }
+    }
+    *status = layout_inq(grp_id, var_id, nc_typ, dim, layout.get());
+  }, io_visible, this, [this, layout, status, ratio, dim_nm, var_nm](io_request_t *req)
+  {
+    if(req->m_id != m_layout_id)
+    {
+      return;
+    }
+    m_layout_id = 0;
+    if(*status != NC_NOERR)
+    {
+      m_layout_text->setPlainText(tr("Cannot read the storage layout of %1").arg(QString::fromUtf8(var_nm.c_str())));
+      return;
+    }
+    layout->m_ratio = ratio;
+    m_layout_text->setPlainText(QString::fromUtf8(layout_report(*layout, dim_nm).c_str()));
+  });
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//ChildWindow::combo_layer
+//PyramidThread::run
 ///////////////////////////////////////////////////////////////////////////////////////
 
-void ChildWindow::combo_layer(int idx_layer)
+void PyramidThread::run()
 {
-  QComboBox *combo = m_vec_combo.at(idx_layer);
-  m_layer[idx_layer] = combo->currentIndex();;
-  update();
+  std::shared_ptr<slab_source_t> source = make_slab_source(m_item_data);
+  m_status = pyramid_build(source.get(), m_key, [](const std::function<void()> &job)
+  {
+    IoScheduler::instance()->execute(job, io_background);
+  }, m_cancel, [this](double progress)
+  {
+    m_progress = progress;
+  });
+}
 
-  m_model->data_changed();
+///////////////////////////////////////////////////////////////////////////////////////
+//DiffThread::run
+///////////////////////////////////////////////////////////////////////////////////////
+
+void DiffThread::run()
+{
+  diff_stats_t stats;
+  int status = diff_stream(m_source->m_source_a.get(), m_source->m_source_b.get(), 0, [](const std::function<void()> &job)
+  {
+    IoScheduler::instance()->execute(job, io_background);
+  }, m_cancel, [this](const diff_stats_t &sts, double progress)
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stats = sts;
+    m_progress = progress;
+  }, &stats);
+  QMutexLocker locker(&m_mutex);
+  m_status = status;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::FileTreeWidget 
+//DiffThread::stats
 ///////////////////////////////////////////////////////////////////////////////////////
 
-FileTreeWidget::FileTreeWidget(QWidget *parent) : QTreeWidget(parent)
+diff_stats_t DiffThread::stats(double *progress, int *status)
 {
-  setContextMenuPolicy(Qt::CustomContextMenu);
+  QMutexLocker locker(&m_mutex);
+  *progress = m_progress;
+  *status = m_status;
+  return m_stats;
+}
 
-  //right click menu
-  connect(this, SIGNAL(customContextMenuRequested(const QPoint &)), SLOT(show_context_menu(const QPoint &)));
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowDiff::ChildWindowDiff
+///////////////////////////////////////////////////////////////////////////////////////
 
-  //double click
-  connect(this, SIGNAL(itemDoubleClicked(QTreeWidgetItem*, int)), this, SLOT(add_grid()));
+ChildWindowDiff::ChildWindowDiff(QWidget *parent, ItemData *item_data, const std::shared_ptr<diff_slab_source_t> &source) :
+ChildWindow(parent, item_data),
+m_item_data(item_data)
+{
+  m_model = new TableModel(this, item_data, source);
+  m_model->m_widget = this;
+  m_table = new TableView(this);
+  m_table->setModel(m_model);
+  m_table->verticalHeader()->setDefaultSectionSize(24);
+  setCentralWidget(new TablePager(this, m_table, m_model));
+  m_model->load_layer();
+
+  //statistics of the whole variables
+  QAction *action_stop = new QAction(tr("Stop statistics"), this);
+  action_stop->setStatusTip(tr("Stop the comparison of the whole variables"));
+  connect(action_stop, SIGNAL(triggered()), this, SLOT(stop_stats()));
+  addToolBar(tr("Diff"))->addAction(action_stop);
+  m_thread = new DiffThread(this, source);
+  m_timer = new QTimer(this);
+  connect(m_timer, SIGNAL(timeout()), this, SLOT(show_stats()));
+  m_timer->start(250);
+  m_thread->start();
+  statusBar()->showMessage(tr("Comparing..."));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowDiff::~ChildWindowDiff
+///////////////////////////////////////////////////////////////////////////////////////
+
+ChildWindowDiff::~ChildWindowDiff()
+{
+  m_thread->m_cancel = true;
+  m_thread->wait();
+  delete m_model; // waits for its sort thread, which may read the data
+  m_model = NULL;
+  m_item_data->m_ncvar_crd.clear();
+  delete m_item_data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowDiff::stop_stats
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindowDiff::stop_stats()
+{
+  m_thread->m_cancel = true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::~FileTreeWidget
+//ChildWindowDiff::show_stats
 ///////////////////////////////////////////////////////////////////////////////////////
 
-FileTreeWidget::~FileTreeWidget()
+void ChildWindowDiff::show_stats()
 {
-  QTreeWidgetItemIterator it(this);
-  while(*it)
+  double progress;
+  int status;
+  diff_stats_t stats = m_thread->stats(&progress, &status);
+  bool running = m_thread->isRunning();
+  QString str = tr("max |A-B| %1  RMS %2  mismatched %3 of %4")
+    .arg(stats.m_max_abs, 0, 'g', 6)
+    .arg(stats.rms(), 0, 'g', 6)
+    .arg(stats.m_nbr_mismatch)
+    .arg(stats.m_nbr);
+  if(running)
+  {
+    str += tr("  (%1%)").arg((int)(progress * 100));
+  }
+  else if(status != NC_NOERR)
+  {
+    str += m_thread->m_cancel ? tr("  (stopped)") : tr("  (read error)");
+  }
+  statusBar()->showMessage(str);
+  if(!running)
   {
-    ItemData *item_data = get_item_data(*it);
-    delete item_data;
-    ++it;
+    m_timer->stop();
   }
+}
 
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::LayerModel
+///////////////////////////////////////////////////////////////////////////////////////
+
+LayerModel::LayerModel(QObject *parent, const ncdata_t *ncvar_crd, size_t nbr_layers) :
+QAbstractListModel(parent),
+m_ncvar_crd(ncvar_crd),
+m_nbr_layers(nbr_layers),
+m_is_time(false),
+m_monotonic(2)
+{
+  if(m_ncvar_crd != NULL && is_numeric() && !m_ncvar_crd->m_units.empty())
+  {
+    m_is_time = m_cf_time.parse(m_ncvar_crd->m_units, m_ncvar_crd->m_calendar);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::enable_data
+//LayerModel::rowCount
 ///////////////////////////////////////////////////////////////////////////////////////
 
-bool FileTreeWidget::enable_data(ItemData *item_data)
+int LayerModel::rowCount(const QModelIndex &parent) const
 {
-  switch(item_data->m_ncdata->m_nc_type)
+  if(parent.isValid())
   {
-  case NC_FLOAT:
-  case NC_DOUBLE:
-  case NC_INT:
-  case NC_SHORT:
-  case NC_CHAR:
-  case NC_BYTE:
-  case NC_UBYTE:
-  case NC_USHORT:
-  case NC_UINT:
-  case NC_INT64:
-  case NC_UINT64:
-  case NC_STRING:
-    return true;
-  };
+    return 0;
+  }
+  return (int)std::min(m_nbr_layers, (size_t)INT_MAX);
+}
 
-  return false;
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::data
+//layers past the end of the coordinate variable (not grown yet) are numbered
+///////////////////////////////////////////////////////////////////////////////////////
+
+QVariant LayerModel::data(const QModelIndex &index, int role) const
+{
+  if(!index.isValid() || role != Qt::DisplayRole)
+  {
+    return QVariant();
+  }
+  size_t idx = (size_t)index.row();
+  if(m_label.size() < m_nbr_layers)
+  {
+    m_label.resize(m_nbr_layers);
+  }
+  QString &label = m_label[idx];
+  if(label.isNull())
+  {
+    char str[256];
+    bool crd = m_ncvar_crd != NULL && idx < m_ncvar_crd->m_dim[0];
+    std::string date = (crd && m_is_time) ? m_cf_time.format(value(idx)) : std::string();
+    if(!crd)
+    {
+      snprintf(str, sizeof(str), "%llu", (unsigned long long)(idx + 1));
+      label = str;
+    }
+    else if(!date.empty())
+    {
+      label = QString::fromStdString(date);
+    }
+    else
+    {
+      format_value(str, sizeof(str), m_ncvar_crd->m_nc_type, m_ncvar_crd->m_buf.data(), idx);
+      label = QString::fromUtf8(str);
+    }
+  }
+  return label;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::grow
+///////////////////////////////////////////////////////////////////////////////////////
+
+void LayerModel::grow(size_t nbr_layers)
+{
+  int first = rowCount();
+  int last = (int)std::min(nbr_layers, (size_t)INT_MAX) - 1;
+  if(last < first)
+  {
+    m_nbr_layers = std::max(m_nbr_layers, nbr_layers);
+    return;
+  }
+  beginInsertRows(QModelIndex(), first, last);
+  m_nbr_layers = nbr_layers;
+  endInsertRows();
+  m_monotonic = 2;
+  m_order.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::is_numeric
+///////////////////////////////////////////////////////////////////////////////////////
+
+bool LayerModel::is_numeric() const
+{
+  return m_ncvar_crd->m_nc_type != NC_CHAR && m_ncvar_crd->m_nc_type != NC_STRING;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::value
+///////////////////////////////////////////////////////////////////////////////////////
+
+double LayerModel::value(size_t idx) const
+{
+  return get_double(m_ncvar_crd->m_nc_type, m_ncvar_crd->m_buf.data(), idx);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::monotonic
+//of the coordinate variable, checked once; NaN makes it not monotonic
+///////////////////////////////////////////////////////////////////////////////////////
+
+int LayerModel::monotonic() const
+{
+  if(m_monotonic != 2)
+  {
+    return m_monotonic;
+  }
+  size_t nbr = std::min(m_nbr_layers, m_ncvar_crd->m_dim[0]);
+  bool inc = true;
+  bool dec = true;
+  for(size_t idx = 0; idx < nbr && (inc || dec); idx++)
+  {
+    double val = value(idx);
+    if(val != val)
+    {
+      inc = dec = false;
+    }
+    else if(idx > 0)
+    {
+      double prev = value(idx - 1);
+      inc = inc && prev <= val;
+      dec = dec && prev >= val;
+    }
+  }
+  m_monotonic = inc ? 1 : (dec ? -1 : 0);
+  return m_monotonic;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//LayerModel::find
+//a number, or a date for CF time; the nearest layer by binary search if the coordinate variable is
+//monotonic, else through an index sorted on first use; text coordinates must match; without a
+//coordinate variable, a layer number from 1
+///////////////////////////////////////////////////////////////////////////////////////
+
+int LayerModel::find(const QString &text) const
+{
+  QString str = text.trimmed();
+  bool ok = false;
+  double val = str.toDouble(&ok);
+  size_t nbr = std::min(m_nbr_layers, (size_t)INT_MAX);
+  if(str.isEmpty())
+  {
+    return -1;
+  }
+  if(m_ncvar_crd == NULL)
+  {
+    if(!ok || !(val >= 1 && val < nbr + 0.5))
+    {
+      return -1;
+    }
+    return (int)(val + 0.5) - 1;
+  }
+  nbr = std::min(nbr, m_ncvar_crd->m_dim[0]);
+  if(!is_numeric())
+  {
+    char chr[256];
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      format_value(chr, sizeof(chr), m_ncvar_crd->m_nc_type, m_ncvar_crd->m_buf.data(), idx);
+      if(QString::fromUtf8(chr) == str)
+      {
+        return (int)idx;
+      }
+    }
+    return -1;
+  }
+  if(!ok && m_is_time)
+  {
+    ok = m_cf_time.value(str.toStdString(), &val);
+  }
+  if(!ok || val != val || nbr == 0)
+  {
+    return -1;
+  }
+
+  //first position not before val, then the nearest of it and the one before
+  bool indexed = (monotonic() == 0);
+  int dir = indexed ? 1 : monotonic();
+  if(indexed && m_order.empty())
+  {
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      double crd = value(idx);
+      if(crd == crd)
+      {
+        m_order.push_back(idx);
+      }
+    }
+    std::stable_sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) { return value(a) < value(b); });
+  }
+  size_t nbr_at = indexed ? m_order.size() : nbr;
+  if(nbr_at == 0)
+  {
+    return -1;
+  }
+  auto at = [this, indexed](size_t idx) { return value(indexed ? m_order[idx] : idx); };
+  size_t lo = 0;
+  size_t hi = nbr_at;
+  while(lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if(dir > 0 ? at(mid) < val : at(mid) > val)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  if(lo == nbr_at || (lo > 0 && fabs(at(lo - 1) - val) <= fabs(at(lo) - val)))
+  {
+    lo--;
+  }
+  return (int)(indexed ? m_order[lo] : lo);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindow::ChildWindow
+///////////////////////////////////////////////////////////////////////////////////////
+
+ChildWindow::ChildWindow(QWidget *parent, ItemData *item_data) :
+QMainWindow(parent),
+m_ncdata(item_data->m_ncdata)
+{
+  QString str;
+  str.sprintf(" : %s", item_data->m_item_nm.c_str());
+  this->setWindowTitle(last_component(item_data->m_file_name.c_str()) + str);
+
+  //currently selected layers for dimensions greater than two are the first layer
+  if(m_ncdata->m_dim.size() > 2)
+  {
+    for(size_t idx_dmn = 0; idx_dmn < m_ncdata->m_dim.size() - 2; idx_dmn++)
+    {
+      m_layer.push_back(0);
+    }
+  }
+
+  QSignalMapper *signal_mapper_next = NULL;
+  QSignalMapper *signal_mapper_previous = NULL;
+  QSignalMapper *signal_mapper_combo = NULL;
+  QSignalMapper *signal_mapper_go = NULL;
+  //data has layers
+  if(item_data->m_ncdata->m_dim.size() > 2)
+  {
+    m_tool_bar = addToolBar(tr("Layers"));
+    signal_mapper_next = new QSignalMapper(this);
+    signal_mapper_previous = new QSignalMapper(this);
+    signal_mapper_combo = new QSignalMapper(this);
+    signal_mapper_go = new QSignalMapper(this);
+    connect(signal_mapper_next, SIGNAL(mapped(int)), this, SLOT(next_layer(int)));
+    connect(signal_mapper_previous, SIGNAL(mapped(int)), this, SLOT(previous_layer(int)));
+    connect(signal_mapper_combo, SIGNAL(mapped(int)), this, SLOT(combo_layer(int)));
+    connect(signal_mapper_go, SIGNAL(mapped(int)), this, SLOT(go_to_layer(int)));
+  }
+
+  //number of dimensions above a two-dimensional dataset
+  for(size_t idx_dmn = 0; idx_dmn < m_layer.size(); idx_dmn++)
+  {
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //next layer
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    QAction *action_next  = new QAction(tr("&Next layer..."), this);
+    action_next->setIcon(QIcon(":/images/right.png"));
+    action_next->setStatusTip(tr("Next layer"));
+    connect(action_next, SIGNAL(triggered()), signal_mapper_next, SLOT(map()));
+    signal_mapper_next->setMapping(action_next, idx_dmn);
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //previous layer
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    QAction *action_previous = new QAction(tr("&Previous layer..."), this);
+    action_previous->setIcon(QIcon(":/images/left.png"));
+    action_previous->setStatusTip(tr("Previous layer"));
+    connect(action_previous, SIGNAL(triggered()), signal_mapper_previous, SLOT(map()));
+    signal_mapper_previous->setMapping(action_previous, idx_dmn);
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //add to toolbar
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    m_tool_bar->addAction(action_next);
+    m_tool_bar->addAction(action_previous);
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //add combo box with layers, fill with possible coordinate variables and store combo in vector 
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    QComboBox *combo = new QComboBox;
+    QFont font = combo->font();
+    font.setPointSize(9);
+    combo->setFont(font);
+    const ncdata_t *crd = idx_dmn < item_data->m_ncvar_crd.size() ? item_data->m_ncvar_crd[idx_dmn] : NULL;
+    LayerModel *layers = new LayerModel(combo, crd, item_data->m_ncdata->m_dim[idx_dmn]);
+    combo->setModel(layers);
+    //labels are formatted when shown: the width is not measured on all the layers
+    combo->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLength);
+    combo->setMinimumContentsLength(19); // "YYYY-MM-DD hh:mm:ss"
+    QListView *view = qobject_cast<QListView *> (combo->view());
+    if(view != NULL)
+    {
+      view->setUniformItemSizes(true);
+    }
+    connect(combo, SIGNAL(currentIndexChanged(int)), signal_mapper_combo, SLOT(map()));
+    signal_mapper_combo->setMapping(combo, idx_dmn);
+    m_tool_bar->addWidget(combo);
+    m_vec_combo.push_back(combo);
+    m_vec_layers.push_back(layers);
+
+    ///////////////////////////////////////////////////////////////////////////////////////
+    //go to the layer nearest to a value
+    ///////////////////////////////////////////////////////////////////////////////////////
+
+    QLineEdit *edit_go = new QLineEdit;
+    edit_go->setFont(font);
+    edit_go->setPlaceholderText(tr("Go to value"));
+    edit_go->setStatusTip(tr("Go to the layer nearest to a value, or a date (YYYY-MM-DD hh:mm:ss)"));
+    connect(edit_go, SIGNAL(returnPressed()), signal_mapper_go, SLOT(map()));
+    signal_mapper_go->setMapping(edit_go, idx_dmn);
+    m_tool_bar->addWidget(edit_go);
+    m_vec_go.push_back(edit_go);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindow::previous_layer
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindow::previous_layer(int idx_layer)
+{
+  m_layer[idx_layer]--;
+  if(m_layer[idx_layer] < 0)
+  {
+    m_layer[idx_layer] = 0;
+    return;
+  }
+  QComboBox *combo = m_vec_combo.at(idx_layer);
+  combo->setCurrentIndex(m_layer[idx_layer]);
+  update();
+
+  m_model->data_changed();
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindow::next_layer
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindow::next_layer(int idx_layer)
+{
+  m_layer[idx_layer]++;
+  if((size_t)m_layer[idx_layer] >= m_ncdata->m_dim[idx_layer])
+  {
+    m_layer[idx_layer] = m_ncdata->m_dim[idx_layer] - 1;
+    return;
+  }
+  QComboBox *combo = m_vec_combo.at(idx_layer);
+  combo->setCurrentIndex(m_layer[idx_layer]);
+  update();
+
+  m_model->data_changed();
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindow::combo_layer
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindow::combo_layer(int idx_layer)
+{
+  QComboBox *combo = m_vec_combo.at(idx_layer);
+  m_layer[idx_layer] = combo->currentIndex();;
+  update();
+
+  m_model->data_changed();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindow::go_to_layer
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindow::go_to_layer(int idx_layer)
+{
+  QString str = m_vec_go.at(idx_layer)->text();
+  int layer = m_vec_layers.at(idx_layer)->find(str);
+  if(layer < 0)
+  {
+    statusBar()->showMessage(tr("No layer for %1").arg(str), 5000);
+    return;
+  }
+  m_vec_combo.at(idx_layer)->setCurrentIndex(layer);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindow::grow
+//the variable grew from dim_old (records appended to the file); layers are added to the combo boxes,
+//the current layer is kept
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindow::grow(const std::vector<size_t> &dim_old)
+{
+  for(size_t idx_dmn = 0; idx_dmn < m_vec_layers.size(); idx_dmn++)
+  {
+    if(m_ncdata->m_dim[idx_dmn] > dim_old[idx_dmn])
+    {
+      m_vec_layers[idx_dmn]->grow(m_ncdata->m_dim[idx_dmn]);
+    }
+  }
+  m_model->grow(dim_old);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowTable::filter_rows
+//asks for the range of the values of the current column; both bounds empty remove the filter
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindowTable::filter_rows()
+{
+  int column = m_table->currentIndex().isValid() ? m_table->currentIndex().column() : 0;
+  QDialog dlg(this);
+  dlg.setWindowTitle(tr("Filter column %1").arg(m_model->headerData(column, Qt::Horizontal).toString()));
+  QLineEdit *edit_min = new QLineEdit(&dlg);
+  QLineEdit *edit_max = new QLineEdit(&dlg);
+  if(m_model->m_filter.m_active && m_model->m_key_col == column)
+  {
+    edit_min->setText(QString::number(m_model->m_filter.m_min, 'g', 17));
+    edit_max->setText(QString::number(m_model->m_filter.m_max, 'g', 17));
+  }
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dlg);
+  connect(buttons, SIGNAL(accepted()), &dlg, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), &dlg, SLOT(reject()));
+  QFormLayout *layout = new QFormLayout(&dlg);
+  layout->addRow(tr("Minimum"), edit_min);
+  layout->addRow(tr("Maximum"), edit_max);
+  layout->addRow(buttons);
+  if(QDialog::Accepted != dlg.exec())
+  {
+    return;
+  }
+
+  sort_filter_t filter;
+  bool ok_min = true;
+  bool ok_max = true;
+  if(!edit_min->text().trimmed().isEmpty())
+  {
+    filter.m_min = edit_min->text().toDouble(&ok_min);
+    filter.m_active = true;
+  }
+  if(!edit_max->text().trimmed().isEmpty())
+  {
+    filter.m_max = edit_max->text().toDouble(&ok_max);
+    filter.m_active = true;
+  }
+  if(!ok_min || !ok_max)
+  {
+    statusBar()->showMessage(tr("Not a number"));
+    return;
+  }
+  m_model->set_filter(column, filter);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowTable::reset_order
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindowTable::reset_order()
+{
+  m_model->reset_order();
+  m_table->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+  statusBar()->clearMessage();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowTable::sort_finished
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindowTable::sort_finished()
+{
+  m_model->sort_finished(static_cast<SortThread*> (sender()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowTable::direct_paint
+///////////////////////////////////////////////////////////////////////////////////////
+
+void ChildWindowTable::direct_paint(bool direct)
+{
+  m_table->set_direct_paint(direct);
+  QSettings settings("space", "netcdf_explorer");
+  settings.setValue("table/direct_paint", direct);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::FileTreeWidget 
+///////////////////////////////////////////////////////////////////////////////////////
+
+FileTreeWidget::FileTreeWidget(QWidget *parent) : QTreeView(parent),
+m_main_window(NULL),
+m_diff_ref(NULL)
+{
+  m_model = new FileTreeModel(this);
+  m_filter = new FileTreeFilter(this);
+  m_filter->setSourceModel(m_model);
+  setModel(m_filter);
+  setUniformRowHeights(true);
+  setContextMenuPolicy(Qt::CustomContextMenu);
+
+  //right click menu
+  connect(this, SIGNAL(customContextMenuRequested(const QPoint &)), SLOT(show_context_menu(const QPoint &)));
+
+  //double click
+  connect(this, SIGNAL(doubleClicked(const QModelIndex &)), this, SLOT(add_grid()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_file
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_file(meta_store_t *store)
+{
+  m_model->add_file(store);
+  if(!m_search.isEmpty())
+  {
+    search(m_search);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::clear_files
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::clear_files()
+{
+  m_diff_ref = NULL;
+  m_model->clear();
+  search(m_search);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::search
+//filter the tree to the items found and their parents; returns the number found
+///////////////////////////////////////////////////////////////////////////////////////
+
+size_t FileTreeWidget::search(const QString &text)
+{
+  m_search = text.trimmed();
+  std::vector<std::vector<char> > keep;
+  size_t nbr_found = 0;
+  if(!m_search.isEmpty())
+  {
+    nbr_found = m_model->search(m_search.toUtf8().data(), keep);
+  }
+  m_filter->set_keep(!m_search.isEmpty(), keep);
+
+  //few results are shown expanded
+  if(!m_search.isEmpty() && nbr_found <= 1000)
+  {
+    expandAll();
+  }
+  return nbr_found;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::enable_data
+///////////////////////////////////////////////////////////////////////////////////////
+
+bool FileTreeWidget::enable_data(nc_type nc_typ)
+{
+  switch(nc_typ)
+  {
+  case NC_FLOAT:
+  case NC_DOUBLE:
+  case NC_INT:
+  case NC_SHORT:
+  case NC_CHAR:
+  case NC_BYTE:
+  case NC_UBYTE:
+  case NC_USHORT:
+  case NC_UINT:
+  case NC_INT64:
+  case NC_UINT64:
+  case NC_STRING:
+    return true;
+  };
+
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::show_context_menu
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::show_context_menu(const QPoint &p)
+{
+  const meta_item_t *item = m_model->item(m_filter->mapToSource(indexAt(p)));
+  if(item == NULL)
+  {
+    return;
+  }
+  QMenu menu;
+  if(item->m_kind == ItemData::Variable || item->m_kind == ItemData::Attribute)
+  {
+    QAction *action_grid = new QAction("Grid...", this);;
+    connect(action_grid, SIGNAL(triggered()), this, SLOT(add_grid()));
+    if(!enable_data(item->m_nc_type))
+    {
+      action_grid->setEnabled(false);
+    }
+    menu.addAction(action_grid);
+  }
+
+  //table of a hyperslab of a variable, by index or coordinate ranges
+  if(item->m_kind == ItemData::Variable && enable_data(item->m_nc_type) && item->m_nbr_dim > 0)
+  {
+    QAction *action_subset = new QAction("Grid subset...", this);
+    connect(action_subset, SIGNAL(triggered()), this, SLOT(add_subset()));
+    menu.addAction(action_subset);
+  }
+
+  //reduction of a numeric variable along one of its dimensions
+  if(item->m_kind == ItemData::Variable && diff_type(item->m_nc_type) && item->m_nbr_dim > 0)
+  {
+    QAction *action_reduce = new QAction("Reduce over dimension...", this);
+    connect(action_reduce, SIGNAL(triggered()), this, SLOT(add_reduce()));
+    menu.addAction(action_reduce);
+  }
+
+  //overview of a large grid of a file, from its pyramid sidecar
+  if(item->m_kind == ItemData::Variable && diff_type(item->m_nc_type) && item->m_nbr_dim >= 2)
+  {
+    ItemData *item_data = m_model->item_data(m_filter->mapToSource(indexAt(p)));
+    QAction *action_overview = new QAction("Overview...", this);
+    connect(action_overview, SIGNAL(triggered()), this, SLOT(add_overview()));
+    action_overview->setEnabled(!item_data->m_series && !item_data->m_source
+      && !is_url(QString::fromUtf8(item_data->m_file_name.c_str())));
+    menu.addAction(action_overview);
+  }
+
+  //derived variable of the variables of the group
+  QAction *action_derived = new QAction("New derived variable...", this);
+  connect(action_derived, SIGNAL(triggered()), this, SLOT(add_derived()));
+  menu.addAction(action_derived);
+
+  //diff of two variables of the same shape: the reference is B
+  if(item->m_kind == ItemData::Variable && diff_type(item->m_nc_type))
+  {
+    ItemData *item_data = m_model->item_data(m_filter->mapToSource(indexAt(p)));
+    bool same_shape = m_diff_ref != NULL && m_diff_ref != item_data && m_diff_ref->m_ncdata->m_dim == item_data->m_ncdata->m_dim;
+    QAction *action_reference = new QAction("Set as diff reference", this);
+    connect(action_reference, SIGNAL(triggered()), this, SLOT(set_diff_reference()));
+    QAction *action_diff = new QAction("Diff with reference...", this);
+    connect(action_diff, SIGNAL(triggered()), this, SLOT(add_diff()));
+    action_diff->setEnabled(same_shape);
+    QAction *action_diff_relative = new QAction("Relative diff with reference...", this);
+    connect(action_diff_relative, SIGNAL(triggered()), this, SLOT(add_diff_relative()));
+    action_diff_relative->setEnabled(same_shape);
+    menu.addSeparator();
+    menu.addAction(action_reference);
+    menu.addAction(action_diff);
+    menu.addAction(action_diff_relative);
+  }
+  menu.exec(QCursor::pos());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::set_diff_reference
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::set_diff_reference()
+{
+  m_diff_ref = m_model->item_data(m_filter->mapToSource(currentIndex()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_diff
+//diff view of the current variable (A) and the reference (B)
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_diff()
+{
+  add_diff(diff_absolute);
+}
+
+void FileTreeWidget::add_diff_relative()
+{
+  add_diff(diff_relative);
+}
+
+void FileTreeWidget::add_diff(int mode)
+{
+  QModelIndex index = m_filter->mapToSource(currentIndex());
+  const meta_item_t *item = m_model->item(index);
+  if(item == NULL || item->m_kind != ItemData::Variable || m_diff_ref == NULL)
+  {
+    return;
+  }
+  ItemData *item_data = m_model->item_data(index);
+  if(item_data->m_ncdata->m_dim != m_diff_ref->m_ncdata->m_dim)
+  {
+    return;
+  }
+  m_main_window->add_diff(item_data, m_diff_ref, mode);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_derived
+//"name = expression", or an expression alone, of the variables of the group of the current item
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_derived()
+{
+  QModelIndex index = m_filter->mapToSource(currentIndex());
+  if(m_model->item(index) == NULL)
+  {
+    return;
+  }
+  QInputDialog dlg(this);
+  dlg.setInputMode(QInputDialog::TextInput);
+  dlg.setLabelText("Derived variable (such as speed = sqrt(u*u + v*v))");
+  dlg.resize(QSize(400, 60));
+  if(QDialog::Accepted != dlg.exec())
+  {
+    return;
+  }
+
+  //the name is before the first = that is not part of a comparison
+  std::string text = dlg.textValue().toUtf8().data();
+  std::string var_nm;
+  for(size_t pos = 0; pos < text.size(); pos++)
+  {
+    if(text[pos] != '=' || (pos > 0 && strchr("<>!", text[pos - 1]) != NULL))
+    {
+      continue;
+    }
+    if(pos + 1 < text.size() && text[pos + 1] == '=')
+    {
+      pos++;
+      continue;
+    }
+    var_nm = QString::fromUtf8(text.substr(0, pos).c_str()).trimmed().toUtf8().data();
+    text = text.substr(pos + 1);
+    break;
+  }
+
+  std::string error;
+  if(m_model->add_derived(index, var_nm, text, &error) != NC_NOERR)
+  {
+    m_main_window->statusBar()->showMessage(tr("Cannot make derived variable: %1").arg(QString::fromUtf8(error.c_str())));
+    return;
+  }
+  if(!m_search.isEmpty())
+  {
+    search(m_search);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_reduce
+//asks for the dimension and the operation
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_reduce()
+{
+  QModelIndex index = m_filter->mapToSource(currentIndex());
+  const meta_item_t *item = m_model->item(index);
+  if(item == NULL || item->m_kind != ItemData::Variable || item->m_nbr_dim == 0)
+  {
+    return;
+  }
+  std::vector<std::string> dim_nm = m_model->dim_names(index);
+  QDialog dlg(this);
+  dlg.setWindowTitle(tr("Reduce over dimension"));
+  QComboBox *combo_dim = new QComboBox(&dlg);
+  for(size_t idx_dmn = 0; idx_dmn < dim_nm.size(); idx_dmn++)
+  {
+    combo_dim->addItem(QString::fromUtf8(dim_nm[idx_dmn].c_str()));
+  }
+  QComboBox *combo_op = new QComboBox(&dlg);
+  int ops[] = { reduce_mean, reduce_min, reduce_max, reduce_sum, reduce_std };
+  for(size_t idx_op = 0; idx_op < sizeof(ops) / sizeof(ops[0]); idx_op++)
+  {
+    combo_op->addItem(reduce_name(ops[idx_op]), ops[idx_op]);
+  }
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dlg);
+  connect(buttons, SIGNAL(accepted()), &dlg, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), &dlg, SLOT(reject()));
+  QFormLayout *layout = new QFormLayout(&dlg);
+  layout->addRow(tr("Dimension"), combo_dim);
+  layout->addRow(tr("Operation"), combo_op);
+  layout->addRow(buttons);
+  if(QDialog::Accepted != dlg.exec())
+  {
+    return;
+  }
+  m_main_window->add_reduce(m_model->item_data(index), combo_dim->currentIndex(), combo_op->itemData(combo_op->currentIndex()).toInt(), dim_nm);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_overview
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_overview()
+{
+  QModelIndex index = m_filter->mapToSource(currentIndex());
+  const meta_item_t *item = m_model->item(index);
+  if(item == NULL || item->m_kind != ItemData::Variable || item->m_nbr_dim < 2)
+  {
+    return;
+  }
+  m_main_window->add_overview(m_model->item_data(index), m_model->dim_names(index));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::currentChanged
+//shows the storage layout of the current variable
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::currentChanged(const QModelIndex &current, const QModelIndex &previous)
+{
+  QTreeView::currentChanged(current, previous);
+  QModelIndex index = m_filter->mapToSource(current);
+  const meta_item_t *item = m_model->item(index);
+  if(item == NULL || item->m_kind != ItemData::Variable)
+  {
+    m_main_window->show_layout(NULL, 0, std::vector<std::string>());
+    return;
+  }
+  unsigned int idx;
+  m_model->get_file(index, &idx);
+  m_main_window->show_layout(m_model->store(index), idx, m_model->dim_names(index));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_grid
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_grid()
+{
+  QModelIndex index = m_filter->mapToSource(currentIndex());
+  const meta_item_t *item = m_model->item(index);
+  if(item == NULL || (item->m_kind != ItemData::Variable && item->m_kind != ItemData::Attribute))
+  {
+    return;
+  }
+  if(!enable_data(item->m_nc_type))
+  {
+    return;
+  }
+  ItemData *item_data = m_model->item_data(index);
+
+  //load on the I/O thread, open the table when done; tiled tables load only the coordinate variables
+  MainWindow *main_window = m_main_window;
+  std::shared_ptr<int> status(new int(NC_NOERR));
+  std::function<void()> job;
+  if(item_data->m_kind == ItemData::Variable)
+  {
+    bool load_data = !TableModel::use_tiles(item_data->m_ncdata);
+    job = [item_data, load_data, status]() { *status = load_item(item_data, load_data); };
+  }
+  else if(!item_data->m_ncdata->m_buf.empty())
+  {
+    //value read in the scan
+    main_window->add_table(item_data);
+    return;
+  }
+  else
+  {
+    job = [item_data, status]() { *status = load_item_attribute(item_data); };
+  }
+  QString error = tr("Cannot read %1").arg(QString::fromUtf8(item_data->m_item_nm.c_str()));
+  IoScheduler::instance()->run_job(job, io_visible, main_window, [main_window, item_data, status, error](io_request_t *)
+  {
+    if(*status != NC_NOERR)
+    {
+      main_window->statusBar()->showMessage(error);
+      return;
+    }
+    main_window->add_table(item_data);
+  });
+
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeWidget::add_subset
+//asks for a range per dimension
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeWidget::add_subset()
+{
+  QModelIndex index = m_filter->mapToSource(currentIndex());
+  const meta_item_t *item = m_model->item(index);
+  if(item == NULL || item->m_kind != ItemData::Variable || item->m_nbr_dim == 0)
+  {
+    return;
+  }
+  ItemData *item_data = m_model->item_data(index);
+  std::vector<std::string> dim_nm = m_model->dim_names(index);
+  QDialog dlg(this);
+  dlg.setWindowTitle(tr("Grid subset of %1").arg(QString::fromUtf8(item_data->m_item_nm.c_str())));
+  QFormLayout *layout = new QFormLayout(&dlg);
+  layout->addRow(new QLabel(tr("Per dimension: empty for all, i, a:b, a:b:stride (indices from 0, b excluded),\n"
+    "or a range of coordinate values such as 30..60 or 2000-01-01..2000-12-31"), &dlg));
+  std::vector<QLineEdit *> edit;
+  for(size_t idx_dmn = 0; idx_dmn < dim_nm.size(); idx_dmn++)
+  {
+    QString str = QString("%1 (%2)").arg(QString::fromUtf8(dim_nm[idx_dmn].c_str()))
+      .arg((qulonglong)item_data->m_ncdata->m_dim[idx_dmn]);
+    edit.push_back(new QLineEdit(&dlg));
+    layout->addRow(str, edit.back());
+  }
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &dlg);
+  connect(buttons, SIGNAL(accepted()), &dlg, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), &dlg, SLOT(reject()));
+  layout->addRow(buttons);
+  if(QDialog::Accepted != dlg.exec())
+  {
+    return;
+  }
+  std::vector<std::string> range;
+  for(size_t idx_dmn = 0; idx_dmn < edit.size(); idx_dmn++)
+  {
+    range.push_back(edit[idx_dmn]->text().trimmed().toUtf8().data());
+  }
+  m_main_window->add_subset(item_data, range, dim_nm);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::FileTreeModel
+///////////////////////////////////////////////////////////////////////////////////////
+
+FileTreeModel::FileTreeModel(QObject *parent) :
+QAbstractItemModel(parent)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::~FileTreeModel
+///////////////////////////////////////////////////////////////////////////////////////
+
+FileTreeModel::~FileTreeModel()
+{
+  for(std::map<quintptr, ItemData*>::iterator it = m_item_data.begin(); it != m_item_data.end(); ++it)
+  {
+    delete it->second;
+  }
+  for(size_t idx_file = 0; idx_file < m_file.size(); idx_file++)
+  {
+    delete m_file[idx_file];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::add_file
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeModel::add_file(meta_store_t *store)
+{
+  quintptr base = m_file.empty() ? 0 : m_base.back() + m_file.back()->size();
+  int row = (int)m_file.size();
+  beginInsertRows(QModelIndex(), row, row);
+  m_file.push_back(store);
+  m_base.push_back(base);
+  endInsertRows();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::clear
+//removes all the files; no table may show their items
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeModel::clear()
+{
+  beginResetModel();
+  for(std::map<quintptr, ItemData*>::iterator it = m_item_data.begin(); it != m_item_data.end(); ++it)
+  {
+    delete it->second;
+  }
+  for(size_t idx_file = 0; idx_file < m_file.size(); idx_file++)
+  {
+    delete m_file[idx_file];
+  }
+  m_item_data.clear();
+  m_file.clear();
+  m_base.clear();
+  endResetModel();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::set_icons
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeModel::set_icons(const QIcon &icon_group, const QIcon &icon_dataset, const QIcon &icon_attribute)
+{
+  m_icon_group = icon_group;
+  m_icon_dataset = icon_dataset;
+  m_icon_attribute = icon_attribute;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::get_file
+//file of an index, and the item index in the file store
+///////////////////////////////////////////////////////////////////////////////////////
+
+size_t FileTreeModel::get_file(const QModelIndex &index, unsigned int *idx) const
+{
+  quintptr id = (quintptr)index.internalId();
+  size_t idx_file = std::upper_bound(m_base.begin(), m_base.end(), id) - m_base.begin() - 1;
+  *idx = (unsigned int)(id - m_base[idx_file]);
+  return idx_file;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::store
+///////////////////////////////////////////////////////////////////////////////////////
+
+const meta_store_t* FileTreeModel::store(const QModelIndex &index) const
+{
+  if(!index.isValid())
+  {
+    return NULL;
+  }
+  unsigned int idx;
+  return m_file[get_file(index, &idx)];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::find_store
+//store of an open file, not of a series or a derived variable, or NULL
+///////////////////////////////////////////////////////////////////////////////////////
+
+meta_store_t* FileTreeModel::find_store(const std::string &file_name) const
+{
+  for(size_t idx_file = 0; idx_file < m_file.size(); idx_file++)
+  {
+    meta_store_t *store = m_file[idx_file];
+    if(store->m_file_name == file_name && !store->m_series && !store->m_source)
+    {
+      return store;
+    }
+  }
+  return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::find_variable
+//item data of a variable by name or by full path name (e.g "/g1/var"), NULL if not found
+///////////////////////////////////////////////////////////////////////////////////////
+
+ItemData* FileTreeModel::find_variable(const std::string &name)
+{
+  for(size_t idx_file = 0; idx_file < m_file.size(); idx_file++)
+  {
+    const meta_store_t *store = m_file[idx_file];
+    for(unsigned int idx = 0; idx < store->size(); idx++)
+    {
+      if(store->item(idx).m_kind != ItemData::Variable)
+      {
+        continue;
+      }
+      std::string path(store->group(idx));
+      if(path != "/")
+      {
+        path += "/";
+      }
+      path += store->name(idx);
+      if(name == store->name(idx) || name == path)
+      {
+        return item_data(idx_file, idx);
+      }
+    }
+  }
+  return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::opened_variables
+//variables of a file that have item data, the ones opened in tables
+///////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<ItemData*> FileTreeModel::opened_variables(const meta_store_t *store) const
+{
+  std::vector<ItemData*> items;
+  size_t idx_file = std::find(m_file.begin(), m_file.end(), store) - m_file.begin();
+  if(idx_file == m_file.size())
+  {
+    return items;
+  }
+  std::map<quintptr, ItemData*>::const_iterator it = m_item_data.lower_bound(m_base[idx_file]);
+  for(; it != m_item_data.end() && it->first < m_base[idx_file] + store->size(); ++it)
+  {
+    if(it->second->m_kind == ItemData::Variable)
+    {
+      items.push_back(it->second);
+    }
+  }
+  return items;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::make_index
+///////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex FileTreeModel::make_index(size_t idx_file, unsigned int idx) const
+{
+  int row = idx == 0 ? (int)idx_file : (int)m_file[idx_file]->row(idx);
+  return createIndex(row, 0, reinterpret_cast<void*> (m_base[idx_file] + idx));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::index
+///////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex FileTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+  if(row < 0 || column != 0)
+  {
+    return QModelIndex();
+  }
+  if(!parent.isValid())
+  {
+    return (size_t)row < m_file.size() ? make_index(row, 0) : QModelIndex();
+  }
+  unsigned int idx_prn;
+  size_t idx_file = get_file(parent, &idx_prn);
+  const meta_item_t &item_prn = m_file[idx_file]->item(idx_prn);
+  if((unsigned int)row >= item_prn.m_nbr_chd)
+  {
+    return QModelIndex();
+  }
+  return make_index(idx_file, item_prn.m_first + row);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::parent
+///////////////////////////////////////////////////////////////////////////////////////
+
+QModelIndex FileTreeModel::parent(const QModelIndex &index) const
+{
+  if(!index.isValid())
+  {
+    return QModelIndex();
+  }
+  unsigned int idx;
+  size_t idx_file = get_file(index, &idx);
+  unsigned int idx_prn = m_file[idx_file]->item(idx).m_parent;
+  if(idx_prn == meta_none)
+  {
+    return QModelIndex();
+  }
+  return make_index(idx_file, idx_prn);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::rowCount
+///////////////////////////////////////////////////////////////////////////////////////
+
+int FileTreeModel::rowCount(const QModelIndex &parent) const
+{
+  if(!parent.isValid())
+  {
+    return (int)m_file.size();
+  }
+  unsigned int idx;
+  size_t idx_file = get_file(parent, &idx);
+  return (int)m_file[idx_file]->item(idx).m_nbr_chd;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::columnCount
+///////////////////////////////////////////////////////////////////////////////////////
+
+int FileTreeModel::columnCount(const QModelIndex &) const
+{
+  return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::data
+///////////////////////////////////////////////////////////////////////////////////////
+
+QVariant FileTreeModel::data(const QModelIndex &index, int role) const
+{
+  if(!index.isValid())
+  {
+    return QVariant();
+  }
+  unsigned int idx;
+  size_t idx_file = get_file(index, &idx);
+  const meta_store_t *store = m_file[idx_file];
+
+  if(role == Qt::DisplayRole)
+  {
+    //the root shows the file name; a series, its glob or NcML file and number of files; a derived
+    //variable, its expression
+    if(idx == 0 && !store->m_title.empty())
+    {
+      return QString::fromUtf8(store->m_title.c_str());
+    }
+    if(idx == 0 && store->m_series)
+    {
+      const std::string &name = store->m_series->m_name;
+      return tr("%1 (%2 files)").arg(QString::fromUtf8(name.c_str() + name.rfind('/') + 1)).arg(store->m_series->size());
+    }
+    if(idx == 0)
+    {
+      const std::string &file_name = store->m_file_name;
+      return QString::fromUtf8(file_name.c_str() + file_name.rfind('/') + 1);
+    }
+    return QString::fromUtf8(store->name(idx));
+  }
+  else if(role == Qt::ToolTipRole)
+  {
+    //attributes show their value, variables their long name and units, from the attribute arena
+    const meta_item_t &item = store->item(idx);
+    if(item.m_kind == ItemData::Attribute)
+    {
+      std::string text = store->att_text(idx);
+      return text.empty() ? QVariant() : QVariant(QString::fromUtf8(text.c_str()));
+    }
+    if(item.m_kind == ItemData::Variable && item.m_nbr_chd > 0)
+    {
+      unsigned int idx_long_name = store->find_att(idx, "long_name");
+      unsigned int idx_units = store->find_att(idx, "units");
+      std::string long_name = idx_long_name == meta_none ? std::string() : store->att_text(idx_long_name);
+      std::string units = idx_units == meta_none ? std::string() : store->att_text(idx_units);
+      if(long_name.empty() && units.empty())
+      {
+        return QVariant();
+      }
+      if(units.empty())
+      {
+        return QString::fromUtf8(long_name.c_str());
+      }
+      if(long_name.empty())
+      {
+        return QString::fromUtf8(units.c_str());
+      }
+      return QString::fromUtf8((long_name + " (" + units + ")").c_str());
+    }
+    return QVariant();
+  }
+  else if(role == Qt::DecorationRole)
+  {
+    switch(store->item(idx).m_kind)
+    {
+    case ItemData::Variable:
+      return m_icon_dataset;
+    case ItemData::Attribute:
+      return m_icon_attribute;
+    default:
+      return m_icon_group;
+    }
+  }
+  return QVariant();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::item
+///////////////////////////////////////////////////////////////////////////////////////
+
+const meta_item_t* FileTreeModel::item(const QModelIndex &index) const
+{
+  if(!index.isValid())
+  {
+    return NULL;
+  }
+  unsigned int idx;
+  size_t idx_file = get_file(index, &idx);
+  return &m_file[idx_file]->item(idx);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::item_data
+//item data of an item, created on first use; it lives as long as the model, since tables point to it
+///////////////////////////////////////////////////////////////////////////////////////
+
+ItemData* FileTreeModel::item_data(const QModelIndex &index)
+{
+  unsigned int idx;
+  size_t idx_file = get_file(index, &idx);
+  return item_data(idx_file, idx);
+}
+
+ItemData* FileTreeModel::item_data(size_t idx_file, unsigned int idx)
+{
+  quintptr id = m_base[idx_file] + idx;
+  std::map<quintptr, ItemData*>::iterator it = m_item_data.find(id);
+  if(it != m_item_data.end())
+  {
+    return it->second;
+  }
+
+  const meta_store_t *store = m_file[idx_file];
+  const meta_item_t &item = store->item(idx);
+  ItemData *item_data_prn = item.m_parent == meta_none ? NULL : item_data(idx_file, item.m_parent);
+  ncdata_t *ncdata = NULL;
+  if(item.m_kind == ItemData::Variable || item.m_kind == ItemData::Attribute)
+  {
+    std::vector<size_t> dim(store->dim(idx), store->dim(idx) + item.m_nbr_dim);
+    ncdata = new ncdata_t(store->name(idx), item.m_nc_type, dim);
+  }
+  ItemData *item_data = new ItemData((ItemData::ItemKind)item.m_kind,
+    store->m_file_name,
+    store->group(idx),
+    store->name(idx),
+    item_data_prn,
+    ncdata);
+  item_data->m_series = store->m_series;
+
+  //groups list their variables (for coordinate variables detection)
+  if(item.m_kind == ItemData::Group)
+  {
+    for(unsigned int idx_chd = item.m_first; idx_chd < item.m_first + item.m_nbr_chd; idx_chd++)
+    {
+      if(store->item(idx_chd).m_kind == ItemData::Variable)
+      {
+        item_data->m_var_nms.push_back(store->name(idx_chd));
+      }
+    }
+  }
+
+  //store an empty coordinate variable for grid variable compability (print indices in table headers)
+  //the value of an attribute comes from the arena of the store when there
+  if(item.m_kind == ItemData::Attribute)
+  {
+    item_data->m_ncvar_crd.push_back(NULL);
+    item_data->m_ncdata->store(store->att_value(idx));
+  }
+
+  m_item_data[id] = item_data;
+  return item_data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::search
+//query the index of each file; marks the items found and their parents in keep
+///////////////////////////////////////////////////////////////////////////////////////
+
+size_t FileTreeModel::search(const std::string &text, std::vector<std::vector<char> > &keep) const
+{
+  trace_t trace("FileTreeModel::search", text.c_str());
+  index_query_t qry(text);
+  std::vector<unsigned int> items;
+  size_t nbr_found = 0;
+  keep.resize(m_file.size());
+  for(size_t idx_file = 0; idx_file < m_file.size(); idx_file++)
+  {
+    const meta_store_t *store = m_file[idx_file];
+    std::vector<char> &kp = keep[idx_file];
+    kp.assign(store->size(), 0);
+    items.clear();
+    store->m_index.query(*store, qry, items);
+    for(size_t idx = 0; idx < items.size(); idx++)
+    {
+      unsigned int idx_item = items[idx];
+      if(kp[idx_item])
+      {
+        continue;
+      }
+      nbr_found++;
+
+      //parents up to the first already shown
+      while(idx_item != meta_none && !kp[idx_item])
+      {
+        kp[idx_item] = 1;
+        idx_item = store->item(idx_item).m_parent;
+      }
+    }
+  }
+  return nbr_found;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::add_derived
+//a derived variable of the variables of the group of index (or of the group index is), added as a
+//file of its own; its operands are the variables named in the expression
+///////////////////////////////////////////////////////////////////////////////////////
+
+int FileTreeModel::add_derived(const QModelIndex &index, const std::string &var_nm, const std::string &text, std::string *error)
+{
+  std::shared_ptr<expr_t> expr(new expr_t);
+  if(expr->parse(text, error) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  unsigned int idx_grp;
+  size_t idx_file = get_file(index, &idx_grp);
+  const meta_store_t *store = m_file[idx_file];
+  while(store->item(idx_grp).m_kind != ItemData::Group)
+  {
+    idx_grp = store->item(idx_grp).m_parent;
+  }
+
+  //operands, by name among the variables of the group
+  const meta_item_t &grp = store->item(idx_grp);
+  std::vector<expr_operand_t> operands(expr->m_var_nm.size());
+  std::vector<ItemData*> operand_item_data(expr->m_var_nm.size(), NULL);
+  for(size_t idx_opr = 0; idx_opr < operands.size(); idx_opr++)
+  {
+    for(unsigned int idx_chd = grp.m_first; idx_chd < grp.m_first + grp.m_nbr_chd; idx_chd++)
+    {
+      const meta_item_t &item = store->item(idx_chd);
+      if(item.m_kind != ItemData::Variable || expr->m_var_nm[idx_opr] != store->name(idx_chd))
+      {
+        continue;
+      }
+      operand_item_data[idx_opr] = item_data(idx_file, idx_chd);
+      operands[idx_opr].m_source = make_slab_source(operand_item_data[idx_opr]);
+      operands[idx_opr].m_dim_nm = dim_names(idx_file, idx_chd);
+      break;
+    }
+    if(operand_item_data[idx_opr] == NULL)
+    {
+      *error = "no variable " + expr->m_var_nm[idx_opr] + " in " + store->group(idx_grp);
+      return NC2_ERR;
+    }
+  }
+  if(expr->bind(operands, error) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+
+  std::vector<size_t> crd_dmn(expr->m_dim.size());
+  for(size_t idx_dmn = 0; idx_dmn < crd_dmn.size(); idx_dmn++)
+  {
+    crd_dmn[idx_dmn] = idx_dmn;
+  }
+  add_virtual(var_nm.empty() ? text : var_nm + " = " + text, var_nm.empty() ? text : var_nm, operand_item_data[expr->m_base],
+    crd_dmn, expr->m_dim_nm, std::shared_ptr<slab_source_t>(new expr_slab_source_t(expr)));
+  return NC_NOERR;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::add_virtual
+//a variable computed by source, added as a file of its own; it shows the coordinate variables of
+//dimensions crd_dmn of item_data_crd, and is in its file and group
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeModel::add_virtual(const std::string &title, const std::string &var_nm, ItemData *item_data_crd, const std::vector<size_t> &crd_dmn,
+  const std::vector<std::string> &dim_nm, const std::shared_ptr<slab_source_t> &source)
+{
+  meta_store_t *store = new meta_store_t(item_data_crd->m_file_name);
+  store->m_source = source;
+  store->m_title = title;
+  meta_derived(store, item_data_crd->m_grp_nm_fll, var_nm, source->dim(), dim_nm);
+  add_file(store);
+
+  //the item data of the variable is made now, and kept
+  ItemData *item_data_virtual = item_data(m_file.size() - 1, 1);
+  item_data_virtual->m_source = source;
+  item_data_virtual->m_item_data_crd = item_data_crd;
+  item_data_virtual->m_crd_dmn = crd_dmn;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::dim_names
+//dimension names of a variable
+///////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> FileTreeModel::dim_names(const QModelIndex &index) const
+{
+  unsigned int idx;
+  size_t idx_file = get_file(index, &idx);
+  return dim_names(idx_file, idx);
+}
+
+std::vector<std::string> FileTreeModel::dim_names(size_t idx_file, unsigned int idx) const
+{
+  const meta_store_t *store = m_file[idx_file];
+  const meta_item_t &item = store->item(idx);
+  std::vector<std::string> dim_nm;
+  for(unsigned int idx_dmn = 0; idx_dmn < item.m_nbr_dim; idx_dmn++)
+  {
+    unsigned int dmn_nm = store->m_dim_nm[item.m_dim + idx_dmn];
+    dim_nm.push_back(dmn_nm == meta_none ? std::string() : store->m_str.at(dmn_nm));
+  }
+  return dim_nm;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeFilter::set_keep
+///////////////////////////////////////////////////////////////////////////////////////
+
+void FileTreeFilter::set_keep(bool active, std::vector<std::vector<char> > &keep)
+{
+  m_active = active;
+  m_keep.swap(keep);
+  invalidateFilter();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeFilter::filterAcceptsRow
+///////////////////////////////////////////////////////////////////////////////////////
+
+bool FileTreeFilter::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+{
+  if(!m_active)
+  {
+    return true;
+  }
+  FileTreeModel *model = static_cast<FileTreeModel*> (sourceModel());
+  unsigned int idx;
+  size_t idx_file = model->get_file(model->index(source_row, 0, source_parent), &idx);
+  return idx_file < m_keep.size() && m_keep[idx_file][idx];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel::bytes
+//memory of the metadata stores
+///////////////////////////////////////////////////////////////////////////////////////
+
+size_t FileTreeModel::bytes() const
+{
+  size_t nbr_bytes = 0;
+  for(size_t idx_file = 0; idx_file < m_file.size(); idx_file++)
+  {
+    nbr_bytes += m_file[idx_file]->bytes();
+  }
+  return nbr_bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//inq_grp_id
+//get the group ID of a full group name
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int inq_grp_id(const int nc_id, const std::string& grp_nm_fll, int *grp_id)
+{
+  int fl_fmt;
+
+  //need a file format inquiry, since nc_inq_grp_full_ncid does not handle netCDF3 cases
+  if(NC_TRACE("nc_inq_format", NULL, 0, nc_inq_format(nc_id, &fl_fmt)) != NC_NOERR)
+  {
+
+  }
+
+  if(fl_fmt == NC_FORMAT_NETCDF4 || fl_fmt == NC_FORMAT_NETCDF4_CLASSIC)
+  {
+    // obtain group ID for netCDF4 files
+    return NC_TRACE("nc_inq_grp_full_ncid", grp_nm_fll.c_str(), 0, nc_inq_grp_full_ncid(nc_id, grp_nm_fll.c_str(), grp_id));
+  }
+
+  //make the group ID the file ID for netCDF3 cases
+  *grp_id = nc_id;
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_item
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int load_item(ItemData *item_data, bool load_data)
+{
+  trace_t trace("load_item", item_data->m_item_nm.c_str());
+  char var_nm[NC_MAX_NAME + 1]; // variable name 
+  char dmn_nm_var[NC_MAX_NAME + 1]; //dimension name
+  int nc_id;
+  int grp_id;
+  int var_id;
+  nc_type var_type;
+  int nbr_dmn;
+  int var_dimid[NC_MAX_VAR_DIMS];
+  size_t dmn_sz[NC_MAX_VAR_DIMS];
+  size_t buf_sz; // variable size
+
+  assert(item_data->m_kind == ItemData::Variable);
+
+  //coordinate variables are loaded once; the data only if asked for (tiled tables read it by slabs)
+  bool load_crd = item_data->m_ncvar_crd.empty();
+  load_data = load_data && item_data->m_ncdata->m_buf.empty();
+  if(!load_crd && !load_data)
+  {
+    return NC_NOERR;
+  }
+
+  //a derived variable shows copies of the numeric coordinate variables of the matching dimensions of
+  //one of its operands
+  if(item_data->m_source)
+  {
+    if(load_crd)
+    {
+      load_item(item_data->m_item_data_crd, false);
+      const std::vector<ncdata_t *> &ncvar_crd = item_data->m_item_data_crd->m_ncvar_crd;
+      for(size_t idx_dmn = 0; idx_dmn < item_data->m_crd_dmn.size(); idx_dmn++)
+      {
+        ncdata_t *ncvar = NULL;
+        size_t idx_crd = item_data->m_crd_dmn[idx_dmn];
+        if(idx_crd < ncvar_crd.size() && ncvar_crd[idx_crd] != NULL && ncvar_crd[idx_crd]->m_nc_type != NC_STRING)
+        {
+          const ncdata_t *crd = ncvar_crd[idx_crd];
+          ncvar = new ncdata_t(crd->m_name.c_str(), crd->m_nc_type, crd->m_dim);
+          ncvar->m_units = crd->m_units;
+          ncvar->m_calendar = crd->m_calendar;
+          buffer_t buf(crd->m_buf.size());
+          if(!buf.empty())
+          {
+            memcpy(buf.data(), crd->m_buf.data(), crd->m_buf.size());
+          }
+          ncvar->store(std::move(buf));
+        }
+        item_data->m_ncvar_crd.push_back(ncvar);
+      }
+    }
+    if(load_data)
+    {
+      const std::vector<size_t> &dim = item_data->m_ncdata->m_dim;
+      item_data->m_ncdata->store(item_data->m_source->read(std::vector<size_t>(dim.size(), 0), dim));
+      if(item_data->m_ncdata->m_buf.empty())
+      {
+        return NC2_ERR;
+      }
+    }
+    return NC_NOERR;
+  }
+
+  //a variable of a remote file is read by its server
+  if(is_remote(item_data->m_file_name))
+  {
+    return remote_load_item(item_data->m_file_name, item_data->m_grp_nm_fll, item_data->m_item_nm,
+      load_crd ? &item_data->m_ncvar_crd : NULL, load_data ? item_data->m_ncdata : NULL);
+  }
+
+  if(NC_TRACE("nc_open", item_data->m_file_name.c_str(), 0, nc_open(item_data->m_file_name.c_str(), NC_NOWRITE, &nc_id)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+
+  if(inq_grp_id(nc_id, item_data->m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+
+  }
+
+  //all hunky dory from here 
+
+  // get variable ID
+  if(NC_TRACE("nc_inq_varid", item_data->m_item_nm.c_str(), 0, nc_inq_varid(grp_id, item_data->m_item_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+
+  }
+
+  if(NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, var_id, var_nm, &var_type, &nbr_dmn, var_dimid, (int *)NULL)) != NC_NOERR)
+  {
+
+  }
+
+  //get dimensions 
+  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    int has_crd_var = 0;
+
+    //dimensions belong to groups
+    if(NC_TRACE("nc_inq_dim", NULL, 0, nc_inq_dim(grp_id, var_dimid[idx_dmn], dmn_nm_var, &dmn_sz[idx_dmn])) != NC_NOERR)
+    {
+
+    }
+
+    //in a series, the series dimension spans all the files
+    bool series_dmn = item_data->m_series && idx_dmn == 0 && item_data->m_series->m_dim_nm == dmn_nm_var;
+    if(series_dmn)
+    {
+      dmn_sz[idx_dmn] = item_data->m_series->records();
+    }
+
+    if(!load_crd)
+    {
+      continue;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+    //look up possible coordinate variables
+    //traverse all variables in group and match a variable name 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    for(size_t idx_var = 0; idx_var < item_data->m_item_data_prn->m_var_nms.size(); idx_var++)
+    {
+      std::string var_nm(item_data->m_item_data_prn->m_var_nms[idx_var]);
+
+      if(var_nm == std::string(dmn_nm_var))
+      {
+        has_crd_var = 1;
+        break;
+      }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+    //a coordinate variable was found
+    //since the lookup was only in the same group, get the variable information on this group 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    if(has_crd_var)
+    {
+      int crd_var_id;
+      char crd_var_nm[NC_MAX_NAME + 1];
+      int crd_nbr_dmn;
+      int crd_var_dimid[NC_MAX_VAR_DIMS];
+      size_t crd_dmn_sz[NC_MAX_VAR_DIMS];
+      nc_type crd_var_type = NC_NAT;
+
+      // get coordinate variable ID (using the dimension name, since there was a match to a variable)
+      if(NC_TRACE("nc_inq_varid", dmn_nm_var, 0, nc_inq_varid(grp_id, dmn_nm_var, &crd_var_id)) != NC_NOERR)
+      {
+
+      }
+
+      if(NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, crd_var_id, crd_var_nm, &crd_var_type, &crd_nbr_dmn, crd_var_dimid, (int *)NULL)) != NC_NOERR)
+      {
+
+      }
+
+      assert(std::string(crd_var_nm) == std::string(dmn_nm_var));
+
+      if(crd_nbr_dmn == 1)
+      {
+        //get size
+        if(NC_TRACE("nc_inq_dim", NULL, 0, nc_inq_dim(grp_id, crd_var_dimid[0], (char *)NULL, &crd_dmn_sz[0])) != NC_NOERR)
+        {
+
+        }
+
+        //store dimension 
+        std::vector<size_t> dim; //dimensions for each variable 
+        dim.push_back(series_dmn ? dmn_sz[idx_dmn] : crd_dmn_sz[0]);
+
+        //coordinate variables of long dimensions are not read: their rows are numbered
+        if(dim[0] > crd_max_load)
+        {
+          item_data->m_ncvar_crd.push_back(NULL);
+          continue;
+        }
+
+        //store a ncdata_t
+        ncdata_t *ncvar = new ncdata_t(crd_var_nm, crd_var_type, dim);
+
+        //allocate, load; the series coordinate variable is read from all the files
+        if(series_dmn)
+        {
+          series_slab_source_t source(item_data->m_series, item_data->m_grp_nm_fll, crd_var_nm, crd_var_type, dim);
+          ncvar->store(source.read(std::vector<size_t>(1, 0), dim));
+        }
+        else
+        {
+          ncvar->store(load_variable(grp_id, crd_var_id, crd_var_type, crd_dmn_sz[0]));
+        }
+
+        ncvar->m_units = load_att_text(grp_id, crd_var_id, "units");
+        ncvar->m_calendar = load_att_text(grp_id, crd_var_id, "calendar");
+
+        //and store in tree; rows are numbered if it could not be read
+        if(ncvar->m_buf.empty())
+        {
+          delete ncvar;
+          ncvar = NULL;
+        }
+        item_data->m_ncvar_crd.push_back(ncvar);
+      }
+      else
+      {
+        item_data->m_ncvar_crd.push_back(NULL); //not a coordinate variable, keep one entry per dimension
+      }
+    }
+    else
+    {
+      item_data->m_ncvar_crd.push_back(NULL); //no coordinate variable for this dimension
+    }
+  }
+
+  //define buffer size
+  buf_sz = 1;
+  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    buf_sz *= dmn_sz[idx_dmn];
+  }
+
+  //allocate buffer and store in item data 
+  if(load_data && item_data->m_series)
+  {
+    std::vector<size_t> dim(dmn_sz, dmn_sz + nbr_dmn);
+    series_slab_source_t source(item_data->m_series, item_data->m_grp_nm_fll, item_data->m_item_nm, var_type, dim);
+    item_data->m_ncdata->store(source.read(std::vector<size_t>(nbr_dmn, 0), dim));
+  }
+  else if(load_data)
+  {
+    item_data->m_ncdata->store(load_variable(grp_id, var_id, var_type, buf_sz));
+  }
+
+  if(NC_TRACE("nc_close", NULL, 0, nc_close(nc_id)) != NC_NOERR)
+  {
+
+  }
+
+  if(load_data && buf_sz > 0 && item_data->m_ncdata->m_buf.empty())
+  {
+    return NC2_ERR;
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_records
+//records of a variable after dim_old[0] when only its first dimension grew, else the whole variable
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static buffer_t load_records(const int grp_id, const int var_id, const nc_type var_type,
+  const std::vector<size_t> &dim_old, const std::vector<size_t> &dim, bool *whole)
+{
+  *whole = var_type == NC_STRING || dim.empty() || dim_old.size() != dim.size();
+  size_t buf_sz = 1;
+  for(size_t idx_dmn = 0; idx_dmn < dim.size(); idx_dmn++)
+  {
+    buf_sz *= dim[idx_dmn];
+    if(idx_dmn > 0 && !*whole && dim[idx_dmn] != dim_old[idx_dmn])
+    {
+      *whole = true;
+    }
+  }
+  if(*whole)
+  {
+    return load_variable(grp_id, var_id, var_type, buf_sz);
+  }
+  std::vector<size_t> start(dim.size(), 0);
+  std::vector<size_t> count(dim);
+  start[0] = dim_old[0];
+  count[0] = dim[0] - dim_old[0];
+  return load_variable_slab(grp_id, var_id, var_type, start, count, std::vector<ptrdiff_t>(dim.size(), 1));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//grow_item
+//I/O thread; the records appended to the file of an opened variable, nc_id opened after they were written
+//m_item_data of growth stays NULL if the variable did not grow
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int grow_item(const int nc_id, ItemData *item_data, item_growth_t *growth)
+{
+  trace_t trace("grow_item", item_data->m_item_nm.c_str());
+  int grp_id;
+  int var_id;
+  int nbr_dmn;
+  int var_dimid[NC_MAX_VAR_DIMS];
+  const ncdata_t *ncdata = item_data->m_ncdata;
+
+  if(inq_grp_id(nc_id, item_data->m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(NC_TRACE("nc_inq_varid", item_data->m_item_nm.c_str(), 0, nc_inq_varid(grp_id, item_data->m_item_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(NC_TRACE("nc_inq_varndims", NULL, 0, nc_inq_varndims(grp_id, var_id, &nbr_dmn)) != NC_NOERR ||
+    (size_t)nbr_dmn != ncdata->m_dim.size())
+  {
+    return NC2_ERR;
+  }
+  if(NC_TRACE("nc_inq_vardimid", NULL, 0, nc_inq_vardimid(grp_id, var_id, var_dimid)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  std::vector<size_t> dim(nbr_dmn);
+  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    if(NC_TRACE("nc_inq_dimlen", NULL, 0, nc_inq_dimlen(grp_id, var_dimid[idx_dmn], &dim[idx_dmn])) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+  }
+  if(dim == ncdata->m_dim)
+  {
+    return NC_NOERR;
+  }
+  growth->m_item_data = item_data;
+  growth->m_dim = dim;
+
+  //coordinate variables, from the records they hold (they may have been read after the file grew)
+  growth->m_crd.resize(nbr_dmn);
+  growth->m_crd_whole.resize(nbr_dmn, 0);
+  for(int idx_dmn = 0; idx_dmn < nbr_dmn && (size_t)nbr_dmn == item_data->m_ncvar_crd.size(); idx_dmn++)
+  {
+    const ncdata_t *crd = item_data->m_ncvar_crd[idx_dmn];
+    int crd_var_id;
+    if(crd == NULL || crd->m_dim.size() != 1 || crd->m_dim[0] >= dim[idx_dmn])
+    {
+      continue;
+    }
+    if(NC_TRACE("nc_inq_varid", crd->m_name.c_str(), 0, nc_inq_varid(grp_id, crd->m_name.c_str(), &crd_var_id)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    bool whole;
+    growth->m_crd[idx_dmn] = load_records(grp_id, crd_var_id, crd->m_nc_type, crd->m_dim,
+      std::vector<size_t>(1, dim[idx_dmn]), &whole);
+    growth->m_crd_whole[idx_dmn] = whole;
+  }
+
+  //data read whole; read again whole if its buffer does not hold the records of its dimensions
+  if(!ncdata->m_buf.empty())
+  {
+    size_t buf_sz = get_type_size(ncdata->m_nc_type);
+    for(size_t idx_dmn = 0; idx_dmn < ncdata->m_dim.size(); idx_dmn++)
+    {
+      buf_sz *= ncdata->m_dim[idx_dmn];
+    }
+    std::vector<size_t> dim_old = ncdata->m_dim;
+    if(ncdata->m_buf.size() != buf_sz)
+    {
+      dim_old.clear();
+    }
+    growth->m_buf = load_records(grp_id, var_id, ncdata->m_nc_type, dim_old, dim, &growth->m_buf_whole);
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//append_records
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void append_records(ncdata_t *ncdata, buffer_t &buf, bool whole)
+{
+  if(whole)
+  {
+    ncdata->store(std::move(buf));
+    return;
+  }
+  size_t size = ncdata->m_buf.size();
+  ncdata->m_buf.resize(size + buf.size());
+  memcpy(static_cast<char*> (ncdata->m_buf.data()) + size, buf.data(), buf.size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//apply_growth
+//GUI thread; the tables of the variable are told by ChildWindow::grow
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void apply_growth(item_growth_t *growth)
+{
+  ItemData *item_data = growth->m_item_data;
+  if(item_data == NULL)
+  {
+    return;
+  }
+  for(size_t idx_dmn = 0; idx_dmn < growth->m_crd.size() && idx_dmn < item_data->m_ncvar_crd.size(); idx_dmn++)
+  {
+    ncdata_t *crd = item_data->m_ncvar_crd[idx_dmn];
+    if(crd == NULL || growth->m_crd[idx_dmn].empty())
+    {
+      continue;
+    }
+    append_records(crd, growth->m_crd[idx_dmn], growth->m_crd_whole[idx_dmn] != 0);
+    crd->m_dim[0] = growth->m_dim[idx_dmn];
+  }
+  if(!growth->m_buf.empty())
+  {
+    append_records(item_data->m_ncdata, growth->m_buf, growth->m_buf_whole);
+  }
+  item_data->m_ncdata->m_dim = growth->m_dim;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_item_attribute
+//A netCDF attribute has a netCDF variable to which it is assigned, a name, a type, a length, and a sequence of one or more values.
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int load_item_attribute(ItemData *item_data)
+{
+  trace_t trace("load_item_attribute", item_data->m_item_nm.c_str());
+  int nc_id = -1;
+  int grp_id = -1;
+  int parent_id = -1;
+  size_t attr_sz; // attribute size
+
+  assert(item_data->m_kind == ItemData::Attribute);
+
+  //item data of parent item, to detect if parent is group or variable
+  ItemData *item_data_prn = item_data->m_item_data_prn;
+  assert(item_data_prn->m_kind == ItemData::Group
+    || item_data_prn->m_kind == ItemData::Root
+    || item_data_prn->m_kind == ItemData::Variable);
+
+  //attribute name is tree item name
+  const char *attr_nm = item_data->m_item_nm.c_str();
+  //attribute type is stored in ncvar_t variable
+  nc_type attr_typ = item_data->m_ncdata->m_nc_type;
+
+  //if not loaded, read buffer from file 
+  if(!item_data->m_ncdata->m_buf.empty())
+  {
+    return NC_NOERR;
+  }
+
+  if(is_remote(item_data->m_file_name))
+  {
+    buffer_t buf;
+    std::string var_nm = item_data_prn->m_kind == ItemData::Variable ? item_data_prn->m_item_nm : std::string();
+    if(remote_load_att(item_data->m_file_name, item_data->m_grp_nm_fll, var_nm, attr_nm, attr_typ, &buf) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    item_data->m_ncdata->store(std::move(buf));
+    return NC_NOERR;
+  }
+
+  if(NC_TRACE("nc_open", item_data->m_file_name.c_str(), 0, nc_open(item_data->m_file_name.c_str(), NC_NOWRITE, &nc_id)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+
+  if(inq_grp_id(nc_id, item_data->m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+
+  }
+
+  if(item_data_prn->m_kind == ItemData::Variable)
+  {
+    //variable name is the parent item data item name
+    const char *var_nm = item_data->m_item_data_prn->m_item_nm.c_str();
+
+    // get variable ID
+    if(NC_TRACE("nc_inq_varid", var_nm, 0, nc_inq_varid(grp_id, var_nm, &parent_id)) != NC_NOERR)
+    {
+
+    }
+  }
+  else if(item_data_prn->m_kind == ItemData::Group || item_data_prn->m_kind == ItemData::Root)
+  {
+    parent_id = NC_GLOBAL;
+  }
+
+
+  if(NC_TRACE("nc_inq_attlen", attr_nm, 0, nc_inq_attlen(grp_id, parent_id, attr_nm, &attr_sz)))
+  {
+
+  }
+
+  //allocate buffer and store in item data 
+  item_data->m_ncdata->store(load_attribute(grp_id, parent_id, attr_nm, attr_typ, attr_sz));
+
+  if(NC_TRACE("nc_close", NULL, 0, nc_close(nc_id)) != NC_NOERR)
+  {
+
+  }
+
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_variable
+//empty buffer if the read fails
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t load_variable(const int nc_id, const int var_id, const nc_type var_type, size_t buf_sz)
+{
+  buffer_t buf;
+  switch(var_type)
+  {
+  case NC_FLOAT:
+    buf = buffer_t(buf_sz * sizeof(float));
+    if(NC_TRACE("nc_get_var_float", NULL, buf_sz * sizeof(float), nc_get_var_float(nc_id, var_id, buf.as<float>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_DOUBLE:
+    buf = buffer_t(buf_sz * sizeof(double));
+    if(NC_TRACE("nc_get_var_double", NULL, buf_sz * sizeof(double), nc_get_var_double(nc_id, var_id, buf.as<double>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_INT:
+    buf = buffer_t(buf_sz * sizeof(int));
+    if(NC_TRACE("nc_get_var_int", NULL, buf_sz * sizeof(int), nc_get_var_int(nc_id, var_id, buf.as<int>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_SHORT:
+    buf = buffer_t(buf_sz * sizeof(short));
+    if(NC_TRACE("nc_get_var_short", NULL, buf_sz * sizeof(short), nc_get_var_short(nc_id, var_id, buf.as<short>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_CHAR:
+    buf = buffer_t(buf_sz * sizeof(char));
+    if(NC_TRACE("nc_get_var_text", NULL, buf_sz * sizeof(char), nc_get_var_text(nc_id, var_id, buf.as<char>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_BYTE:
+    buf = buffer_t(buf_sz * sizeof(signed char));
+    if(NC_TRACE("nc_get_var_schar", NULL, buf_sz * sizeof(signed char), nc_get_var_schar(nc_id, var_id, buf.as<signed char>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_UBYTE:
+    buf = buffer_t(buf_sz * sizeof(unsigned char));
+    if(NC_TRACE("nc_get_var_uchar", NULL, buf_sz * sizeof(unsigned char), nc_get_var_uchar(nc_id, var_id, buf.as<unsigned char>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_USHORT:
+    buf = buffer_t(buf_sz * sizeof(unsigned short));
+    if(NC_TRACE("nc_get_var_ushort", NULL, buf_sz * sizeof(unsigned short), nc_get_var_ushort(nc_id, var_id, buf.as<unsigned short>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_UINT:
+    buf = buffer_t(buf_sz * sizeof(unsigned int));
+    if(NC_TRACE("nc_get_var_uint", NULL, buf_sz * sizeof(unsigned int), nc_get_var_uint(nc_id, var_id, buf.as<unsigned int>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_INT64:
+    buf = buffer_t(buf_sz * sizeof(long long));
+    if(NC_TRACE("nc_get_var_longlong", NULL, buf_sz * sizeof(long long), nc_get_var_longlong(nc_id, var_id, buf.as<long long>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_UINT64:
+    buf = buffer_t(buf_sz * sizeof(unsigned long long));
+    if(NC_TRACE("nc_get_var_ulonglong", NULL, buf_sz * sizeof(unsigned long long), nc_get_var_ulonglong(nc_id, var_id, buf.as<unsigned long long>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_STRING:
+    buf = load_variable_string(nc_id, var_id, buf_sz);
+    break;
+  }
+  return buf;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_variable_string
+//NC_STRING variable into a string arena, read in batches of rows of the first dimension
+//so that the strings allocated by netCDF are bounded by one batch, not by the whole variable
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t load_variable_string(const int nc_id, const int var_id, size_t buf_sz)
+{
+  const size_t batch_sz = 65536;
+  int nbr_dmn;
+  int dmn_id[NC_MAX_DIMS];
+  size_t start[NC_MAX_DIMS];
+  size_t count[NC_MAX_DIMS];
+  size_t row_sz = 1;
+  string_arena_t arena(buf_sz);
+
+  if(NC_TRACE("nc_inq_varndims", NULL, 0, nc_inq_varndims(nc_id, var_id, &nbr_dmn)) != NC_NOERR)
+  {
+    return arena.release();
+  }
+
+  //scalar
+  if(nbr_dmn == 0)
+  {
+    char *str[1] = { NULL };
+    if(NC_TRACE("nc_get_var_string", NULL, sizeof(char*), nc_get_var_string(nc_id, var_id, str)) == NC_NOERR)
+    {
+      arena.append(str, 1);
+    }
+    return arena.release();
+  }
+
+  if(NC_TRACE("nc_inq_vardimid", NULL, 0, nc_inq_vardimid(nc_id, var_id, dmn_id)) != NC_NOERR)
+  {
+    return arena.release();
+  }
+  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    if(NC_TRACE("nc_inq_dimlen", NULL, 0, nc_inq_dimlen(nc_id, dmn_id[idx_dmn], &count[idx_dmn])) != NC_NOERR)
+    {
+      return arena.release();
+    }
+    start[idx_dmn] = 0;
+    if(idx_dmn > 0)
+    {
+      row_sz *= count[idx_dmn];
+    }
+  }
+
+  size_t nbr_row = count[0];
+  if(row_sz == 0 || nbr_row == 0)
+  {
+    return arena.release();
+  }
+  size_t row_batch = std::max<size_t>(1, batch_sz / row_sz);
+  std::vector<char*> str(std::min(nbr_row, row_batch) * row_sz);
+
+  for(size_t idx_row = 0; idx_row < nbr_row; idx_row += row_batch)
+  {
+    start[0] = idx_row;
+    count[0] = std::min(row_batch, nbr_row - idx_row);
+    size_t nbr_str = count[0] * row_sz;
+    std::fill(str.begin(), str.begin() + nbr_str, (char*)NULL);
+    if(NC_TRACE("nc_get_vara_string", NULL, nbr_str * sizeof(char*), nc_get_vara_string(nc_id, var_id, start, count, &str[0])) != NC_NOERR)
+    {
+      break;
+    }
+    arena.append(&str[0], nbr_str);
+  }
+  return arena.release();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_variable_slab
+//read a strided hyperslab of a variable; start, count and stride have one element per dimension;
+//empty buffer if the read fails
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t load_variable_slab(const int nc_id, const int var_id, const nc_type var_type,
+  const std::vector<size_t> &start, const std::vector<size_t> &count, const std::vector<ptrdiff_t> &stride)
+{
+  buffer_t buf;
+  size_t buf_sz = 1;
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
+  {
+    buf_sz *= count[idx_dmn];
+  }
+
+  //scalar variable
+  if(count.size() == 0)
+  {
+    return load_variable(nc_id, var_id, var_type, 1);
+  }
+
+  switch(var_type)
+  {
+  case NC_FLOAT:
+    buf = buffer_t(buf_sz * sizeof(float));
+    if(NC_TRACE("nc_get_vars_float", NULL, buf_sz * sizeof(float), nc_get_vars_float(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<float>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_DOUBLE:
+    buf = buffer_t(buf_sz * sizeof(double));
+    if(NC_TRACE("nc_get_vars_double", NULL, buf_sz * sizeof(double), nc_get_vars_double(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<double>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_INT:
+    buf = buffer_t(buf_sz * sizeof(int));
+    if(NC_TRACE("nc_get_vars_int", NULL, buf_sz * sizeof(int), nc_get_vars_int(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<int>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_SHORT:
+    buf = buffer_t(buf_sz * sizeof(short));
+    if(NC_TRACE("nc_get_vars_short", NULL, buf_sz * sizeof(short), nc_get_vars_short(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<short>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_CHAR:
+    buf = buffer_t(buf_sz * sizeof(char));
+    if(NC_TRACE("nc_get_vars_text", NULL, buf_sz * sizeof(char), nc_get_vars_text(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<char>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_BYTE:
+    buf = buffer_t(buf_sz * sizeof(signed char));
+    if(NC_TRACE("nc_get_vars_schar", NULL, buf_sz * sizeof(signed char), nc_get_vars_schar(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<signed char>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_UBYTE:
+    buf = buffer_t(buf_sz * sizeof(unsigned char));
+    if(NC_TRACE("nc_get_vars_uchar", NULL, buf_sz * sizeof(unsigned char), nc_get_vars_uchar(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<unsigned char>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_USHORT:
+    buf = buffer_t(buf_sz * sizeof(unsigned short));
+    if(NC_TRACE("nc_get_vars_ushort", NULL, buf_sz * sizeof(unsigned short), nc_get_vars_ushort(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<unsigned short>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_UINT:
+    buf = buffer_t(buf_sz * sizeof(unsigned int));
+    if(NC_TRACE("nc_get_vars_uint", NULL, buf_sz * sizeof(unsigned int), nc_get_vars_uint(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<unsigned int>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_INT64:
+    buf = buffer_t(buf_sz * sizeof(long long));
+    if(NC_TRACE("nc_get_vars_longlong", NULL, buf_sz * sizeof(long long), nc_get_vars_longlong(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<long long>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_UINT64:
+    buf = buffer_t(buf_sz * sizeof(unsigned long long));
+    if(NC_TRACE("nc_get_vars_ulonglong", NULL, buf_sz * sizeof(unsigned long long), nc_get_vars_ulonglong(nc_id, var_id, &start[0], &count[0], &stride[0], buf.as<unsigned long long>())) != NC_NOERR)
+    {
+      buf.reset();
+    }
+    break;
+  case NC_STRING:
+    {
+      std::vector<char*> str(std::max<size_t>(1, buf_sz), (char*)NULL);
+      //the strings read are freed by the arena, also on error
+      bool done = NC_TRACE("nc_get_vars_string", NULL, buf_sz * sizeof(char*), nc_get_vars_string(nc_id, var_id, &start[0], &count[0], &stride[0], &str[0])) == NC_NOERR;
+      buf = load_string_arena(&str[0], buf_sz);
+      if(!done)
+      {
+        buf.reset();
+      }
+    }
+    break;
+  }
+  return buf;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_attribute
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t load_attribute(const int nc_id, const int var_id, const char *attr_name, const nc_type var_type, size_t buf_sz)
+{
+  buffer_t buf;
+  switch(var_type)
+  {
+  case NC_FLOAT:
+    buf = buffer_t(buf_sz * sizeof(float));
+    if(NC_TRACE("nc_get_att_float", attr_name, buf_sz * sizeof(float), nc_get_att_float(nc_id, var_id, attr_name, buf.as<float>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_DOUBLE:
+    buf = buffer_t(buf_sz * sizeof(double));
+    if(NC_TRACE("nc_get_att_double", attr_name, buf_sz * sizeof(double), nc_get_att_double(nc_id, var_id, attr_name, buf.as<double>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_INT:
+    buf = buffer_t(buf_sz * sizeof(int));
+    if(NC_TRACE("nc_get_att_int", attr_name, buf_sz * sizeof(int), nc_get_att_int(nc_id, var_id, attr_name, buf.as<int>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_SHORT:
+    buf = buffer_t(buf_sz * sizeof(short));
+    if(NC_TRACE("nc_get_att_short", attr_name, buf_sz * sizeof(short), nc_get_att_short(nc_id, var_id, attr_name, buf.as<short>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_CHAR:
+    buf = buffer_t(buf_sz * sizeof(char));
+    if(NC_TRACE("nc_get_att_text", attr_name, buf_sz * sizeof(char), nc_get_att_text(nc_id, var_id, attr_name, buf.as<char>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_BYTE:
+    buf = buffer_t(buf_sz * sizeof(signed char));
+    if(NC_TRACE("nc_get_att_schar", attr_name, buf_sz * sizeof(signed char), nc_get_att_schar(nc_id, var_id, attr_name, buf.as<signed char>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_UBYTE:
+    buf = buffer_t(buf_sz * sizeof(unsigned char));
+    if(NC_TRACE("nc_get_att_uchar", attr_name, buf_sz * sizeof(unsigned char), nc_get_att_uchar(nc_id, var_id, attr_name, buf.as<unsigned char>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_USHORT:
+    buf = buffer_t(buf_sz * sizeof(unsigned short));
+    if(NC_TRACE("nc_get_att_ushort", attr_name, buf_sz * sizeof(unsigned short), nc_get_att_ushort(nc_id, var_id, attr_name, buf.as<unsigned short>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_UINT:
+    buf = buffer_t(buf_sz * sizeof(unsigned int));
+    if(NC_TRACE("nc_get_att_uint", attr_name, buf_sz * sizeof(unsigned int), nc_get_att_uint(nc_id, var_id, attr_name, buf.as<unsigned int>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_INT64:
+    buf = buffer_t(buf_sz * sizeof(long long));
+    if(NC_TRACE("nc_get_att_longlong", attr_name, buf_sz * sizeof(long long), nc_get_att_longlong(nc_id, var_id, attr_name, buf.as<long long>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_UINT64:
+    buf = buffer_t(buf_sz * sizeof(unsigned long long));
+    if(NC_TRACE("nc_get_att_ulonglong", attr_name, buf_sz * sizeof(unsigned long long), nc_get_att_ulonglong(nc_id, var_id, attr_name, buf.as<unsigned long long>())) != NC_NOERR)
+    {
+    }
+    break;
+  case NC_STRING:
+    {
+      std::vector<char*> str(std::max<size_t>(1, buf_sz), (char*)NULL);
+      if(NC_TRACE("nc_get_att_string", attr_name, buf_sz * sizeof(char*), nc_get_att_string(nc_id, var_id, attr_name, &str[0])) != NC_NOERR)
+      {
+      }
+      buf = load_string_arena(&str[0], buf_sz);
+    }
+    break;
+  }
+  return buf;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_att_text
+//a text attribute without its trailing NULs; empty if missing or not text
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string load_att_text(const int nc_id, const int var_id, const char *attr_name)
+{
+  nc_type attr_typ;
+  size_t attr_sz;
+  if(NC_TRACE("nc_inq_att", attr_name, 0, nc_inq_att(nc_id, var_id, attr_name, &attr_typ, &attr_sz)) != NC_NOERR || attr_typ != NC_CHAR || attr_sz == 0)
+  {
+    return std::string();
+  }
+  std::string str(attr_sz, '\0');
+  if(NC_TRACE("nc_get_att_text", attr_name, attr_sz, nc_get_att_text(nc_id, var_id, attr_name, &str[0])) != NC_NOERR)
+  {
+    return std::string();
+  }
+  while(!str.empty() && str[str.size() - 1] == '\0')
+  {
+    str.erase(str.size() - 1);
+  }
+  return str;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_format
+//Provide sprintf() format string for specified netCDF type
+//Based on NCO utilities
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* get_format(const nc_type typ)
+{
+  switch(typ)
+  {
+  case NC_FLOAT:
+    return "%g";
+  case NC_DOUBLE:
+    return "%.12g";
+  case NC_INT:
+    return "%i";
+  case NC_SHORT:
+    return "%hi";
+  case NC_CHAR:
+    return "%c";
+  case NC_BYTE:
+    return "%hhi";
+  case NC_UBYTE:
+    return "%hhu";
+  case NC_USHORT:
+    return "%hu";
+  case NC_UINT:
+    return "%u";
+  case NC_INT64:
+    return "%lli";
+  case NC_UINT64:
+    return "%llu";
+  case NC_STRING:
+    return "%s";
+  }
+  return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_type_size
+//size in memory of one element of a netCDF type; NC_STRING elements are pointers
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t get_type_size(const nc_type typ)
+{
+  switch(typ)
+  {
+  case NC_BYTE:
+  case NC_UBYTE:
+  case NC_CHAR:
+    return 1;
+  case NC_SHORT:
+  case NC_USHORT:
+    return 2;
+  case NC_INT:
+  case NC_UINT:
+  case NC_FLOAT:
+    return 4;
+  case NC_DOUBLE:
+  case NC_INT64:
+  case NC_UINT64:
+    return 8;
+  case NC_STRING:
+    return sizeof(char*);
+  }
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//format_value
+//format element idx of a typed buffer into a character buffer, with the get_format() format string
+//returns the number of characters written, like snprintf
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int format_value(char *str, size_t str_sz, const nc_type typ, const void *buf, size_t idx)
+{
+  switch(typ)
+  {
+  case NC_CHAR:
+    return snprintf(str, str_sz, get_format(NC_CHAR), static_cast<const char*> (buf)[idx]);
+  case NC_FLOAT:
+    return snprintf(str, str_sz, get_format(NC_FLOAT), static_cast<const float*> (buf)[idx]);
+  case NC_DOUBLE:
+    return snprintf(str, str_sz, get_format(NC_DOUBLE), static_cast<const double*> (buf)[idx]);
+  case NC_INT:
+    return snprintf(str, str_sz, get_format(NC_INT), static_cast<const int*> (buf)[idx]);
+  case NC_SHORT:
+    return snprintf(str, str_sz, get_format(NC_SHORT), static_cast<const short*> (buf)[idx]);
+  case NC_BYTE:
+    return snprintf(str, str_sz, get_format(NC_BYTE), static_cast<const signed char*> (buf)[idx]);
+  case NC_UBYTE:
+    return snprintf(str, str_sz, get_format(NC_UBYTE), static_cast<const unsigned char*> (buf)[idx]);
+  case NC_USHORT:
+    return snprintf(str, str_sz, get_format(NC_USHORT), static_cast<const unsigned short*> (buf)[idx]);
+  case NC_UINT:
+    return snprintf(str, str_sz, get_format(NC_UINT), static_cast<const unsigned int*> (buf)[idx]);
+  case NC_INT64:
+    return snprintf(str, str_sz, get_format(NC_INT64), static_cast<const long long*> (buf)[idx]);
+  case NC_UINT64:
+    return snprintf(str, str_sz, get_format(NC_UINT64), static_cast<const unsigned long long*> (buf)[idx]);
+  case NC_STRING:
+    return snprintf(str, str_sz, get_format(NC_STRING), string_at(buf, idx).m_ptr);
+  }
+  if(str_sz)
+  {
+    str[0] = '\0';
+  }
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_double
+//element idx of a numeric typed buffer as a double
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double get_double(const nc_type typ, const void *buf, size_t idx)
+{
+  switch(typ)
+  {
+  case NC_FLOAT: return static_cast<const float*> (buf)[idx];
+  case NC_DOUBLE: return static_cast<const double*> (buf)[idx];
+  case NC_INT: return static_cast<const int*> (buf)[idx];
+  case NC_SHORT: return static_cast<const short*> (buf)[idx];
+  case NC_BYTE: return static_cast<const signed char*> (buf)[idx];
+  case NC_UBYTE: return static_cast<const unsigned char*> (buf)[idx];
+  case NC_USHORT: return static_cast<const unsigned short*> (buf)[idx];
+  case NC_UINT: return static_cast<const unsigned int*> (buf)[idx];
+  case NC_INT64: return (double)static_cast<const long long*> (buf)[idx];
+  case NC_UINT64: return (double)static_cast<const unsigned long long*> (buf)[idx];
+  }
+  return NAN;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//make_slab_source
+//slab source of a variable: in its file, in its file series, on its server, or its expression
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<slab_source_t> make_slab_source(const ItemData *item_data)
+{
+  const ncdata_t *ncdata = item_data->m_ncdata;
+  if(item_data->m_source)
+  {
+    return item_data->m_source;
+  }
+  if(item_data->m_series)
+  {
+    return std::shared_ptr<slab_source_t>(new series_slab_source_t(item_data->m_series, item_data->m_grp_nm_fll,
+      item_data->m_item_nm, ncdata->m_nc_type, ncdata->m_dim));
+  }
+  if(is_remote(item_data->m_file_name))
+  {
+    return std::shared_ptr<slab_source_t>(new remote_slab_source_t(item_data->m_file_name, item_data->m_grp_nm_fll,
+      item_data->m_item_nm, ncdata->m_nc_type, ncdata->m_dim));
+  }
+  return std::shared_ptr<slab_source_t>(new nc_slab_source_t(item_data->m_file_name, item_data->m_grp_nm_fll,
+    item_data->m_item_nm, ncdata->m_nc_type, ncdata->m_dim));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::TableModel
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TableModel::TableModel(QObject *parent, ItemData *item_data, const std::shared_ptr<slab_source_t> &source) :
+QAbstractTableModel(parent),
+m_widget(NULL),
+m_item_data(item_data),
+m_ncdata(item_data->m_ncdata),
+m_ncvar_crd(item_data->m_ncvar_crd),
+m_row_first(0),
+m_pager(NULL),
+m_key_col(-1),
+m_order(sort_none),
+m_remap(false),
+m_sort_thread(NULL),
+m_sort_pending(false),
+m_tiled(false),
+m_layer_whole(true),
+m_tile_rows(1)
+{
+  /////////////////////////////////////////////////////////////////////////////////////////////////////
+  //define grid
+  /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+  if(m_ncdata->m_dim.size() == 0)
+  {
+    m_dim_rows = -1;
+    m_dim_cols = -1;
+    m_nbr_rows = 1;
+    m_nbr_cols = 1;
+  }
+  else if(m_ncdata->m_dim.size() == 1)
+  {
+    m_dim_rows = 0;
+    m_dim_cols = -1;
+    //for NC_CHAR define rank 0, so that all text is displayed in one grid cell
+    if(NC_CHAR == m_ncdata->m_nc_type)
+    {
+      m_nbr_rows = 1;
+    }
+    else
+    {
+      m_nbr_rows = m_ncdata->m_dim[m_dim_rows];
+    }
+    m_nbr_cols = 1;
+  }
+  else
+  {
+    m_dim_cols = m_ncdata->m_dim.size() - 1; //2 for 3D
+    m_dim_rows = m_ncdata->m_dim.size() - 2; //1 for 3D
+    m_nbr_rows = m_ncdata->m_dim[m_dim_rows];
+    m_nbr_cols = (int)m_ncdata->m_dim[m_dim_cols];
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////////
+  //tiles of about 1 MB; layers of more than 256 MB are read only where on screen
+  /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+  if(m_item_data->m_kind == ItemData::Variable && m_ncdata->m_buf.empty() && use_tiles(m_ncdata))
+  {
+    size_t row_sz = std::max<size_t>(1, m_nbr_cols * get_type_size(m_ncdata->m_nc_type));
+    m_tiled = true;
+    m_tile_rows = (int)std::min<size_t>(std::max<size_t>(1, (1 << 20) / row_sz), std::max<size_t>(1, m_nbr_rows));
+    m_layer_whole = (m_nbr_rows * row_sz <= ((size_t)256 << 20));
+    m_source = source ? source : make_slab_source(item_data);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::~TableModel
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TableModel::~TableModel()
+{
+  if(m_tiled)
+  {
+    IoScheduler::instance()->cancel_owner(this);
+  }
+  if(m_sort_thread != NULL)
+  {
+    m_sort_thread->wait();
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::use_tiles
+//variables of two or more dimensions, and of one dimension longer than a window; NC_CHAR is displayed
+//as text from the whole buffer
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TableModel::use_tiles(const ncdata_t *ncdata)
+{
+  if(ncdata->m_nc_type == NC_CHAR)
+  {
+    return false;
+  }
+  return ncdata->m_dim.size() >= 2 || (ncdata->m_dim.size() == 1 && ncdata->m_dim[0] > table_page_rows);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::layer_index
+//layer number in the dimensions above the two displayed
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t TableModel::layer_index(const std::vector<int> &layer) const
+{
+  size_t idx_lyr = 0;
+  for(size_t idx_dmn = 0; idx_dmn < layer.size(); idx_dmn++)
+  {
+    idx_lyr = idx_lyr * m_ncdata->m_dim[idx_dmn] + layer[idx_dmn];
+  }
+  return idx_lyr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::layer_tiles
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<tile_t>& TableModel::layer_tiles(size_t idx_lyr) const
+{
+  std::vector<tile_t> &tiles = m_tiles[idx_lyr];
+  if(tiles.empty())
+  {
+    tiles.resize((m_nbr_rows + m_tile_rows - 1) / m_tile_rows);
+  }
+  return tiles;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::show_context_menu
-///////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::tile_box
+//box of a tile; the layer dimensions are those before the rows
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void FileTreeWidget::show_context_menu(const QPoint &p)
+void TableModel::tile_box(size_t idx_lyr, size_t idx_tile, std::vector<size_t> *start, std::vector<size_t> *count) const
 {
-  QTreeWidgetItem *item = static_cast <QTreeWidgetItem*> (itemAt(p));
-  ItemData *item_data = get_item_data(item);
-  if(item_data->m_kind != ItemData::Variable && item_data->m_kind != ItemData::Attribute)
+  start->assign(m_ncdata->m_dim.size(), 0);
+  count->assign(m_ncdata->m_dim.size(), 1);
+  for(int idx_dmn = m_dim_rows - 1; idx_dmn >= 0; idx_dmn--)
   {
-    return;
+    (*start)[idx_dmn] = idx_lyr % m_ncdata->m_dim[idx_dmn];
+    idx_lyr /= m_ncdata->m_dim[idx_dmn];
   }
-  QMenu menu;
-  QAction *action_grid = new QAction("Grid...", this);;
-  connect(action_grid, SIGNAL(triggered()), this, SLOT(add_grid()));
-  if(!enable_data(item_data))
+  (*start)[m_dim_rows] = idx_tile * m_tile_rows;
+  (*count)[m_dim_rows] = std::min<size_t>(m_tile_rows, m_nbr_rows - (*start)[m_dim_rows]);
+  if(m_dim_cols != -1)
   {
-    action_grid->setEnabled(false);
+    (*count)[m_dim_cols] = m_nbr_cols;
   }
-  menu.addAction(action_grid);
-  menu.exec(QCursor::pos());
 }
 
-///////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::add_grid
-///////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::request_tile
+//queue the read of a tile, or raise the priority of its queued read; requests are counted as hits of
+//the first cache tier when the tile is read; the I/O thread serves the tile from the second tier if
+//it holds it; a tile whose read failed is not requested again
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void FileTreeWidget::add_grid()
+void TableModel::request_tile(const std::vector<int> &layer, size_t idx_tile, int priority) const
 {
-  QTreeWidgetItem *item = static_cast <QTreeWidgetItem*> (currentItem());
-  ItemData *item_data = get_item_data(item);
-  assert(item_data->m_kind == ItemData::Variable || item_data->m_kind == ItemData::Attribute);
-  if(!enable_data(item_data))
+  size_t idx_lyr = layer_index(layer);
+  tile_t &tile = layer_tiles(idx_lyr)[idx_tile];
+  if(!tile.m_buf.empty())
   {
+    cache_count_tile(true);
     return;
   }
-  if(item_data->m_kind == ItemData::Variable)
+  if(tile.m_failed)
   {
-    this->load_item(item);
-    m_main_window->add_table(item_data);
+    return;
   }
-  else if(item_data->m_kind == ItemData::Attribute)
+  if(tile.m_id != 0)
   {
-    this->load_item_attribute(item);
-    m_main_window->add_table(item_data);
+    if(priority < tile.m_priority)
+    {
+      IoScheduler::instance()->set_priority(tile.m_id, priority);
+      tile.m_priority = priority;
+    }
+    return;
   }
+  cache_count_tile(false);
 
+  std::vector<size_t> start;
+  std::vector<size_t> count;
+  tile_box(idx_lyr, idx_tile, &start, &count);
+
+  TableModel *model = const_cast<TableModel*> (this);
+  tile.m_priority = priority;
+  tile.m_id = IoScheduler::instance()->read_slab(m_source, start, count, priority, model,
+    [model, idx_lyr, idx_tile](io_request_t *req) { model->tile_done(idx_lyr, idx_tile, req); });
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::load_item
+//TableModel::tile_done
+//GUI thread; stores the tile, or marks it failed, and repaints its rows if on the current layer
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void FileTreeWidget::load_item(QTreeWidgetItem  *item)
+void TableModel::tile_done(size_t idx_lyr, size_t idx_tile, io_request_t *req)
 {
-  char var_nm[NC_MAX_NAME + 1]; // variable name 
-  char dmn_nm_var[NC_MAX_NAME + 1]; //dimension name
-  int nc_id;
-  int grp_id;
-  int var_id;
-  nc_type var_type;
-  int nbr_dmn;
-  int var_dimid[NC_MAX_VAR_DIMS];
-  size_t dmn_sz[NC_MAX_VAR_DIMS];
-  size_t buf_sz; // variable size
-  int fl_fmt;
-
-  ItemData *item_data = get_item_data(item);
-  assert(item_data->m_kind == ItemData::Variable);
-
-  //if not loaded, read buffer from file 
-  if(item_data->m_ncdata->m_buf != NULL)
+  std::map<size_t, std::vector<tile_t> >::iterator it = m_tiles.find(idx_lyr);
+  if(it == m_tiles.end() || it->second[idx_tile].m_id != req->m_id)
   {
     return;
   }
-
-  if(nc_open(item_data->m_file_name.c_str(), NC_NOWRITE, &nc_id) != NC_NOERR)
+  tile_t &tile = it->second[idx_tile];
+  tile.m_id = 0;
+  tile.m_buf = std::move(req->m_buf);
+  tile.m_failed = tile.m_buf.empty();
+  if(m_widget != NULL && idx_lyr == layer_index(m_widget->m_layer))
   {
-
+    //rows shown through a permutation are anywhere in the view; else the rows of the tile in the window
+    size_t row_first = std::max<size_t>(idx_tile * m_tile_rows, m_row_first);
+    size_t row_end = std::min<size_t>(std::min<size_t>((idx_tile + 1) * m_tile_rows, m_nbr_rows), m_row_first + rowCount());
+    if(m_remap)
+    {
+      row_first = m_row_first;
+      row_end = m_row_first + rowCount();
+    }
+    if(row_end > row_first)
+    {
+      emit dataChanged(index((int)(row_first - m_row_first), 0), index((int)(row_end - m_row_first) - 1, m_nbr_cols - 1));
+    }
   }
+}
 
-  //need a file format inquiry, since nc_inq_grp_full_ncid does not handle netCDF3 cases
-  if(nc_inq_format(nc_id, &fl_fmt) != NC_NOERR)
-  {
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::load_layer
+//the cells on screen are requested by data() at io_visible; here the rest of the current layer at io_layer,
+//the layers one step away in each dimension at io_prefetch; other layers are dropped and their reads cancelled,
+//and their tiles read are handed to the compressed cache tier
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TableModel::load_layer()
+{
+  if(!m_tiled || m_widget == NULL)
+  {
+    return;
   }
+  IoScheduler *io = IoScheduler::instance();
+  const std::vector<int> &layer = m_widget->m_layer;
 
-  if(fl_fmt == NC_FORMAT_NETCDF4 || fl_fmt == NC_FORMAT_NETCDF4_CLASSIC)
+  std::vector<std::vector<int> > layer_near;
+  for(size_t idx_dmn = 0; idx_dmn < layer.size(); idx_dmn++)
   {
-    // obtain group ID for netCDF4 files
-    if(nc_inq_grp_full_ncid(nc_id, item_data->m_grp_nm_fll.c_str(), &grp_id) != NC_NOERR)
+    std::vector<int> lyr = layer;
+    if(layer[idx_dmn] > 0)
     {
+      lyr[idx_dmn] = layer[idx_dmn] - 1;
+      layer_near.push_back(lyr);
+    }
+    if((size_t)layer[idx_dmn] + 1 < m_ncdata->m_dim[idx_dmn])
+    {
+      lyr[idx_dmn] = layer[idx_dmn] + 1;
+      layer_near.push_back(lyr);
+    }
+  }
 
+  std::set<size_t> keep;
+  keep.insert(layer_index(layer));
+  if(m_layer_whole)
+  {
+    for(size_t idx = 0; idx < layer_near.size(); idx++)
+    {
+      keep.insert(layer_index(layer_near[idx]));
     }
   }
-  else
+  std::string key = m_source->key();
+  for(std::map<size_t, std::vector<tile_t> >::iterator it = m_tiles.begin(); it != m_tiles.end();)
   {
-    //make the group ID the file ID for netCDF3 cases
-    grp_id = nc_id;
+    if(keep.count(it->first))
+    {
+      ++it;
+      continue;
+    }
+    for(size_t idx_tile = 0; idx_tile < it->second.size(); idx_tile++)
+    {
+      tile_t &tile = it->second[idx_tile];
+      if(tile.m_id != 0)
+      {
+        io->cancel(tile.m_id);
+      }
+      else if(!tile.m_buf.empty())
+      {
+        std::vector<size_t> start;
+        std::vector<size_t> count;
+        tile_box(it->first, idx_tile, &start, &count);
+        cache_put(cache_key(key, start, count), m_source->type(), std::move(tile.m_buf));
+      }
+    }
+    m_tiles.erase(it++);
   }
 
-  //all hunky dory from here 
-
-  // get variable ID
-  if(nc_inq_varid(grp_id, item_data->m_item_nm.c_str(), &var_id) != NC_NOERR)
+  if(!m_layer_whole)
   {
-
+    return;
   }
-
-  if(nc_inq_var(grp_id, var_id, var_nm, &var_type, &nbr_dmn, var_dimid, (int *)NULL) != NC_NOERR)
+  size_t nbr_tiles = layer_tiles(layer_index(layer)).size();
+  for(size_t idx_tile = 0; idx_tile < nbr_tiles; idx_tile++)
   {
-
+    request_tile(layer, idx_tile, io_layer);
   }
-
-  //get dimensions 
-  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  for(size_t idx = 0; idx < layer_near.size(); idx++)
   {
-    int has_crd_var = 0;
-
-    //dimensions belong to groups
-    if(nc_inq_dim(grp_id, var_dimid[idx_dmn], dmn_nm_var, &dmn_sz[idx_dmn]) != NC_NOERR)
+    for(size_t idx_tile = 0; idx_tile < nbr_tiles; idx_tile++)
     {
-
+      request_tile(layer_near[idx], idx_tile, io_prefetch);
     }
+  }
+}
 
-    /////////////////////////////////////////////////////////////////////////////////////////////////////
-    //look up possible coordinate variables
-    //traverse all variables in group and match a variable name 
-    /////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::reload_failed
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    for(size_t idx_var = 0; idx_var < item_data->m_item_data_prn->m_var_nms.size(); idx_var++)
+void TableModel::reload_failed()
+{
+  bool reload = false;
+  for(std::map<size_t, std::vector<tile_t> >::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it)
+  {
+    for(size_t idx_tile = 0; idx_tile < it->second.size(); idx_tile++)
     {
-      std::string var_nm(item_data->m_item_data_prn->m_var_nms[idx_var]);
-
-      if(var_nm == std::string(dmn_nm_var))
+      if(it->second[idx_tile].m_failed)
       {
-        has_crd_var = 1;
-        break;
+        it->second[idx_tile] = tile_t();
+        reload = true;
       }
     }
+  }
+  if(!reload)
+  {
+    return;
+  }
+  load_layer();
+  if(rowCount() > 0 && columnCount() > 0)
+  {
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+  }
+}
 
-    /////////////////////////////////////////////////////////////////////////////////////////////////////
-    //a coordinate variable was found
-    //since the lookup was only in the same group, get the variable information on this group 
-    /////////////////////////////////////////////////////////////////////////////////////////////////////
-
-    if(has_crd_var)
-    {
-      int crd_var_id;
-      char crd_var_nm[NC_MAX_NAME + 1];
-      int crd_nbr_dmn;
-      int crd_var_dimid[NC_MAX_VAR_DIMS];
-      size_t crd_dmn_sz[NC_MAX_VAR_DIMS];
-      nc_type crd_var_type = NC_NAT;
-
-      // get coordinate variable ID (using the dimension name, since there was a match to a variable)
-      if(nc_inq_varid(grp_id, dmn_nm_var, &crd_var_id) != NC_NOERR)
-      {
-
-      }
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::wait_sort
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      if(nc_inq_var(grp_id, crd_var_id, crd_var_nm, &crd_var_type, &crd_nbr_dmn, crd_var_dimid, (int *)NULL) != NC_NOERR)
-      {
+void TableModel::wait_sort()
+{
+  if(m_sort_thread != NULL)
+  {
+    m_sort_thread->wait();
+  }
+}
 
-      }
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::grow
+//m_ncdata grew from dim_old; new rows are inserted and the tiles read are kept: the layer index does not
+//depend on the first dimension, and only the last tile of a layer may have fewer rows than now; if the
+//columns or another layer dimension grew, the tiles are read again
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      assert(std::string(crd_var_nm) == std::string(dmn_nm_var));
+void TableModel::grow(const std::vector<size_t> &dim_old)
+{
+  const std::vector<size_t> &dim = m_ncdata->m_dim;
+  if(dim.empty() || dim.size() != dim_old.size())
+  {
+    return;
+  }
+  size_t nbr_rows = m_nbr_rows;
+  int nbr_cols = m_nbr_cols;
+  if(m_dim_cols == -1)
+  {
+    nbr_rows = NC_CHAR == m_ncdata->m_nc_type ? 1 : dim[m_dim_rows];
+  }
+  else
+  {
+    nbr_rows = dim[m_dim_rows];
+    nbr_cols = (int)dim[m_dim_cols];
+  }
+  bool layer_moved = false;
+  for(size_t idx_dmn = 1; m_dim_cols != -1 && idx_dmn < (size_t)m_dim_rows; idx_dmn++)
+  {
+    layer_moved = layer_moved || dim[idx_dmn] != dim_old[idx_dmn];
+  }
+  bool reset = nbr_cols != m_nbr_cols || layer_moved;
 
-      if(crd_nbr_dmn == 1)
+  if(m_tiled)
+  {
+    IoScheduler *io = IoScheduler::instance();
+    size_t row_sz = std::max<size_t>(1, nbr_cols * get_type_size(m_ncdata->m_nc_type));
+    m_source = make_slab_source(m_item_data);
+    m_layer_whole = (nbr_rows * row_sz <= ((size_t)256 << 20));
+    size_t nbr_tiles = (nbr_rows + m_tile_rows - 1) / m_tile_rows;
+    for(std::map<size_t, std::vector<tile_t> >::iterator it = m_tiles.begin(); it != m_tiles.end();)
+    {
+      std::vector<tile_t> &tiles = it->second;
+      for(size_t idx_tile = 0; idx_tile < tiles.size(); idx_tile++)
       {
-        //get size
-        if(nc_inq_dim(grp_id, crd_var_dimid[0], (char *)NULL, &crd_dmn_sz[0]) != NC_NOERR)
+        bool partial = idx_tile + 1 == tiles.size() && nbr_rows != m_nbr_rows && m_nbr_rows % m_tile_rows != 0;
+        if(!reset && !partial)
         {
-
+          continue;
         }
-
-        //store dimension 
-        std::vector<size_t> dim; //dimensions for each variable 
-        dim.push_back(crd_dmn_sz[0]);
-
-        //store a ncdata_t
-        ncdata_t *ncvar = new ncdata_t(crd_var_nm, crd_var_type, dim);
-
-        //allocate, load 
-        ncvar->store(load_variable(grp_id, crd_var_id, crd_var_type, crd_dmn_sz[0]));
-
-        //and store in tree 
-        item_data->m_ncvar_crd.push_back(ncvar);
+        if(tiles[idx_tile].m_id != 0)
+        {
+          io->cancel(tiles[idx_tile].m_id);
+        }
+        tiles[idx_tile] = tile_t();
       }
-    }
-    else
-    {
-      item_data->m_ncvar_crd.push_back(NULL); //no coordinate variable for this dimension
+      if(reset)
+      {
+        m_tiles.erase(it++);
+        continue;
+      }
+      tiles.resize(nbr_tiles);
+      ++it;
     }
   }
 
-  //define buffer size
-  buf_sz = 1;
-  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  //rows shown through a permutation change when it is computed again; rows past a full window are
+  //reached through the pager
+  int nbr_win = (int)std::min(nbr_rows, table_page_rows);
+  if(reset)
   {
-    buf_sz *= dmn_sz[idx_dmn];
+    beginResetModel();
+    m_nbr_rows = nbr_rows;
+    m_nbr_cols = nbr_cols;
+    m_row_first = 0;
+    endResetModel();
   }
-
-  //allocate buffer and store in item data 
-  item_data->m_ncdata->store(load_variable(grp_id, var_id, var_type, buf_sz));
-
-  if(nc_close(nc_id) != NC_NOERR)
+  else if(nbr_win > rowCount() && !m_remap)
   {
-
+    beginInsertRows(QModelIndex(), rowCount(), nbr_win - 1);
+    m_nbr_rows = nbr_rows;
+    endInsertRows();
+  }
+  else
+  {
+    m_nbr_rows = nbr_rows;
+  }
+  if(m_pager != NULL)
+  {
+    m_pager->update_range();
   }
+  data_changed();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::load_item_attribute
-//A netCDF attribute has a netCDF variable to which it is assigned, a name, a type, a length, and a sequence of one or more values.
+//TableModel::view_rows
+//tiles requested for the screen that scrolled away are lowered to io_layer, or cancelled
+//if the layer is not read whole; then tiles far from the screen are dropped
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void FileTreeWidget::load_item_attribute(QTreeWidgetItem  *item)
+void TableModel::view_rows(int row_first, int row_last)
 {
-  int nc_id = -1;
-  int grp_id = -1;
-  int parent_id = -1;
-  size_t attr_sz; // attribute size
-  int fl_fmt;
-
-  //get item data of parent item, to detect if parent is group or variable
-  ItemData *item_data_prn = get_item_data(item->parent());
-  assert(item_data_prn->m_kind == ItemData::Group
-    || item_data_prn->m_kind == ItemData::Root
-    || item_data_prn->m_kind == ItemData::Variable);
-
-  ItemData *item_data = get_item_data(item);
-  assert(item_data->m_kind == ItemData::Attribute);
-
-  //attribute name is tree item name
-  const char *attr_nm = item_data->m_item_nm.c_str();
-  //attribute type is stored in ncvar_t variable
-  nc_type attr_typ = item_data->m_ncdata->m_nc_type;
-
-  //if not loaded, read buffer from file 
-  if(item_data->m_ncdata->m_buf != NULL)
+  //rows shown through a permutation are not the rows of the tiles; tiles are kept
+  if(!m_tiled || m_widget == NULL || m_remap)
   {
     return;
   }
-
-  if(nc_open(item_data->m_file_name.c_str(), NC_NOWRITE, &nc_id) != NC_NOERR)
+  IoScheduler *io = IoScheduler::instance();
+  std::vector<tile_t> &tiles = layer_tiles(layer_index(m_widget->m_layer));
+  size_t tile_first = (m_row_first + std::max(0, row_first)) / m_tile_rows;
+  size_t tile_last = (m_row_first + std::max(0, row_last)) / m_tile_rows;
+  for(size_t idx_tile = 0; idx_tile < tiles.size(); idx_tile++)
   {
-
+    tile_t &tile = tiles[idx_tile];
+    if(idx_tile >= tile_first && idx_tile <= tile_last)
+    {
+      continue;
+    }
+    if(tile.m_id != 0 && tile.m_priority == io_visible)
+    {
+      if(m_layer_whole)
+      {
+        io->set_priority(tile.m_id, io_layer);
+        tile.m_priority = io_layer;
+      }
+      else
+      {
+        io->cancel(tile.m_id);
+        tile.m_id = 0;
+      }
+    }
+    //keep 8 screens around the rows on screen
+    size_t margin = 8 * (tile_last - tile_first + 1);
+    if(!m_layer_whole && (idx_tile + margin < tile_first || idx_tile > tile_last + margin))
+    {
+      tile.m_buf.reset();
+    }
   }
+}
 
-  //need a file format inquiry, since nc_inq_grp_full_ncid does not handle netCDF3 cases
-  if(nc_inq_format(nc_id, &fl_fmt) != NC_NOERR)
-  {
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::rowCount
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  }
+int TableModel::rowCount(const QModelIndex &) const
+{
+  return (int)std::min(rows_shown(), table_page_rows);
+}
 
-  if(fl_fmt == NC_FORMAT_NETCDF4 || fl_fmt == NC_FORMAT_NETCDF4_CLASSIC)
-  {
-    // obtain group ID for netCDF4 files
-    if(nc_inq_grp_full_ncid(nc_id, item_data->m_grp_nm_fll.c_str(), &grp_id) != NC_NOERR)
-    {
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::move_window
+//the number of rows in the view does not change: the window ends at the last row shown at most
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    }
-  }
-  else
+void TableModel::move_window(size_t row_first)
+{
+  int nbr_win = rowCount();
+  row_first = std::min(row_first, rows_shown() - nbr_win);
+  if(row_first == m_row_first)
   {
-    //make the group ID the file ID for netCDF3 cases
-    grp_id = nc_id;
+    return;
   }
-
-  if(item_data_prn->m_kind == ItemData::Variable)
+  m_row_first = row_first;
+  emit dataChanged(index(0, 0), index(nbr_win - 1, m_nbr_cols - 1));
+  emit headerDataChanged(Qt::Vertical, 0, nbr_win - 1);
+  if(m_pager != NULL)
   {
-    //variable name is the parent item data item name
-    const char *var_nm = item_data->m_item_data_prn->m_item_nm.c_str();
+    m_pager->update_range();
+  }
+}
 
-    // get variable ID
-    if(nc_inq_varid(grp_id, var_nm, &parent_id) != NC_NOERR)
-    {
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::columnCount
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    }
-  }
-  else if(item_data_prn->m_kind == ItemData::Group || item_data_prn->m_kind == ItemData::Root)
-  {
-    parent_id = NC_GLOBAL;
-  }
+int TableModel::columnCount(const QModelIndex &) const
+{
+  return m_nbr_cols;
+}
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::data_changed
+//update table view when change of layer
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  if(nc_inq_attlen(grp_id, parent_id, attr_nm, &attr_sz))
+void TableModel::data_changed()
+{
+  load_layer();
+  if(m_key_col >= 0)
   {
-
+    start_sort();
   }
+  QModelIndex top = index(0, 0, QModelIndex());
+  QModelIndex bottom = index(rowCount() - 1, m_nbr_cols - 1, QModelIndex());
+  dataChanged(top, bottom);
+}
 
-  //allocate buffer and store in item data 
-  item_data->m_ncdata->store(load_attribute(grp_id, parent_id, attr_nm, attr_typ, attr_sz));
 
-  if(nc_close(nc_id) != NC_NOERR)
-  {
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::can_sort
+//numeric variables and attributes with rows; the permutation holds int rows
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  }
+bool TableModel::can_sort() const
+{
+  return m_dim_rows != -1 && m_nbr_rows > 1 && m_nbr_rows <= (size_t)INT_MAX && diff_type(m_ncdata->m_nc_type);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::load_variable
+//TableModel::sort
+//a click on a column header; column -1 keeps the filter only
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void* FileTreeWidget::load_variable(const int nc_id, const int var_id, const nc_type var_type, size_t buf_sz)
+void TableModel::sort(int column, Qt::SortOrder order)
 {
-  void *buf = NULL;
-  switch(var_type)
+  if(!can_sort())
   {
-  case NC_FLOAT:
-    buf = malloc(buf_sz * sizeof(float));
-    if(nc_get_var_float(nc_id, var_id, static_cast<float *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_DOUBLE:
-    buf = malloc(buf_sz * sizeof(double));
-    if(nc_get_var_double(nc_id, var_id, static_cast<double *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_INT:
-    buf = malloc(buf_sz * sizeof(int));
-    if(nc_get_var_int(nc_id, var_id, static_cast<int *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_SHORT:
-    buf = malloc(buf_sz * sizeof(short));
-    if(nc_get_var_short(nc_id, var_id, static_cast<short *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_CHAR:
-    buf = malloc(buf_sz * sizeof(char));
-    if(nc_get_var_text(nc_id, var_id, static_cast<char *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_BYTE:
-    buf = malloc(buf_sz * sizeof(signed char));
-    if(nc_get_var_schar(nc_id, var_id, static_cast<signed char *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_UBYTE:
-    buf = malloc(buf_sz * sizeof(unsigned char));
-    if(nc_get_var_uchar(nc_id, var_id, static_cast<unsigned char *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_USHORT:
-    buf = malloc(buf_sz * sizeof(unsigned short));
-    if(nc_get_var_ushort(nc_id, var_id, static_cast<unsigned short *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_UINT:
-    buf = malloc(buf_sz * sizeof(unsigned int));
-    if(nc_get_var_uint(nc_id, var_id, static_cast<unsigned int *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_INT64:
-    buf = malloc(buf_sz * sizeof(long long));
-    if(nc_get_var_longlong(nc_id, var_id, static_cast<long long *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_UINT64:
-    buf = malloc(buf_sz * sizeof(unsigned long long));
-    if(nc_get_var_ulonglong(nc_id, var_id, static_cast<unsigned long long *>(buf)) != NC_NOERR)
+    return;
+  }
+  if(column < 0 || column >= m_nbr_cols)
+  {
+    m_order = sort_none;
+    if(!m_filter.m_active)
     {
+      reset_order();
+      return;
     }
-    break;
-  case NC_STRING:
-    buf = malloc(buf_sz * sizeof(char*));
-    if(nc_get_var_string(nc_id, var_id, static_cast<char* *>(buf)) != NC_NOERR)
+  }
+  else
+  {
+    if(column != m_key_col)
     {
+      m_filter = sort_filter_t();
     }
-    break;
+    m_key_col = column;
+    m_order = (order == Qt::AscendingOrder) ? sort_ascending : sort_descending;
   }
-  return buf;
+  start_sort();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//FileTreeWidget::load_attribute
+//TableModel::set_filter
+//a filter on another column than the one sorted shows the rows in file order
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void* FileTreeWidget::load_attribute(const int nc_id, const int var_id, const char *attr_name, const nc_type var_type, size_t buf_sz)
+void TableModel::set_filter(int column, const sort_filter_t &filter)
 {
-  void *buf = NULL;
-  switch(var_type)
+  if(!can_sort() || column < 0 || column >= m_nbr_cols)
   {
-  case NC_FLOAT:
-    buf = malloc(buf_sz * sizeof(float));
-    if(nc_get_att_float(nc_id, var_id, attr_name, static_cast<float *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_DOUBLE:
-    buf = malloc(buf_sz * sizeof(double));
-    if(nc_get_att_double(nc_id, var_id, attr_name, static_cast<double *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_INT:
-    buf = malloc(buf_sz * sizeof(int));
-    if(nc_get_att_int(nc_id, var_id, attr_name, static_cast<int *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_SHORT:
-    buf = malloc(buf_sz * sizeof(short));
-    if(nc_get_att_short(nc_id, var_id, attr_name, static_cast<short *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_CHAR:
-    buf = malloc(buf_sz * sizeof(char));
-    if(nc_get_att_text(nc_id, var_id, attr_name, static_cast<char *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_BYTE:
-    buf = malloc(buf_sz * sizeof(signed char));
-    if(nc_get_att_schar(nc_id, var_id, attr_name, static_cast<signed char *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_UBYTE:
-    buf = malloc(buf_sz * sizeof(unsigned char));
-    if(nc_get_att_uchar(nc_id, var_id, attr_name, static_cast<unsigned char *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_USHORT:
-    buf = malloc(buf_sz * sizeof(unsigned short));
-    if(nc_get_att_ushort(nc_id, var_id, attr_name, static_cast<unsigned short *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_UINT:
-    buf = malloc(buf_sz * sizeof(unsigned int));
-    if(nc_get_att_uint(nc_id, var_id, attr_name, static_cast<unsigned int *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_INT64:
-    buf = malloc(buf_sz * sizeof(long long));
-    if(nc_get_att_longlong(nc_id, var_id, attr_name, static_cast<long long *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_UINT64:
-    buf = malloc(buf_sz * sizeof(unsigned long long));
-    if(nc_get_att_ulonglong(nc_id, var_id, attr_name, static_cast<unsigned long long *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
-  case NC_STRING:
-    buf = malloc(buf_sz * sizeof(char*));
-    if(nc_get_att_string(nc_id, var_id, attr_name, static_cast<char* *>(buf)) != NC_NOERR)
-    {
-    }
-    break;
+    return;
   }
-  return buf;
+  if(column != m_key_col)
+  {
+    m_order = sort_none;
+  }
+  m_key_col = column;
+  m_filter = filter;
+  if(!m_filter.m_active && m_order == sort_none)
+  {
+    reset_order();
+    return;
+  }
+  start_sort();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//get_format
-//Provide sprintf() format string for specified netCDF type
-//Based on NCO utilities
+//TableModel::reset_order
+//all the rows in file order; a running sort is dropped when it finishes
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-const char* get_format(const nc_type typ)
+void TableModel::reset_order()
 {
-  switch(typ)
+  m_key_col = -1;
+  m_order = sort_none;
+  m_filter = sort_filter_t();
+  m_sort_pending = false;
+  if(m_remap)
   {
-  case NC_FLOAT:
-    return "%g";
-  case NC_DOUBLE:
-    return "%.12g";
-  case NC_INT:
-    return "%i";
-  case NC_SHORT:
-    return "%hi";
-  case NC_CHAR:
-    return "%c";
-  case NC_BYTE:
-    return "%hhi";
-  case NC_UBYTE:
-    return "%hhu";
-  case NC_USHORT:
-    return "%hu";
-  case NC_UINT:
-    return "%u";
-  case NC_INT64:
-    return "%lli";
-  case NC_UINT64:
-    return "%llu";
-  case NC_STRING:
-    return "%s";
+    beginResetModel();
+    m_remap = false;
+    std::vector<int>().swap(m_row_index);
+    m_row_first = 0;
+    endResetModel();
+    if(m_pager != NULL)
+    {
+      m_pager->update_range();
+    }
   }
-  return NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//TableModel::TableModel
+//TableModel::start_sort
+//the column of the current layer: in place from the buffer of a variable in memory, else read whole
+//through the I/O thread; one sort runs at a time, a change meanwhile starts another when it finishes
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-TableModel::TableModel(QObject *parent, ItemData *item_data) :
-QAbstractTableModel(parent),
-m_widget(NULL),
-m_item_data(item_data),
-m_ncdata(item_data->m_ncdata),
-m_ncvar_crd(item_data->m_ncvar_crd)
+void TableModel::start_sort()
 {
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  //define grid
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-
-  if(m_ncdata->m_dim.size() == 0)
+  if(m_sort_thread != NULL)
   {
-    m_dim_rows = -1;
-    m_dim_cols = -1;
-    m_nbr_rows = 1;
-    m_nbr_cols = 1;
+    m_sort_pending = true;
+    return;
   }
-  else if(m_ncdata->m_dim.size() == 1)
+  if(m_key_col < 0 || m_widget == NULL || (!m_tiled && m_ncdata->m_buf.empty()))
   {
-    m_dim_rows = 0;
-    m_dim_cols = -1;
-    //for NC_CHAR define rank 0, so that all text is displayed in one grid cell
-    if(NC_CHAR == m_ncdata->m_nc_type)
+    return;
+  }
+  SortThread *thread = new SortThread(this, m_ncdata->m_nc_type, m_nbr_rows, m_order, m_filter);
+  const std::vector<int> &layer = m_widget->m_layer;
+  if(m_tiled)
+  {
+    thread->m_source = m_source;
+    thread->m_start.assign(m_ncdata->m_dim.size(), 0);
+    thread->m_count.assign(m_ncdata->m_dim.size(), 1);
+    for(size_t idx_dmn = 0; idx_dmn < layer.size(); idx_dmn++)
     {
-      m_nbr_rows = 1;
+      thread->m_start[idx_dmn] = layer[idx_dmn];
     }
-    else
+    if(m_dim_cols != -1)
     {
-      m_nbr_rows = m_ncdata->m_dim[m_dim_rows];
+      thread->m_start[m_dim_cols] = m_key_col;
     }
-    m_nbr_cols = 1;
+    thread->m_count[m_dim_rows] = m_nbr_rows;
   }
   else
   {
-    m_dim_cols = m_ncdata->m_dim.size() - 1; //2 for 3D
-    m_dim_rows = m_ncdata->m_dim.size() - 2; //1 for 3D
-    m_nbr_rows = m_ncdata->m_dim[m_dim_rows];
-    m_nbr_cols = m_ncdata->m_dim[m_dim_cols];
+    if(m_item_data->m_kind == ItemData::Variable)
+    {
+      thread->m_source = make_slab_source(m_item_data);
+    }
+    size_t idx_buf = layer_index(layer) * m_nbr_rows * m_nbr_cols + m_key_col;
+    thread->m_buf = static_cast<const char*> (m_ncdata->m_buf.data()) + idx_buf * get_type_size(m_ncdata->m_nc_type);
+    thread->m_stride = m_nbr_cols;
   }
-
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-//TableModel::rowCount
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int TableModel::rowCount(const QModelIndex &) const
-{
-  return m_nbr_rows;
+  m_sort_thread = thread;
+  m_sort_pending = false;
+  QObject::connect(thread, SIGNAL(finished()), m_widget, SLOT(sort_finished()));
+  m_widget->statusBar()->showMessage(tr("Sorting..."));
+  thread->start();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//TableModel::columnCount
+//TableModel::sort_finished
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int TableModel::columnCount(const QModelIndex &) const
+void TableModel::sort_finished(SortThread *thread)
 {
-  return m_nbr_cols;
+  m_sort_thread = NULL;
+  if(m_sort_pending || m_key_col < 0)
+  {
+    thread->deleteLater();
+    start_sort();
+    return;
+  }
+  if(thread->m_status != NC_NOERR)
+  {
+    m_widget->statusBar()->showMessage(tr("Sort failed"));
+    thread->deleteLater();
+    return;
+  }
+  beginResetModel();
+  m_remap = true;
+  m_row_index.swap(thread->m_index);
+  m_row_first = 0;
+  endResetModel();
+  if(m_pager != NULL)
+  {
+    m_pager->update_range();
+  }
+  m_widget->statusBar()->showMessage(tr("%1 of %2 rows").arg((qulonglong)m_row_index.size()).arg((qulonglong)m_nbr_rows));
+  thread->deleteLater();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//TableModel::data_changed
-//update table view when change of layer
+//SortThread::run
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TableModel::data_changed()
+void SortThread::run()
 {
-  QModelIndex top = index(0, 0, QModelIndex());
-  QModelIndex bottom = index(m_nbr_rows, m_nbr_cols, QModelIndex());
-  dataChanged(top, bottom);
+  buffer_t buf;
+  bool has_fill = false;
+  double fill = 0;
+  IoScheduler::instance()->execute([this, &buf, &has_fill, &fill]()
+  {
+    if(m_source)
+    {
+      has_fill = m_source->fill_value(&fill);
+      if(m_buf == NULL)
+      {
+        buf = m_source->read(m_start, m_count);
+      }
+    }
+  }, io_layer);
+  const void *data = m_buf;
+  size_t stride = m_stride;
+  if(data == NULL)
+  {
+    if(buf.empty())
+    {
+      m_status = NC2_ERR;
+      return;
+    }
+    data = buf.data();
+    stride = 1;
+  }
+  m_status = sort_index(data, m_nc_type, m_nbr, stride, has_fill, fill, m_order, m_filter, &m_index);
 }
 
-
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 //TableModel::headerData
 //For horizontal headers, the section number corresponds to the column number.
@@ -1753,6 +5380,8 @@ QVariant TableModel::headerData(int section, Qt::Orientation orientation, int ro
     return QVariant();
   }
 
+  trace_t trace("TableModel::headerData", m_ncdata->m_name.c_str());
+
   /////////////////////////////////////////////////////////////////////////////////////////////////////
   //labels for columns
   /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1770,78 +5399,79 @@ QVariant TableModel::headerData(int section, Qt::Orientation orientation, int ro
     {
       //coordinate variable exists
       int idx_col = section;
-      if(m_ncvar_crd[m_dim_cols] != NULL)
+      const ncdata_t *crd_col = (size_t)m_dim_cols < m_ncvar_crd.size() ? m_ncvar_crd[m_dim_cols] : NULL;
+      if(crd_col != NULL)
       {
-        if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_FLOAT)
+        if(crd_col->m_nc_type == NC_FLOAT)
         {
-          float *buf_ = static_cast<float*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          float *buf_ = static_cast<float*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_FLOAT), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_DOUBLE)
+        else if(crd_col->m_nc_type == NC_DOUBLE)
         {
-          double *buf_ = static_cast<double*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          double *buf_ = static_cast<double*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_DOUBLE), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_INT)
+        else if(crd_col->m_nc_type == NC_INT)
         {
-          int *buf_ = static_cast<int*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          int *buf_ = static_cast<int*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_INT), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_SHORT)
+        else if(crd_col->m_nc_type == NC_SHORT)
         {
-          short *buf_ = static_cast<short*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          short *buf_ = static_cast<short*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_SHORT), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_CHAR)
+        else if(crd_col->m_nc_type == NC_CHAR)
         {
-          char *buf_ = static_cast<char*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          char *buf_ = static_cast<char*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_CHAR), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_BYTE)
+        else if(crd_col->m_nc_type == NC_BYTE)
         {
-          signed char *buf_ = static_cast<signed char*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          signed char *buf_ = static_cast<signed char*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_BYTE), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_UBYTE)
+        else if(crd_col->m_nc_type == NC_UBYTE)
         {
-          unsigned char *buf_ = static_cast<unsigned char*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          unsigned char *buf_ = static_cast<unsigned char*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_UBYTE), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_USHORT)
+        else if(crd_col->m_nc_type == NC_USHORT)
         {
-          unsigned short *buf_ = static_cast<unsigned short*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          unsigned short *buf_ = static_cast<unsigned short*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_USHORT), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_UINT)
+        else if(crd_col->m_nc_type == NC_UINT)
         {
-          unsigned int *buf_ = static_cast<unsigned int*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          unsigned int *buf_ = static_cast<unsigned int*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_UINT), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_INT64)
+        else if(crd_col->m_nc_type == NC_INT64)
         {
-          long long *buf_ = static_cast<long long*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          long long *buf_ = static_cast<long long*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_INT64), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_UINT64)
+        else if(crd_col->m_nc_type == NC_UINT64)
         {
-          unsigned long long *buf_ = static_cast<unsigned long long*> (m_ncvar_crd[m_dim_cols]->m_buf);
+          unsigned long long *buf_ = static_cast<unsigned long long*> (crd_col->m_buf.data());
           str.sprintf(get_format(NC_UINT64), buf_[idx_col]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_cols]->m_nc_type == NC_STRING)
+        else if(crd_col->m_nc_type == NC_STRING)
         {
-          char* *buf_ = static_cast<char**> (m_ncvar_crd[m_dim_cols]->m_buf);
-          str.sprintf(get_format(NC_STRING), buf_[idx_col]);
+          string_view_t str_ = string_at(crd_col->m_buf.data(), idx_col);
+          str = QString::fromUtf8(str_.m_ptr, (int)str_.m_len);
           return str;
         }
       }
@@ -1869,86 +5499,87 @@ QVariant TableModel::headerData(int section, Qt::Orientation orientation, int ro
     else
     {
       //coordinate variable exists
-      int idx_row = section;
-      if(m_ncvar_crd[m_dim_rows] != NULL)
+      size_t idx_row = data_row(section);
+      const ncdata_t *crd_row = (size_t)m_dim_rows < m_ncvar_crd.size() ? m_ncvar_crd[m_dim_rows] : NULL;
+      if(crd_row != NULL)
       {
-        if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_FLOAT)
+        if(crd_row->m_nc_type == NC_FLOAT)
         {
-          float *buf_ = static_cast<float*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          float *buf_ = static_cast<float*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_FLOAT), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_DOUBLE)
+        else if(crd_row->m_nc_type == NC_DOUBLE)
         {
-          double *buf_ = static_cast<double*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          double *buf_ = static_cast<double*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_DOUBLE), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_INT)
+        else if(crd_row->m_nc_type == NC_INT)
         {
-          int *buf_ = static_cast<int*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          int *buf_ = static_cast<int*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_INT), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_SHORT)
+        else if(crd_row->m_nc_type == NC_SHORT)
         {
-          short *buf_ = static_cast<short*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          short *buf_ = static_cast<short*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_SHORT), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_CHAR)
+        else if(crd_row->m_nc_type == NC_CHAR)
         {
-          char *buf_ = static_cast<char*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          char *buf_ = static_cast<char*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_CHAR), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_BYTE)
+        else if(crd_row->m_nc_type == NC_BYTE)
         {
-          signed char *buf_ = static_cast<signed char*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          signed char *buf_ = static_cast<signed char*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_BYTE), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_UBYTE)
+        else if(crd_row->m_nc_type == NC_UBYTE)
         {
-          unsigned char *buf_ = static_cast<unsigned char*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          unsigned char *buf_ = static_cast<unsigned char*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_UBYTE), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_USHORT)
+        else if(crd_row->m_nc_type == NC_USHORT)
         {
-          unsigned short *buf_ = static_cast<unsigned short*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          unsigned short *buf_ = static_cast<unsigned short*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_USHORT), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_UINT)
+        else if(crd_row->m_nc_type == NC_UINT)
         {
-          unsigned int *buf_ = static_cast<unsigned int*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          unsigned int *buf_ = static_cast<unsigned int*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_UINT), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_INT64)
+        else if(crd_row->m_nc_type == NC_INT64)
         {
-          long long *buf_ = static_cast<long long*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          long long *buf_ = static_cast<long long*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_INT64), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_UINT64)
+        else if(crd_row->m_nc_type == NC_UINT64)
         {
-          unsigned long long *buf_ = static_cast<unsigned long long*> (m_ncvar_crd[m_dim_rows]->m_buf);
+          unsigned long long *buf_ = static_cast<unsigned long long*> (crd_row->m_buf.data());
           str.sprintf(get_format(NC_UINT64), buf_[idx_row]);
           return str;
         }
-        else if(m_ncvar_crd[m_dim_rows]->m_nc_type == NC_STRING)
+        else if(crd_row->m_nc_type == NC_STRING)
         {
-          char* *buf_ = static_cast<char**> (m_ncvar_crd[m_dim_rows]->m_buf);
-          str.sprintf(get_format(NC_STRING), buf_[idx_row]);
+          string_view_t str_ = string_at(crd_row->m_buf.data(), idx_row);
+          str = QString::fromUtf8(str_.m_ptr, (int)str_.m_len);
           return str;
         }
       }
       //coordinate variable does not exist: print index
       else
       {
-        str.sprintf("%d", idx_row + 1);
+        str.sprintf("%llu", (unsigned long long)idx_row + 1);
         return str;
       }
     }
@@ -1960,73 +5591,140 @@ QVariant TableModel::headerData(int section, Qt::Orientation orientation, int ro
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
-//TableModel::data
+//TableModel::cell
+//buffer holding a cell and its index in it; NULL if the tile of the cell is not read yet, in which case
+//it is requested at io_visible, or if its read failed, with failed set
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-QVariant TableModel::data(const QModelIndex &index, int role) const
+const void* TableModel::cell(int row_view, int column, size_t *idx_buf, bool *failed) const
 {
   ChildWindow* parent = m_widget;
-  QString str;
-  size_t idx_buf = 0;
+  *idx_buf = 0;
+  *failed = false;
   //3D
   if(parent->m_layer.size() == 1)
   {
-    idx_buf = parent->m_layer[0] * m_nbr_rows * m_nbr_cols;
+    *idx_buf = parent->m_layer[0] * m_nbr_rows * m_nbr_cols;
   }
   //4D
   else if(parent->m_layer.size() == 2)
   {
-    idx_buf = parent->m_layer[0] * m_ncdata->m_dim[1] + parent->m_layer[1];
-    idx_buf *= m_nbr_rows * m_nbr_cols;
+    *idx_buf = parent->m_layer[0] * m_ncdata->m_dim[1] + parent->m_layer[1];
+    *idx_buf *= m_nbr_rows * m_nbr_cols;
   }
   //5D
   else if(parent->m_layer.size() == 3)
   {
-    idx_buf = parent->m_layer[0] * m_ncdata->m_dim[1] * m_ncdata->m_dim[2]
+    *idx_buf = parent->m_layer[0] * m_ncdata->m_dim[1] * m_ncdata->m_dim[2]
       + parent->m_layer[1] * m_ncdata->m_dim[2]
       + parent->m_layer[2];
-    idx_buf *= m_nbr_rows * m_nbr_cols;
+    *idx_buf *= m_nbr_rows * m_nbr_cols;
   }
 
   //into current index
-  idx_buf += index.row() * m_nbr_cols + index.column();
+  size_t row = data_row(row_view);
+  *idx_buf += row * m_nbr_cols + column;
+
+  //tiled: the tile holds the rows of the current layer only
+  if(m_tiled)
+  {
+    size_t idx_tile = row / m_tile_rows;
+    tile_t &tile = layer_tiles(layer_index(parent->m_layer))[idx_tile];
+    if(tile.m_buf.empty())
+    {
+      *failed = tile.m_failed;
+      request_tile(parent->m_layer, idx_tile, io_visible);
+      return NULL;
+    }
+    *idx_buf = (row - idx_tile * m_tile_rows) * m_nbr_cols + column;
+    return tile.m_buf.data();
+  }
+  return m_ncdata->m_buf.data();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::cell_text
+//the text of a cell as data() shows it, into str; returns its length, or -1 if the cell is not read yet
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TableModel::cell_text(int row, int column, char *str, size_t str_sz) const
+{
+  size_t idx_buf;
+  bool failed;
+  const void *buf = cell(row, column, &idx_buf, &failed);
+  if(buf == NULL && failed)
+  {
+    snprintf(str, str_sz, "%s", table_error_text);
+    return (int)std::min(strlen(table_error_text), str_sz - 1);
+  }
+  if(buf == NULL)
+  {
+    return -1;
+  }
+  if(m_ncdata->m_nc_type == NC_CHAR)
+  {
+    //size of string, display in one cell
+    size_t len = std::min(m_ncdata->m_dim[0], str_sz - 1);
+    memcpy(str, buf, len);
+    str[len] = '\0';
+    return (int)len;
+  }
+  int len = format_value(str, str_sz, m_ncdata->m_nc_type, buf, idx_buf);
+  return std::max(0, std::min(len, (int)str_sz - 1));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel::data
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
+QVariant TableModel::data(const QModelIndex &index, int role) const
+{
+  QString str;
   if(role != Qt::DisplayRole)
   {
     return QVariant();
   }
 
+  trace_t trace("TableModel::data", m_ncdata->m_name.c_str());
+  size_t idx_buf;
+  bool failed;
+  const void *buf = cell(index.row(), index.column(), &idx_buf, &failed);
+  if(buf == NULL)
+  {
+    return failed ? QVariant(QString(table_error_text)) : QVariant();
+  }
+
   /////////////////////////////////////////////////////////////////////////////////////////////////////
   //grid
   /////////////////////////////////////////////////////////////////////////////////////////////////////
 
   if(m_ncdata->m_nc_type == NC_FLOAT)
   {
-    float *buf_ = static_cast<float*> (m_ncdata->m_buf);
+    const float *buf_ = static_cast<const float*> (buf);
     str.sprintf(get_format(NC_FLOAT), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_DOUBLE)
   {
-    double *buf_ = static_cast<double*> (m_ncdata->m_buf);
+    const double *buf_ = static_cast<const double*> (buf);
     str.sprintf(get_format(NC_DOUBLE), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_INT)
   {
-    int* buf_ = static_cast<int*> (m_ncdata->m_buf);
+    const int* buf_ = static_cast<const int*> (buf);
     str.sprintf(get_format(NC_INT), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_SHORT)
   {
-    short *buf_ = static_cast<short*> (m_ncdata->m_buf);
+    const short *buf_ = static_cast<const short*> (buf);
     str.sprintf(get_format(NC_SHORT), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_CHAR)
   {
-    char *buf_ = static_cast<char*> (m_ncdata->m_buf);
+    const char *buf_ = static_cast<const char*> (buf);
     //size of string, display in one cell
     for(size_t idx = 0; idx < m_ncdata->m_dim[0]; idx++)
     {
@@ -2036,44 +5734,44 @@ QVariant TableModel::data(const QModelIndex &index, int role) const
   }
   else if(m_ncdata->m_nc_type == NC_BYTE)
   {
-    signed char *buf_ = static_cast<signed char*> (m_ncdata->m_buf);
+    const signed char *buf_ = static_cast<const signed char*> (buf);
     str.sprintf(get_format(NC_BYTE), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_UBYTE)
   {
-    unsigned char *buf_ = static_cast<unsigned char*> (m_ncdata->m_buf);
+    const unsigned char *buf_ = static_cast<const unsigned char*> (buf);
     str.sprintf(get_format(NC_UBYTE), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_USHORT)
   {
-    unsigned short *buf_ = static_cast<unsigned short*> (m_ncdata->m_buf);
+    const unsigned short *buf_ = static_cast<const unsigned short*> (buf);
     str.sprintf(get_format(NC_USHORT), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_UINT)
   {
-    unsigned int* buf_ = static_cast<unsigned int*> (m_ncdata->m_buf);
+    const unsigned int* buf_ = static_cast<const unsigned int*> (buf);
     str.sprintf(get_format(NC_UINT), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_INT64)
   {
-    unsigned long long* buf_ = static_cast<unsigned long long*> (m_ncdata->m_buf);
+    const long long* buf_ = static_cast<const long long*> (buf);
     str.sprintf(get_format(NC_INT64), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_UINT64)
   {
-    unsigned long long* buf_ = static_cast<unsigned long long*> (m_ncdata->m_buf);
+    const unsigned long long* buf_ = static_cast<const unsigned long long*> (buf);
     str.sprintf(get_format(NC_UINT64), buf_[idx_buf]);
     return str;
   }
   else if(m_ncdata->m_nc_type == NC_STRING)
   {
-    char* *buf_ = static_cast<char**> (m_ncdata->m_buf);
-    str.sprintf(get_format(NC_STRING), buf_[idx_buf]);
+    string_view_t str_ = string_at(buf, idx_buf);
+    str = QString::fromUtf8(str_.m_ptr, (int)str_.m_len);
     return str;
   }
 
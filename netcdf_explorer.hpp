@@ -8,42 +8,284 @@
 #include <QtGui>
 #include <QIcon>
 #include <QMdiArea>
+#include <cstdlib>
 #include <string>
 #include <vector>
+#include <utility>
+#include <map>
+#include <memory>
 #include "netcdf.h"
+#include "netcdf_string.hpp"
+#include "netcdf_io.hpp"
+#include "netcdf_meta.hpp"
+#include "netcdf_series.hpp"
+#include "netcdf_diff.hpp"
+#include "netcdf_expr.hpp"
+#include "netcdf_reduce.hpp"
+#include "netcdf_pyramid.hpp"
+#include "netcdf_sort.hpp"
+#include "netcdf_layout.hpp"
+#include "netcdf_remote.hpp"
+#include "netcdf_time.hpp"
+#include "netcdf_subset.hpp"
+#include "netcdf_chunk.hpp"
+#include "netcdf_reader.hpp"
+#include "netcdf_cache.hpp"
 
 class MainWindow;
+class JobThread;
+class ReduceThread;
+class PyramidThread;
 class ItemData;
 class ncdata_t;
 class TableModel;
+class TablePager;
+class SortThread;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//ncdata_t
+//ncdata_t is an abstraction to store in memory information for both: 1) netCDF variables. 2) netCDF attributes
+//1) netCDF variables
+//a netCDF variable has a name, a netCDF type, data buffer, and an array of dimensions
+//these are defined in iteration of the file
+//the data buffer is stored on per load variable from tree using netCDF API from item input
+//2) netCDF attributes
+//a netCDF attribute has a name, a netCDF type, data buffer, and a size
+//Variables may be multidimensional. Attributes are all either scalars(single-valued) or vectors(a single, fixed dimension)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ncdata_t
+{
+public:
+  ncdata_t(const char* name, nc_type nc_typ, const std::vector<size_t> &dim) :
+    m_name(name),
+    m_nc_type(nc_typ),
+    m_dim(dim)
+  {
+  }
+  void store(buffer_t &&buf)
+  {
+    m_buf = std::move(buf);
+  }
+  std::string m_name;
+  nc_type m_nc_type;
+  buffer_t m_buf; // pooled; NC_STRING data is a string arena
+  std::vector<size_t> m_dim;
+  std::string m_units; // (coordinate variable) units attribute, for CF time
+  std::string m_calendar; // (coordinate variable) calendar attribute
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//ItemData
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ItemData
+{
+public:
+  enum ItemKind
+  {
+    Root,
+    Group,
+    Variable,
+    Attribute
+  };
+
+  ItemData(ItemKind kind, const std::string& file_name, const std::string& grp_nm_fll, const std::string& item_nm,
+    ItemData *item_data_prn, ncdata_t *ncdata) :
+    m_file_name(file_name),
+    m_grp_nm_fll(grp_nm_fll),
+    m_item_nm(item_nm),
+    m_kind(kind),
+    m_item_data_prn(item_data_prn),
+    m_ncdata(ncdata),
+    m_item_data_crd(NULL)
+  {
+  }
+  ~ItemData()
+  {
+    delete m_ncdata;
+    for(size_t idx_dmn = 0; idx_dmn < m_ncvar_crd.size(); idx_dmn++)
+    {
+      delete m_ncvar_crd[idx_dmn];
+    }
+  }
+  std::string m_file_name;  // (Root/Variable/Group/Attribute) file name
+  std::string m_grp_nm_fll; // (Group) full name of group
+  std::string m_item_nm; // (Root/Variable/Group/Attribute ) item name to display on tree
+  ItemKind m_kind; // (Root/Variable/Group/Attribute) type of item 
+  std::vector<std::string> m_var_nms; // (Group) list of variables if item is group (filled from the metadata store)
+  ItemData *m_item_data_prn; //  (Variable/Group) item data of the parent group (to get list of variables in group)
+  ncdata_t *m_ncdata; // (Variable, Attribute) netCDF variable/attribute to display
+  std::vector<ncdata_t *> m_ncvar_crd; // (Variable) optional coordinate variables for variable
+  std::shared_ptr<series_t> m_series; // (Variable) file series the item is in, or NULL; m_file_name is its first file
+  std::shared_ptr<slab_source_t> m_source; // (Variable) data of a derived variable, or NULL
+  ItemData *m_item_data_crd; // (Variable) derived variable: the operand whose coordinate variables it shows
+  std::vector<size_t> m_crd_dmn; // (Variable) derived variable: the dimension of m_item_data_crd of each of its dimensions
+};
+
+Q_DECLARE_METATYPE(ItemData*);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//item_growth_t
+//records appended to the file of an opened variable since it was read, read on the I/O thread and applied
+//to the variable on the GUI thread: its new dimensions, the records of its coordinate variables and of
+//its data if read whole; all of it when appending is not possible (a dimension other than the first grew)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class item_growth_t
+{
+public:
+  item_growth_t() :
+    m_item_data(NULL),
+    m_buf_whole(false)
+  {
+  }
+  ItemData *m_item_data; // variable, NULL if it did not grow
+  std::vector<size_t> m_dim; // new dimensions
+  std::vector<buffer_t> m_crd; // per dimension, records appended to the coordinate variable, or empty
+  std::vector<char> m_crd_whole; // per dimension, m_crd holds the whole coordinate variable
+  buffer_t m_buf; // records appended to the data, or empty if not read whole
+  bool m_buf_whole; // m_buf holds the whole data
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//netCDF loading engine
+//used by both the GUI and the headless command line mode; no widgets are created here
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int load_item(ItemData *item_data, bool load_data = true);
+int load_item_attribute(ItemData *item_data);
+buffer_t load_variable(const int nc_id, const int var_id, const nc_type var_type, size_t buf_sz);
+buffer_t load_variable_string(const int nc_id, const int var_id, size_t buf_sz);
+buffer_t load_variable_slab(const int nc_id, const int var_id, const nc_type var_type,
+  const std::vector<size_t> &start, const std::vector<size_t> &count, const std::vector<ptrdiff_t> &stride);
+buffer_t load_attribute(const int nc_id, const int var_id, const char *name, const nc_type var_type, size_t buf_sz);
+std::string load_att_text(const int nc_id, const int var_id, const char *name);
+int inq_grp_id(const int nc_id, const std::string& grp_nm_fll, int *grp_id);
+const char* get_format(const nc_type typ);
+size_t get_type_size(const nc_type typ);
+int format_value(char *str, size_t str_sz, const nc_type typ, const void *buf, size_t idx);
+double get_double(const nc_type typ, const void *buf, size_t idx);
+std::shared_ptr<slab_source_t> make_slab_source(const ItemData *item_data);
+int grow_item(const int nc_id, ItemData *item_data, item_growth_t *growth);
+void apply_growth(item_growth_t *growth);
+
+#if QT_VERSION >= 0x050000
+int run_headless(const QCommandLineParser &parser);
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//FileTreeModel
+//tree of the open files over their metadata stores; an index ID is the item index plus the number of
+//items of the files before it; ItemData is created only for the items opened in tables, and their parents
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class FileTreeModel : public QAbstractItemModel
+{
+public:
+  FileTreeModel(QObject *parent);
+  ~FileTreeModel();
+  QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+  QModelIndex parent(const QModelIndex &index) const;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  void add_file(meta_store_t *store);
+  void clear();
+  void set_icons(const QIcon &icon_group, const QIcon &icon_dataset, const QIcon &icon_attribute);
+  const meta_item_t* item(const QModelIndex &index) const;
+  ItemData* item_data(const QModelIndex &index);
+  size_t bytes() const;
+  size_t get_file(const QModelIndex &index, unsigned int *idx) const;
+  size_t search(const std::string &text, std::vector<std::vector<char> > &keep) const;
+  int add_derived(const QModelIndex &index, const std::string &var_nm, const std::string &text, std::string *error);
+  void add_virtual(const std::string &title, const std::string &var_nm, ItemData *item_data_crd, const std::vector<size_t> &crd_dmn,
+    const std::vector<std::string> &dim_nm, const std::shared_ptr<slab_source_t> &source);
+  std::vector<std::string> dim_names(const QModelIndex &index) const;
+  const meta_store_t* store(const QModelIndex &index) const;
+  meta_store_t* find_store(const std::string &file_name) const;
+  ItemData* find_variable(const std::string &name);
+  std::vector<ItemData*> opened_variables(const meta_store_t *store) const;
+
+private:
+  QModelIndex make_index(size_t idx_file, unsigned int idx) const;
+  ItemData* item_data(size_t idx_file, unsigned int idx);
+  std::vector<std::string> dim_names(size_t idx_file, unsigned int idx) const;
+  std::vector<meta_store_t*> m_file;
+  std::vector<quintptr> m_base; // ID of the root of each file
+  std::map<quintptr, ItemData*> m_item_data; // items opened, by ID
+  QIcon m_icon_group;
+  QIcon m_icon_dataset;
+  QIcon m_icon_attribute;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//FileTreeFilter
+//shows the items found by a search and their parents
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class FileTreeFilter : public QSortFilterProxyModel
+{
+public:
+  FileTreeFilter(QObject *parent) :
+    QSortFilterProxyModel(parent),
+    m_active(false)
+  {
+  }
+  void set_keep(bool active, std::vector<std::vector<char> > &keep);
+
+protected:
+  bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+
+private:
+  bool m_active;
+  std::vector<std::vector<char> > m_keep; // per file and item, 1 if shown
+};
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 //FileTreeWidget
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class FileTreeWidget : public QTreeWidget
+class FileTreeWidget : public QTreeView
 {
   Q_OBJECT
 public:
   FileTreeWidget(QWidget *parent = 0);
-  ~FileTreeWidget();
+  void add_file(meta_store_t *store);
+  void clear_files();
+  size_t search(const QString &text);
   private slots:
   void show_context_menu(const QPoint &);
   void add_grid();
+  void add_subset();
+  void set_diff_reference();
+  void add_diff();
+  void add_diff_relative();
+  void add_derived();
+  void add_reduce();
+  void add_overview();
 
 public:
   void set_main_window(MainWindow *p)
   {
     m_main_window = p;
   }
+  FileTreeModel *tree_model() const
+  {
+    return m_model;
+  }
+
+protected:
+  void currentChanged(const QModelIndex &current, const QModelIndex &previous);
 
 private:
   MainWindow *m_main_window;
-  void load_item(QTreeWidgetItem *);
-  void load_item_attribute(QTreeWidgetItem *);
-  void* load_variable(const int nc_id, const int var_id, const nc_type var_type, size_t buf_sz);
-  void* load_attribute(const int nc_id, const int var_id, const char *name, const nc_type var_type, size_t buf_sz);
-  bool enable_data(ItemData *item_data);
+  FileTreeModel *m_model;
+  FileTreeFilter *m_filter;
+  QString m_search; // current search text
+  ItemData *m_diff_ref; // variable B of the next diff view, or NULL
+  bool enable_data(nc_type nc_typ);
+  void add_diff(int mode);
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,13 +298,39 @@ class MainWindow : public QMainWindow
 public:
   MainWindow();
   void add_table(ItemData *item_data);
+  void add_diff(ItemData *item_a, ItemData *item_b, int mode);
+  void add_subset(ItemData *item_data, const std::vector<std::string> &range, const std::vector<std::string> &dim_nm);
+  void add_reduce(ItemData *item_data, size_t dmn, int op, const std::vector<std::string> &dim_nm);
+  void add_overview(ItemData *item_data, const std::vector<std::string> &dim_nm);
+  void show_layout(const meta_store_t *store, unsigned int idx, const std::vector<std::string> &dim_nm);
   int read_file(QString file_name);
+  int read_series(QString spec);
+  void close_files();
+  void set_trace_checked()
+  {
+    m_action_trace_enable->setChecked(true);
+  }
 
   private slots:
   void open_recent_file();
   void open_file();
   void open_dap();
+  void open_remote();
+  void open_series();
   void about();
+  void enable_trace(bool);
+  void save_trace();
+  void clear_trace();
+  void show_memory();
+  void show_io();
+  void enable_readers(bool);
+  void search(const QString &text);
+  void show_job_progress();
+  void cancel_job();
+  void job_finished();
+  void file_changed(const QString &path);
+  void refresh_files();
+  void refresh_all();
 
 private:
 
@@ -72,11 +340,24 @@ private:
 
   QMenu *m_menu_file;
   QMenu *m_menu_help;
+  QMenu *m_menu_performance;
   QMenu *m_menu_windows;
   QToolBar *m_tool_bar;
   QMdiArea *m_mdi_area;
   FileTreeWidget *m_tree;
+  QLineEdit *m_search;
   QDockWidget *m_tree_dock;
+  QDockWidget *m_layout_dock;
+  QPlainTextEdit *m_layout_text; // storage layout of the current variable
+  quint64 m_layout_id; // I/O request of the layout shown next, or 0
+  QProgressBar *m_job_progress;
+  QToolButton *m_job_cancel;
+  QTimer *m_job_timer;
+  JobThread *m_job_thread; // running reduction or overview build, or NULL
+  QFileSystemWatcher *m_watcher; // open files, for records appended while they are open
+  QTimer *m_refresh_timer; // refresh once the writes of a burst are done
+  QStringList m_refresh_pending; // files changed, to refresh
+  QStringList m_refresh_busy; // files being refreshed
 
   ///////////////////////////////////////////////////////////////////////////////////////
   //actions
@@ -84,10 +365,19 @@ private:
 
   QAction *m_action_open;
   QAction *m_action_opendap;
+  QAction *m_action_open_remote;
+  QAction *m_action_open_series;
+  QAction *m_action_refresh;
   QAction *m_action_exit;
   QAction *m_action_about;
   QAction *m_action_tile;
   QAction *m_action_close_all;
+  QAction *m_action_trace_enable;
+  QAction *m_action_trace_save;
+  QAction *m_action_trace_clear;
+  QAction *m_action_memory;
+  QAction *m_action_io;
+  QAction *m_action_readers;
 
   ///////////////////////////////////////////////////////////////////////////////////////
   //icons
@@ -112,7 +402,40 @@ private:
   void closeEvent(QCloseEvent *eve);
 
 private:
-  int iterate(const std::string& file_name, const int grp_id, QTreeWidgetItem *tree_item);
+  void add_file(meta_store_t *store);
+  void refresh_file(const QString &file_name);
+  void start_job(JobThread *thread, const QString &message);
+  void reduce_finished(ReduceThread *thread);
+  void pyramid_finished(PyramidThread *thread);
+  void show_overview(ItemData *item_data, const pyramid_t &pyramid, const std::vector<std::string> &dim_nm);
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//LayerModel
+//layers of a dimension for the combo box of a ChildWindow: the values of its coordinate variable (as
+//dates if its units are CF time), or numbers; a label is formatted when first shown, then kept
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class LayerModel : public QAbstractListModel
+{
+public:
+  LayerModel(QObject *parent, const ncdata_t *ncvar_crd, size_t nbr_layers);
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  void grow(size_t nbr_layers);
+  int find(const QString &text) const; // layer nearest to a value or date, -1 if none
+
+private:
+  bool is_numeric() const;
+  double value(size_t idx) const;
+  int monotonic() const;
+  const ncdata_t *m_ncvar_crd; // NULL if none; grows with the variable
+  size_t m_nbr_layers;
+  bool m_is_time; // units parsed as CF time
+  cf_time_t m_cf_time;
+  mutable std::vector<QString> m_label; // null until shown
+  mutable int m_monotonic; // 1 increasing, -1 decreasing, 0 neither, 2 not known yet
+  mutable std::vector<size_t> m_order; // layers by increasing value, NaN left out; if not monotonic
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -124,21 +447,471 @@ class ChildWindow : public QMainWindow
   Q_OBJECT
 public:
   ChildWindow(QWidget *parent, ItemData *item_data);
+  void grow(const std::vector<size_t> &dim_old);
   std::vector<int> m_layer;  // current selected layer of a dimension > 2 
 
   private slots:
   void previous_layer(int);
   void next_layer(int);
   void combo_layer(int);
+  void go_to_layer(int);
 
 private:
   QToolBar *m_tool_bar;
   std::vector<QComboBox *> m_vec_combo;
+  std::vector<LayerModel *> m_vec_layers; // models of the combo boxes
+  std::vector<QLineEdit *> m_vec_go; // "go to value" boxes
+
+public:
+  TableModel *model() const
+  {
+    return m_model;
+  }
 
 protected:
   TableModel *m_model;
   ncdata_t *m_ncdata; // netCDF data (variable or attribute) to display (convenience pointer to data in ItemData)
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//tile_t
+//a block of rows of one layer, read through the I/O scheduler
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class tile_t
+{
+public:
+  tile_t() :
+    m_id(0),
+    m_priority(io_nbr_priority),
+    m_failed(false)
+  {
+  }
+  quint64 m_id; // pending request, 0 if none
+  int m_priority; // priority of the pending request
+  buffer_t m_buf; // data, empty until read
+  bool m_failed; // read failed; not requested again until the file is refreshed
+};
+
+//text of the cells of a tile that could not be read
+static const char table_error_text[] = "#error";
+
+//rows of a table in its view at a time; QHeaderView keeps data per section
+static const size_t table_page_rows = (size_t)1 << 20;
+
+//longest coordinate variable read whole; the rows of longer dimensions are numbered
+static const size_t crd_max_load = (size_t)1 << 24;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableModel
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class TableModel : public QAbstractTableModel
+{
+public:
+  TableModel(QObject *parent, ItemData *item_data, const std::shared_ptr<slab_source_t> &source = std::shared_ptr<slab_source_t>());
+  ~TableModel();
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  int cell_text(int row, int column, char *str, size_t str_sz) const; //data() without QVariant and QString
+  //display custom header data
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+  ChildWindow* m_widget; //get layers in toolbar
+  size_t m_nbr_rows;   // number of rows
+  int m_nbr_cols;   // number of columns
+  void data_changed(); //update table view when change of layer
+
+  ItemData *m_item_data; // the tree item that generated this grid
+  ncdata_t *m_ncdata; // netCDF data to display (convenience pointer to data in ItemData)
+  int m_dim_rows;   // choose rows (convenience duplicate to data in ItemData)
+  int m_dim_cols;   // choose columns (convenience duplicate to data in ItemData)
+  std::vector<ncdata_t *> m_ncvar_crd; // optional coordinate variables for variable (convenience duplicate to data in ItemData)
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //tiles
+  //variables of two or more dimensions are not loaded whole; the cells on screen are read first,
+  //then the rest of the current layer, then the neighbour layers
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  static bool use_tiles(const ncdata_t *ncdata);
+  void load_layer(); //request the current layer and prefetch its neighbours, drop the others
+  void view_rows(int row_first, int row_last); //rows on screen changed
+  void grow(const std::vector<size_t> &dim_old); //records appended to the file
+  void reload_failed(); //the file was refreshed; tiles that could not be read are read again
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //window
+  //the view gets at most table_page_rows rows, from m_row_first of the rows shown; the pager moves
+  //the window over all of them, so that positions are 64 bit and only the window is read
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  size_t rows_shown() const
+  {
+    return m_remap ? m_row_index.size() : m_nbr_rows;
+  }
+  void move_window(size_t row_first);
+  size_t m_row_first; // first row shown in the view
+  TablePager *m_pager; // or NULL
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //sort and filter
+  //the rows of the layer are shown through a permutation computed on a thread from one column;
+  //a layer change computes it again for the new layer
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  bool can_sort() const;
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+  void set_filter(int column, const sort_filter_t &filter);
+  void reset_order();
+  void sort_finished(SortThread *thread);
+  void wait_sort(); //the buffers of the variable are about to change
+  int m_key_col; // column sorted or filtered, -1 in file order
+  int m_order; // sort_order_t
+  sort_filter_t m_filter;
+
+private:
+  size_t data_row(int row) const
+  {
+    size_t pos = m_row_first + row;
+    return m_remap ? m_row_index[pos] : pos;
+  }
+  void start_sort();
+  const void* cell(int row_view, int column, size_t *idx_buf, bool *failed) const;
+  bool m_remap; // rows shown through m_row_index
+  std::vector<int> m_row_index; // row of the layer of each row shown
+  SortThread *m_sort_thread; // running, or NULL
+  bool m_sort_pending; // sort or filter changed while m_sort_thread runs
+
+  size_t layer_index(const std::vector<int> &layer) const;
+  std::vector<tile_t>& layer_tiles(size_t idx_lyr) const;
+  void tile_box(size_t idx_lyr, size_t idx_tile, std::vector<size_t> *start, std::vector<size_t> *count) const;
+  void request_tile(const std::vector<int> &layer, size_t idx_tile, int priority) const;
+  void tile_done(size_t idx_lyr, size_t idx_tile, io_request_t *req);
+  bool m_tiled; // data read by tiles
+  bool m_layer_whole; // the whole current layer is read, not only the rows on screen
+  int m_tile_rows; // rows per tile
+  std::shared_ptr<slab_source_t> m_source;
+  mutable std::map<size_t, std::vector<tile_t> > m_tiles; // tiles of the cached layers, by layer index
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TableView
+//QTableView with the paint event traced
+//with direct paint, the cells are painted from the buffers of the model instead of through data(), QVariant,
+//QString and the item delegate: each cell is formatted into one character buffer, and the glyphs of all
+//the ASCII cells on screen are drawn as one glyph run; headers and selection stay those of QTableView
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class TableView : public QTableView
+{
+public:
+  TableView(QWidget *parent = 0);
+  void view_rows(); //tell the model the rows on screen
+  void set_direct_paint(bool direct);
+  bool direct_paint() const
+  {
+    return m_direct;
+  }
+  void copy_selection(); //selected cells to the clipboard, tab separated
+protected:
+  void paintEvent(QPaintEvent *eve);
+  void scrollContentsBy(int dx, int dy);
+  void keyPressEvent(QKeyEvent *eve);
+private:
+  void paint_cells(QPaintEvent *eve);
+  bool m_direct;
+  QFont m_glyph_font; // font of m_raw_font
+  QRawFont m_raw_font;
+  quint32 m_glyph[128]; // glyph of each ASCII character
+  qreal m_advance[128];
+  QVector<quint32> m_run_glyph[2]; // glyphs of a frame, of the cells not selected and selected
+  QVector<QPointF> m_run_pos[2];
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//TablePager
+//the table view, with a scroll bar over all the rows and a box to go to a row when there are more rows
+//than the model shows at a time; the bar moves by half a window, so that rows near the end of a window
+//are near the start of the next
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class TablePager : public QWidget
+{
+  Q_OBJECT
+public:
+  TablePager(QWidget *parent, TableView *table, TableModel *model);
+  void update_range(); //rows shown or window changed
+
+  private slots:
+  void page_moved(int value);
+  void go_to_row();
+
+private:
+  size_t page_step() const;
+  TableView *m_table;
+  TableModel *m_model;
+  QScrollBar *m_bar;
+  QWidget *m_bar_go; // position and go to box
+  QLabel *m_label;
+  QLineEdit *m_edit;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowTable
+//model/view
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ChildWindowTable : public ChildWindow
+{
+  Q_OBJECT
+public:
+  ChildWindowTable(QWidget *parent, ItemData *item_data) :
+    ChildWindow(parent, item_data)
+  {
+    //each new table widget has its own model
+    m_model = new TableModel(this, item_data);
+    m_model->m_widget = this;
+    m_table = new TableView(this);
+    m_table->setModel(m_model);
+
+    //set default row height
+    QHeaderView *verticalHeader = m_table->verticalHeader();
+#if QT_VERSION >= 0x050000
+    verticalHeader->sectionResizeMode(QHeaderView::Fixed);
+#else
+    verticalHeader->setResizeMode(QHeaderView::Fixed);
 #endif
+    verticalHeader->setDefaultSectionSize(24);
+    setCentralWidget(new TablePager(this, m_table, m_model));
+
+    //sort by a click on a column header; filter on the current column
+    if(m_model->can_sort())
+    {
+      m_table->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+      m_table->setSortingEnabled(true);
+      QToolBar *tool_bar = addToolBar(tr("Sort"));
+      QAction *action_filter = new QAction(tr("Filter..."), this);
+      action_filter->setStatusTip(tr("Show the rows with a value of the current column in a range"));
+      connect(action_filter, SIGNAL(triggered()), this, SLOT(filter_rows()));
+      tool_bar->addAction(action_filter);
+      QAction *action_reset = new QAction(tr("File order"), this);
+      action_reset->setStatusTip(tr("Show all the rows in file order"));
+      connect(action_reset, SIGNAL(triggered()), this, SLOT(reset_order()));
+      tool_bar->addAction(action_reset);
+    }
 
+    //paint the cells from the buffers of the model; the choice is kept for the next tables
+    QAction *action_direct = new QAction(tr("Direct paint"), this);
+    action_direct->setCheckable(true);
+    action_direct->setChecked(m_table->direct_paint());
+    action_direct->setStatusTip(tr("Paint the cells straight from the data, without the item delegate"));
+    connect(action_direct, SIGNAL(toggled(bool)), this, SLOT(direct_paint(bool)));
+    addToolBar(tr("View"))->addAction(action_direct);
+    m_model->load_layer();
+  }
+  TableView *table() const
+  {
+    return m_table;
+  }
+
+  private slots:
+  void filter_rows();
+  void reset_order();
+  void sort_finished();
+  void direct_paint(bool direct);
+
+private:
+  TableView *m_table;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowSubset
+//table of a subset of a variable; owns its ItemData and the coordinate variables of the subset
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ChildWindowSubset : public ChildWindowTable
+{
+  Q_OBJECT
+public:
+  ChildWindowSubset(QWidget *parent, ItemData *item_data) :
+    ChildWindowTable(parent, item_data),
+    m_item_data(item_data)
+  {
+  }
+  ~ChildWindowSubset()
+  {
+    delete m_model; // waits for its sort thread, which may read the data
+    m_model = NULL;
+    delete m_item_data;
+  }
+
+private:
+  ItemData *m_item_data;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//SortThread
+//the permutation of the rows of a table from one column: the column is read through the I/O thread,
+//or taken in place from a buffer in memory
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class SortThread : public QThread
+{
+public:
+  SortThread(QObject *parent, nc_type nc_typ, size_t nbr, int order, const sort_filter_t &filter) :
+    QThread(parent),
+    m_nc_type(nc_typ),
+    m_nbr(nbr),
+    m_order(order),
+    m_filter(filter),
+    m_buf(NULL),
+    m_stride(1),
+    m_status(NC_NOERR)
+  {
+  }
+  nc_type m_nc_type;
+  size_t m_nbr; // rows
+  int m_order; // sort_order_t
+  sort_filter_t m_filter;
+  std::shared_ptr<slab_source_t> m_source; // fill value, and the column if m_buf is NULL
+  std::vector<size_t> m_start; // column slab
+  std::vector<size_t> m_count;
+  const void *m_buf; // column in memory, m_stride cells apart, or NULL
+  size_t m_stride;
+  std::vector<int> m_index; // when finished with NC_NOERR
+  int m_status;
+
+protected:
+  void run();
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//DiffThread
+//whole-variable statistics of a diff view, read through the I/O thread at background priority
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class DiffThread : public QThread
+{
+public:
+  DiffThread(QObject *parent, const std::shared_ptr<diff_slab_source_t> &source) :
+    QThread(parent),
+    m_cancel(false),
+    m_source(source),
+    m_progress(0),
+    m_status(NC_NOERR)
+  {
+  }
+  diff_stats_t stats(double *progress, int *status);
+  std::atomic<bool> m_cancel;
+
+protected:
+  void run();
+
+private:
+  std::shared_ptr<diff_slab_source_t> m_source;
+  QMutex m_mutex;
+  diff_stats_t m_stats; // statistics so far
+  double m_progress; // fraction done
+  int m_status;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//JobThread
+//a long computation of the main window (reduction, overview build), read through the I/O thread at
+//background priority; its progress and a cancel button are in the status bar
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class JobThread : public QThread
+{
+public:
+  JobThread(QObject *parent, ItemData *item_data, const std::vector<std::string> &dim_nm) :
+    QThread(parent),
+    m_cancel(false),
+    m_item_data(item_data),
+    m_dim_nm(dim_nm),
+    m_status(NC_NOERR),
+    m_progress(0)
+  {
+  }
+  double progress()
+  {
+    return m_progress;
+  }
+  std::atomic<bool> m_cancel;
+  ItemData *m_item_data; // variable, owned by the tree
+  std::vector<std::string> m_dim_nm; // dimension names of the variable
+  int m_status;
+
+protected:
+  std::atomic<double> m_progress; // fraction done
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//ReduceThread
+//a reduction along a dimension; the result is added to the tree when the thread finishes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ReduceThread : public JobThread
+{
+public:
+  ReduceThread(QObject *parent, ItemData *item_data, size_t dmn, int op, const std::vector<std::string> &dim_nm) :
+    JobThread(parent, item_data, dim_nm),
+    m_dmn(dmn),
+    m_op(op),
+    m_cached(false)
+  {
+  }
+  size_t m_dmn;
+  int m_op; // reduce_op_t
+  std::shared_ptr<const std::vector<double> > m_result; // when finished with NC_NOERR
+  bool m_cached; // m_result found in the reduction cache
+
+protected:
+  void run();
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//PyramidThread
+//the overview pyramid of a variable, written to its sidecar
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class PyramidThread : public JobThread
+{
+public:
+  PyramidThread(QObject *parent, ItemData *item_data, const std::string &key, const std::vector<std::string> &dim_nm) :
+    JobThread(parent, item_data, dim_nm),
+    m_key(key)
+  {
+  }
+  std::string m_key; // pyramid_key of the variable
+
+protected:
+  void run();
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//ChildWindowDiff
+//table of A - B, read tile by tile, with the statistics of the whole variables in the status bar
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ChildWindowDiff : public ChildWindow
+{
+  Q_OBJECT
+public:
+  ChildWindowDiff(QWidget *parent, ItemData *item_data, const std::shared_ptr<diff_slab_source_t> &source);
+  ~ChildWindowDiff();
+
+  private slots:
+  void show_stats();
+  void stop_stats();
+
+private:
+  ItemData *m_item_data; // owned; the coordinate variables are the ones of A, owned by the tree
+  TableView *m_table;
+  DiffThread *m_thread;
+  QTimer *m_timer;
+};
+
+#endif
@@ -0,0 +1,696 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "netcdf_explorer.hpp"
+#include "netcdf_expr.hpp"
+#include "netcdf_diff.hpp"
+#include "netcdf_trace.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EXPR_SSE2
+#endif
+
+//cells evaluated at a time; the registers of all the nodes stay in cache
+static const size_t expr_block_cells = 1024;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//functions
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const struct
+{
+  const char *m_name;
+  int m_op;
+  int m_nbr_arg;
+} expr_function[] =
+{
+  { "sqrt", expr_sqrt, 1 },
+  { "abs", expr_abs, 1 },
+  { "exp", expr_exp, 1 },
+  { "log", expr_log, 1 },
+  { "log10", expr_log10, 1 },
+  { "sin", expr_sin, 1 },
+  { "cos", expr_cos, 1 },
+  { "tan", expr_tan, 1 },
+  { "floor", expr_floor, 1 },
+  { "ceil", expr_ceil, 1 },
+  { "min", expr_min, 2 },
+  { "max", expr_max, 2 },
+  { "pow", expr_pow, 2 },
+  { "atan2", expr_atan2, 2 }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//binary
+//SSE2 for the arithmetic, a plain loop for the rest
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+static void binary(double *r, const double *a, const double *b, size_t nbr, F fun)
+{
+  for(size_t idx = 0; idx < nbr; idx++)
+  {
+    r[idx] = fun(a[idx], b[idx]);
+  }
+}
+
+template <typename F>
+static void unary(double *r, const double *a, size_t nbr, F fun)
+{
+  for(size_t idx = 0; idx < nbr; idx++)
+  {
+    r[idx] = fun(a[idx]);
+  }
+}
+
+#ifdef EXPR_SSE2
+#define EXPR_SSE2_BINARY(intrinsic) \
+  for(; idx + 2 <= nbr; idx += 2) \
+  { \
+    _mm_storeu_pd(r + idx, intrinsic(_mm_loadu_pd(a + idx), _mm_loadu_pd(b + idx))); \
+  }
+#else
+#define EXPR_SSE2_BINARY(intrinsic)
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//eval_block
+//one node over a block; a and b are the registers of its arguments
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void eval_block(int op, double *r, const double *a, const double *b, size_t nbr)
+{
+  size_t idx = 0;
+  switch(op)
+  {
+  case expr_neg:
+    unary(r, a, nbr, [](double x) { return -x; });
+    break;
+  case expr_add:
+    EXPR_SSE2_BINARY(_mm_add_pd);
+    binary(r + idx, a + idx, b + idx, nbr - idx, [](double x, double y) { return x + y; });
+    break;
+  case expr_sub:
+    EXPR_SSE2_BINARY(_mm_sub_pd);
+    binary(r + idx, a + idx, b + idx, nbr - idx, [](double x, double y) { return x - y; });
+    break;
+  case expr_mul:
+    EXPR_SSE2_BINARY(_mm_mul_pd);
+    binary(r + idx, a + idx, b + idx, nbr - idx, [](double x, double y) { return x * y; });
+    break;
+  case expr_div:
+    EXPR_SSE2_BINARY(_mm_div_pd);
+    binary(r + idx, a + idx, b + idx, nbr - idx, [](double x, double y) { return x / y; });
+    break;
+  case expr_min:
+    binary(r, a, b, nbr, [](double x, double y) { return std::min(x, y); });
+    break;
+  case expr_max:
+    binary(r, a, b, nbr, [](double x, double y) { return std::max(x, y); });
+    break;
+  case expr_pow:
+    binary(r, a, b, nbr, [](double x, double y) { return std::pow(x, y); });
+    break;
+  case expr_atan2:
+    binary(r, a, b, nbr, [](double x, double y) { return std::atan2(x, y); });
+    break;
+  case expr_lt:
+    binary(r, a, b, nbr, [](double x, double y) { return (double)(x < y); });
+    break;
+  case expr_gt:
+    binary(r, a, b, nbr, [](double x, double y) { return (double)(x > y); });
+    break;
+  case expr_le:
+    binary(r, a, b, nbr, [](double x, double y) { return (double)(x <= y); });
+    break;
+  case expr_ge:
+    binary(r, a, b, nbr, [](double x, double y) { return (double)(x >= y); });
+    break;
+  case expr_eq:
+    binary(r, a, b, nbr, [](double x, double y) { return (double)(x == y); });
+    break;
+  case expr_ne:
+    binary(r, a, b, nbr, [](double x, double y) { return (double)(x != y); });
+    break;
+  case expr_sqrt:
+#ifdef EXPR_SSE2
+    for(; idx + 2 <= nbr; idx += 2)
+    {
+      _mm_storeu_pd(r + idx, _mm_sqrt_pd(_mm_loadu_pd(a + idx)));
+    }
+#endif
+    unary(r + idx, a + idx, nbr - idx, [](double x) { return std::sqrt(x); });
+    break;
+  case expr_abs:
+    unary(r, a, nbr, [](double x) { return std::fabs(x); });
+    break;
+  case expr_exp:
+    unary(r, a, nbr, [](double x) { return std::exp(x); });
+    break;
+  case expr_log:
+    unary(r, a, nbr, [](double x) { return std::log(x); });
+    break;
+  case expr_log10:
+    unary(r, a, nbr, [](double x) { return std::log10(x); });
+    break;
+  case expr_sin:
+    unary(r, a, nbr, [](double x) { return std::sin(x); });
+    break;
+  case expr_cos:
+    unary(r, a, nbr, [](double x) { return std::cos(x); });
+    break;
+  case expr_tan:
+    unary(r, a, nbr, [](double x) { return std::tan(x); });
+    break;
+  case expr_floor:
+    unary(r, a, nbr, [](double x) { return std::floor(x); });
+    break;
+  case expr_ceil:
+    unary(r, a, nbr, [](double x) { return std::ceil(x); });
+    break;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t
+//recursive descent; precedence from low to high: comparison, + -, * /, unary -, ^
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class expr_parser_t
+{
+public:
+  expr_parser_t(expr_t *expr) :
+    m_expr(expr),
+    m_ptr(expr->m_text.c_str())
+  {
+  }
+  int parse_comparison();
+  void skip_space()
+  {
+    while(isspace((unsigned char)*m_ptr))
+    {
+      m_ptr++;
+    }
+  }
+  bool accept(const char *token)
+  {
+    skip_space();
+    size_t len = strlen(token);
+    if(strncmp(m_ptr, token, len) != 0)
+    {
+      return false;
+    }
+    m_ptr += len;
+    return true;
+  }
+  expr_t *m_expr;
+  const char *m_ptr;
+  std::string m_error;
+
+private:
+  int parse_sum();
+  int parse_product();
+  int parse_unary();
+  int parse_power();
+  int parse_primary();
+  int add_node(int op, int lhs, int rhs);
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::add_node
+//operations of constants are evaluated now
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::add_node(int op, int lhs, int rhs)
+{
+  if(lhs < 0 || (rhs < 0 && op >= expr_add && op <= expr_ne) || (rhs < 0 && op >= expr_min))
+  {
+    return -1;
+  }
+  std::vector<expr_node_t> &node = m_expr->m_node;
+  expr_node_t nod;
+  nod.m_op = op;
+  nod.m_lhs = lhs;
+  nod.m_rhs = rhs;
+  nod.m_value = 0;
+  nod.m_var = -1;
+  if(node[lhs].m_op == expr_const && (rhs < 0 || node[rhs].m_op == expr_const))
+  {
+    double a = node[lhs].m_value;
+    double b = rhs < 0 ? 0 : node[rhs].m_value;
+    eval_block(op, &nod.m_value, &a, &b, 1);
+    nod.m_op = expr_const;
+    nod.m_lhs = -1;
+    nod.m_rhs = -1;
+  }
+  node.push_back(nod);
+  return (int)node.size() - 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::parse_comparison
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::parse_comparison()
+{
+  static const char *token[] = { "<=", ">=", "==", "!=", "<", ">" };
+  static const int op[] = { expr_le, expr_ge, expr_eq, expr_ne, expr_lt, expr_gt };
+  int lhs = parse_sum();
+  for(int idx = 0; idx < 6 && lhs >= 0; idx++)
+  {
+    if(accept(token[idx]))
+    {
+      return add_node(op[idx], lhs, parse_sum());
+    }
+  }
+  return lhs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::parse_sum
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::parse_sum()
+{
+  int lhs = parse_product();
+  while(lhs >= 0)
+  {
+    if(accept("+"))
+    {
+      lhs = add_node(expr_add, lhs, parse_product());
+    }
+    else if(accept("-"))
+    {
+      lhs = add_node(expr_sub, lhs, parse_product());
+    }
+    else
+    {
+      break;
+    }
+  }
+  return lhs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::parse_product
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::parse_product()
+{
+  int lhs = parse_unary();
+  while(lhs >= 0)
+  {
+    if(accept("*"))
+    {
+      lhs = add_node(expr_mul, lhs, parse_unary());
+    }
+    else if(accept("/"))
+    {
+      lhs = add_node(expr_div, lhs, parse_unary());
+    }
+    else
+    {
+      break;
+    }
+  }
+  return lhs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::parse_unary
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::parse_unary()
+{
+  if(accept("-"))
+  {
+    return add_node(expr_neg, parse_unary(), -1);
+  }
+  if(accept("+"))
+  {
+    return parse_unary();
+  }
+  return parse_power();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::parse_power
+//right associative: a^b^c is a^(b^c)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::parse_power()
+{
+  int lhs = parse_primary();
+  if(lhs >= 0 && accept("^"))
+  {
+    return add_node(expr_pow, lhs, parse_unary());
+  }
+  return lhs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_parser_t::parse_primary
+//number, variable, function call, parenthesis
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_parser_t::parse_primary()
+{
+  std::vector<expr_node_t> &node = m_expr->m_node;
+  skip_space();
+  if(accept("("))
+  {
+    int idx = parse_comparison();
+    if(idx >= 0 && !accept(")"))
+    {
+      m_error = "missing )";
+      return -1;
+    }
+    return idx;
+  }
+
+  //number
+  if(isdigit((unsigned char)*m_ptr) || *m_ptr == '.')
+  {
+    char *end;
+    expr_node_t nod;
+    nod.m_op = expr_const;
+    nod.m_lhs = -1;
+    nod.m_rhs = -1;
+    nod.m_value = strtod(m_ptr, &end);
+    nod.m_var = -1;
+    if(end == m_ptr)
+    {
+      m_error = std::string("bad number at ") + m_ptr;
+      return -1;
+    }
+    m_ptr = end;
+    node.push_back(nod);
+    return (int)node.size() - 1;
+  }
+
+  //name
+  const char *first = m_ptr;
+  while(isalnum((unsigned char)*m_ptr) || *m_ptr == '_' || *m_ptr == '.')
+  {
+    m_ptr++;
+  }
+  if(first == m_ptr)
+  {
+    m_error = *m_ptr ? std::string("unexpected ") + m_ptr : std::string("unexpected end");
+    return -1;
+  }
+  std::string name(first, m_ptr);
+
+  //function
+  if(accept("("))
+  {
+    for(size_t idx_fun = 0; idx_fun < sizeof(expr_function) / sizeof(expr_function[0]); idx_fun++)
+    {
+      if(name != expr_function[idx_fun].m_name)
+      {
+        continue;
+      }
+      int lhs = parse_comparison();
+      int rhs = -1;
+      if(lhs >= 0 && expr_function[idx_fun].m_nbr_arg == 2)
+      {
+        if(!accept(","))
+        {
+          m_error = name + " takes two arguments";
+          return -1;
+        }
+        rhs = parse_comparison();
+      }
+      if(lhs >= 0 && !accept(")"))
+      {
+        m_error = "missing ) after the arguments of " + name;
+        return -1;
+      }
+      return add_node(expr_function[idx_fun].m_op, lhs, rhs);
+    }
+    m_error = "unknown function " + name;
+    return -1;
+  }
+
+  //variable, one node per variable
+  for(size_t idx = 0; idx < node.size(); idx++)
+  {
+    if(node[idx].m_op == expr_var && m_expr->m_var_nm[node[idx].m_var] == name)
+    {
+      return (int)idx;
+    }
+  }
+  expr_node_t nod;
+  nod.m_op = expr_var;
+  nod.m_lhs = -1;
+  nod.m_rhs = -1;
+  nod.m_value = 0;
+  nod.m_var = (int)m_expr->m_var_nm.size();
+  m_expr->m_var_nm.push_back(name);
+  node.push_back(nod);
+  return (int)node.size() - 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_t::parse
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_t::parse(const std::string &text, std::string *error)
+{
+  m_text = text;
+  m_node.clear();
+  m_var_nm.clear();
+  expr_parser_t parser(this);
+  int idx = parser.parse_comparison();
+  parser.skip_space();
+  if(idx >= 0 && *parser.m_ptr != '\0')
+  {
+    parser.m_error = std::string("unexpected ") + parser.m_ptr;
+    idx = -1;
+  }
+  if(idx < 0)
+  {
+    *error = parser.m_error.empty() ? std::string("syntax error") : parser.m_error;
+    return NC2_ERR;
+  }
+
+  //the result is the last node
+  if(idx != (int)m_node.size() - 1)
+  {
+    expr_node_t nod = m_node[idx];
+    m_node.push_back(nod);
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_t::bind
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int expr_t::bind(const std::vector<expr_operand_t> &operands, std::string *error)
+{
+  if(operands.size() != m_var_nm.size() || operands.empty())
+  {
+    *error = "the expression has no variable";
+    return NC2_ERR;
+  }
+  m_operand = operands;
+  m_base = 0;
+  for(size_t idx_opr = 0; idx_opr < operands.size(); idx_opr++)
+  {
+    if(!diff_type(operands[idx_opr].m_source->type()))
+    {
+      *error = m_var_nm[idx_opr] + " is not numeric";
+      return NC2_ERR;
+    }
+    if(operands[idx_opr].m_dim_nm.size() > operands[m_base].m_dim_nm.size())
+    {
+      m_base = idx_opr;
+    }
+  }
+  m_dim = operands[m_base].m_source->dim();
+  m_dim_nm = operands[m_base].m_dim_nm;
+
+  //every operand has some of the result dimensions, in the same order, of the same size
+  m_map.assign(operands.size(), std::vector<size_t>());
+  for(size_t idx_opr = 0; idx_opr < operands.size(); idx_opr++)
+  {
+    const std::vector<size_t> &dim = operands[idx_opr].m_source->dim();
+    const std::vector<std::string> &dim_nm = operands[idx_opr].m_dim_nm;
+    size_t idx_res = 0;
+    for(size_t idx_dmn = 0; idx_dmn < dim_nm.size(); idx_dmn++)
+    {
+      while(idx_res < m_dim_nm.size() && m_dim_nm[idx_res] != dim_nm[idx_dmn])
+      {
+        idx_res++;
+      }
+      if(idx_res == m_dim_nm.size() || m_dim[idx_res] != dim[idx_dmn])
+      {
+        *error = "dimension " + dim_nm[idx_dmn] + " of " + m_var_nm[idx_opr] + " is not a dimension of "
+          + m_var_nm[m_base] + " of the same size and order";
+        return NC2_ERR;
+      }
+      m_map[idx_opr].push_back(idx_res++);
+    }
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_slab_source_t::key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string expr_slab_source_t::key() const
+{
+  std::string key = "expr\n" + m_expr->m_text;
+  for(size_t idx_opr = 0; idx_opr < m_expr->m_operand.size(); idx_opr++)
+  {
+    key += '\n' + m_expr->m_operand[idx_opr].m_source->key();
+  }
+  return key;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//gather
+//cells first to first + nbr of the result slab from an operand slab; stride is, per result dimension,
+//the stride of the operand slab, 0 for the dimensions it is broadcast over
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void gather(const double *src, const std::vector<size_t> &stride, const std::vector<size_t> &count,
+  size_t first, size_t nbr, double *dst)
+{
+  size_t nbr_dmn = count.size();
+  if(nbr_dmn == 0)
+  {
+    std::fill(dst, dst + nbr, src[0]);
+    return;
+  }
+  std::vector<size_t> idx(nbr_dmn);
+  size_t off = 0;
+  size_t rem = first;
+  for(size_t idx_dmn = nbr_dmn; idx_dmn-- > 0;)
+  {
+    idx[idx_dmn] = rem % count[idx_dmn];
+    rem /= count[idx_dmn];
+    off += idx[idx_dmn] * stride[idx_dmn];
+  }
+
+  //by runs of the last dimension: a copy, or a value repeated
+  size_t last = nbr_dmn - 1;
+  size_t done = 0;
+  while(done < nbr)
+  {
+    size_t run = std::min(count[last] - idx[last], nbr - done);
+    if(stride[last] != 0)
+    {
+      memcpy(dst + done, src + off, run * sizeof(double));
+    }
+    else
+    {
+      std::fill(dst + done, dst + done + run, src[off]);
+    }
+    done += run;
+    idx[last] += run;
+    off += run * stride[last];
+    for(size_t idx_dmn = last; idx[idx_dmn] == count[idx_dmn] && idx_dmn > 0; idx_dmn--)
+    {
+      off -= idx[idx_dmn] * stride[idx_dmn];
+      idx[idx_dmn] = 0;
+      idx[idx_dmn - 1]++;
+      off += stride[idx_dmn - 1];
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_slab_source_t::read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t expr_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  trace_t trace("expr_slab_source_t::read", m_expr->m_text.c_str());
+  const expr_t &expr = *m_expr;
+  size_t nbr_dmn = count.size();
+  size_t nbr = 1;
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    nbr *= count[idx_dmn];
+  }
+
+  //the slab of each operand, in double, and its strides in the result slab
+  size_t nbr_opr = expr.m_operand.size();
+  std::vector<std::vector<double> > val(nbr_opr);
+  std::vector<std::vector<size_t> > stride(nbr_opr, std::vector<size_t>(nbr_dmn, 0));
+  for(size_t idx_opr = 0; idx_opr < nbr_opr; idx_opr++)
+  {
+    const std::vector<size_t> &map = expr.m_map[idx_opr];
+    slab_source_t *source = expr.m_operand[idx_opr].m_source.get();
+    std::vector<size_t> start_opr(map.size());
+    std::vector<size_t> count_opr(map.size());
+    size_t nbr_opr_cells = 1;
+    for(size_t idx_dmn = 0; idx_dmn < map.size(); idx_dmn++)
+    {
+      start_opr[idx_dmn] = start[map[idx_dmn]];
+      count_opr[idx_dmn] = count[map[idx_dmn]];
+      nbr_opr_cells *= count_opr[idx_dmn];
+    }
+    buffer_t buf = source->read(start_opr, count_opr);
+    if(buf.size() != nbr_opr_cells * get_type_size(source->type()))
+    {
+      return buffer_t();
+    }
+    val[idx_opr].resize(nbr_opr_cells);
+    diff_to_double(buf.data(), source->type(), nbr_opr_cells, &val[idx_opr][0]);
+    size_t str = 1;
+    for(size_t idx_dmn = map.size(); idx_dmn-- > 0;)
+    {
+      stride[idx_opr][map[idx_dmn]] = str;
+      str *= count_opr[idx_dmn];
+    }
+  }
+
+  //one register of a block per node; constants are filled once
+  size_t nbr_node = expr.m_node.size();
+  std::vector<double> reg(nbr_node * expr_block_cells);
+  for(size_t idx_node = 0; idx_node < nbr_node; idx_node++)
+  {
+    if(expr.m_node[idx_node].m_op == expr_const)
+    {
+      std::fill(&reg[idx_node * expr_block_cells], &reg[idx_node * expr_block_cells] + expr_block_cells, expr.m_node[idx_node].m_value);
+    }
+  }
+
+  buffer_t buf(nbr * sizeof(double));
+  if(buf.empty())
+  {
+    return buf;
+  }
+  for(size_t first = 0; first < nbr; first += expr_block_cells)
+  {
+    size_t nbr_blk = std::min(expr_block_cells, nbr - first);
+    for(size_t idx_node = 0; idx_node < nbr_node; idx_node++)
+    {
+      const expr_node_t &node = expr.m_node[idx_node];
+      double *r = &reg[idx_node * expr_block_cells];
+      if(node.m_op == expr_const)
+      {
+        continue;
+      }
+      if(node.m_op == expr_var)
+      {
+        gather(&val[node.m_var][0], stride[node.m_var], count, first, nbr_blk, r);
+        continue;
+      }
+      const double *a = &reg[node.m_lhs * expr_block_cells];
+      const double *b = node.m_rhs < 0 ? a : &reg[node.m_rhs * expr_block_cells];
+      eval_block(node.m_op, r, a, b, nbr_blk);
+    }
+    memcpy(buf.as<double>() + first, &reg[(nbr_node - 1) * expr_block_cells], nbr_blk * sizeof(double));
+  }
+  return buf;
+}
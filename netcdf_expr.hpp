@@ -0,0 +1,125 @@
+#ifndef NETCDF_EXPR_H
+#define NETCDF_EXPR_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_io.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//derived variables
+//an expression of variables such as sqrt(u*u + v*v) or (t - 273.15) * mask, evaluated per slab:
+//each slab reads the slabs of its operands, then runs the compiled expression over blocks of cells
+//operands are broadcast by dimension name: the result has the dimensions of the operand with the most
+//dimensions, and the dimensions of every other operand are some of these, in the same order
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum expr_op_t
+{
+  expr_const,
+  expr_var,
+  expr_neg,
+  expr_add,
+  expr_sub,
+  expr_mul,
+  expr_div,
+  expr_pow,
+  expr_lt,
+  expr_gt,
+  expr_le,
+  expr_ge,
+  expr_eq,
+  expr_ne,
+  expr_sqrt,
+  expr_abs,
+  expr_exp,
+  expr_log,
+  expr_log10,
+  expr_sin,
+  expr_cos,
+  expr_tan,
+  expr_floor,
+  expr_ceil,
+  expr_min,
+  expr_max,
+  expr_atan2
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_node_t
+//one operation; its result is a block register, the node index
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class expr_node_t
+{
+public:
+  int m_op; // expr_op_t
+  int m_lhs; // node of the first argument, -1 if none
+  int m_rhs; // node of the second argument, -1 if none
+  double m_value; // (expr_const) value
+  int m_var; // (expr_var) operand index
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_operand_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class expr_operand_t
+{
+public:
+  std::shared_ptr<slab_source_t> m_source;
+  std::vector<std::string> m_dim_nm; // dimension names, parallel to m_source->dim()
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_t
+//parse() compiles the text into nodes, arguments before the node, the result last; a variable used
+//twice is one node; operations of constants are folded
+//bind() takes the operands of m_var_nm, in order, and finds the dimensions of the result
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class expr_t
+{
+public:
+  int parse(const std::string &text, std::string *error);
+  int bind(const std::vector<expr_operand_t> &operands, std::string *error);
+  std::string m_text;
+  std::vector<expr_node_t> m_node;
+  std::vector<std::string> m_var_nm; // variable names, by operand index
+  std::vector<expr_operand_t> m_operand; // bound operands
+  std::vector<size_t> m_dim; // dimensions of the result
+  std::vector<std::string> m_dim_nm; // dimension names of the result
+  std::vector<std::vector<size_t> > m_map; // per operand, the result dimension of each of its dimensions
+  size_t m_base; // operand whose dimensions are the result dimensions
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//expr_slab_source_t
+//NC_DOUBLE slabs of a bound expression
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class expr_slab_source_t : public slab_source_t
+{
+public:
+  expr_slab_source_t(const std::shared_ptr<const expr_t> &expr) :
+    m_expr(expr)
+  {
+  }
+  nc_type type() const
+  {
+    return NC_DOUBLE;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_expr->m_dim;
+  }
+  std::string key() const;
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+
+private:
+  std::shared_ptr<const expr_t> m_expr;
+};
+
+#endif
@@ -0,0 +1,323 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include "netcdf_explorer.hpp"
+#include "netcdf_index.hpp"
+#include "netcdf_meta.hpp"
+#include "netcdf_trace.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//to_lower
+//ASCII only; names in netCDF files are almost always ASCII
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned char to_lower(unsigned char chr)
+{
+  return (chr >= 'A' && chr <= 'Z') ? chr + ('a' - 'A') : chr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_trigrams
+//sorted unique trigrams of a string, lower case
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void get_trigrams(const char *str, std::vector<unsigned int> &tri)
+{
+  tri.clear();
+  size_t len = strlen(str);
+  for(size_t idx = 0; idx + 3 <= len; idx++)
+  {
+    tri.push_back((to_lower(str[idx]) << 16) | (to_lower(str[idx + 1]) << 8) | to_lower(str[idx + 2]));
+  }
+  std::sort(tri.begin(), tri.end());
+  tri.erase(std::unique(tri.begin(), tri.end()), tri.end());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//contains
+//case insensitive substring; needle is lower case
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool contains(const char *hay, const std::string &needle)
+{
+  size_t len = needle.size();
+  for(; *hay; hay++)
+  {
+    size_t idx = 0;
+    while(idx < len && hay[idx] && to_lower(hay[idx]) == (unsigned char)needle[idx])
+    {
+      idx++;
+    }
+    if(idx == len)
+    {
+      return true;
+    }
+  }
+  return len == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//index_query_t::index_query_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+index_query_t::index_query_t(const std::string &str) :
+  m_fields(index_all),
+  m_exact(false)
+{
+  static const char *prefix[] = { "var:", "dim:", "att:", "val:" };
+  static const int field[] = { index_variable, index_dimension, index_attribute, index_value };
+
+  size_t first = str.find_first_not_of(" \t");
+  size_t last = str.find_last_not_of(" \t");
+  m_text = first == std::string::npos ? std::string() : str.substr(first, last - first + 1);
+
+  for(int idx = 0; idx < 4; idx++)
+  {
+    if(m_text.compare(0, 4, prefix[idx]) == 0)
+    {
+      m_fields = field[idx];
+      m_text.erase(0, 4);
+      break;
+    }
+  }
+
+  size_t pos = m_text.find('=');
+  if(m_fields == index_all && pos != std::string::npos && pos > 0)
+  {
+    m_key = m_text.substr(0, pos);
+    m_text.erase(0, pos + 1);
+    m_fields = index_value;
+    m_exact = true;
+    return;
+  }
+
+  for(size_t idx = 0; idx < m_text.size(); idx++)
+  {
+    m_text[idx] = to_lower(m_text[idx]);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_index_t::build
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void meta_index_t::build(const meta_store_t &store)
+{
+  trace_t trace("meta_index_t::build", store.m_file_name.c_str());
+  std::vector<std::pair<unsigned int, index_entry_t> > entry;
+  for(unsigned int idx = 0; idx < store.size(); idx++)
+  {
+    const meta_item_t &item = store.item(idx);
+    index_entry_t ent;
+    ent.m_item = idx;
+    if(item.m_kind == ItemData::Variable)
+    {
+      ent.m_field = index_variable;
+      entry.push_back(std::make_pair(item.m_name, ent));
+      ent.m_field = index_dimension;
+      for(unsigned int idx_dmn = 0; idx_dmn < item.m_nbr_dim; idx_dmn++)
+      {
+        unsigned int dim_nm = store.m_dim_nm[item.m_dim + idx_dmn];
+        if(dim_nm != meta_none)
+        {
+          entry.push_back(std::make_pair(dim_nm, ent));
+        }
+      }
+    }
+    else if(item.m_kind == ItemData::Attribute)
+    {
+      ent.m_field = index_attribute;
+      entry.push_back(std::make_pair(item.m_name, ent));
+    }
+  }
+  for(size_t idx = 0; idx < store.m_value.size(); idx++)
+  {
+    index_entry_t ent;
+    ent.m_item = store.m_value[idx].first;
+    ent.m_field = index_value;
+    entry.push_back(std::make_pair(store.m_value[idx].second, ent));
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //entries by string ID, a counting sort
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  size_t nbr_str = store.m_str.size();
+  m_str_first.assign(nbr_str + 1, 0);
+  for(size_t idx = 0; idx < entry.size(); idx++)
+  {
+    m_str_first[entry[idx].first + 1]++;
+  }
+  for(size_t idx = 0; idx < nbr_str; idx++)
+  {
+    m_str_first[idx + 1] += m_str_first[idx];
+  }
+  m_entry.resize(entry.size());
+  std::vector<unsigned int> pos(m_str_first.begin(), m_str_first.end() - 1);
+  for(size_t idx = 0; idx < entry.size(); idx++)
+  {
+    m_entry[pos[entry[idx].first]++] = entry[idx].second;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //trigrams of the strings that have entries
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  std::vector<std::pair<unsigned int, unsigned int> > tri_str;
+  std::vector<unsigned int> tri;
+  m_lower.clear();
+  m_lower_off.clear();
+  m_lower_id.clear();
+  for(unsigned int id = 0; id < nbr_str; id++)
+  {
+    if(m_str_first[id + 1] == m_str_first[id])
+    {
+      continue;
+    }
+    const char *str = store.m_str.at(id);
+    m_lower_off.push_back((unsigned int)m_lower.size());
+    m_lower_id.push_back(id);
+    for(; *str; str++)
+    {
+      m_lower.push_back(to_lower(*str));
+    }
+    m_lower.push_back('\0');
+    get_trigrams(store.m_str.at(id), tri);
+    for(size_t idx = 0; idx < tri.size(); idx++)
+    {
+      tri_str.push_back(std::make_pair(tri[idx], id));
+    }
+  }
+  std::sort(tri_str.begin(), tri_str.end());
+
+  m_tri.clear();
+  m_tri_first.clear();
+  m_tri_str.resize(tri_str.size());
+  for(size_t idx = 0; idx < tri_str.size(); idx++)
+  {
+    if(m_tri.empty() || m_tri.back() != tri_str[idx].first)
+    {
+      m_tri.push_back(tri_str[idx].first);
+      m_tri_first.push_back((unsigned int)idx);
+    }
+    m_tri_str[idx] = tri_str[idx].second;
+  }
+  m_tri_first.push_back((unsigned int)tri_str.size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_index_t::match_string
+//the entries of a matching string
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void meta_index_t::match_string(unsigned int id, const index_query_t &qry, unsigned int key, const meta_store_t &store,
+  std::vector<unsigned int> &items) const
+{
+  for(unsigned int idx = m_str_first[id]; idx < m_str_first[id + 1]; idx++)
+  {
+    const index_entry_t &ent = m_entry[idx];
+    if(!(ent.m_field & qry.m_fields))
+    {
+      continue;
+    }
+    if(key != meta_none && store.item(ent.m_item).m_name != key)
+    {
+      continue;
+    }
+    items.push_back(ent.m_item);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_index_t::query
+//items matching a query; an item may be listed more than once
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void meta_index_t::query(const meta_store_t &store, const index_query_t &qry, std::vector<unsigned int> &items) const
+{
+  if(m_str_first.empty())
+  {
+    return;
+  }
+
+  //name=value: both are looked up in the string pool
+  if(qry.m_exact)
+  {
+    unsigned int key = store.m_str.find(qry.m_key.c_str());
+    unsigned int id = store.m_str.find(qry.m_text.c_str());
+    if(key != meta_none && id != meta_none)
+    {
+      match_string(id, qry, key, store, items);
+    }
+    return;
+  }
+
+  //short text: memchr of its first character in the lower case copies
+  std::vector<unsigned int> tri;
+  get_trigrams(qry.m_text.c_str(), tri);
+  if(tri.empty())
+  {
+    if(qry.m_text.empty() || m_lower.empty())
+    {
+      return;
+    }
+    const char *first = &m_lower[0];
+    const char *last = first + m_lower.size();
+    const char *ptr = first;
+    while((ptr = static_cast<const char*> (memchr(ptr, qry.m_text[0], last - ptr))) != NULL)
+    {
+      if(strncmp(ptr, qry.m_text.c_str(), qry.m_text.size()) != 0)
+      {
+        ptr++;
+        continue;
+      }
+      size_t idx = std::upper_bound(m_lower_off.begin(), m_lower_off.end(), (unsigned int)(ptr - first)) - m_lower_off.begin() - 1;
+      match_string(m_lower_id[idx], qry, meta_none, store, items);
+
+      //next string
+      ptr = idx + 1 < m_lower_off.size() ? first + m_lower_off[idx + 1] : last;
+    }
+    return;
+  }
+
+  //the strings of the rarest trigram of the text are the candidates
+  size_t idx_rare = 0;
+  size_t nbr_rare = (size_t)-1;
+  for(size_t idx = 0; idx < tri.size(); idx++)
+  {
+    std::vector<unsigned int>::const_iterator it = std::lower_bound(m_tri.begin(), m_tri.end(), tri[idx]);
+    if(it == m_tri.end() || *it != tri[idx])
+    {
+      return;
+    }
+    size_t idx_tri = it - m_tri.begin();
+    size_t nbr = m_tri_first[idx_tri + 1] - m_tri_first[idx_tri];
+    if(nbr < nbr_rare)
+    {
+      nbr_rare = nbr;
+      idx_rare = idx_tri;
+    }
+  }
+  for(unsigned int idx = m_tri_first[idx_rare]; idx < m_tri_first[idx_rare + 1]; idx++)
+  {
+    unsigned int id = m_tri_str[idx];
+    if(contains(store.m_str.at(id), qry.m_text))
+    {
+      match_string(id, qry, meta_none, store, items);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_index_t::bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t meta_index_t::bytes() const
+{
+  return (m_str_first.capacity() + m_tri.capacity() + m_tri_first.capacity() + m_tri_str.capacity()
+    + m_lower_off.capacity() + m_lower_id.capacity()) * sizeof(unsigned int)
+    + m_entry.capacity() * sizeof(index_entry_t) + m_lower.capacity();
+}
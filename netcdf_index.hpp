@@ -0,0 +1,78 @@
+#ifndef NETCDF_INDEX_H
+#define NETCDF_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class meta_store_t;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//metadata index
+//built at the end of the metadata scan of a file: the variable names, dimension names, attribute names
+//and attribute values of the store, by interned string, and a trigram index of these strings for
+//case insensitive substring search
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum index_field_t
+{
+  index_variable = 1, // variable names
+  index_dimension = 2, // dimension names of variables
+  index_attribute = 4, // attribute names
+  index_value = 8, // attribute values
+  index_all = 15
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//index_query_t
+//text: substring of any name or value
+//var:text, dim:text, att:text, val:text: substring of one field
+//name=value: attributes named name whose value is value, both exact
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class index_query_t
+{
+public:
+  index_query_t(const std::string &str);
+  std::string m_text;
+  std::string m_key; // attribute name for name=value
+  int m_fields; // index_field_t mask
+  bool m_exact;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_index_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class index_entry_t
+{
+public:
+  unsigned int m_item; // the variable, for variable and dimension names; the attribute, for attribute names and values
+  unsigned int m_field; // index_field_t
+};
+
+class meta_index_t
+{
+public:
+  void build(const meta_store_t &store);
+  void query(const meta_store_t &store, const index_query_t &qry, std::vector<unsigned int> &items) const;
+  size_t size() const
+  {
+    return m_entry.size();
+  }
+  size_t bytes() const;
+
+private:
+  void match_string(unsigned int id, const index_query_t &qry, unsigned int key, const meta_store_t &store,
+    std::vector<unsigned int> &items) const;
+  std::vector<unsigned int> m_str_first; // entries of string ID i are m_entry[m_str_first[i]] to m_entry[m_str_first[i + 1]]
+  std::vector<index_entry_t> m_entry;
+  std::vector<unsigned int> m_tri; // trigrams (3 lower case bytes), sorted
+  std::vector<unsigned int> m_tri_first; // strings of trigram i are m_tri_str[m_tri_first[i]] to m_tri_str[m_tri_first[i + 1]]
+  std::vector<unsigned int> m_tri_str; // string IDs, sorted per trigram
+  std::vector<char> m_lower; // lower case copies of the strings with entries, NUL separated, for texts too short for trigrams
+  std::vector<unsigned int> m_lower_off; // offset of each copy in m_lower
+  std::vector<unsigned int> m_lower_id; // string ID of each copy
+};
+
+#endif
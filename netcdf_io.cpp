@@ -0,0 +1,888 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QCoreApplication>
+#include <QMetaType>
+#include <cstring>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include "netcdf_explorer.hpp"
+#include "netcdf_io.hpp"
+#include "netcdf_trace.hpp"
+
+//files opened by slab sources; used on the I/O thread only
+static std::map<std::string, int> open_files;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//io_open
+//netCDF ID of a file, opened on first use
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int io_open(const std::string &file_name, int *nc_id)
+{
+  std::map<std::string, int>::iterator it = open_files.find(file_name);
+  if(it != open_files.end())
+  {
+    *nc_id = it->second;
+    return NC_NOERR;
+  }
+  if(NC_TRACE("nc_open", file_name.c_str(), 0, nc_open(file_name.c_str(), NC_NOWRITE, nc_id)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  open_files[file_name] = *nc_id;
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//io_close
+//closes a file kept open, so that the next use opens it again and sees records appended since; its
+//slabs in the compressed cache stay, records appended do not change them
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void io_close(const std::string &file_name)
+{
+  chunk_close(file_name);
+  reader_close(file_name);
+  std::map<std::string, int>::iterator it = open_files.find(file_name);
+  if(it == open_files.end())
+  {
+    return;
+  }
+  if(NC_TRACE("nc_close", file_name.c_str(), 0, nc_close(it->second)) != NC_NOERR)
+  {
+
+  }
+  open_files.erase(it);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//io_close_all
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void io_close_all()
+{
+  for(std::map<std::string, int>::iterator it = open_files.begin(); it != open_files.end(); ++it)
+  {
+    if(NC_TRACE("nc_close", NULL, 0, nc_close(it->second)) != NC_NOERR)
+    {
+
+    }
+  }
+  open_files.clear();
+  chunk_close_all();
+  reader_close_all();
+  cache_close_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//slab_source_t::read_strided
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t slab_source_t::read_strided(const std::vector<size_t> &start, const std::vector<size_t> &count,
+  const std::vector<ptrdiff_t> &stride)
+{
+  size_t nbr_dmn = count.size();
+  std::vector<size_t> box(nbr_dmn);
+  size_t nbr_elm = 1;
+  bool unit = true;
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    box[idx_dmn] = count[idx_dmn] ? (count[idx_dmn] - 1) * stride[idx_dmn] + 1 : 0;
+    nbr_elm *= count[idx_dmn];
+    unit = unit && stride[idx_dmn] == 1;
+  }
+  if(unit || nbr_elm == 0)
+  {
+    return read(start, count);
+  }
+  if(type() == NC_STRING)
+  {
+    return buffer_t();
+  }
+  buffer_t src = read(start, box);
+  if(src.empty())
+  {
+    return src;
+  }
+
+  //pick the elements by runs of the last dimension, like copy_slab
+  size_t type_sz = get_type_size(type());
+  buffer_t dst(nbr_elm * type_sz);
+  const char *ptr_src = static_cast<const char*> (src.data());
+  char *ptr_dst = static_cast<char*> (dst.data());
+  std::vector<size_t> idx(nbr_dmn, 0);
+  size_t nbr_run = nbr_elm / count[nbr_dmn - 1];
+  for(size_t idx_run = 0; idx_run < nbr_run; idx_run++)
+  {
+    size_t off = 0;
+    for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      off = off * box[idx_dmn] + idx[idx_dmn] * stride[idx_dmn];
+    }
+    for(size_t idx_elm = 0; idx_elm < count[nbr_dmn - 1]; idx_elm++)
+    {
+      memcpy(ptr_dst, ptr_src + (off + idx_elm * stride[nbr_dmn - 1]) * type_sz, type_sz);
+      ptr_dst += type_sz;
+    }
+    for(size_t idx_dmn = nbr_dmn - 1; idx_dmn-- > 0;)
+    {
+      if(++idx[idx_dmn] < count[idx_dmn])
+      {
+        break;
+      }
+      idx[idx_dmn] = 0;
+    }
+  }
+  return dst;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//nc_slab_source_t::read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t nc_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  return read_strided(start, count, std::vector<ptrdiff_t>(count.size(), 1));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//nc_slab_source_t::read_strided
+//one nc_get_vars call
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t nc_slab_source_t::read_strided(const std::vector<size_t> &start, const std::vector<size_t> &count,
+  const std::vector<ptrdiff_t> &stride)
+{
+  int nc_id;
+  int grp_id;
+  int var_id;
+  //large boxes are read by the reader processes, boxes over several compressed chunks are
+  //decompressed in parallel
+  bool unit = true;
+  size_t bytes = get_type_size(m_nc_type);
+  for(size_t idx_dmn = 0; idx_dmn < stride.size(); idx_dmn++)
+  {
+    unit = unit && stride[idx_dmn] == 1;
+    bytes *= count[idx_dmn];
+  }
+  buffer_t buf;
+  //boxes of less than two parts (tiles) stay in process without asking for the chunks
+  if(unit && reader_processes() > 0 && bytes >= 2 * reader_min_part
+    && reader_read(m_file_name, m_grp_nm_fll, m_var_nm, m_nc_type, start, count, chunking(), &buf) == NC_NOERR)
+  {
+    return buf;
+  }
+  if(unit && chunk_read(m_file_name, m_grp_nm_fll, m_var_nm, m_nc_type, start, count, &buf) == NC_NOERR)
+  {
+    return buf;
+  }
+  if(io_open(m_file_name, &nc_id) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+  if(inq_grp_id(nc_id, m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+  if(NC_TRACE("nc_inq_varid", m_var_nm.c_str(), 0, nc_inq_varid(grp_id, m_var_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+  return load_variable_slab(grp_id, var_id, m_nc_type, start, count, stride);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//nc_slab_source_t::chunking
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<size_t> nc_slab_source_t::chunking()
+{
+  int nc_id;
+  int grp_id;
+  int var_id;
+  int storage;
+  std::vector<size_t> chunk(m_dim.size());
+  if(m_dim.empty() || io_open(m_file_name, &nc_id) != NC_NOERR || inq_grp_id(nc_id, m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+    return std::vector<size_t>();
+  }
+  if(NC_TRACE("nc_inq_varid", m_var_nm.c_str(), 0, nc_inq_varid(grp_id, m_var_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+    return std::vector<size_t>();
+  }
+  if(NC_TRACE("nc_inq_var_chunking", m_var_nm.c_str(), 0, nc_inq_var_chunking(grp_id, var_id, &storage, &chunk[0])) != NC_NOERR
+    || storage != NC_CHUNKED)
+  {
+    return std::vector<size_t>();
+  }
+  return chunk;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//nc_slab_source_t::fill_value
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool nc_slab_source_t::fill_value(double *fill)
+{
+  int nc_id;
+  int grp_id;
+  int var_id;
+  if(io_open(m_file_name, &nc_id) != NC_NOERR || inq_grp_id(nc_id, m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+    return false;
+  }
+  if(NC_TRACE("nc_inq_varid", m_var_nm.c_str(), 0, nc_inq_varid(grp_id, m_var_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+    return false;
+  }
+  return NC_TRACE("nc_get_att_double", "_FillValue", sizeof(double), nc_get_att_double(grp_id, var_id, "_FillValue", fill)) == NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//copy_slab
+//copy the box dst_start/dst_count out of a buffer holding the box src_start/src_count, which contains it
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void copy_slab(void *dst, const std::vector<size_t> &dst_start, const std::vector<size_t> &dst_count,
+  const void *src, const std::vector<size_t> &src_start, const std::vector<size_t> &src_count, size_t type_sz)
+{
+  size_t nbr_dmn = dst_count.size();
+  if(nbr_dmn == 0)
+  {
+    memcpy(dst, src, type_sz);
+    return;
+  }
+
+  //copy by runs of the last dimension
+  size_t run_sz = dst_count[nbr_dmn - 1] * type_sz;
+  size_t nbr_run = 1;
+  for(size_t idx_dmn = 0; idx_dmn + 1 < nbr_dmn; idx_dmn++)
+  {
+    nbr_run *= dst_count[idx_dmn];
+  }
+  if(run_sz == 0)
+  {
+    return;
+  }
+
+  std::vector<size_t> idx(nbr_dmn, 0);
+  for(size_t idx_run = 0; idx_run < nbr_run; idx_run++)
+  {
+    size_t off = 0;
+    for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      off = off * src_count[idx_dmn] + dst_start[idx_dmn] - src_start[idx_dmn] + idx[idx_dmn];
+    }
+    memcpy(static_cast<char*> (dst) + idx_run * run_sz, static_cast<const char*> (src) + off * type_sz, run_sz);
+
+    for(size_t idx_dmn = nbr_dmn - 1; idx_dmn-- > 0;)
+    {
+      if(++idx[idx_dmn] < dst_count[idx_dmn])
+      {
+        break;
+      }
+      idx[idx_dmn] = 0;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_volume
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t get_volume(const std::vector<size_t> &count)
+{
+  size_t vol = 1;
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
+  {
+    vol *= count[idx_dmn];
+  }
+  return vol;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//merge_box
+//union of two boxes, if reading it is not more than reading both; boxes that overlap or touch
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool merge_box(std::vector<size_t> &start, std::vector<size_t> &count,
+  const std::vector<size_t> &start_add, const std::vector<size_t> &count_add)
+{
+  if(start.size() != start_add.size() || start.empty())
+  {
+    return false;
+  }
+  std::vector<size_t> start_uni(start.size());
+  std::vector<size_t> count_uni(start.size());
+  for(size_t idx_dmn = 0; idx_dmn < start.size(); idx_dmn++)
+  {
+    start_uni[idx_dmn] = std::min(start[idx_dmn], start_add[idx_dmn]);
+    count_uni[idx_dmn] = std::max(start[idx_dmn] + count[idx_dmn], start_add[idx_dmn] + count_add[idx_dmn]) - start_uni[idx_dmn];
+  }
+  if(get_volume(count_uni) > get_volume(count) + get_volume(count_add))
+  {
+    return false;
+  }
+  start = start_uni;
+  count = count_uni;
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::instance
+//created and started by the first caller, in the GUI thread
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+IoScheduler* IoScheduler::instance()
+{
+  static IoScheduler *scheduler = NULL;
+  if(scheduler == NULL)
+  {
+    scheduler = new IoScheduler;
+    connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), scheduler, SLOT(stop()));
+    scheduler->start();
+  }
+  return scheduler;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::IoScheduler
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+IoScheduler::IoScheduler() :
+  m_id(0),
+  m_stop(false)
+{
+  qRegisterMetaType<io_request_ptr>("io_request_ptr");
+  connect(this, SIGNAL(request_finished(io_request_ptr)), this, SLOT(deliver(io_request_ptr)), Qt::QueuedConnection);
+  m_timer.start();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::~IoScheduler
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+IoScheduler::~IoScheduler()
+{
+  stop();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::push
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+quint64 IoScheduler::push(const io_request_ptr &req)
+{
+  QMutexLocker locker(&m_mutex);
+  req->m_id = ++m_id;
+  req->m_time_queued = m_timer.nsecsElapsed();
+  if(m_stop)
+  {
+    req->m_cancelled = true;
+    return req->m_id;
+  }
+  req->m_priority = std::max(0, std::min(req->m_priority, (int)io_nbr_priority - 1));
+  m_queue[req->m_priority].push_back(req);
+  size_t depth = 0;
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    depth += m_queue[idx].size();
+  }
+  m_stats.m_depth_max = std::max(m_stats.m_depth_max, depth);
+  m_cond_queue.wakeOne();
+  return req->m_id;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::read_slab
+//stride 1 hyperslab of a source; the buffer is in io_request_t::m_buf when done is called
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+quint64 IoScheduler::read_slab(const std::shared_ptr<slab_source_t> &source, const std::vector<size_t> &start, const std::vector<size_t> &count,
+  int priority, QObject *owner, const std::function<void(io_request_t*)> &done)
+{
+  io_request_ptr req(new io_request_t);
+  req->m_priority = priority;
+  req->m_owner = owner;
+  req->m_owner_key = owner;
+  req->m_source = source;
+  req->m_start = start;
+  req->m_count = count;
+  req->m_done = done;
+  return push(req);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::run_job
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+quint64 IoScheduler::run_job(const std::function<void()> &job, int priority, QObject *owner, const std::function<void(io_request_t*)> &done)
+{
+  io_request_ptr req(new io_request_t);
+  req->m_priority = priority;
+  req->m_owner = owner;
+  req->m_owner_key = owner;
+  req->m_job = job;
+  req->m_done = done;
+  return push(req);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::execute
+//run a job on the I/O thread and wait for it; by default ahead of the queued requests
+//the job does not run if cancelled by stop()
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::execute(const std::function<void()> &job, int priority)
+{
+  //on the I/O thread, or after stop(), there is no other netCDF user
+  if(QThread::currentThread() == this || !isRunning())
+  {
+    job();
+    return;
+  }
+  io_request_ptr req(new io_request_t);
+  req->m_priority = priority;
+  req->m_job = job;
+  push(req);
+  QMutexLocker locker(&m_mutex);
+  while(!req->m_finished && !req->m_cancelled)
+  {
+    m_cond_done.wait(&m_mutex);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::cancel
+//a queued request is removed; a running one is served but not delivered
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::cancel(quint64 id)
+{
+  QMutexLocker locker(&m_mutex);
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    for(std::deque<io_request_ptr>::iterator it = m_queue[idx].begin(); it != m_queue[idx].end(); ++it)
+    {
+      if((*it)->m_id == id)
+      {
+        (*it)->m_cancelled = true;
+        m_queue[idx].erase(it);
+        m_stats.m_nbr_cancelled++;
+        m_cond_done.wakeAll();
+        return;
+      }
+    }
+  }
+  for(size_t idx = 0; idx < m_running.size(); idx++)
+  {
+    if(m_running[idx]->m_id == id)
+    {
+      m_running[idx]->m_cancelled = true;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::cancel_owner
+//cancel the queued requests of an owner, of one priority or all (-1)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::cancel_owner(QObject *owner, int priority)
+{
+  QMutexLocker locker(&m_mutex);
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    if(priority >= 0 && priority != idx)
+    {
+      continue;
+    }
+    std::deque<io_request_ptr> &queue = m_queue[idx];
+    for(std::deque<io_request_ptr>::iterator it = queue.begin(); it != queue.end();)
+    {
+      if((*it)->m_owner_key == owner)
+      {
+        (*it)->m_cancelled = true;
+        it = queue.erase(it);
+        m_stats.m_nbr_cancelled++;
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+  for(size_t idx = 0; idx < m_running.size(); idx++)
+  {
+    if(m_running[idx]->m_owner_key == owner && (priority < 0 || priority == m_running[idx]->m_priority))
+    {
+      m_running[idx]->m_cancelled = true;
+    }
+  }
+  m_cond_done.wakeAll();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::set_priority
+//move a queued request to another priority, e.g. a prefetched tile that became visible
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::set_priority(quint64 id, int priority)
+{
+  priority = std::max(0, std::min(priority, (int)io_nbr_priority - 1));
+  QMutexLocker locker(&m_mutex);
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    for(std::deque<io_request_ptr>::iterator it = m_queue[idx].begin(); it != m_queue[idx].end(); ++it)
+    {
+      if((*it)->m_id == id)
+      {
+        if(idx == priority)
+        {
+          return;
+        }
+        io_request_ptr req = *it;
+        m_queue[idx].erase(it);
+        req->m_priority = priority;
+        m_queue[priority].push_back(req);
+        return;
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::wait_idle
+//wait until all the queued requests are served; their results are delivered by the event loop
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::wait_idle()
+{
+  QMutexLocker locker(&m_mutex);
+  for(;;)
+  {
+    bool idle = m_running.empty();
+    for(int idx = 0; idx < io_nbr_priority; idx++)
+    {
+      idle = idle && m_queue[idx].empty();
+    }
+    if(idle || m_stop)
+    {
+      return;
+    }
+    m_cond_done.wait(&m_mutex);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::stop
+//the queued requests are dropped; the running one is finished
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::stop()
+{
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stop = true;
+    m_cond_queue.wakeAll();
+  }
+  wait();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+io_stats_t IoScheduler::stats()
+{
+  QMutexLocker locker(&m_mutex);
+  io_stats_t sts = m_stats;
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    sts.m_depth[idx] = m_queue[idx].size();
+  }
+  return sts;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::pop
+//called with the mutex locked; takes the first request of the highest priority
+//queued slab reads of the same source whose union with it reads no more than separately are merged into it
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+io_request_ptr IoScheduler::pop(std::vector<io_request_ptr> &merged, std::vector<size_t> &start, std::vector<size_t> &count)
+{
+  io_request_ptr req;
+  merged.clear();
+  for(int idx = 0; idx < io_nbr_priority && req.isNull(); idx++)
+  {
+    if(!m_queue[idx].empty())
+    {
+      req = m_queue[idx].front();
+      m_queue[idx].pop_front();
+    }
+  }
+  if(req.isNull())
+  {
+    return req;
+  }
+
+  start = req->m_start;
+  count = req->m_count;
+
+  //NC_STRING slabs are arenas, not arrays, and are not merged; nor are slabs held compressed, served
+  //by their box
+  if(req->m_source && req->m_source->type() != NC_STRING && !cache_has(cache_key(req->m_source->key(), start, count)))
+  {
+    std::string key = req->m_source->key();
+    for(int idx = 0; idx < io_nbr_priority; idx++)
+    {
+      std::deque<io_request_ptr> &queue = m_queue[idx];
+      for(std::deque<io_request_ptr>::iterator it = queue.begin(); it != queue.end();)
+      {
+        if((*it)->m_source && (*it)->m_source->key() == key && !cache_has(cache_key(key, (*it)->m_start, (*it)->m_count)) &&
+          merge_box(start, count, (*it)->m_start, (*it)->m_count))
+        {
+          merged.push_back(*it);
+          it = queue.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+  }
+  m_running = merged;
+  m_running.push_back(req);
+  return req;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::serve
+//called with the mutex unlocked
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::serve(const io_request_ptr &req, std::vector<io_request_ptr> &merged, const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  if(req->m_job)
+  {
+    trace_t trace("io_job");
+    req->m_job();
+    return;
+  }
+
+  trace_t trace("io_slab", NULL, 0);
+  if(merged.empty() && req->m_source->type() != NC_STRING &&
+    cache_get(cache_key(req->m_source->key(), start, count), &req->m_buf))
+  {
+    return;
+  }
+  buffer_t buf = req->m_source->read(start, count);
+  if(merged.empty() && start == req->m_start && count == req->m_count)
+  {
+    req->m_buf = std::move(buf);
+    return;
+  }
+
+  //merged read: each request gets its box; all stay empty if the read failed
+  size_t type_sz = get_type_size(req->m_source->type());
+  merged.push_back(req);
+  for(size_t idx = 0; idx < merged.size() && !buf.empty(); idx++)
+  {
+    io_request_t *req_mrg = merged[idx].data();
+    req_mrg->m_buf = buffer_t(get_volume(req_mrg->m_count) * type_sz);
+    if(!req_mrg->m_buf.empty())
+    {
+      copy_slab(req_mrg->m_buf.data(), req_mrg->m_start, req_mrg->m_count, buf.data(), start, count, type_sz);
+    }
+  }
+  merged.pop_back();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::run
+//the I/O thread
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::run()
+{
+  std::vector<io_request_ptr> merged;
+  std::vector<size_t> start;
+  std::vector<size_t> count;
+  for(;;)
+  {
+    io_request_ptr req;
+    {
+      QMutexLocker locker(&m_mutex);
+      for(;;)
+      {
+        if(m_stop)
+        {
+          break;
+        }
+        req = pop(merged, start, count);
+        if(!req.isNull())
+        {
+          break;
+        }
+        m_cond_queue.wait(&m_mutex);
+      }
+      if(m_stop)
+      {
+        break;
+      }
+
+      //wait times, at the priority each request was queued with
+      qint64 now = m_timer.nsecsElapsed();
+      merged.push_back(req);
+      for(size_t idx = 0; idx < merged.size(); idx++)
+      {
+        int prt = merged[idx]->m_priority;
+        qint64 wait = now - merged[idx]->m_time_queued;
+        m_stats.m_nbr_wait[prt]++;
+        m_stats.m_wait_ns[prt] += wait;
+        m_stats.m_wait_ns_max[prt] = std::max(m_stats.m_wait_ns_max[prt], wait);
+      }
+      merged.pop_back();
+      m_stats.m_nbr_merged += merged.size();
+    }
+
+    serve(req, merged, start, count);
+
+    merged.push_back(req);
+    {
+      QMutexLocker locker(&m_mutex);
+      for(size_t idx = 0; idx < merged.size(); idx++)
+      {
+        merged[idx]->m_finished = true;
+      }
+      m_stats.m_nbr_done += merged.size();
+      m_running.clear();
+      m_cond_done.wakeAll();
+    }
+    for(size_t idx = 0; idx < merged.size(); idx++)
+    {
+      if(merged[idx]->m_done)
+      {
+        emit request_finished(merged[idx]);
+      }
+    }
+    merged.clear();
+  }
+
+  io_close_all();
+  remote_close_all();
+
+  //requests still queued are dropped; wake anyone in execute() or wait_idle()
+  QMutexLocker locker(&m_mutex);
+  for(int idx = 0; idx < io_nbr_priority; idx++)
+  {
+    for(size_t idx_req = 0; idx_req < m_queue[idx].size(); idx_req++)
+    {
+      m_queue[idx][idx_req]->m_cancelled = true;
+    }
+    m_queue[idx].clear();
+  }
+  m_cond_done.wakeAll();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler::deliver
+//GUI thread; requests cancelled after being served, or whose owner was deleted, are dropped
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IoScheduler::deliver(io_request_ptr req)
+{
+  {
+    //m_cancelled is set under the lock by cancel, from any thread
+    QMutexLocker locker(&m_mutex);
+    if(req->m_cancelled)
+    {
+      return;
+    }
+  }
+  if(req->m_owner_key != NULL && req->m_owner.isNull())
+  {
+    return;
+  }
+  req->m_done(req.data());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//slab_stream
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int slab_stream(const std::vector<slab_source_t*> &sources, size_t nbr_slab, const slab_io_t &io,
+  const std::atomic<bool> &cancel, const slab_range_t &range, const slab_process_t &process)
+{
+  if(sources.empty() || nbr_slab == 0)
+  {
+    return NC_NOERR;
+  }
+  const std::vector<size_t> &dim = sources[0]->dim();
+  std::vector<size_t> start[2];
+  std::vector<size_t> count[2];
+  std::vector<buffer_t> buf[2];
+  for(int idx_buf = 0; idx_buf < 2; idx_buf++)
+  {
+    start[idx_buf].assign(dim.size(), 0);
+    count[idx_buf] = dim;
+    buf[idx_buf].resize(sources.size());
+  }
+  auto read = [&](size_t idx_slab, int idx_buf)
+  {
+    range(idx_slab, &start[idx_buf], &count[idx_buf]);
+    io([&]()
+    {
+      for(size_t idx_src = 0; idx_src < sources.size(); idx_src++)
+      {
+        buf[idx_buf][idx_src] = sources[idx_src]->read(start[idx_buf], count[idx_buf]);
+      }
+    });
+  };
+
+  int cur = 0;
+  read(0, cur);
+  for(size_t idx_slab = 0; idx_slab < nbr_slab; idx_slab++)
+  {
+    if(cancel)
+    {
+      return NC2_ERR;
+    }
+
+    //the next slab is read while this one is processed
+    std::thread reader;
+    if(idx_slab + 1 < nbr_slab)
+    {
+      reader = std::thread(read, idx_slab + 1, 1 - cur);
+    }
+    size_t nbr = 1;
+    for(size_t idx_dmn = 0; idx_dmn < count[cur].size(); idx_dmn++)
+    {
+      nbr *= count[cur][idx_dmn];
+    }
+    bool ok = true;
+    for(size_t idx_src = 0; idx_src < sources.size() && ok; idx_src++)
+    {
+      ok = buf[cur][idx_src].size() == nbr * get_type_size(sources[idx_src]->type());
+    }
+    ok = ok && process(idx_slab, start[cur], count[cur], buf[cur]);
+    if(reader.joinable())
+    {
+      reader.join();
+    }
+    if(!ok)
+    {
+      return NC2_ERR;
+    }
+    for(size_t idx_src = 0; idx_src < sources.size(); idx_src++)
+    {
+      buf[cur][idx_src].reset();
+    }
+    cur = 1 - cur;
+  }
+  return NC_NOERR;
+}
@@ -0,0 +1,247 @@
+#ifndef NETCDF_IO_H
+#define NETCDF_IO_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//I/O scheduler
+//the netCDF library is not thread-safe; in the GUI every netCDF call runs on one I/O thread
+//requests are served by priority, then in order of arrival
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum io_priority_t
+{
+  io_visible, // tiles on screen
+  io_layer, // rest of the current layer
+  io_prefetch, // neighbour layers
+  io_background, // statistics, scans
+  io_nbr_priority
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//slab_source_t
+//a variable that can be read by hyperslabs; read() is called on the I/O thread only
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class slab_source_t
+{
+public:
+  virtual ~slab_source_t()
+  {
+  }
+  virtual nc_type type() const = 0;
+  virtual const std::vector<size_t>& dim() const = 0;
+  //identifies the data: requests with the same key may be merged and cached together
+  virtual std::string key() const = 0;
+  virtual buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count) = 0;
+  //count elements every stride elements from start; by default the box that holds them is read, and
+  //they are picked from it (not for NC_STRING)
+  virtual buffer_t read_strided(const std::vector<size_t> &start, const std::vector<size_t> &count,
+    const std::vector<ptrdiff_t> &stride);
+  //chunk sizes of the storage, empty if contiguous or not known
+  virtual std::vector<size_t> chunking()
+  {
+    return std::vector<size_t>();
+  }
+  //_FillValue of the variable, false if it has none
+  virtual bool fill_value(double *)
+  {
+    return false;
+  }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//nc_slab_source_t
+//a variable of a netCDF file; the file stays open on the I/O thread between reads
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class nc_slab_source_t : public slab_source_t
+{
+public:
+  nc_slab_source_t(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm,
+    nc_type nc_typ, const std::vector<size_t> &dim) :
+    m_file_name(file_name),
+    m_grp_nm_fll(grp_nm_fll),
+    m_var_nm(var_nm),
+    m_nc_type(nc_typ),
+    m_dim(dim)
+  {
+  }
+  nc_type type() const
+  {
+    return m_nc_type;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_dim;
+  }
+  std::string key() const
+  {
+    return m_file_name + '\n' + m_grp_nm_fll + '\n' + m_var_nm;
+  }
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+  buffer_t read_strided(const std::vector<size_t> &start, const std::vector<size_t> &count,
+    const std::vector<ptrdiff_t> &stride);
+  std::vector<size_t> chunking();
+  bool fill_value(double *fill);
+
+private:
+  std::string m_file_name;
+  std::string m_grp_nm_fll;
+  std::string m_var_nm;
+  nc_type m_nc_type;
+  std::vector<size_t> m_dim;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//io_request_t
+//a hyperslab read of a source, or a job (any netCDF work); m_done runs on the GUI thread
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class io_request_t
+{
+public:
+  io_request_t() :
+    m_id(0),
+    m_priority(io_visible),
+    m_owner_key(NULL),
+    m_time_queued(0),
+    m_cancelled(false),
+    m_finished(false)
+  {
+  }
+  quint64 m_id;
+  int m_priority;
+  QPointer<QObject> m_owner; // results are dropped if the owner was deleted
+  QObject *m_owner_key; // owner, for cancellation
+  std::shared_ptr<slab_source_t> m_source; // slab read, or NULL for a job
+  std::vector<size_t> m_start;
+  std::vector<size_t> m_count;
+  buffer_t m_buf; // slab read result
+  std::function<void()> m_job; // job, runs on the I/O thread
+  std::function<void(io_request_t*)> m_done; // runs on the GUI thread
+  qint64 m_time_queued; // nanoseconds
+  bool m_cancelled;
+  bool m_finished;
+};
+
+typedef QSharedPointer<io_request_t> io_request_ptr;
+Q_DECLARE_METATYPE(io_request_ptr)
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//io_stats_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class io_stats_t
+{
+public:
+  io_stats_t() :
+    m_depth_max(0),
+    m_nbr_done(0),
+    m_nbr_cancelled(0),
+    m_nbr_merged(0)
+  {
+    for(int idx = 0; idx < io_nbr_priority; idx++)
+    {
+      m_depth[idx] = 0;
+      m_nbr_wait[idx] = 0;
+      m_wait_ns[idx] = 0;
+      m_wait_ns_max[idx] = 0;
+    }
+  }
+  size_t m_depth[io_nbr_priority]; // queued requests per priority
+  size_t m_depth_max; // maximum of the total queued
+  size_t m_nbr_done; // requests served
+  size_t m_nbr_cancelled; // requests cancelled before being served
+  size_t m_nbr_merged; // slab requests served by the read of another request
+  size_t m_nbr_wait[io_nbr_priority]; // served requests per priority
+  qint64 m_wait_ns[io_nbr_priority]; // total time in queue per priority
+  qint64 m_wait_ns_max[io_nbr_priority]; // maximum time in queue per priority
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//IoScheduler
+//the QThread object lives in the GUI thread; run() is the I/O thread
+//results are posted back with a queued signal to deliver(), which calls m_done in the GUI thread
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class IoScheduler : public QThread
+{
+  Q_OBJECT
+public:
+  static IoScheduler* instance();
+  quint64 read_slab(const std::shared_ptr<slab_source_t> &source, const std::vector<size_t> &start, const std::vector<size_t> &count,
+    int priority, QObject *owner, const std::function<void(io_request_t*)> &done);
+  quint64 run_job(const std::function<void()> &job, int priority, QObject *owner, const std::function<void(io_request_t*)> &done);
+  void execute(const std::function<void()> &job, int priority = io_visible);
+  void cancel(quint64 id);
+  void cancel_owner(QObject *owner, int priority = -1);
+  void set_priority(quint64 id, int priority);
+  void wait_idle();
+  io_stats_t stats();
+
+public slots:
+  void stop();
+
+signals:
+  void request_finished(io_request_ptr req);
+
+private slots:
+  void deliver(io_request_ptr req);
+
+protected:
+  void run();
+
+private:
+  IoScheduler();
+  ~IoScheduler();
+  quint64 push(const io_request_ptr &req);
+  io_request_ptr pop(std::vector<io_request_ptr> &merged, std::vector<size_t> &start, std::vector<size_t> &count);
+  void serve(const io_request_ptr &req, std::vector<io_request_ptr> &merged, const std::vector<size_t> &start, const std::vector<size_t> &count);
+  QMutex m_mutex;
+  QWaitCondition m_cond_queue; // requests queued or stop
+  QWaitCondition m_cond_done; // a request finished
+  std::deque<io_request_ptr> m_queue[io_nbr_priority];
+  std::vector<io_request_ptr> m_running; // popped, not finished
+  quint64 m_id;
+  bool m_stop;
+  QElapsedTimer m_timer;
+  io_stats_t m_stats;
+};
+
+//netCDF ID of a file kept open on the I/O thread, and its close; call on the I/O thread only
+int io_open(const std::string &file_name, int *nc_id);
+void io_close(const std::string &file_name);
+void copy_slab(void *dst, const std::vector<size_t> &dst_start, const std::vector<size_t> &dst_count,
+  const void *src, const std::vector<size_t> &src_start, const std::vector<size_t> &src_count, size_t type_sz);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//slab_stream
+//a pass over sources of the same shape by nbr_slab slabs, double buffered: the next slab is read on
+//a thread while the current one is processed; range sets the start and count of a slab (given the
+//whole variable), io runs the reads (on the I/O thread in the GUI), process gets one buffer per
+//source; stops with NC2_ERR when cancel is set, a read fails or process returns false
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::function<void(const std::function<void()>&)> slab_io_t;
+typedef std::function<void(size_t idx_slab, std::vector<size_t> *start, std::vector<size_t> *count)> slab_range_t;
+typedef std::function<bool(size_t idx_slab, const std::vector<size_t> &start, const std::vector<size_t> &count,
+  const std::vector<buffer_t> &buf)> slab_process_t;
+
+int slab_stream(const std::vector<slab_source_t*> &sources, size_t nbr_slab, const slab_io_t &io,
+  const std::atomic<bool> &cancel, const slab_range_t &range, const slab_process_t &process);
+
+#endif
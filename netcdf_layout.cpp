@@ -0,0 +1,362 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cstdio>
+#include <algorithm>
+#include "netcdf_explorer.hpp"
+#include "netcdf_layout.hpp"
+#include "netcdf_trace.hpp"
+
+//HDF5 filters reported by their own inquiry
+static const unsigned int layout_filter_deflate = 1;
+static const unsigned int layout_filter_szip = 4;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_t::bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double layout_t::bytes() const
+{
+  double nbr_bytes = (double)m_type_size;
+  for(size_t idx_dmn = 0; idx_dmn < m_dim.size(); idx_dmn++)
+  {
+    nbr_bytes *= (double)m_dim[idx_dmn];
+  }
+  return nbr_bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_t::chunk_bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double layout_t::chunk_bytes() const
+{
+  double nbr_bytes = (double)m_type_size;
+  for(size_t idx_dmn = 0; idx_dmn < m_chunk.size(); idx_dmn++)
+  {
+    nbr_bytes *= (double)m_chunk[idx_dmn];
+  }
+  return nbr_bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_inq
+//netCDF-3 files are always contiguous; the filters of netCDF-4 variables are read only if chunked
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int layout_inq(const int grp_id, const int var_id, nc_type nc_typ, const std::vector<size_t> &dim, layout_t *layout)
+{
+  *layout = layout_t();
+  layout->m_dim = dim;
+  layout->m_type_size = std::max<size_t>(1, get_type_size(nc_typ));
+  if(NC_TRACE("nc_inq_format", NULL, 0, nc_inq_format(grp_id, &layout->m_format)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(layout->m_format != NC_FORMAT_NETCDF4 && layout->m_format != NC_FORMAT_NETCDF4_CLASSIC)
+  {
+    return NC_NOERR;
+  }
+
+  std::vector<size_t> chunk(std::max<size_t>(1, dim.size()));
+  if(NC_TRACE("nc_inq_var_chunking", NULL, 0, nc_inq_var_chunking(grp_id, var_id, &layout->m_storage, chunk.data())) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(layout->m_storage != NC_CHUNKED || dim.empty())
+  {
+    return NC_NOERR;
+  }
+  layout->m_chunk.assign(chunk.begin(), chunk.begin() + dim.size());
+
+  if(NC_TRACE("nc_inq_var_deflate", NULL, 0, nc_inq_var_deflate(grp_id, var_id, &layout->m_shuffle, &layout->m_deflate,
+    &layout->m_deflate_level)) != NC_NOERR)
+  {
+
+  }
+  if(NC_TRACE("nc_inq_var_fletcher32", NULL, 0, nc_inq_var_fletcher32(grp_id, var_id, &layout->m_fletcher32)) != NC_NOERR)
+  {
+
+  }
+  int options_mask = 0;
+  int pixels_per_block = 0;
+  if(NC_TRACE("nc_inq_var_szip", NULL, 0, nc_inq_var_szip(grp_id, var_id, &options_mask, &pixels_per_block)) == NC_NOERR)
+  {
+    layout->m_szip = options_mask != 0;
+  }
+  //first filter of the pipeline; fails for variables without filters in recent versions
+  unsigned int filter_id = 0;
+  size_t nbr_params = 0;
+  if(NC_TRACE("nc_inq_var_filter", NULL, 0, nc_inq_var_filter(grp_id, var_id, &filter_id, &nbr_params, NULL)) == NC_NOERR &&
+    filter_id != layout_filter_deflate && filter_id != layout_filter_szip)
+  {
+    layout->m_filter_id = filter_id;
+  }
+
+  size_t nelems;
+  float preemption;
+  if(NC_TRACE("nc_get_var_chunk_cache", NULL, 0, nc_get_var_chunk_cache(grp_id, var_id, &layout->m_cache_size, &nelems,
+    &preemption)) != NC_NOERR)
+  {
+
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_cost
+//chunked: every chunk the box touches along each dimension, read and decompressed whole
+//contiguous: the box is read by runs; a run spans the last dimensions the box covers whole and its
+//part of the first one it does not
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+layout_cost_t layout_cost(const layout_t &layout, const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  layout_cost_t cost;
+  size_t nbr_dmn = count.size();
+  if(layout.m_storage == NC_CHUNKED && layout.m_chunk.size() == nbr_dmn)
+  {
+    cost.m_nbr_chunk = 1;
+    for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      size_t chunk = std::max<size_t>(1, layout.m_chunk[idx_dmn]);
+      if(count[idx_dmn] == 0)
+      {
+        return layout_cost_t();
+      }
+      cost.m_nbr_chunk *= (double)((start[idx_dmn] + count[idx_dmn] - 1) / chunk - start[idx_dmn] / chunk + 1);
+    }
+    cost.m_bytes = cost.m_nbr_chunk * layout.chunk_bytes();
+    cost.m_bytes_disk = layout.filtered() ? cost.m_bytes * layout.m_ratio : cost.m_bytes;
+    return cost;
+  }
+
+  cost.m_bytes = (double)layout.m_type_size;
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    cost.m_bytes *= (double)count[idx_dmn];
+  }
+  cost.m_nbr_run = cost.m_bytes > 0 ? 1 : 0;
+  size_t idx_dmn = nbr_dmn;
+  while(idx_dmn > 0 && count[idx_dmn - 1] == layout.m_dim[idx_dmn - 1])
+  {
+    idx_dmn--;
+  }
+  for(size_t idx = 0; idx + 1 < idx_dmn; idx++)
+  {
+    cost.m_nbr_run *= (double)count[idx];
+  }
+  cost.m_bytes_disk = cost.m_bytes;
+  return cost;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//format_bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::string format_bytes(double nbr_bytes)
+{
+  const char *unit[] = { "bytes", "KB", "MB", "GB", "TB" };
+  size_t idx_unit = 0;
+  while(nbr_bytes >= 1024 && idx_unit < 4)
+  {
+    nbr_bytes /= 1024;
+    idx_unit++;
+  }
+  char str[64];
+  snprintf(str, sizeof(str), idx_unit == 0 ? "%.0f %s" : "%.1f %s", nbr_bytes, unit[idx_unit]);
+  return str;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//format_shape
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::string format_shape(const std::vector<size_t> &shape)
+{
+  std::string str;
+  for(size_t idx_dmn = 0; idx_dmn < shape.size(); idx_dmn++)
+  {
+    if(idx_dmn > 0)
+    {
+      str += " x ";
+    }
+    str += std::to_string(shape[idx_dmn]);
+  }
+  return str;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//format_cost
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::string format_cost(const layout_t &layout, const layout_cost_t &cost, double data_bytes)
+{
+  char str[64];
+  std::string line;
+  if(layout.m_storage == NC_CHUNKED && !layout.m_chunk.empty())
+  {
+    line = std::to_string((unsigned long long)cost.m_nbr_chunk) + (cost.m_nbr_chunk == 1 ? " chunk, " : " chunks, ");
+    line += format_bytes(cost.m_bytes) + (layout.filtered() ? " decompressed" : " read");
+    if(layout.filtered())
+    {
+      line += ", ~" + format_bytes(cost.m_bytes_disk) + " read";
+    }
+  }
+  else
+  {
+    line = format_bytes(cost.m_bytes) + " in " + std::to_string((unsigned long long)cost.m_nbr_run) +
+      (cost.m_nbr_run == 1 ? " run" : " runs");
+  }
+  if(data_bytes > 0 && cost.m_bytes > data_bytes * 1.05)
+  {
+    snprintf(str, sizeof(str), " (x%.1f the data)", cost.m_bytes / data_bytes);
+    line += str;
+  }
+  return line;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_report
+//text of the panel: storage, then the cost of the reads of a table: its first tile (about 1 MB of rows,
+//as TableModel reads them), a whole layer of the last two dimensions, and a step along each of the others
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string layout_report(const layout_t &layout, const std::vector<std::string> &dim_nm)
+{
+  std::string report;
+  size_t nbr_dmn = layout.m_dim.size();
+  bool chunked = layout.m_storage == NC_CHUNKED && layout.m_chunk.size() == nbr_dmn && nbr_dmn > 0;
+  switch(layout.m_format)
+  {
+  case NC_FORMAT_NETCDF4:
+  case NC_FORMAT_NETCDF4_CLASSIC:
+    report += chunked ? "Storage: chunked (netCDF-4)\n" :
+      (layout.m_storage == NC_COMPACT ? "Storage: compact (netCDF-4)\n" : "Storage: contiguous (netCDF-4)\n");
+    break;
+  default:
+    report += "Storage: contiguous (netCDF-3)\n";
+    break;
+  }
+
+  report += "Size: " + format_bytes(layout.bytes());
+  if(chunked && layout.filtered())
+  {
+    char str[64];
+    snprintf(str, sizeof(str), " with the compression of the file (%.2f)", layout.m_ratio);
+    report += " uncompressed, ~" + format_bytes(layout.bytes() * layout.m_ratio) + " on disk, estimated" + str;
+  }
+  report += "\n";
+
+  if(chunked)
+  {
+    std::vector<size_t> nbr_chunk(nbr_dmn);
+    for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      size_t chunk = std::max<size_t>(1, layout.m_chunk[idx_dmn]);
+      nbr_chunk[idx_dmn] = (layout.m_dim[idx_dmn] + chunk - 1) / chunk;
+    }
+    report += "Chunk shape: " + format_shape(layout.m_chunk) + " (" + format_bytes(layout.chunk_bytes()) + ")\n";
+    report += "Chunks: " + format_shape(nbr_chunk) + "\n";
+
+    std::string filters;
+    if(layout.m_shuffle)
+    {
+      filters += "shuffle, ";
+    }
+    if(layout.m_deflate)
+    {
+      filters += "deflate level " + std::to_string(layout.m_deflate_level) + ", ";
+    }
+    if(layout.m_szip)
+    {
+      filters += "szip, ";
+    }
+    if(layout.m_filter_id != 0)
+    {
+      filters += "filter " + std::to_string(layout.m_filter_id) + ", ";
+    }
+    if(layout.m_fletcher32)
+    {
+      filters += "fletcher32, ";
+    }
+    report += "Filters: " + (filters.empty() ? std::string("none") : filters.substr(0, filters.size() - 2)) + "\n";
+    report += "Chunk cache: " + format_bytes((double)layout.m_cache_size) + "\n";
+  }
+  if(nbr_dmn == 0)
+  {
+    return report;
+  }
+
+  //first tile and layer, as a table shows them; one dimensional variables are read whole
+  std::vector<size_t> start(nbr_dmn, 0);
+  std::vector<size_t> count(nbr_dmn, 1);
+  double type_sz = (double)layout.m_type_size;
+  report += "\n";
+  if(nbr_dmn == 1)
+  {
+    count[0] = layout.m_dim[0];
+    report += "Whole variable: " + format_cost(layout, layout_cost(layout, start, count), layout.bytes()) + "\n";
+    return report;
+  }
+
+  size_t dim_rows = nbr_dmn - 2;
+  size_t dim_cols = nbr_dmn - 1;
+  size_t nbr_rows = layout.m_dim[dim_rows];
+  size_t nbr_cols = layout.m_dim[dim_cols];
+  size_t row_sz = std::max<size_t>(1, nbr_cols * layout.m_type_size);
+  size_t tile_rows = std::min<size_t>(std::max<size_t>(1, (1 << 20) / row_sz), std::max<size_t>(1, nbr_rows));
+  count[dim_rows] = std::min(tile_rows, nbr_rows);
+  count[dim_cols] = nbr_cols;
+  double tile_bytes = (double)count[dim_rows] * nbr_cols * type_sz;
+  layout_cost_t tile = layout_cost(layout, start, count);
+  report += "First tile (" + std::to_string(count[dim_rows]) + " rows): " + format_cost(layout, tile, tile_bytes) + "\n";
+
+  count[dim_rows] = nbr_rows;
+  double layer_bytes = (double)nbr_rows * nbr_cols * type_sz;
+  layout_cost_t layer = layout_cost(layout, start, count);
+  report += "Layer (" + std::to_string(nbr_rows) + " x " + std::to_string(nbr_cols) + "): " +
+    format_cost(layout, layer, layer_bytes) + "\n";
+
+  //tiles that share chunks decompress them again when the chunks of a tile do not stay in the cache
+  if(chunked && layout.m_chunk[dim_rows] > tile_rows && tile.m_bytes > (double)layout.m_cache_size)
+  {
+    layout_cost_t tiles = tile;
+    double nbr_tile = (double)((nbr_rows + tile_rows - 1) / tile_rows);
+    tiles.m_nbr_chunk *= nbr_tile;
+    tiles.m_bytes *= nbr_tile;
+    tiles.m_bytes_disk *= nbr_tile;
+    report += "Layer by tiles: " + format_cost(layout, tiles, layer_bytes) + " (the chunks of a tile exceed the chunk cache)\n";
+  }
+
+  //a step along a dimension reads the next layer; chunked, it reads new chunks only when it leaves the
+  //chunks of the layer, if they all stay in the chunk cache
+  for(size_t idx_dmn = 0; idx_dmn < dim_rows; idx_dmn++)
+  {
+    std::string name = idx_dmn < dim_nm.size() ? dim_nm[idx_dmn] : "dimension " + std::to_string(idx_dmn);
+    std::string line = "Step along " + name + ": ";
+    if(layout.m_dim[idx_dmn] < 2)
+    {
+      continue;
+    }
+    if(!chunked)
+    {
+      line += format_bytes(layer.m_bytes) + " every step";
+    }
+    else if(layout.m_chunk[idx_dmn] > 1 && layer.m_bytes <= (double)layout.m_cache_size)
+    {
+      line += format_cost(layout, layer, 0) + " every " + std::to_string(layout.m_chunk[idx_dmn]) +
+        " steps (the chunks of a layer fit the chunk cache)";
+    }
+    else
+    {
+      line += format_cost(layout, layer, layer_bytes) + " every step";
+      if(layout.m_chunk[idx_dmn] > 1)
+      {
+        line += " (the chunks of a layer exceed the chunk cache)";
+      }
+    }
+    report += line + "\n";
+  }
+  return report;
+}
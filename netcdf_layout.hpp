@@ -0,0 +1,86 @@
+#ifndef NETCDF_LAYOUT_H
+#define NETCDF_LAYOUT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//storage layout
+//how a variable is stored (contiguous, chunked or compact, chunk shape, filters, chunk cache), and what
+//reading a box of it costs: a chunk is read and decompressed whole for any cell of it, so that a layer
+//that cuts across chunks reads much more than its size
+//netCDF gives no size on disk of a variable; for filtered variables it is estimated with the ratio of
+//the file size to the size of all its variables
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class layout_t
+{
+public:
+  layout_t() :
+    m_format(0),
+    m_storage(NC_CONTIGUOUS),
+    m_shuffle(0),
+    m_deflate(0),
+    m_deflate_level(0),
+    m_fletcher32(0),
+    m_szip(0),
+    m_filter_id(0),
+    m_type_size(0),
+    m_cache_size(0),
+    m_ratio(1)
+  {
+  }
+  bool filtered() const
+  {
+    return m_deflate || m_szip || m_filter_id != 0;
+  }
+  double bytes() const; // in memory
+  double chunk_bytes() const;
+
+  int m_format; // NC_FORMAT_*
+  int m_storage; // NC_CONTIGUOUS, NC_CHUNKED or NC_COMPACT
+  std::vector<size_t> m_dim;
+  std::vector<size_t> m_chunk; // chunk shape; empty if not chunked
+  int m_shuffle;
+  int m_deflate;
+  int m_deflate_level;
+  int m_fletcher32;
+  int m_szip;
+  unsigned int m_filter_id; // HDF5 filter other than deflate and szip, 0 if none
+  size_t m_type_size;
+  size_t m_cache_size; // chunk cache of the variable, bytes
+  double m_ratio; // estimated size on disk over size in memory of filtered variables
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//layout_cost_t
+//the read of a box: chunks touched and bytes decompressed, or contiguous runs and bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class layout_cost_t
+{
+public:
+  layout_cost_t() :
+    m_nbr_chunk(0),
+    m_nbr_run(0),
+    m_bytes(0),
+    m_bytes_disk(0)
+  {
+  }
+  double m_nbr_chunk; // chunked: chunks touched
+  double m_nbr_run; // contiguous: runs of cells read
+  double m_bytes; // bytes read and decompressed
+  double m_bytes_disk; // estimated bytes read from disk
+};
+
+int layout_inq(const int grp_id, const int var_id, nc_type nc_typ, const std::vector<size_t> &dim, layout_t *layout);
+layout_cost_t layout_cost(const layout_t &layout, const std::vector<size_t> &start, const std::vector<size_t> &count);
+std::string layout_report(const layout_t &layout, const std::vector<std::string> &dim_nm);
+
+#endif
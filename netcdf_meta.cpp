@@ -0,0 +1,603 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include "netcdf_explorer.hpp"
+#include "netcdf_meta.hpp"
+#include "netcdf_trace.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_hash
+//FNV-1a
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int get_hash(const char *str)
+{
+  unsigned int hash = 2166136261u;
+  for(; *str; str++)
+  {
+    hash = (hash ^ (unsigned char)*str) * 16777619u;
+  }
+  return hash;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_pool_t::string_pool_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+string_pool_t::string_pool_t() :
+  m_slot(64, 0)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_pool_t::intern
+//ID of a string, added if new
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int string_pool_t::intern(const char *str)
+{
+  size_t mask = m_slot.size() - 1;
+  size_t idx_slot = get_hash(str) & mask;
+  while(m_slot[idx_slot] != 0)
+  {
+    unsigned int id = m_slot[idx_slot] - 1;
+    if(strcmp(at(id), str) == 0)
+    {
+      return id;
+    }
+    idx_slot = (idx_slot + 1) & mask;
+  }
+
+  unsigned int id = (unsigned int)m_off.size();
+  m_off.push_back((unsigned int)m_chars.size());
+  m_chars.insert(m_chars.end(), str, str + strlen(str) + 1);
+  m_slot[idx_slot] = id + 1;
+
+  //keep the table at most half full
+  if(m_off.size() * 2 > m_slot.size())
+  {
+    grow();
+  }
+  return id;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_pool_t::find
+//ID of a string, meta_none if not in the pool
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int string_pool_t::find(const char *str) const
+{
+  size_t mask = m_slot.size() - 1;
+  size_t idx_slot = get_hash(str) & mask;
+  while(m_slot[idx_slot] != 0)
+  {
+    unsigned int id = m_slot[idx_slot] - 1;
+    if(strcmp(at(id), str) == 0)
+    {
+      return id;
+    }
+    idx_slot = (idx_slot + 1) & mask;
+  }
+  return meta_none;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_pool_t::grow
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void string_pool_t::grow()
+{
+  std::vector<unsigned int> slot(m_slot.size() * 2, 0);
+  size_t mask = slot.size() - 1;
+  for(unsigned int id = 0; id < m_off.size(); id++)
+  {
+    size_t idx_slot = get_hash(at(id)) & mask;
+    while(slot[idx_slot] != 0)
+    {
+      idx_slot = (idx_slot + 1) & mask;
+    }
+    slot[idx_slot] = id + 1;
+  }
+  m_slot.swap(slot);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_pool_t::bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t string_pool_t::bytes() const
+{
+  return m_chars.capacity() + m_off.capacity() * sizeof(unsigned int) + m_slot.capacity() * sizeof(unsigned int);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t::bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t meta_store_t::bytes() const
+{
+  return sizeof(meta_store_t) + m_file_name.capacity() + m_str.bytes()
+    + m_item.capacity() * sizeof(meta_item_t) + m_dim.capacity() * sizeof(size_t)
+    + m_dim_nm.capacity() * sizeof(unsigned int) + m_value.capacity() * sizeof(m_value[0]) + m_index.bytes()
+    + m_att.capacity() + m_att_item.capacity() * sizeof(meta_att_t);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t::data_bytes
+//size in memory of all the variables of the file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double meta_store_t::data_bytes() const
+{
+  double nbr_bytes = 0;
+  for(size_t idx = 0; idx < m_item.size(); idx++)
+  {
+    const meta_item_t &item = m_item[idx];
+    if(item.m_kind != ItemData::Variable)
+    {
+      continue;
+    }
+    double var_bytes = (double)get_type_size(item.m_nc_type);
+    for(unsigned short idx_dmn = 0; idx_dmn < item.m_nbr_dim; idx_dmn++)
+    {
+      var_bytes *= (double)m_dim[item.m_dim + idx_dmn];
+    }
+    nbr_bytes += var_bytes;
+  }
+  return nbr_bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t::att
+//the value of an attribute in the arena, or NULL
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const meta_att_t* meta_store_t::att(unsigned int idx) const
+{
+  meta_att_t key;
+  key.m_item = idx;
+  std::vector<meta_att_t>::const_iterator it = std::lower_bound(m_att_item.begin(), m_att_item.end(), key,
+    [](const meta_att_t &a, const meta_att_t &b) { return a.m_item < b.m_item; });
+  if(it == m_att_item.end() || it->m_item != idx)
+  {
+    return NULL;
+  }
+  return &(*it);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t::att_value
+//a pooled copy of the value of an attribute, empty if not in the arena
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t meta_store_t::att_value(unsigned int idx) const
+{
+  const meta_att_t *value = att(idx);
+  if(value == NULL)
+  {
+    return buffer_t();
+  }
+  buffer_t buf(value->m_size);
+  if(!buf.empty())
+  {
+    memcpy(buf.data(), &m_att[value->m_off], value->m_size);
+  }
+  return buf;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t::att_text
+//the value of an attribute as text, the first max_values values of arrays; empty if not in the arena
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string meta_store_t::att_text(unsigned int idx, size_t max_values) const
+{
+  const meta_att_t *value = att(idx);
+  if(value == NULL)
+  {
+    return std::string();
+  }
+  const char *buf = &m_att[value->m_off];
+  nc_type nc_typ = m_item[idx].m_nc_type;
+  if(nc_typ == NC_CHAR)
+  {
+    size_t len = value->m_size;
+    while(len > 0 && buf[len - 1] == '\0')
+    {
+      len--;
+    }
+    return std::string(buf, len);
+  }
+
+  size_t nbr = (nc_typ == NC_STRING) ? string_count(buf) : *dim(idx);
+  std::string text;
+  char str[64];
+  for(size_t idx_val = 0; idx_val < nbr && idx_val < max_values; idx_val++)
+  {
+    if(idx_val > 0)
+    {
+      text += ", ";
+    }
+    if(nc_typ == NC_STRING)
+    {
+      text += string_at(buf, idx_val).m_ptr;
+    }
+    else
+    {
+      format_value(str, sizeof(str), nc_typ, buf, idx_val);
+      text += str;
+    }
+  }
+  if(nbr > max_values)
+  {
+    text += ", ...";
+  }
+  return text;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t::find_att
+//the attribute of a group or variable by name, or meta_none
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int meta_store_t::find_att(unsigned int idx_prn, const char *name) const
+{
+  const meta_item_t &prn = m_item[idx_prn];
+  for(unsigned int idx = prn.m_first; idx < prn.m_first + prn.m_nbr_chd; idx++)
+  {
+    if(m_item[idx].m_kind != ItemData::Attribute)
+    {
+      break;
+    }
+    if(strcmp(this->name(idx), name) == 0)
+    {
+      return idx;
+    }
+  }
+  return meta_none;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//add_item
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void add_item(meta_store_t *store, unsigned int idx, int kind, const char *name, unsigned int idx_prn,
+  unsigned int grp_nm_fll, nc_type nc_typ, const size_t *dim, const unsigned int *dim_nm, int nbr_dim)
+{
+  meta_item_t &item = store->m_item[idx];
+  item.m_name = store->m_str.intern(name);
+  item.m_parent = idx_prn;
+  item.m_first = 0;
+  item.m_nbr_chd = 0;
+  item.m_group = grp_nm_fll;
+  item.m_dim = (unsigned int)store->m_dim.size();
+  item.m_nc_type = nc_typ;
+  item.m_nbr_dim = (unsigned short)nbr_dim;
+  item.m_kind = (unsigned char)kind;
+  store->m_dim.insert(store->m_dim.end(), dim, dim + nbr_dim);
+  if(dim_nm != NULL)
+  {
+    store->m_dim_nm.insert(store->m_dim_nm.end(), dim_nm, dim_nm + nbr_dim);
+  }
+  else
+  {
+    store->m_dim_nm.insert(store->m_dim_nm.end(), nbr_dim, meta_none);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//add_value
+//the value of a text attribute of up to 256 characters, or of a scalar attribute, for the index
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void add_value(meta_store_t *store, unsigned int idx, nc_type attr_typ, size_t size_attr, const void *buf)
+{
+  char str[256 + 1];
+  if(attr_typ == NC_CHAR && size_attr > 0 && size_attr <= 256)
+  {
+    //text attributes may be NUL padded
+    memcpy(str, buf, size_attr);
+    str[size_attr] = '\0';
+  }
+  else if(attr_typ == NC_STRING && size_attr == 1)
+  {
+    snprintf(str, sizeof(str), "%s", string_at(buf, 0).m_ptr);
+  }
+  else if(attr_typ != NC_CHAR && attr_typ != NC_STRING && attr_typ <= NC_UINT64 && size_attr == 1)
+  {
+    double val;
+    diff_to_double(buf, attr_typ, 1, &val);
+    snprintf(str, sizeof(str), "%g", val);
+  }
+  else
+  {
+    return;
+  }
+  store->m_value.push_back(std::make_pair(idx, store->m_str.intern(str)));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//add_att_value
+//the value of an attribute, into the arena if small
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void add_att_value(meta_store_t *store, unsigned int idx, const buffer_t &buf)
+{
+  if(buf.empty() || buf.size() > meta_att_bytes)
+  {
+    return;
+  }
+  meta_att_t value;
+  value.m_item = idx;
+  value.m_size = (unsigned int)buf.size();
+  value.m_off = (store->m_att.size() + 7) & ~(size_t)7;
+  store->m_att.resize(value.m_off + buf.size());
+  memcpy(&store->m_att[value.m_off], buf.data(), buf.size());
+  store->m_att_item.push_back(value);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//add_attributes
+//the attributes of a group (NC_GLOBAL) or variable, as one block of children of idx_prn
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void add_attributes(meta_store_t *store, const int grp_id, const int var_id, int nbr_att, unsigned int idx_prn,
+  unsigned int grp_nm_fll)
+{
+  unsigned int first = (unsigned int)store->m_item.size();
+  store->m_item.resize(first + nbr_att);
+  store->m_item[idx_prn].m_first = first;
+  store->m_item[idx_prn].m_nbr_chd = nbr_att;
+  for(int idx_att = 0; idx_att < nbr_att; idx_att++)
+  {
+    char attr_name[NC_MAX_NAME + 1];
+    nc_type attr_typ = NC_NAT;
+    size_t size_attr = 0;
+
+    if(NC_TRACE("nc_inq_attname", NULL, 0, nc_inq_attname(grp_id, var_id, idx_att, attr_name)) != NC_NOERR)
+    {
+
+    }
+
+    if(NC_TRACE("nc_inq_att", attr_name, 0, nc_inq_att(grp_id, var_id, attr_name, &attr_typ, &size_attr)) != NC_NOERR)
+    {
+
+    }
+
+    add_item(store, first + idx_att, ItemData::Attribute, attr_name, idx_prn, grp_nm_fll, attr_typ, &size_attr, NULL, 1);
+
+    //values too large for the arena are read when opened
+    if(size_attr == 0 || size_attr * get_type_size(attr_typ) > meta_att_bytes || get_type_size(attr_typ) == 0)
+    {
+      continue;
+    }
+    buffer_t buf = load_attribute(grp_id, var_id, attr_name, attr_typ, size_attr);
+    if(!buf.empty())
+    {
+      add_value(store, first + idx_att, attr_typ, size_attr, buf.data());
+      add_att_value(store, first + idx_att, buf);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//scan_group
+//children of a group: its attributes, variables and sub-groups, in this order, as one block
+//then the attribute blocks of the variables, then the sub-groups recursively
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int scan_group(meta_store_t *store, const int grp_id, unsigned int idx_grp)
+{
+  char grp_nm[NC_MAX_NAME + 1]; // group name
+  char var_nm[NC_MAX_NAME + 1]; // variable name
+  int nbr_att; // number of attributes
+  int nbr_dmn_grp; // number of dimensions for group
+  int nbr_var; // number of variables
+  int nbr_grp; // number of sub-groups in this group
+  int nbr_dmn_var; // number of dimensions for variable
+  nc_type var_typ; // netCDF type
+  size_t grp_nm_lng; //lenght of full group name
+  int var_dimid[NC_MAX_VAR_DIMS]; // dimensions for variable
+  size_t dmn_sz[NC_MAX_VAR_DIMS]; // dimensions for variable sizes
+  unsigned int dmn_nm_id[NC_MAX_VAR_DIMS]; // dimensions for variable names, interned
+  char dmn_nm_var[NC_MAX_NAME + 1]; //dimension name
+
+  if(NC_TRACE("nc_inq_grpname_full", NULL, 0, nc_inq_grpname_full(grp_id, &grp_nm_lng, NULL)) != NC_NOERR)
+  {
+
+  }
+  std::vector<char> grp_nm_fll(grp_nm_lng + 1);
+  if(NC_TRACE("nc_inq_grpname_full", NULL, 0, nc_inq_grpname_full(grp_id, &grp_nm_lng, &grp_nm_fll[0])) != NC_NOERR)
+  {
+
+  }
+  unsigned int grp_nm_id = store->m_str.intern(&grp_nm_fll[0]);
+
+  if(NC_TRACE("nc_inq", NULL, 0, nc_inq(grp_id, &nbr_dmn_grp, &nbr_var, &nbr_att, (int *)NULL)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(NC_TRACE("nc_inq_grps", NULL, 0, nc_inq_grps(grp_id, &nbr_grp, (int *)NULL)) != NC_NOERR)
+  {
+    nbr_grp = 0;
+  }
+  std::vector<int> grp_ids(nbr_grp);
+  if(nbr_grp > 0 && NC_TRACE("nc_inq_grps", NULL, 0, nc_inq_grps(grp_id, &nbr_grp, &grp_ids[0])) != NC_NOERR)
+  {
+
+  }
+
+  //the block of children, group attributes first
+  add_attributes(store, grp_id, NC_GLOBAL, nbr_att, idx_grp, grp_nm_id);
+  unsigned int first = store->m_item[idx_grp].m_first;
+  store->m_item.resize(first + nbr_att + nbr_var + nbr_grp);
+  store->m_item[idx_grp].m_nbr_chd = nbr_att + nbr_var + nbr_grp;
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //variables
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  std::vector<int> var_nbr_att(nbr_var);
+  for(int idx_var = 0; idx_var < nbr_var; idx_var++)
+  {
+    if(NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, idx_var, var_nm, &var_typ, &nbr_dmn_var, var_dimid, &var_nbr_att[idx_var])) != NC_NOERR)
+    {
+
+    }
+    for(int idx_dmn = 0; idx_dmn < nbr_dmn_var; idx_dmn++)
+    {
+      //dimensions belong to groups
+      if(NC_TRACE("nc_inq_dim", NULL, 0, nc_inq_dim(grp_id, var_dimid[idx_dmn], dmn_nm_var, &dmn_sz[idx_dmn])) != NC_NOERR)
+      {
+        dmn_nm_var[0] = '\0';
+      }
+      dmn_nm_id[idx_dmn] = store->m_str.intern(dmn_nm_var);
+    }
+    add_item(store, first + nbr_att + idx_var, ItemData::Variable, var_nm, idx_grp, grp_nm_id, var_typ, dmn_sz, dmn_nm_id, nbr_dmn_var);
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //sub-groups
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  for(int idx = 0; idx < nbr_grp; idx++)
+  {
+    if(NC_TRACE("nc_inq_grpname", NULL, 0, nc_inq_grpname(grp_ids[idx], grp_nm)) != NC_NOERR)
+    {
+
+    }
+    add_item(store, first + nbr_att + nbr_var + idx, ItemData::Group, grp_nm, idx_grp, grp_nm_id, NC_NAT, NULL, NULL, 0);
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////////
+  //variable attributes, then the sub-groups
+  ///////////////////////////////////////////////////////////////////////////////////////
+
+  for(int idx_var = 0; idx_var < nbr_var; idx_var++)
+  {
+    add_attributes(store, grp_id, idx_var, var_nbr_att[idx_var], first + nbr_att + idx_var, grp_nm_id);
+  }
+  for(int idx = 0; idx < nbr_grp; idx++)
+  {
+    if(scan_group(store, grp_ids[idx], first + nbr_att + nbr_var + idx) != NC_NOERR)
+    {
+
+    }
+  }
+
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_scan
+//metadata scan of an open file into an empty store
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int meta_scan(meta_store_t *store, const int nc_id)
+{
+  trace_t trace("meta_scan", store->m_file_name.c_str());
+  store->m_item.resize(1);
+  add_item(store, 0, ItemData::Group, "/", meta_none, store->m_str.intern("/"), NC_NAT, NULL, NULL, 0);
+  int status = scan_group(store, nc_id, 0);
+
+  //the scan grows the arrays by blocks; release the slack
+  std::vector<meta_item_t>(store->m_item).swap(store->m_item);
+  std::vector<size_t>(store->m_dim).swap(store->m_dim);
+  std::vector<unsigned int>(store->m_dim_nm).swap(store->m_dim_nm);
+  std::vector<char>(store->m_att).swap(store->m_att);
+  std::vector<meta_att_t>(store->m_att_item).swap(store->m_att_item);
+
+  //search index of the names and values
+  store->m_index.build(*store);
+  return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_grow
+//dimensions of the variables of a store that grew since the scan, as records appended to an open file:
+//the offset in m_dim and the new size of each; NC2_ERR if a variable is gone or changed its shape, or a
+//dimension shrank, when the file was rewritten and must be opened again
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int meta_grow(const meta_store_t *store, const int nc_id, std::vector<std::pair<size_t, size_t> > *grown)
+{
+  trace_t trace("meta_grow", store->m_file_name.c_str());
+  std::map<unsigned int, int> grp_ids; // by interned group name
+  grown->clear();
+  for(unsigned int idx = 0; idx < store->size(); idx++)
+  {
+    const meta_item_t &item = store->item(idx);
+    if(item.m_kind != ItemData::Variable)
+    {
+      continue;
+    }
+    std::map<unsigned int, int>::iterator it = grp_ids.find(item.m_group);
+    if(it == grp_ids.end())
+    {
+      int grp_id;
+      if(inq_grp_id(nc_id, store->group(idx), &grp_id) != NC_NOERR)
+      {
+        return NC2_ERR;
+      }
+      it = grp_ids.insert(std::make_pair(item.m_group, grp_id)).first;
+    }
+    int grp_id = it->second;
+    int var_id;
+    int nbr_dmn;
+    int var_dimid[NC_MAX_VAR_DIMS];
+    if(NC_TRACE("nc_inq_varid", store->name(idx), 0, nc_inq_varid(grp_id, store->name(idx), &var_id)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    if(NC_TRACE("nc_inq_varndims", NULL, 0, nc_inq_varndims(grp_id, var_id, &nbr_dmn)) != NC_NOERR || nbr_dmn != item.m_nbr_dim)
+    {
+      return NC2_ERR;
+    }
+    if(NC_TRACE("nc_inq_vardimid", NULL, 0, nc_inq_vardimid(grp_id, var_id, var_dimid)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      size_t dmn_sz;
+      size_t off = item.m_dim + idx_dmn;
+      if(NC_TRACE("nc_inq_dimlen", NULL, 0, nc_inq_dimlen(grp_id, var_dimid[idx_dmn], &dmn_sz)) != NC_NOERR || dmn_sz < store->m_dim[off])
+      {
+        return NC2_ERR;
+      }
+      if(dmn_sz > store->m_dim[off])
+      {
+        grown->push_back(std::make_pair(off, dmn_sz));
+      }
+    }
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_derived
+//store of a derived variable: the root group and one NC_DOUBLE variable, in the group of its operands
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int meta_derived(meta_store_t *store, const std::string &grp_nm_fll, const std::string &var_nm,
+  const std::vector<size_t> &dim, const std::vector<std::string> &dim_nm)
+{
+  std::vector<unsigned int> dmn_nm_id(dim_nm.size());
+  for(size_t idx_dmn = 0; idx_dmn < dim_nm.size(); idx_dmn++)
+  {
+    dmn_nm_id[idx_dmn] = store->m_str.intern(dim_nm[idx_dmn].c_str());
+  }
+  store->m_item.resize(2);
+  add_item(store, 0, ItemData::Group, "/", meta_none, store->m_str.intern("/"), NC_NAT, NULL, NULL, 0);
+  store->m_item[0].m_first = 1;
+  store->m_item[0].m_nbr_chd = 1;
+  add_item(store, 1, ItemData::Variable, var_nm.c_str(), 0, store->m_str.intern(grp_nm_fll.c_str()), NC_DOUBLE,
+    dim.data(), dmn_nm_id.data(), (int)dim.size());
+  store->m_index.build(*store);
+  return NC_NOERR;
+}
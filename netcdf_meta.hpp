@@ -0,0 +1,154 @@
+#ifndef NETCDF_META_H
+#define NETCDF_META_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+#include "netcdf_index.hpp"
+
+class series_t;
+class slab_source_t;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//metadata store
+//the metadata of one file (groups, variables, attributes) in flat arrays, for files of 100k+ items
+//names are interned, items are plain structs indexed by integer, the file name is stored once
+//and each group full name once; the children of an item are contiguous, so that the tree model
+//finds a child by row and the row of an item without any search
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const unsigned int meta_none = 0xffffffff;
+
+//attribute values of up to this size are read by the scan into the attribute arena
+static const size_t meta_att_bytes = 4096;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_pool_t
+//interned strings: equal strings get the same ID; characters in one array, NUL terminated
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class string_pool_t
+{
+public:
+  string_pool_t();
+  unsigned int intern(const char *str);
+  unsigned int find(const char *str) const;
+  const char* at(unsigned int id) const
+  {
+    return &m_chars[m_off[id]];
+  }
+  size_t size() const
+  {
+    return m_off.size();
+  }
+  size_t bytes() const;
+
+private:
+  void grow();
+  std::vector<char> m_chars;
+  std::vector<unsigned int> m_off; // offset of each string in m_chars
+  std::vector<unsigned int> m_slot; // open addressing hash table of ID + 1, 0 if empty
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_item_t
+//one group, variable or attribute; 32 bytes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class meta_item_t
+{
+public:
+  unsigned int m_name; // interned name
+  unsigned int m_parent; // index of the parent item, meta_none for the root group
+  unsigned int m_first; // index of the first child
+  unsigned int m_nbr_chd; // number of children
+  unsigned int m_group; // interned full name of the group the item is in
+  unsigned int m_dim; // offset of the dimensions in meta_store_t::m_dim
+  nc_type m_nc_type; // (Variable/Attribute) netCDF type
+  unsigned short m_nbr_dim; // (Variable) number of dimensions; (Attribute) 1, the size
+  unsigned char m_kind; // ItemData::ItemKind
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_att_t
+//the value of an attribute in the attribute arena, as load_attribute returns it
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class meta_att_t
+{
+public:
+  unsigned int m_item; // attribute item
+  unsigned int m_size; // bytes
+  size_t m_off; // offset in meta_store_t::m_att, 8 byte aligned
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//meta_store_t
+//item 0 is the root group
+//the values of the attributes are read in the scan, in one pass per group and variable, into one
+//arena, so that attribute tables and tooltips need no I/O; larger values are read when opened
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class meta_store_t
+{
+public:
+  meta_store_t(const std::string &file_name) :
+    m_file_name(file_name)
+  {
+  }
+  const meta_item_t& item(unsigned int idx) const
+  {
+    return m_item[idx];
+  }
+  size_t size() const
+  {
+    return m_item.size();
+  }
+  const char* name(unsigned int idx) const
+  {
+    return m_str.at(m_item[idx].m_name);
+  }
+  const char* group(unsigned int idx) const
+  {
+    return m_str.at(m_item[idx].m_group);
+  }
+  const size_t* dim(unsigned int idx) const
+  {
+    return m_dim.data() + m_item[idx].m_dim;
+  }
+  unsigned int row(unsigned int idx) const
+  {
+    unsigned int idx_prn = m_item[idx].m_parent;
+    return idx_prn == meta_none ? 0 : idx - m_item[idx_prn].m_first;
+  }
+  size_t bytes() const;
+  double data_bytes() const;
+  const meta_att_t* att(unsigned int idx) const;
+  buffer_t att_value(unsigned int idx) const;
+  std::string att_text(unsigned int idx, size_t max_values = 8) const;
+  unsigned int find_att(unsigned int idx_prn, const char *name) const;
+
+  std::string m_file_name;
+  string_pool_t m_str;
+  std::vector<meta_item_t> m_item;
+  std::vector<size_t> m_dim; // dimensions of all the variables, sizes of all the attributes
+  std::vector<unsigned int> m_dim_nm; // interned dimension names, parallel to m_dim; meta_none for attribute sizes
+  std::vector<std::pair<unsigned int, unsigned int> > m_value; // attribute item and interned value, for short text and scalar attributes
+  std::vector<char> m_att; // attribute arena
+  std::vector<meta_att_t> m_att_item; // values in the arena, by item
+  meta_index_t m_index;
+  std::shared_ptr<series_t> m_series; // file series whose first file is m_file_name, or NULL
+  std::shared_ptr<slab_source_t> m_source; // (derived variable) data of the only variable, or NULL
+  std::string m_title; // shown instead of the file name if not empty
+};
+
+int meta_scan(meta_store_t *store, const int nc_id);
+int meta_grow(const meta_store_t *store, const int nc_id, std::vector<std::pair<size_t, size_t> > *grown);
+int meta_derived(meta_store_t *store, const std::string &grp_nm_fll, const std::string &var_nm,
+  const std::vector<size_t> &dim, const std::vector<std::string> &dim_nm);
+
+#endif
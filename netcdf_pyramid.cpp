@@ -0,0 +1,545 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#include "netcdf_explorer.hpp"
+#include "netcdf_pyramid.hpp"
+#include "netcdf_trace.hpp"
+
+static const char pyramid_magic[8] = { 'N', 'C', 'P', 'Y', 'R', 'M', 'D', '2' };
+
+//cells of a slab of rows, about 4 MB of doubles
+static const size_t pyramid_slab_cells = (size_t)1 << 19;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_row_t
+//one row of a level while building: sum, number, minimum and maximum of the numbers of each block
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class pyramid_row_t
+{
+public:
+  void resize(size_t nbr)
+  {
+    m_sum.assign(nbr, 0);
+    m_nbr.assign(nbr, 0);
+    m_min.assign(nbr, 0);
+    m_max.assign(nbr, 0);
+  }
+  void add(size_t idx, double sum, double nbr, double min, double max)
+  {
+    if(nbr == 0)
+    {
+      return;
+    }
+    m_min[idx] = m_nbr[idx] == 0 ? min : std::min(m_min[idx], min);
+    m_max[idx] = m_nbr[idx] == 0 ? max : std::max(m_max[idx], max);
+    m_sum[idx] += sum;
+    m_nbr[idx] += nbr;
+  }
+  std::vector<double> m_sum;
+  std::vector<double> m_nbr;
+  std::vector<double> m_min;
+  std::vector<double> m_max;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_t::dim
+//the dimensions of the variable, with the last two of the level
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<size_t> pyramid_t::dim(size_t idx_lvl) const
+{
+  std::vector<size_t> dim(m_dim);
+  dim[dim.size() - 2] = m_rows[idx_lvl];
+  dim[dim.size() - 1] = m_cols[idx_lvl];
+  return dim;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_t::layout
+//levels down to one cell, and their offsets after the header
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pyramid_t::layout(const std::vector<size_t> &dim)
+{
+  size_t nbr_dmn = dim.size();
+  m_dim = dim;
+  m_nbr_layer = 1;
+  for(size_t idx_dmn = 0; idx_dmn + 2 < nbr_dmn; idx_dmn++)
+  {
+    m_nbr_layer *= dim[idx_dmn];
+  }
+  m_rows.clear();
+  m_cols.clear();
+  m_off.clear();
+  qint64 off = sizeof(pyramid_magic) + sizeof(quint32) + m_key.size() + sizeof(quint32) + nbr_dmn * sizeof(quint64)
+    + sizeof(quint32) + sizeof(double);
+  off = (off + 63) / 64 * 64;
+  size_t rows = dim[nbr_dmn - 2];
+  size_t cols = dim[nbr_dmn - 1];
+  while(rows > 1 || cols > 1)
+  {
+    rows = (rows + 1) / 2;
+    cols = (cols + 1) / 2;
+    m_rows.push_back(rows);
+    m_cols.push_back(cols);
+    m_off.push_back(off);
+    off += (qint64)(3 * m_nbr_layer * rows * cols * sizeof(float));
+  }
+  m_off.push_back(off);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string pyramid_key(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm)
+{
+  QFileInfo info(QString::fromUtf8(file_name.c_str()));
+  QString key = QString("%1\n%2\n%3\n").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+  return std::string(key.toUtf8().data()) + grp_nm_fll + '\n' + var_nm;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_path
+//sidecar in the cache directory, named by the hash of the key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string pyramid_path(const std::string &key)
+{
+#if QT_VERSION >= 0x050000
+  QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pyramid";
+#else
+  QString dir = QDir::homePath() + "/.netcdf_explorer/pyramid";
+#endif
+  QDir().mkpath(dir);
+  QByteArray hash = QCryptographicHash::hash(QByteArray(key.c_str(), (int)key.size()), QCryptographicHash::Sha1).toHex();
+  return std::string((dir + "/" + QString::fromLatin1(hash.data()) + ".pyr").toUtf8().data());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_open
+//the sidecar of key if it is complete and of a variable of dimensions dim
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int pyramid_open(const std::string &key, const std::vector<size_t> &dim, pyramid_t *pyramid)
+{
+  if(dim.size() < 2)
+  {
+    return NC2_ERR;
+  }
+  QFile file(QString::fromUtf8(pyramid_path(key).c_str()));
+  if(!file.open(QIODevice::ReadOnly))
+  {
+    return NC2_ERR;
+  }
+  char magic[sizeof(pyramid_magic)];
+  quint32 key_sz = 0;
+  quint32 nbr_dmn = 0;
+  if(file.read(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, pyramid_magic, sizeof(magic)) != 0
+    || file.read((char*)&key_sz, sizeof(key_sz)) != sizeof(key_sz) || key_sz != key.size())
+  {
+    return NC2_ERR;
+  }
+  std::vector<char> key_file(key_sz);
+  if(key_sz > 0 && file.read(&key_file[0], key_sz) != key_sz)
+  {
+    return NC2_ERR;
+  }
+  if(std::string(key_file.begin(), key_file.end()) != key
+    || file.read((char*)&nbr_dmn, sizeof(nbr_dmn)) != sizeof(nbr_dmn) || nbr_dmn != dim.size())
+  {
+    return NC2_ERR;
+  }
+  for(size_t idx_dmn = 0; idx_dmn < dim.size(); idx_dmn++)
+  {
+    quint64 sz;
+    if(file.read((char*)&sz, sizeof(sz)) != sizeof(sz) || sz != dim[idx_dmn])
+    {
+      return NC2_ERR;
+    }
+  }
+  quint32 has_fill = 0;
+  double fill = 0;
+  if(file.read((char*)&has_fill, sizeof(has_fill)) != sizeof(has_fill) || file.read((char*)&fill, sizeof(fill)) != sizeof(fill))
+  {
+    return NC2_ERR;
+  }
+  pyramid->m_has_fill = has_fill != 0;
+  pyramid->m_fill = fill;
+  pyramid->m_key = key;
+  pyramid->layout(dim);
+  return file.size() == pyramid->m_off.back() ? NC_NOERR : NC2_ERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//downsample_rows
+//level 0 rows of the row pairs of a slab, columns first to first + nbr; rows is the number of
+//variable rows of the slab, cols of variable columns; cells of the _FillValue are skipped
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void downsample_rows(const void *buf, nc_type nc_typ, size_t rows, size_t cols, size_t first, size_t nbr,
+  bool has_fill, double fill, std::vector<pyramid_row_t> *out)
+{
+  size_t type_sz = get_type_size(nc_typ);
+  std::vector<double> x(2 * nbr + 1);
+  for(size_t row = 0; row < rows; row++)
+  {
+    pyramid_row_t &acc = (*out)[row / 2];
+    size_t col_first = 2 * first;
+    size_t nbr_col = std::min(2 * nbr, cols - col_first);
+    diff_to_double(static_cast<const char*> (buf) + (row * cols + col_first) * type_sz, nc_typ, nbr_col, &x[0]);
+    if(has_fill)
+    {
+      diff_fill_to_nan(&x[0], nbr_col, fill);
+    }
+    for(size_t idx = 0; idx < nbr_col; idx++)
+    {
+      if(x[idx] == x[idx])
+      {
+        acc.add(first + idx / 2, x[idx], 1, x[idx], x[idx]);
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_writer_t
+//rows of each level of one layer, in order; a row is written, then paired with the previous one of
+//its level to make a row of the next level
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class pyramid_writer_t
+{
+public:
+  pyramid_writer_t(const pyramid_t &pyramid, QFile *file) :
+    m_ok(true),
+    m_pyramid(pyramid),
+    m_file(file)
+  {
+  }
+  void start_layer(size_t idx_lyr)
+  {
+    m_idx_lyr = idx_lyr;
+    m_row.assign(m_pyramid.nbr_level(), 0);
+    m_pending.assign(m_pyramid.nbr_level(), pyramid_row_t());
+    m_has_pending.assign(m_pyramid.nbr_level(), false);
+  }
+  void add(size_t idx_lvl, pyramid_row_t &row);
+  void end_layer();
+  bool m_ok;
+
+private:
+  void next_level(size_t idx_lvl, const pyramid_row_t &row_a, const pyramid_row_t *row_b);
+  const pyramid_t &m_pyramid;
+  QFile *m_file;
+  size_t m_idx_lyr;
+  std::vector<size_t> m_row; // rows written of each level
+  std::vector<pyramid_row_t> m_pending; // first row of a pair, of each level
+  std::vector<bool> m_has_pending;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_writer_t::add
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pyramid_writer_t::add(size_t idx_lvl, pyramid_row_t &row)
+{
+  size_t cols = m_pyramid.m_cols[idx_lvl];
+  float none = m_pyramid.m_has_fill ? (float)m_pyramid.m_fill : std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> val(cols);
+  for(int stat = pyramid_mean; stat <= pyramid_max; stat++)
+  {
+    for(size_t idx = 0; idx < cols; idx++)
+    {
+      if(row.m_nbr[idx] == 0)
+      {
+        val[idx] = none;
+      }
+      else
+      {
+        val[idx] = (float)(stat == pyramid_mean ? row.m_sum[idx] / row.m_nbr[idx] : stat == pyramid_min ? row.m_min[idx] : row.m_max[idx]);
+      }
+    }
+    qint64 sz = (qint64)(cols * sizeof(float));
+    if(!m_file->seek(m_pyramid.offset(idx_lvl, stat, m_idx_lyr, m_row[idx_lvl])) || m_file->write((const char*)&val[0], sz) != sz)
+    {
+      m_ok = false;
+    }
+  }
+  m_row[idx_lvl]++;
+  if(idx_lvl + 1 == m_pyramid.nbr_level())
+  {
+    return;
+  }
+  if(!m_has_pending[idx_lvl])
+  {
+    std::swap(m_pending[idx_lvl], row);
+    m_has_pending[idx_lvl] = true;
+    return;
+  }
+  m_has_pending[idx_lvl] = false;
+  next_level(idx_lvl, m_pending[idx_lvl], &row);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_writer_t::end_layer
+//a last row without its pair makes a row of the next level alone
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pyramid_writer_t::end_layer()
+{
+  for(size_t idx_lvl = 0; idx_lvl + 1 < m_pyramid.nbr_level(); idx_lvl++)
+  {
+    if(m_has_pending[idx_lvl])
+    {
+      m_has_pending[idx_lvl] = false;
+      next_level(idx_lvl, m_pending[idx_lvl], NULL);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_writer_t::next_level
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void pyramid_writer_t::next_level(size_t idx_lvl, const pyramid_row_t &row_a, const pyramid_row_t *row_b)
+{
+  size_t cols = m_pyramid.m_cols[idx_lvl];
+  pyramid_row_t row;
+  row.resize(m_pyramid.m_cols[idx_lvl + 1]);
+  for(size_t idx = 0; idx < cols; idx++)
+  {
+    row.add(idx / 2, row_a.m_sum[idx], row_a.m_nbr[idx], row_a.m_min[idx], row_a.m_max[idx]);
+    if(row_b != NULL)
+    {
+      row.add(idx / 2, row_b->m_sum[idx], row_b->m_nbr[idx], row_b->m_min[idx], row_b->m_max[idx]);
+    }
+  }
+  add(idx_lvl + 1, row);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_build
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int pyramid_build(slab_source_t *source, const std::string &key, const diff_io_t &io, const std::atomic<bool> &cancel,
+  const std::function<void(double)> &progress)
+{
+  trace_t trace("pyramid_build", source->key().c_str());
+  const std::vector<size_t> &dim = source->dim();
+  nc_type nc_typ = source->type();
+  size_t nbr_dmn = dim.size();
+  if(nbr_dmn < 2 || !diff_type(nc_typ))
+  {
+    return NC2_ERR;
+  }
+  pyramid_t pyramid;
+  pyramid.m_key = key;
+  pyramid.layout(dim);
+  size_t rows = dim[nbr_dmn - 2];
+  size_t cols = dim[nbr_dmn - 1];
+  if(pyramid.nbr_level() == 0 || pyramid.m_nbr_layer == 0)
+  {
+    return NC2_ERR;
+  }
+  std::vector<size_t> chunk;
+  io([&]()
+  {
+    chunk = source->chunking();
+    pyramid.m_has_fill = source->fill_value(&pyramid.m_fill);
+  });
+
+  //header, then the levels, written in place
+  QString path = QString::fromUtf8(pyramid_path(key).c_str());
+  QFile file(path + ".tmp");
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !file.resize(pyramid.m_off.back()))
+  {
+    file.close();
+    QFile::remove(path + ".tmp");
+    return NC2_ERR;
+  }
+  quint32 key_sz = (quint32)key.size();
+  quint32 nbr_dmn_file = (quint32)nbr_dmn;
+  quint32 has_fill = pyramid.m_has_fill ? 1 : 0;
+  bool ok = file.write(pyramid_magic, sizeof(pyramid_magic)) == sizeof(pyramid_magic)
+    && file.write((const char*)&key_sz, sizeof(key_sz)) == sizeof(key_sz)
+    && file.write(key.c_str(), key_sz) == key_sz
+    && file.write((const char*)&nbr_dmn_file, sizeof(nbr_dmn_file)) == sizeof(nbr_dmn_file);
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn && ok; idx_dmn++)
+  {
+    quint64 sz = dim[idx_dmn];
+    ok = file.write((const char*)&sz, sizeof(sz)) == sizeof(sz);
+  }
+  ok = ok && file.write((const char*)&has_fill, sizeof(has_fill)) == sizeof(has_fill)
+    && file.write((const char*)&pyramid.m_fill, sizeof(pyramid.m_fill)) == sizeof(pyramid.m_fill);
+  if(!ok)
+  {
+    file.close();
+    QFile::remove(path + ".tmp");
+    return NC2_ERR;
+  }
+
+  //slabs of an even number of rows, whole chunks of rows when the storage is chunked
+  size_t rows_slab = std::max<size_t>(1, pyramid_slab_cells / std::max<size_t>(1, cols));
+  if(!chunk.empty() && chunk[nbr_dmn - 2] > 0)
+  {
+    rows_slab = std::max<size_t>(1, rows_slab / chunk[nbr_dmn - 2]) * chunk[nbr_dmn - 2];
+  }
+  rows_slab += rows_slab % 2;
+  size_t slab_lyr = (rows + rows_slab - 1) / rows_slab;
+  size_t nbr_slab = slab_lyr * pyramid.m_nbr_layer;
+
+  pyramid_writer_t writer(pyramid, &file);
+  std::vector<pyramid_row_t> out;
+  std::vector<slab_source_t*> sources(1, source);
+  int status = slab_stream(sources, nbr_slab, io, cancel, [&](size_t idx_slab, std::vector<size_t> *start, std::vector<size_t> *count)
+  {
+    size_t idx_lyr = idx_slab / slab_lyr;
+    for(size_t idx_dmn = nbr_dmn - 2; idx_dmn-- > 0;)
+    {
+      (*start)[idx_dmn] = idx_lyr % dim[idx_dmn];
+      (*count)[idx_dmn] = 1;
+      idx_lyr /= dim[idx_dmn];
+    }
+    (*start)[nbr_dmn - 2] = (idx_slab % slab_lyr) * rows_slab;
+    (*count)[nbr_dmn - 2] = std::min(rows_slab, rows - (*start)[nbr_dmn - 2]);
+  }, [&](size_t idx_slab, const std::vector<size_t> &, const std::vector<size_t> &count, const std::vector<buffer_t> &buf)
+  {
+    if(idx_slab % slab_lyr == 0)
+    {
+      writer.start_layer(idx_slab / slab_lyr);
+    }
+
+    //level 0 rows in parallel, by columns
+    size_t rows_cur = count[nbr_dmn - 2];
+    size_t cols_out = pyramid.m_cols[0];
+    out.resize((rows_cur + 1) / 2);
+    for(size_t idx = 0; idx < out.size(); idx++)
+    {
+      out[idx].resize(cols_out);
+    }
+    size_t nbr_thread = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), rows_cur * cols / 65536));
+    nbr_thread = std::min(nbr_thread, cols_out);
+    size_t part = (cols_out + nbr_thread - 1) / nbr_thread;
+    std::vector<std::thread> threads;
+    for(size_t idx_thread = 1; idx_thread < nbr_thread; idx_thread++)
+    {
+      size_t first = idx_thread * part;
+      size_t nbr_part = first < cols_out ? std::min(part, cols_out - first) : 0;
+      threads.push_back(std::thread(downsample_rows, buf[0].data(), nc_typ, rows_cur, cols, first, nbr_part,
+        pyramid.m_has_fill, pyramid.m_fill, &out));
+    }
+    downsample_rows(buf[0].data(), nc_typ, rows_cur, cols, 0, std::min(part, cols_out), pyramid.m_has_fill, pyramid.m_fill, &out);
+    for(size_t idx_thread = 0; idx_thread < threads.size(); idx_thread++)
+    {
+      threads[idx_thread].join();
+    }
+    for(size_t idx = 0; idx < out.size(); idx++)
+    {
+      writer.add(0, out[idx]);
+    }
+    if(idx_slab % slab_lyr == slab_lyr - 1)
+    {
+      writer.end_layer();
+    }
+    if(progress)
+    {
+      progress((double)(idx_slab + 1) / nbr_slab);
+    }
+    return writer.m_ok;
+  });
+
+  if(status == NC_NOERR && !file.flush())
+  {
+    status = NC2_ERR;
+  }
+  file.close();
+  if(status != NC_NOERR)
+  {
+    QFile::remove(path + ".tmp");
+    return status;
+  }
+  QFile::remove(path);
+  return QFile::rename(path + ".tmp", path) ? NC_NOERR : NC2_ERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_slab_source_t::read
+//by rows of the level, or by blocks of rows when whole rows are asked for
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t pyramid_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  size_t nbr_dmn = m_dim.size();
+  size_t nbr = 1;
+  size_t nbr_lyr = 1;
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    nbr *= count[idx_dmn];
+    nbr_lyr *= idx_dmn + 2 < nbr_dmn ? count[idx_dmn] : 1;
+  }
+  if(!m_file.isOpen())
+  {
+    m_file.setFileName(QString::fromUtf8(pyramid_path(m_pyramid.m_key).c_str()));
+    if(!m_file.open(QIODevice::ReadOnly))
+    {
+      return buffer_t();
+    }
+  }
+  trace_t trace("pyramid_slab_source_t::read", m_file.fileName().toUtf8().data(), nbr * sizeof(float));
+  buffer_t buf(nbr * sizeof(float));
+  if(buf.empty())
+  {
+    return buf;
+  }
+  size_t row_first = start[nbr_dmn - 2];
+  size_t nbr_row = count[nbr_dmn - 2];
+  size_t col_first = start[nbr_dmn - 1];
+  size_t nbr_col = count[nbr_dmn - 1];
+  size_t cols = m_dim[nbr_dmn - 1];
+  bool whole_rows = col_first == 0 && nbr_col == cols;
+  char *dst = static_cast<char*> (buf.data());
+  std::vector<size_t> idx(nbr_dmn - 2, 0);
+  for(size_t idx_lyr = 0; idx_lyr < nbr_lyr; idx_lyr++)
+  {
+    //layer in the variable
+    size_t lyr = 0;
+    for(size_t idx_dmn = 0; idx_dmn + 2 < nbr_dmn; idx_dmn++)
+    {
+      lyr = lyr * m_dim[idx_dmn] + start[idx_dmn] + idx[idx_dmn];
+    }
+    for(size_t row = row_first; row < row_first + nbr_row; row += whole_rows ? nbr_row : 1)
+    {
+      qint64 sz = (qint64)((whole_rows ? nbr_row * cols : nbr_col) * sizeof(float));
+      qint64 off = m_pyramid.offset(m_idx_lvl, m_stat, lyr, row) + (qint64)(col_first * sizeof(float));
+      if(!m_file.seek(off) || m_file.read(dst, sz) != sz)
+      {
+        return buffer_t();
+      }
+      dst += sz;
+    }
+    for(size_t idx_dmn = idx.size(); idx_dmn-- > 0;)
+    {
+      if(++idx[idx_dmn] < count[idx_dmn])
+      {
+        break;
+      }
+      idx[idx_dmn] = 0;
+    }
+  }
+  return buf;
+}
@@ -0,0 +1,125 @@
+#ifndef NETCDF_PYRAMID_H
+#define NETCDF_PYRAMID_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <QFile>
+#include "netcdf.h"
+#include "netcdf_io.hpp"
+#include "netcdf_diff.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//overview pyramid
+//levels of a variable of two or more dimensions downsampled 2x at each level along its last two
+//dimensions (the rows and columns of a table), for each layer of the others; each cell of a level
+//holds the mean, minimum and maximum of the block of variable cells it covers (NaN and _FillValue
+//skipped), or the _FillValue of the variable (NaN if it has none) when the block has no number
+//built once by streaming the variable, and kept in a sidecar file in the cache directory named after
+//the file identity (path, size, modification time) and the variable, so that an overview of a large
+//variable reads a few MB of the sidecar instead of the variable
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum pyramid_stat_t
+{
+  pyramid_mean,
+  pyramid_min,
+  pyramid_max
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_t
+//sidecar layout: a header (key, dimensions, _FillValue), then per level the mean, minimum and maximum planes, each of
+//layers x rows x columns float cells
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class pyramid_t
+{
+public:
+  pyramid_t() :
+    m_nbr_layer(0),
+    m_has_fill(false),
+    m_fill(0)
+  {
+  }
+  size_t nbr_level() const
+  {
+    return m_rows.size();
+  }
+  std::vector<size_t> dim(size_t idx_lvl) const;
+  qint64 offset(size_t idx_lvl, int stat, size_t idx_lyr, size_t row) const
+  {
+    return m_off[idx_lvl] + (qint64)(((stat * m_nbr_layer + idx_lyr) * m_rows[idx_lvl] + row) * m_cols[idx_lvl] * sizeof(float));
+  }
+  void layout(const std::vector<size_t> &dim);
+
+  std::string m_key; // file identity and variable
+  std::vector<size_t> m_dim; // dimensions of the variable
+  size_t m_nbr_layer; // product of the dimensions before the last two
+  std::vector<size_t> m_rows; // rows of each level; level 0 is 2x downsampled
+  std::vector<size_t> m_cols; // columns of each level
+  std::vector<qint64> m_off; // offset of each level in the sidecar
+  bool m_has_fill; // the variable has a _FillValue
+  double m_fill; // _FillValue of the variable, the value of cells with no number
+};
+
+std::string pyramid_key(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm);
+std::string pyramid_path(const std::string &key);
+int pyramid_open(const std::string &key, const std::vector<size_t> &dim, pyramid_t *pyramid);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_build
+//reads go through io (the I/O thread in the GUI) by slabs of rows aligned to the chunks, the next
+//slab read while the current one is downsampled in parallel; the sidecar is written to a temporary
+//file renamed when complete; progress gets the fraction done; stops with NC2_ERR when cancel is set
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int pyramid_build(slab_source_t *source, const std::string &key, const diff_io_t &io, const std::atomic<bool> &cancel,
+  const std::function<void(double)> &progress);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//pyramid_slab_source_t
+//NC_FLOAT slabs of one statistic of one level, read from the sidecar
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class pyramid_slab_source_t : public slab_source_t
+{
+public:
+  pyramid_slab_source_t(const pyramid_t &pyramid, size_t idx_lvl, int stat) :
+    m_pyramid(pyramid),
+    m_idx_lvl(idx_lvl),
+    m_stat(stat),
+    m_dim(pyramid.dim(idx_lvl))
+  {
+  }
+  nc_type type() const
+  {
+    return NC_FLOAT;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_dim;
+  }
+  std::string key() const
+  {
+    return "pyramid\n" + std::to_string(m_idx_lvl) + '\n' + std::to_string(m_stat) + '\n' + m_pyramid.m_key;
+  }
+  bool fill_value(double *fill)
+  {
+    *fill = m_pyramid.m_fill;
+    return m_pyramid.m_has_fill;
+  }
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+
+private:
+  pyramid_t m_pyramid;
+  size_t m_idx_lvl;
+  int m_stat; // pyramid_stat_t
+  std::vector<size_t> m_dim;
+  QFile m_file; // opened on the first read, on the I/O thread
+};
+
+#endif
@@ -0,0 +1,461 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QSharedMemory>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#include "netcdf_explorer.hpp"
+#include "netcdf_reader.hpp"
+#include "netcdf_trace.hpp"
+
+enum reader_op_t
+{
+  reader_op_read,
+  reader_op_close
+};
+
+//reply: status and bytes written to the segment
+static const int reader_reply = 12;
+
+//segments grow by steps of 16 MB
+static const size_t reader_segment_step = (size_t)16 << 20;
+
+//a process that takes more ms to take a request or to answer it is taken as hung, and the pool is killed
+static const int reader_timeout = 60000;
+
+static std::atomic<int> nbr_wanted(0);
+static std::mutex stats_mutex;
+static reader_stats_t stats;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_process_t
+//a worker process and its segment; the key changes when the segment is made larger
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class reader_process_t
+{
+public:
+  reader_process_t() :
+    m_process(NULL),
+    m_shm(NULL),
+    m_gen(0)
+  {
+  }
+  QProcess *m_process;
+  QSharedMemory *m_shm;
+  unsigned int m_gen;
+};
+
+//processes of the I/O thread, started for nbr_started processes wanted
+static std::vector<reader_process_t> readers;
+static int nbr_started = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_set_processes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reader_set_processes(int nbr)
+{
+  nbr_wanted = std::max(0, nbr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_processes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int reader_processes()
+{
+  return nbr_wanted;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+reader_stats_t reader_stats()
+{
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//send_frame
+//false if the process ended or did not take the frame within reader_timeout
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool send_frame(QProcess *process, const QByteArray &payload)
+{
+  QByteArray frame;
+  QDataStream out(&frame, QIODevice::WriteOnly);
+  out << (quint32)payload.size();
+  frame.append(payload);
+  if(process->write(frame) != frame.size())
+  {
+    return false;
+  }
+  return process->waitForBytesWritten(reader_timeout);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//receive_reply
+//false if the process ended before replying or did not reply within reader_timeout
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool receive_reply(QProcess *process, qint32 *status, quint64 *bytes)
+{
+  QElapsedTimer timer;
+  timer.start();
+  while(process->bytesAvailable() < reader_reply)
+  {
+    qint64 left = reader_timeout - timer.elapsed();
+    if(left <= 0 || !process->waitForReadyRead((int)left))
+    {
+      return false;
+    }
+  }
+  QByteArray reply = process->read(reader_reply);
+  QDataStream in(reply);
+  in >> *status >> *bytes;
+  return in.status() == QDataStream::Ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_close_all
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reader_close_all()
+{
+  for(size_t idx = 0; idx < readers.size(); idx++)
+  {
+    //the worker ends at the end of its input
+    readers[idx].m_process->closeWriteChannel();
+    if(!readers[idx].m_process->waitForFinished(1000))
+    {
+      readers[idx].m_process->kill();
+      readers[idx].m_process->waitForFinished(1000);
+    }
+    delete readers[idx].m_process;
+    delete readers[idx].m_shm;
+  }
+  readers.clear();
+  nbr_started = 0;
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  stats.m_nbr_process = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_start
+//processes that do not start are left out of the pool
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reader_start(int nbr)
+{
+  reader_close_all();
+  for(int idx = 0; idx < nbr; idx++)
+  {
+    reader_process_t reader;
+    reader.m_process = new QProcess;
+#if QT_VERSION >= 0x050200
+    reader.m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+#endif
+    reader.m_process->start(QCoreApplication::applicationFilePath(), QStringList() << "--reader");
+    if(!reader.m_process->waitForStarted(5000))
+    {
+      delete reader.m_process;
+      continue;
+    }
+    reader.m_shm = new QSharedMemory;
+    readers.push_back(reader);
+  }
+  nbr_started = nbr;
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  stats.m_nbr_process = readers.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reserve_segment
+//a larger segment is a new one, under a new key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool reserve_segment(reader_process_t &reader, size_t size, size_t idx)
+{
+  if(reader.m_shm->isAttached() && (size_t)reader.m_shm->size() >= size)
+  {
+    return true;
+  }
+  reader.m_shm->detach();
+  reader.m_gen++;
+  reader.m_shm->setKey(QString("netcdf-explorer-%1-%2-%3").arg(QCoreApplication::applicationPid())
+    .arg((qulonglong)idx).arg(reader.m_gen));
+  size = (size + reader_segment_step - 1) / reader_segment_step * reader_segment_step;
+  return size <= (size_t)INT_MAX && reader.m_shm->create((int)size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_read
+//the parts are ranges of the first dimension with more than one index, so that each is contiguous
+//in the box; their bounds are on chunk bounds when the dimension has enough chunks, so that no chunk
+//is decompressed by two processes; all the requests are sent before any reply is read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int reader_read(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm,
+  nc_type nc_typ, const std::vector<size_t> &start, const std::vector<size_t> &count,
+  const std::vector<size_t> &chunk, buffer_t *buf)
+{
+  if(nbr_started != nbr_wanted)
+  {
+    reader_start(nbr_wanted);
+  }
+  if(readers.empty() || nc_typ < NC_BYTE || nc_typ >= NC_STRING)
+  {
+    return NC2_ERR;
+  }
+
+  //dimension to split
+  size_t nbr_dmn = count.size();
+  size_t dmn = 0;
+  while(dmn < nbr_dmn && count[dmn] == 1)
+  {
+    dmn++;
+  }
+  size_t nbr_elm = 1;
+  for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    nbr_elm *= count[idx_dmn];
+  }
+  size_t type_sz = get_type_size(nc_typ);
+  size_t bytes = nbr_elm * type_sz;
+  size_t nbr_part = std::min(std::min(readers.size(), bytes / reader_min_part), dmn < nbr_dmn ? count[dmn] : 0);
+  if(nbr_part < 2)
+  {
+    return NC2_ERR;
+  }
+  size_t row_bytes = bytes / count[dmn];
+  size_t chunk_dmn = chunk.size() == nbr_dmn ? chunk[dmn] : 1;
+  if(chunk_dmn == 0 || count[dmn] / chunk_dmn < nbr_part)
+  {
+    chunk_dmn = 1;
+  }
+  std::vector<size_t> bound(nbr_part + 1);
+  bound[0] = start[dmn];
+  bound[nbr_part] = start[dmn] + count[dmn];
+  for(size_t idx = 1; idx < nbr_part; idx++)
+  {
+    size_t pos = start[dmn] + count[dmn] * idx / nbr_part;
+    pos = (pos + chunk_dmn / 2) / chunk_dmn * chunk_dmn;
+    bound[idx] = std::min(std::max(pos, bound[idx - 1]), bound[nbr_part]);
+  }
+
+  buffer_t out(bytes);
+  if(out.empty())
+  {
+    return NC2_ERR;
+  }
+  bool ok = true;
+  bool hung = false;
+  std::vector<size_t> sent;
+  for(size_t idx = 0; idx < nbr_part && ok; idx++)
+  {
+    size_t nbr_row = bound[idx + 1] - bound[idx];
+    if(nbr_row == 0)
+    {
+      continue;
+    }
+    reader_process_t &reader = readers[idx];
+    ok = reserve_segment(reader, nbr_row * row_bytes, idx);
+    QByteArray req;
+    QDataStream out_req(&req, QIODevice::WriteOnly);
+    out_req << (qint32)reader_op_read << reader.m_shm->key() << (quint64)reader.m_shm->size()
+      << QByteArray(file_name.c_str()) << QByteArray(grp_nm_fll.c_str()) << QByteArray(var_nm.c_str())
+      << (qint32)nc_typ << (quint32)nbr_dmn;
+    for(size_t idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      out_req << (quint64)(idx_dmn == dmn ? bound[idx] : start[idx_dmn]);
+      out_req << (quint64)(idx_dmn == dmn ? nbr_row : count[idx_dmn]);
+    }
+    if(ok && !send_frame(reader.m_process, req))
+    {
+      ok = false;
+      hung = true;
+    }
+    if(ok)
+    {
+      sent.push_back(idx);
+    }
+  }
+
+  //every request sent is answered, also after a failure, so that the replies stay in order; after a
+  //missing reply they do not, and the pool is killed
+  for(size_t idx_snt = 0; idx_snt < sent.size() && !hung; idx_snt++)
+  {
+    size_t idx = sent[idx_snt];
+    reader_process_t &reader = readers[idx];
+    qint32 status;
+    quint64 nbr_byt;
+    size_t part_bytes = (bound[idx + 1] - bound[idx]) * row_bytes;
+    if(!receive_reply(reader.m_process, &status, &nbr_byt))
+    {
+      ok = false;
+      hung = true;
+      continue;
+    }
+    if(status != NC_NOERR || nbr_byt != part_bytes)
+    {
+      ok = false;
+      continue;
+    }
+    trace_t trace("reader_copy", var_nm.c_str(), part_bytes);
+    memcpy(out.as<char>() + (bound[idx] - start[dmn]) * row_bytes, reader.m_shm->constData(), part_bytes);
+  }
+
+  if(!ok)
+  {
+    //the pool is started again at the next read if a process ended or hung
+    for(size_t idx = 0; idx < readers.size(); idx++)
+    {
+      if(hung || readers[idx].m_process->state() != QProcess::Running)
+      {
+        reader_close_all();
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats.m_nbr_fallback++;
+    return NC2_ERR;
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  stats.m_nbr_read++;
+  stats.m_nbr_part += sent.size();
+  stats.m_bytes += bytes;
+  *buf = std::move(out);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_close
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reader_close(const std::string &file_name)
+{
+  for(size_t idx = 0; idx < readers.size(); idx++)
+  {
+    QByteArray req;
+    QDataStream out(&req, QIODevice::WriteOnly);
+    out << (qint32)reader_op_close << QByteArray(file_name.c_str());
+    if(!send_frame(readers[idx].m_process, req))
+    {
+      reader_close_all();
+      return;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//read_input
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool read_input(char *buf, size_t size)
+{
+  return fread(buf, 1, size, stdin) == size;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader_serve
+//a failed read is answered with its status, and the worker goes on
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int reader_serve()
+{
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  QSharedMemory shm;
+  for(;;)
+  {
+    char header[4];
+    if(!read_input(header, sizeof(header)))
+    {
+      return 0;
+    }
+    quint32 size;
+    QByteArray ba_size(header, sizeof(header));
+    QDataStream in_size(ba_size);
+    in_size >> size;
+    QByteArray payload(size, '\0');
+    if(size && !read_input(payload.data(), size))
+    {
+      return 0;
+    }
+
+    QDataStream in(payload);
+    qint32 op;
+    in >> op;
+    if(op == reader_op_close)
+    {
+      QByteArray path;
+      in >> path;
+      io_close(path.constData());
+      continue;
+    }
+
+    QString key;
+    quint64 shm_size;
+    QByteArray path;
+    QByteArray grp_nm_fll;
+    QByteArray var_nm;
+    qint32 nc_typ;
+    quint32 nbr_dmn;
+    in >> key >> shm_size >> path >> grp_nm_fll >> var_nm >> nc_typ >> nbr_dmn;
+    std::vector<size_t> start;
+    std::vector<size_t> count;
+    size_t bytes = get_type_size((nc_type)nc_typ);
+    for(quint32 idx_dmn = 0; idx_dmn < nbr_dmn && in.status() == QDataStream::Ok; idx_dmn++)
+    {
+      quint64 beg;
+      quint64 cnt;
+      in >> beg >> cnt;
+      start.push_back((size_t)beg);
+      count.push_back((size_t)cnt);
+      bytes *= (size_t)cnt;
+    }
+
+    qint32 status = NC2_ERR;
+    if(in.status() == QDataStream::Ok && shm.key() != key)
+    {
+      shm.detach();
+      shm.setKey(key);
+      shm.attach();
+    }
+    int nc_id;
+    int grp_id;
+    int var_id;
+    if(in.status() == QDataStream::Ok && shm.isAttached() && bytes <= (size_t)shm.size()
+      && io_open(path.constData(), &nc_id) == NC_NOERR && inq_grp_id(nc_id, grp_nm_fll.constData(), &grp_id) == NC_NOERR
+      && NC_TRACE("nc_inq_varid", var_nm.constData(), 0, nc_inq_varid(grp_id, var_nm.constData(), &var_id)) == NC_NOERR)
+    {
+      status = NC_TRACE("nc_get_vara", var_nm.constData(), bytes,
+        nc_get_vara(grp_id, var_id, start.data(), count.data(), shm.data()));
+    }
+
+    QByteArray reply;
+    QDataStream out(&reply, QIODevice::WriteOnly);
+    out << status << (quint64)(status == NC_NOERR ? bytes : 0);
+    if(fwrite(reply.constData(), 1, reply.size(), stdout) != (size_t)reply.size() || fflush(stdout) != 0)
+    {
+      return 1;
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef NETCDF_READER_H
+#define NETCDF_READER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reader processes
+//the netCDF library serializes all its calls, so one process reads one hyperslab at a time; when the
+//pool is on, a large box of a local file is split along its outer dimension among worker processes
+//(this binary started with --reader), each with its own netCDF handles, which read their parts into
+//shared memory segments mapped by the I/O thread; the pool is off by default
+//protocol on the standard input of a worker: frames of a 4 byte size and a QDataStream payload; a
+//read is answered on its standard output by a status and the bytes written to the segment
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//smallest part given to a process; boxes of less than two parts (tiles of tables) are read in process
+static const size_t reader_min_part = (size_t)1 << 20;
+
+class reader_stats_t
+{
+public:
+  reader_stats_t() :
+    m_nbr_process(0),
+    m_nbr_read(0),
+    m_nbr_part(0),
+    m_nbr_fallback(0),
+    m_bytes(0)
+  {
+  }
+  size_t m_nbr_process; // processes running
+  size_t m_nbr_read; // boxes read by the pool
+  size_t m_nbr_part; // parts sent to the processes
+  size_t m_nbr_fallback; // boxes read in process after a process failed
+  size_t m_bytes; // bytes read by the processes
+};
+
+//number of processes, 0 for none; applied by the I/O thread at its next read
+void reader_set_processes(int nbr);
+int reader_processes();
+reader_stats_t reader_stats();
+
+//the box start/count of a variable of a local file, split on the chunks of chunk if not empty; NC2_ERR
+//if the box must be read in process; I/O thread only
+int reader_read(const std::string &file_name, const std::string &grp_nm_fll, const std::string &var_nm,
+  nc_type nc_typ, const std::vector<size_t> &start, const std::vector<size_t> &count,
+  const std::vector<size_t> &chunk, buffer_t *buf);
+
+//closes a file in the processes, with io_close, so that they see records appended since
+void reader_close(const std::string &file_name);
+void reader_close_all();
+
+//main loop of a worker process, until its standard input is closed
+int reader_serve();
+
+#endif
@@ -0,0 +1,411 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "netcdf_explorer.hpp"
+#include "netcdf_reduce.hpp"
+#include "netcdf_trace.hpp"
+
+//cells of a slab of records, about 4 MB of doubles
+static const size_t reduce_slab_cells = (size_t)1 << 19;
+
+//cells converted to double at a time
+static const size_t reduce_block_cells = 4096;
+
+//bytes of results kept by the cache
+static const size_t reduce_cache_bytes = (size_t)256 << 20;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_name
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* reduce_name(int op)
+{
+  switch(op)
+  {
+  case reduce_mean:
+    return "mean";
+  case reduce_min:
+    return "min";
+  case reduce_max:
+    return "max";
+  case reduce_sum:
+    return "sum";
+  case reduce_std:
+    return "std";
+  }
+  return "";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_acc_t
+//per result cell: number of values, and the sum, minimum, maximum or running mean (Welford) with the
+//sum of squared deviations for the standard deviation
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class reduce_acc_t
+{
+public:
+  reduce_acc_t(int op, size_t nbr) :
+    m_op(op),
+    m_nbr(nbr, 0),
+    m_val(nbr, 0),
+    m_m2(op == reduce_std ? nbr : 0, 0)
+  {
+  }
+  void add(const double *x, size_t nbr, size_t idx_out);
+  void result(std::vector<double> *result);
+  int m_op;
+  std::vector<double> m_nbr;
+  std::vector<double> m_val;
+  std::vector<double> m_m2;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_acc_t::add
+//values x go to result cells idx_out to idx_out + nbr
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reduce_acc_t::add(const double *x, size_t nbr, size_t idx_out)
+{
+  double *n = &m_nbr[idx_out];
+  double *v = &m_val[idx_out];
+  switch(m_op)
+  {
+  case reduce_sum:
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      bool ok = x[idx] == x[idx];
+      n[idx] += ok;
+      v[idx] += ok ? x[idx] : 0;
+    }
+    break;
+  case reduce_min:
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      if(x[idx] == x[idx] && (n[idx] == 0 || x[idx] < v[idx]))
+      {
+        v[idx] = x[idx];
+        n[idx] = 1;
+      }
+    }
+    break;
+  case reduce_max:
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      if(x[idx] == x[idx] && (n[idx] == 0 || x[idx] > v[idx]))
+      {
+        v[idx] = x[idx];
+        n[idx] = 1;
+      }
+    }
+    break;
+  case reduce_mean:
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      if(x[idx] == x[idx])
+      {
+        n[idx] += 1;
+        v[idx] += (x[idx] - v[idx]) / n[idx];
+      }
+    }
+    break;
+  case reduce_std:
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      if(x[idx] == x[idx])
+      {
+        double *m2 = &m_m2[idx_out];
+        double delta = x[idx] - v[idx];
+        n[idx] += 1;
+        v[idx] += delta / n[idx];
+        m2[idx] += delta * (x[idx] - v[idx]);
+      }
+    }
+    break;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_acc_t::result
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reduce_acc_t::result(std::vector<double> *result)
+{
+  for(size_t idx = 0; idx < m_val.size(); idx++)
+  {
+    if(m_nbr[idx] == 0)
+    {
+      m_val[idx] = std::numeric_limits<double>::quiet_NaN();
+    }
+    else if(m_op == reduce_std)
+    {
+      m_val[idx] = std::sqrt(m_m2[idx] / m_nbr[idx]);
+    }
+  }
+  result->swap(m_val);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_layout_t
+//a slab of records seen as rows of len x inner cells, reduced over len; row r of the slab goes to
+//result row out_first + r, or to row 0 when reducing over the records themselves
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class reduce_layout_t
+{
+public:
+  size_t m_nbr_row;
+  size_t m_len;
+  size_t m_inner;
+  size_t m_out_first;
+  bool m_over_rec;
+  bool m_has_fill;
+  double m_fill;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_part
+//rows row_first to row_first + nbr_row, result columns inner_first to inner_first + nbr_inner
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reduce_part(const void *buf, nc_type nc_typ, const reduce_layout_t &layout, size_t row_first, size_t nbr_row,
+  size_t inner_first, size_t nbr_inner, reduce_acc_t *acc)
+{
+  size_t type_sz = get_type_size(nc_typ);
+  bool convert = nc_typ != NC_DOUBLE || layout.m_has_fill;
+  std::vector<double> blk(convert ? reduce_block_cells : 0);
+  for(size_t row = row_first; row < row_first + nbr_row; row++)
+  {
+    size_t out_row = layout.m_over_rec ? 0 : layout.m_out_first + row;
+    for(size_t idx_len = 0; idx_len < layout.m_len; idx_len++)
+    {
+      size_t off = (row * layout.m_len + idx_len) * layout.m_inner;
+      for(size_t idx = inner_first; idx < inner_first + nbr_inner; idx += reduce_block_cells)
+      {
+        size_t nbr_blk = std::min(reduce_block_cells, inner_first + nbr_inner - idx);
+        const char *src = static_cast<const char*> (buf) + (off + idx) * type_sz;
+        const double *x = reinterpret_cast<const double*> (src);
+        if(convert)
+        {
+          diff_to_double(src, nc_typ, nbr_blk, &blk[0]);
+          if(layout.m_has_fill)
+          {
+            diff_fill_to_nan(&blk[0], nbr_blk, layout.m_fill);
+          }
+          x = &blk[0];
+        }
+        acc->add(x, nbr_blk, out_row * layout.m_inner + idx);
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_slab
+//the threads own disjoint result cells: the rows are split among them, or the columns when there
+//are fewer rows than threads or all rows go to the same result row
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reduce_slab(const void *buf, nc_type nc_typ, const reduce_layout_t &layout, reduce_acc_t *acc)
+{
+  size_t nbr = layout.m_nbr_row * layout.m_len * layout.m_inner;
+  size_t nbr_thread = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), nbr / (16 * reduce_block_cells)));
+  bool split_rows = !layout.m_over_rec && layout.m_nbr_row >= nbr_thread;
+  size_t nbr_split = split_rows ? layout.m_nbr_row : layout.m_inner;
+  nbr_thread = std::max<size_t>(1, std::min(nbr_thread, nbr_split));
+  size_t part = (nbr_split + nbr_thread - 1) / nbr_thread;
+  std::vector<std::thread> threads;
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    size_t first = idx_thread * part;
+    size_t nbr_part = first < nbr_split ? std::min(part, nbr_split - first) : 0;
+    size_t row_first = split_rows ? first : 0;
+    size_t nbr_row = split_rows ? nbr_part : layout.m_nbr_row;
+    size_t inner_first = split_rows ? 0 : first;
+    size_t nbr_inner = split_rows ? layout.m_inner : nbr_part;
+    if(idx_thread + 1 == nbr_thread)
+    {
+      reduce_part(buf, nc_typ, layout, row_first, nbr_row, inner_first, nbr_inner, acc);
+    }
+    else
+    {
+      threads.push_back(std::thread(reduce_part, buf, nc_typ, std::cref(layout), row_first, nbr_row, inner_first, nbr_inner, acc));
+    }
+  }
+  for(size_t idx_thread = 0; idx_thread < threads.size(); idx_thread++)
+  {
+    threads[idx_thread].join();
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_stream
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int reduce_stream(slab_source_t *source, size_t dmn, int op, const diff_io_t &io, const std::atomic<bool> &cancel,
+  const std::function<void(double)> &progress, std::vector<double> *result)
+{
+  trace_t trace("reduce_stream", source->key().c_str());
+  const std::vector<size_t> &dim = source->dim();
+  nc_type nc_typ = source->type();
+  if(dmn >= dim.size() || !diff_type(nc_typ))
+  {
+    return NC2_ERR;
+  }
+
+  //rows of a record: the dimensions between the records and the reduced one
+  reduce_layout_t layout;
+  size_t nbr_rec = dim[0];
+  size_t rec_row = 1;
+  layout.m_len = dmn == 0 ? 1 : dim[dmn];
+  layout.m_inner = 1;
+  layout.m_over_rec = dmn == 0;
+  layout.m_has_fill = false;
+  layout.m_fill = 0;
+  for(size_t idx_dmn = 1; idx_dmn < dmn; idx_dmn++)
+  {
+    rec_row *= dim[idx_dmn];
+  }
+  for(size_t idx_dmn = dmn + 1; idx_dmn < dim.size(); idx_dmn++)
+  {
+    layout.m_inner *= dim[idx_dmn];
+  }
+  size_t rec_cells = rec_row * layout.m_len * layout.m_inner;
+  size_t nbr_out = (dmn == 0 ? 1 : nbr_rec * rec_row) * layout.m_inner;
+  reduce_acc_t acc(op, nbr_out);
+  if(nbr_rec == 0 || rec_cells == 0)
+  {
+    acc.result(result);
+    return NC_NOERR;
+  }
+
+  //slabs of whole chunks of records, when the storage is chunked
+  std::vector<size_t> chunk;
+  io([&]()
+  {
+    chunk = source->chunking();
+    layout.m_has_fill = source->fill_value(&layout.m_fill);
+  });
+  size_t rec_slab = std::max<size_t>(1, reduce_slab_cells / rec_cells);
+  if(!chunk.empty() && chunk[0] > 0)
+  {
+    rec_slab = std::max<size_t>(1, rec_slab / chunk[0]) * chunk[0];
+  }
+
+  size_t nbr_slab = (nbr_rec + rec_slab - 1) / rec_slab;
+
+  std::vector<slab_source_t*> sources(1, source);
+  int status = slab_stream(sources, nbr_slab, io, cancel, [&](size_t idx_slab, std::vector<size_t> *start, std::vector<size_t> *count)
+  {
+    (*start)[0] = idx_slab * rec_slab;
+    (*count)[0] = std::min(rec_slab, nbr_rec - (*start)[0]);
+  }, [&](size_t idx_slab, const std::vector<size_t> &start, const std::vector<size_t> &count, const std::vector<buffer_t> &buf)
+  {
+    layout.m_nbr_row = count[0] * rec_row;
+    layout.m_out_first = start[0] * rec_row;
+    reduce_slab(buf[0].data(), nc_typ, layout, &acc);
+    if(progress)
+    {
+      progress((double)std::min((idx_slab + 1) * rec_slab, nbr_rec) / nbr_rec);
+    }
+    return true;
+  });
+  if(status != NC_NOERR)
+  {
+    return status;
+  }
+  acc.result(result);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduction cache
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::mutex cache_mutex;
+static std::list<std::pair<std::string, std::shared_ptr<const std::vector<double> > > > cache; // most recent first
+static size_t cache_bytes = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string reduce_key(slab_source_t *source, size_t dmn, int op)
+{
+  std::string key = std::string("reduce\n") + reduce_name(op) + '\n' + std::to_string(dmn) + '\n';
+  for(size_t idx_dmn = 0; idx_dmn < source->dim().size(); idx_dmn++)
+  {
+    key += std::to_string(source->dim()[idx_dmn]) + ',';
+  }
+  return key + '\n' + source->key();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_cache_find
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const std::vector<double> > reduce_cache_find(const std::string &key)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  for(auto it = cache.begin(); it != cache.end(); ++it)
+  {
+    if(it->first == key)
+    {
+      cache.splice(cache.begin(), cache, it);
+      return cache.front().second;
+    }
+  }
+  return std::shared_ptr<const std::vector<double> >();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_cache_add
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reduce_cache_add(const std::string &key, const std::shared_ptr<const std::vector<double> > &result)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache.push_front(std::make_pair(key, result));
+  cache_bytes += result->size() * sizeof(double);
+  while(cache_bytes > reduce_cache_bytes && cache.size() > 1)
+  {
+    cache_bytes -= cache.back().second->size() * sizeof(double);
+    cache.pop_back();
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_slab_source_t::read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t reduce_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  size_t nbr = 1;
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
+  {
+    nbr *= count[idx_dmn];
+  }
+  size_t nbr_result = 1;
+  for(size_t idx_dmn = 0; idx_dmn < m_dim.size(); idx_dmn++)
+  {
+    nbr_result *= m_dim[idx_dmn];
+  }
+  if(m_result->size() != nbr_result)
+  {
+    return buffer_t();
+  }
+  buffer_t buf(nbr * sizeof(double));
+  if(!buf.empty())
+  {
+    copy_slab(buf.data(), start, count, m_result->data(), std::vector<size_t>(m_dim.size(), 0), m_dim, sizeof(double));
+  }
+  return buf;
+}
@@ -0,0 +1,86 @@
+#ifndef NETCDF_REDUCE_H
+#define NETCDF_REDUCE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_io.hpp"
+#include "netcdf_diff.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduction along a dimension
+//the mean, minimum, maximum, sum or standard deviation of a variable along one of its dimensions (over
+//time, over levels), a variable of one dimension less; the variable is read by slabs of records
+//aligned to its chunks, each slab reduced in parallel, so that memory is bounded by the result
+//NaN and _FillValue cells are skipped; cells with no number are NaN
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum reduce_op_t
+{
+  reduce_mean,
+  reduce_min,
+  reduce_max,
+  reduce_sum,
+  reduce_std // population standard deviation
+};
+
+const char* reduce_name(int op);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_stream
+//reads go through io (the I/O thread in the GUI), the next slab read while the current one is reduced;
+//progress gets the fraction done; stops with NC2_ERR when cancel is set
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int reduce_stream(slab_source_t *source, size_t dmn, int op, const diff_io_t &io, const std::atomic<bool> &cancel,
+  const std::function<void(double)> &progress, std::vector<double> *result);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduction cache
+//results by reduce_key, the least recently used dropped above 256 MB; the key has the dimensions of the
+//source, so that a variable that grew is reduced again
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string reduce_key(slab_source_t *source, size_t dmn, int op);
+std::shared_ptr<const std::vector<double> > reduce_cache_find(const std::string &key);
+void reduce_cache_add(const std::string &key, const std::shared_ptr<const std::vector<double> > &result);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//reduce_slab_source_t
+//NC_DOUBLE slabs of a computed reduction, held in memory
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class reduce_slab_source_t : public slab_source_t
+{
+public:
+  reduce_slab_source_t(const std::string &key, const std::vector<size_t> &dim, const std::shared_ptr<const std::vector<double> > &result) :
+    m_key(key),
+    m_dim(dim),
+    m_result(result)
+  {
+  }
+  nc_type type() const
+  {
+    return NC_DOUBLE;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_dim;
+  }
+  std::string key() const
+  {
+    return m_key;
+  }
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+
+private:
+  std::string m_key;
+  std::vector<size_t> m_dim;
+  std::shared_ptr<const std::vector<double> > m_result;
+};
+
+#endif
@@ -0,0 +1,1114 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QCoreApplication>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include "netcdf_explorer.hpp"
+#include "netcdf_remote.hpp"
+#include "netcdf_trace.hpp"
+
+static const char remote_scheme[] = "ncx://";
+static const char remote_magic[] = "ncx1";
+static const int remote_header = 16;
+static const int remote_max_request = 1 << 24; // bytes; requests are names and boxes
+static const unsigned int remote_max_reply = INT_MAX - remote_header; // bytes; the most a QByteArray holds with its header
+static const int remote_compress_min = 256; // bytes; smaller replies are not compressed
+
+//header flags
+static const int remote_flag_compress = 1; // request: the reply may be compressed
+static const int remote_flag_compressed = 2; // payload compressed with qCompress
+
+//clients ask for compressed replies unless turned off, as netcdf_bench does to compare
+static std::atomic<bool> compress_replies(true);
+
+//connections of the I/O thread, by host:port
+static std::map<std::string, remote_connection_t*> connections;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//put_u32, put_u64, put_str, put_bytes
+//integers little endian; strings and bytes after their size
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void put_u32(QByteArray &ba, unsigned int val)
+{
+  char buf[4];
+  for(int idx = 0; idx < 4; idx++)
+  {
+    buf[idx] = (char)((val >> (8 * idx)) & 0xFF);
+  }
+  ba.append(buf, 4);
+}
+
+static void put_u64(QByteArray &ba, unsigned long long val)
+{
+  put_u32(ba, (unsigned int)(val & 0xFFFFFFFFull));
+  put_u32(ba, (unsigned int)(val >> 32));
+}
+
+static void put_str(QByteArray &ba, const std::string &str)
+{
+  put_u32(ba, (unsigned int)str.size());
+  ba.append(str.data(), (int)str.size());
+}
+
+static void put_bytes(QByteArray &ba, const void *ptr, size_t size)
+{
+  put_u64(ba, size);
+  if(size)
+  {
+    ba.append(static_cast<const char*> (ptr), (int)size);
+  }
+}
+
+template <typename T>
+static void put_vector(QByteArray &ba, const std::vector<T> &vec)
+{
+  put_bytes(ba, vec.data(), vec.size() * sizeof(T));
+}
+
+static void put_sizes(QByteArray &ba, const std::vector<size_t> &vec)
+{
+  put_u32(ba, (unsigned int)vec.size());
+  for(size_t idx = 0; idx < vec.size(); idx++)
+  {
+    put_u64(ba, vec[idx]);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//get_u32
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int get_u32(const char *ptr)
+{
+  unsigned int val = 0;
+  for(int idx = 0; idx < 4; idx++)
+  {
+    val |= (unsigned int)(unsigned char)ptr[idx] << (8 * idx);
+  }
+  return val;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_reader_t
+//reads a payload in the order it was written; m_ok is false after a read past its end
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class remote_reader_t
+{
+public:
+  remote_reader_t(const QByteArray &ba) :
+    m_ba(ba),
+    m_pos(0),
+    m_ok(true)
+  {
+  }
+  bool take(size_t size)
+  {
+    m_ok = m_ok && size <= (size_t)(m_ba.size() - m_pos);
+    return m_ok;
+  }
+  unsigned int u32()
+  {
+    if(!take(4))
+    {
+      return 0;
+    }
+    m_pos += 4;
+    return get_u32(m_ba.constData() + m_pos - 4);
+  }
+  unsigned long long u64()
+  {
+    unsigned long long lo = u32();
+    unsigned long long hi = u32();
+    return lo | (hi << 32);
+  }
+  std::string str()
+  {
+    size_t size = u32();
+    if(!take(size))
+    {
+      return std::string();
+    }
+    m_pos += (int)size;
+    return std::string(m_ba.constData() + m_pos - size, size);
+  }
+  const char* bytes(size_t *size)
+  {
+    *size = (size_t)u64();
+    if(!take(*size))
+    {
+      *size = 0;
+      return NULL;
+    }
+    m_pos += (int)*size;
+    return m_ba.constData() + m_pos - *size;
+  }
+  template <typename T>
+  void vector(std::vector<T> *vec)
+  {
+    size_t size;
+    const char *ptr = bytes(&size);
+    vec->resize(size / sizeof(T));
+    if(size)
+    {
+      memcpy(static_cast<void*> (vec->data()), ptr, vec->size() * sizeof(T));
+    }
+  }
+  std::vector<size_t> sizes()
+  {
+    std::vector<size_t> vec(std::min<size_t>(u32(), NC_MAX_VAR_DIMS));
+    for(size_t idx = 0; idx < vec.size(); idx++)
+    {
+      vec[idx] = (size_t)u64();
+    }
+    return vec;
+  }
+
+  const QByteArray &m_ba;
+  int m_pos;
+  bool m_ok;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//make_frame
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static QByteArray make_frame(unsigned int id, int type, int flags, int status, const QByteArray &payload)
+{
+  QByteArray frame;
+  frame.reserve(remote_header + payload.size());
+  put_u32(frame, (unsigned int)payload.size());
+  put_u32(frame, id);
+  frame.append((char)type);
+  frame.append((char)flags);
+  frame.append((char)0);
+  frame.append((char)0);
+  put_u32(frame, (unsigned int)status);
+  frame.append(payload);
+  return frame;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//hello
+//what both ends must agree on to exchange buffers as they are in memory
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static QByteArray hello()
+{
+  unsigned int one = 1;
+  QByteArray ba(remote_magic);
+  ba.append((char)sizeof(size_t));
+  ba.append(*reinterpret_cast<const char*> (&one));
+  return ba;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//is_remote
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool is_remote(const std::string &file_name)
+{
+  return file_name.compare(0, sizeof(remote_scheme) - 1, remote_scheme) == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_parse
+//ncx://host:port/path, ncx://host/path with the default port; the path is the one on the server
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool remote_parse(const std::string &url, std::string *host, unsigned short *port, std::string *path)
+{
+  if(!is_remote(url))
+  {
+    return false;
+  }
+  size_t pos_host = sizeof(remote_scheme) - 1;
+  size_t pos_path = url.find('/', pos_host);
+  if(pos_path == std::string::npos || pos_path == pos_host)
+  {
+    return false;
+  }
+  std::string addr = url.substr(pos_host, pos_path - pos_host);
+  size_t pos_port = addr.rfind(':');
+  *port = remote_port;
+  if(pos_port != std::string::npos)
+  {
+    int val = atoi(addr.c_str() + pos_port + 1);
+    if(val <= 0 || val > 65535)
+    {
+      return false;
+    }
+    *port = (unsigned short)val;
+    addr.erase(pos_port);
+  }
+  *host = addr;
+  *path = url.substr(pos_path);
+  return !host->empty();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_set_compress
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void remote_set_compress(bool compress)
+{
+  compress_replies = compress;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t::remote_connection_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+remote_connection_t::remote_connection_t(const std::string &host, unsigned short port) :
+  m_host(host),
+  m_port(port),
+  m_socket(NULL),
+  m_id(0),
+  m_bytes_received(0)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t::~remote_connection_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+remote_connection_t::~remote_connection_t()
+{
+  delete m_socket;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t::connect
+//connects on first use, or again after an error; the server must be of the same build
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_connection_t::connect()
+{
+  if(m_socket != NULL && m_socket->state() == QAbstractSocket::ConnectedState)
+  {
+    return NC_NOERR;
+  }
+  delete m_socket;
+  m_in.clear();
+  m_socket = new QTcpSocket;
+  m_socket->connectToHost(QString::fromStdString(m_host), m_port);
+  if(!m_socket->waitForConnected(10000))
+  {
+    delete m_socket;
+    m_socket = NULL;
+    return NC2_ERR;
+  }
+  m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+  unsigned int id = ++m_id;
+  m_socket->write(make_frame(id, remote_hello, 0, NC_NOERR, hello()));
+  QByteArray reply;
+  if(receive(id, &reply) != NC_NOERR || reply != hello())
+  {
+    //not a server, or one of another version, word size or byte order
+    delete m_socket;
+    m_socket = NULL;
+    return NC2_ERR;
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t::send
+//returns the ID of the request, 0 if it could not be sent
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int remote_connection_t::send(int type, const QByteArray &payload)
+{
+  if(connect() != NC_NOERR)
+  {
+    return 0;
+  }
+  unsigned int id = ++m_id;
+  if(id == 0)
+  {
+    id = ++m_id;
+  }
+  m_socket->write(make_frame(id, type, compress_replies ? remote_flag_compress : 0, NC_NOERR, payload));
+  return id;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t::receive
+//waits for the reply of request id, dropping the replies before it; when cancel is set, the
+//connection is closed, so that the replies still to come are dropped with it
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_connection_t::receive(unsigned int id, QByteArray *payload, const std::atomic<bool> *cancel)
+{
+  if(id == 0 || m_socket == NULL)
+  {
+    return NC2_ERR;
+  }
+  for(;;)
+  {
+    while(m_in.size() >= remote_header)
+    {
+      const char *hdr = m_in.constData();
+      unsigned int size = get_u32(hdr);
+      if(size > remote_max_reply)
+      {
+        //not a frame of a server: the stream cannot be followed further
+        m_socket->abort();
+        m_in.clear();
+        return NC2_ERR;
+      }
+      if((unsigned int)(m_in.size() - remote_header) < size)
+      {
+        break;
+      }
+      unsigned int id_frm = get_u32(hdr + 4);
+      int flags = (unsigned char)hdr[9];
+      int status = (int)get_u32(hdr + 12);
+      QByteArray body = m_in.mid(remote_header, (int)size);
+      m_in.remove(0, remote_header + (int)size);
+      if(id_frm != id)
+      {
+        continue;
+      }
+      if(status != NC_NOERR)
+      {
+        return status;
+      }
+      if(flags & remote_flag_compressed)
+      {
+        //replies are compressed only from remote_compress_min bytes: empty is a corrupt payload
+        body = qUncompress(body);
+        if(body.isEmpty())
+        {
+          return NC2_ERR;
+        }
+      }
+      payload->swap(body);
+      return NC_NOERR;
+    }
+
+    if(cancel != NULL && *cancel)
+    {
+      m_socket->abort();
+      m_in.clear();
+      return NC2_ERR;
+    }
+    if(!m_socket->waitForReadyRead(100))
+    {
+      if(m_socket->state() != QAbstractSocket::ConnectedState)
+      {
+        m_in.clear();
+        return NC2_ERR;
+      }
+      continue;
+    }
+    QByteArray data = m_socket->readAll();
+    m_bytes_received += data.size();
+    m_in.append(data);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t::request
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_connection_t::request(int type, const QByteArray &payload, QByteArray *reply, const std::atomic<bool> *cancel)
+{
+  trace_t trace("remote_request");
+  return receive(send(type, payload), reply, cancel);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+remote_connection_t* remote_connection(const std::string &url)
+{
+  std::string host;
+  unsigned short port;
+  std::string path;
+  if(!remote_parse(url, &host, &port, &path))
+  {
+    return NULL;
+  }
+  std::string key = host + ':' + std::to_string(port);
+  std::map<std::string, remote_connection_t*>::iterator it = connections.find(key);
+  if(it != connections.end())
+  {
+    return it->second;
+  }
+  remote_connection_t *connection = new remote_connection_t(host, port);
+  connections[key] = connection;
+  return connection;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_close_all
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void remote_close_all()
+{
+  for(std::map<std::string, remote_connection_t*>::iterator it = connections.begin(); it != connections.end(); ++it)
+  {
+    delete it->second;
+  }
+  connections.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_buffer
+//a pooled buffer with the bytes of a reply
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static buffer_t remote_buffer(const char *ptr, size_t size)
+{
+  buffer_t buf(size);
+  if(size && !buf.empty())
+  {
+    memcpy(buf.data(), ptr, size);
+  }
+  return buf;
+}
+
+buffer_t remote_buffer(const QByteArray &payload)
+{
+  remote_reader_t rd(payload);
+  size_t size;
+  const char *ptr = rd.bytes(&size);
+  return rd.m_ok ? remote_buffer(ptr, size) : buffer_t();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_meta_read
+//the arrays of the store of the server; the strings are interned in the same order, so that they
+//get the same IDs
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_meta_read(const std::string &url, meta_store_t *store)
+{
+  std::string host;
+  unsigned short port;
+  std::string path;
+  remote_connection_t *connection = remote_connection(url);
+  if(connection == NULL || !remote_parse(url, &host, &port, &path))
+  {
+    return NC2_ERR;
+  }
+  QByteArray req;
+  QByteArray reply;
+  put_str(req, path);
+  if(connection->request(remote_meta, req, &reply) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+
+  remote_reader_t rd(reply);
+  unsigned int nbr_str = rd.u32();
+  for(unsigned int idx = 0; idx < nbr_str && rd.m_ok; idx++)
+  {
+    if(store->m_str.intern(rd.str().c_str()) != idx)
+    {
+      return NC2_ERR;
+    }
+  }
+  rd.vector(&store->m_item);
+  rd.vector(&store->m_dim);
+  rd.vector(&store->m_dim_nm);
+  rd.vector(&store->m_value);
+  rd.vector(&store->m_att);
+  rd.vector(&store->m_att_item);
+  if(!rd.m_ok || store->m_item.empty())
+  {
+    return NC2_ERR;
+  }
+  store->m_index.build(*store);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_load_item
+//coordinate variables (one entry per dimension, NULL if none) if ncvar_crd is not NULL, and the data
+//if ncdata is not NULL
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_load_item(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm,
+  std::vector<ncdata_t *> *ncvar_crd, ncdata_t *ncdata)
+{
+  std::string host;
+  unsigned short port;
+  std::string path;
+  remote_connection_t *connection = remote_connection(url);
+  if(connection == NULL || !remote_parse(url, &host, &port, &path))
+  {
+    return NC2_ERR;
+  }
+  QByteArray req;
+  QByteArray reply;
+  put_str(req, path);
+  put_str(req, grp_nm_fll);
+  put_str(req, var_nm);
+  put_u32(req, ncvar_crd != NULL);
+  put_u32(req, ncdata != NULL);
+  if(connection->request(remote_load, req, &reply) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+
+  remote_reader_t rd(reply);
+  if(ncvar_crd != NULL)
+  {
+    unsigned int nbr_dmn = rd.u32();
+    for(unsigned int idx_dmn = 0; idx_dmn < nbr_dmn && rd.m_ok; idx_dmn++)
+    {
+      if(rd.u32() == 0)
+      {
+        ncvar_crd->push_back(NULL);
+        continue;
+      }
+      std::string crd_nm = rd.str();
+      nc_type crd_type = (nc_type)rd.u32();
+      size_t crd_sz = (size_t)rd.u64();
+      std::string units = rd.str();
+      std::string calendar = rd.str();
+      size_t size;
+      const char *ptr = rd.bytes(&size);
+      ncdata_t *ncvar = new ncdata_t(crd_nm.c_str(), crd_type, std::vector<size_t>(1, crd_sz));
+      ncvar->m_units = units;
+      ncvar->m_calendar = calendar;
+      ncvar->store(remote_buffer(ptr, size));
+      ncvar_crd->push_back(ncvar);
+    }
+  }
+  if(ncdata != NULL)
+  {
+    size_t size;
+    const char *ptr = rd.bytes(&size);
+    if(rd.m_ok)
+    {
+      ncdata->store(remote_buffer(ptr, size));
+    }
+  }
+  return rd.m_ok ? NC_NOERR : NC2_ERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_load_att
+//var_nm is empty for a group attribute
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_load_att(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm,
+  const std::string &att_nm, nc_type nc_typ, buffer_t *buf)
+{
+  std::string host;
+  unsigned short port;
+  std::string path;
+  remote_connection_t *connection = remote_connection(url);
+  if(connection == NULL || !remote_parse(url, &host, &port, &path))
+  {
+    return NC2_ERR;
+  }
+  QByteArray req;
+  QByteArray reply;
+  put_str(req, path);
+  put_str(req, grp_nm_fll);
+  put_str(req, var_nm);
+  put_str(req, att_nm);
+  put_u32(req, (unsigned int)nc_typ);
+  if(connection->request(remote_att, req, &reply) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  *buf = remote_buffer(reply);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_reduce_read
+//the reduction runs on the server; the connection is the caller's own, so that the I/O thread is not
+//held for the time of the reduction
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_reduce_read(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm, nc_type nc_typ,
+  const std::vector<size_t> &dim, size_t dmn, int op, const std::atomic<bool> &cancel, std::vector<double> *result)
+{
+  std::string host;
+  unsigned short port;
+  std::string path;
+  if(!remote_parse(url, &host, &port, &path))
+  {
+    return NC2_ERR;
+  }
+  remote_connection_t connection(host, port);
+  QByteArray req;
+  QByteArray reply;
+  put_str(req, path);
+  put_str(req, grp_nm_fll);
+  put_str(req, var_nm);
+  put_u32(req, (unsigned int)nc_typ);
+  put_sizes(req, dim);
+  put_u32(req, (unsigned int)dmn);
+  put_u32(req, (unsigned int)op);
+  if(connection.request(remote_reduce, req, &reply, &cancel) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  remote_reader_t rd(reply);
+  rd.vector(result);
+  return rd.m_ok ? NC_NOERR : NC2_ERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_slab_source_t::slab_request
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+QByteArray remote_slab_source_t::slab_request(const std::vector<size_t> &start, const std::vector<size_t> &count) const
+{
+  std::string host;
+  unsigned short port;
+  std::string path;
+  remote_parse(m_url, &host, &port, &path);
+  QByteArray req;
+  put_str(req, path);
+  put_str(req, m_grp_nm_fll);
+  put_str(req, m_var_nm);
+  put_u32(req, (unsigned int)m_nc_type);
+  put_sizes(req, start);
+  put_sizes(req, count);
+  return req;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_slab_source_t::read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t remote_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  remote_connection_t *connection = remote_connection(m_url);
+  QByteArray reply;
+  if(connection == NULL || connection->request(remote_slab, slab_request(start, count), &reply) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+  return remote_buffer(reply);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//serve_open
+//group and variable of a request; an empty variable name is the group itself (NC_GLOBAL)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int serve_open(const std::string &path, const std::string &grp_nm_fll, const std::string &var_nm, int *grp_id, int *var_id)
+{
+  int nc_id;
+  if(io_open(path, &nc_id) != NC_NOERR || inq_grp_id(nc_id, grp_nm_fll, grp_id) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(var_nm.empty())
+  {
+    *var_id = NC_GLOBAL;
+    return NC_NOERR;
+  }
+  return NC_TRACE("nc_inq_varid", var_nm.c_str(), 0, nc_inq_varid(*grp_id, var_nm.c_str(), var_id));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//serve_meta
+//the file is opened again, so that the scan sees it as it is now
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int serve_meta(remote_reader_t &rd, QByteArray *reply)
+{
+  std::string path = rd.str();
+  int nc_id;
+  if(!rd.m_ok)
+  {
+    return NC2_ERR;
+  }
+  io_close(path);
+  if(io_open(path, &nc_id) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  meta_store_t store(path);
+  if(meta_scan(&store, nc_id) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  put_u32(*reply, (unsigned int)store.m_str.size());
+  for(size_t idx = 0; idx < store.m_str.size(); idx++)
+  {
+    put_str(*reply, store.m_str.at((unsigned int)idx));
+  }
+  put_vector(*reply, store.m_item);
+  put_vector(*reply, store.m_dim);
+  put_vector(*reply, store.m_dim_nm);
+  put_vector(*reply, store.m_value);
+  put_vector(*reply, store.m_att);
+  put_vector(*reply, store.m_att_item);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//serve_load
+//coordinate variables are the variables of the group named as a dimension, of one dimension, as in
+//load_item
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int serve_load(remote_reader_t &rd, QByteArray *reply)
+{
+  std::string path = rd.str();
+  std::string grp_nm_fll = rd.str();
+  std::string var_nm = rd.str();
+  bool load_crd = rd.u32() != 0;
+  bool load_data = rd.u32() != 0;
+  int grp_id;
+  int var_id;
+  nc_type var_type;
+  int nbr_dmn;
+  int var_dimid[NC_MAX_VAR_DIMS];
+  if(!rd.m_ok)
+  {
+    return NC2_ERR;
+  }
+  if(var_nm.empty() || serve_open(path, grp_nm_fll, var_nm, &grp_id, &var_id) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, var_id, NULL, &var_type, &nbr_dmn, var_dimid, NULL)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+
+  size_t buf_sz = 1;
+  if(load_crd)
+  {
+    put_u32(*reply, (unsigned int)nbr_dmn);
+  }
+  for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+  {
+    char dmn_nm[NC_MAX_NAME + 1];
+    size_t dmn_sz;
+    if(NC_TRACE("nc_inq_dim", NULL, 0, nc_inq_dim(grp_id, var_dimid[idx_dmn], dmn_nm, &dmn_sz)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    buf_sz *= dmn_sz;
+    if(!load_crd)
+    {
+      continue;
+    }
+    int crd_var_id;
+    nc_type crd_var_type;
+    int crd_nbr_dmn;
+    int crd_var_dimid[NC_MAX_VAR_DIMS];
+    size_t crd_dmn_sz;
+    if(NC_TRACE("nc_inq_varid", dmn_nm, 0, nc_inq_varid(grp_id, dmn_nm, &crd_var_id)) != NC_NOERR
+      || NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, crd_var_id, NULL, &crd_var_type, &crd_nbr_dmn, crd_var_dimid, NULL)) != NC_NOERR
+      || crd_nbr_dmn != 1
+      || NC_TRACE("nc_inq_dim", NULL, 0, nc_inq_dim(grp_id, crd_var_dimid[0], NULL, &crd_dmn_sz)) != NC_NOERR
+      || crd_dmn_sz > crd_max_load)
+    {
+      put_u32(*reply, 0);
+      continue;
+    }
+    //a coordinate variable that cannot be read is sent as none, as load_item does
+    buffer_t buf = load_variable(grp_id, crd_var_id, crd_var_type, crd_dmn_sz);
+    if(buf.empty() && crd_dmn_sz > 0)
+    {
+      put_u32(*reply, 0);
+      continue;
+    }
+    put_u32(*reply, 1);
+    put_str(*reply, dmn_nm);
+    put_u32(*reply, (unsigned int)crd_var_type);
+    put_u64(*reply, crd_dmn_sz);
+    put_str(*reply, load_att_text(grp_id, crd_var_id, "units"));
+    put_str(*reply, load_att_text(grp_id, crd_var_id, "calendar"));
+    put_bytes(*reply, buf.data(), buf.size());
+  }
+
+  if(load_data)
+  {
+    buffer_t buf = load_variable(grp_id, var_id, var_type, buf_sz);
+    if(buf.empty() && buf_sz > 0)
+    {
+      return NC2_ERR;
+    }
+    put_bytes(*reply, buf.data(), buf.size());
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//serve_att
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int serve_att(remote_reader_t &rd, QByteArray *reply)
+{
+  std::string path = rd.str();
+  std::string grp_nm_fll = rd.str();
+  std::string var_nm = rd.str();
+  std::string att_nm = rd.str();
+  nc_type att_type = (nc_type)rd.u32();
+  int grp_id;
+  int var_id;
+  size_t att_sz;
+  if(!rd.m_ok || serve_open(path, grp_nm_fll, var_nm, &grp_id, &var_id) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  if(NC_TRACE("nc_inq_attlen", att_nm.c_str(), 0, nc_inq_attlen(grp_id, var_id, att_nm.c_str(), &att_sz)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  buffer_t buf = load_attribute(grp_id, var_id, att_nm.c_str(), att_type, att_sz);
+  put_bytes(*reply, buf.data(), buf.size());
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//serve_slab
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int serve_slab(remote_reader_t &rd, QByteArray *reply)
+{
+  std::string path = rd.str();
+  std::string grp_nm_fll = rd.str();
+  std::string var_nm = rd.str();
+  nc_type var_type = (nc_type)rd.u32();
+  std::vector<size_t> start = rd.sizes();
+  std::vector<size_t> count = rd.sizes();
+  if(!rd.m_ok || start.size() != count.size())
+  {
+    return NC2_ERR;
+  }
+  size_t vol = 1;
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
+  {
+    vol *= count[idx_dmn];
+  }
+  nc_slab_source_t source(path, grp_nm_fll, var_nm, var_type, count);
+  buffer_t buf = source.read(start, count);
+  if(buf.empty() && vol > 0)
+  {
+    return NC2_ERR;
+  }
+  put_bytes(*reply, buf.data(), buf.size());
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//serve_reduce
+//reduce_stream reads one slab at a time, so that its reads can run where they are asked for
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int serve_reduce(remote_reader_t &rd, QByteArray *reply)
+{
+  std::string path = rd.str();
+  std::string grp_nm_fll = rd.str();
+  std::string var_nm = rd.str();
+  nc_type var_type = (nc_type)rd.u32();
+  std::vector<size_t> dim = rd.sizes();
+  size_t dmn = rd.u32();
+  int op = (int)rd.u32();
+  if(!rd.m_ok || dmn >= dim.size())
+  {
+    return NC2_ERR;
+  }
+  nc_slab_source_t source(path, grp_nm_fll, var_nm, var_type, dim);
+  std::atomic<bool> cancel(false);
+  std::vector<double> result;
+  if(reduce_stream(&source, dmn, op, [](const std::function<void()> &job)
+  {
+    job();
+  }, cancel, std::function<void(double)>(), &result) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  put_vector(*reply, result);
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::RemoteServer
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RemoteServer::RemoteServer(QObject *parent) :
+  QObject(parent)
+{
+  m_server = new QTcpServer(this);
+  connect(m_server, SIGNAL(newConnection()), this, SLOT(new_connection()));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::~RemoteServer
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RemoteServer::~RemoteServer()
+{
+  m_server->close();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::listen
+//on the loopback interface; port 0 picks a free port
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RemoteServer::listen(unsigned short port)
+{
+  return m_server->listen(QHostAddress(QHostAddress::LocalHost), port);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::port
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned short RemoteServer::port() const
+{
+  return m_server->serverPort();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::new_connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RemoteServer::new_connection()
+{
+  while(m_server->hasPendingConnections())
+  {
+    QTcpSocket *socket = m_server->nextPendingConnection();
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    m_in[socket] = QByteArray();
+    connect(socket, SIGNAL(readyRead()), this, SLOT(read_request()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(disconnected()));
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::read_request
+//serves the complete frames received; a frame too large for a request closes the connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RemoteServer::read_request()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  if(socket == NULL || m_in.find(socket) == m_in.end())
+  {
+    return;
+  }
+  QByteArray &in = m_in[socket];
+  in.append(socket->readAll());
+  while(in.size() >= remote_header)
+  {
+    const char *hdr = in.constData();
+    unsigned int size = get_u32(hdr);
+    if(size > (unsigned int)remote_max_request)
+    {
+      socket->abort();
+      return;
+    }
+    if((unsigned int)(in.size() - remote_header) < size)
+    {
+      break;
+    }
+    unsigned int id = get_u32(hdr + 4);
+    int type = (unsigned char)hdr[8];
+    int flags = (unsigned char)hdr[9];
+    QByteArray payload = in.mid(remote_header, (int)size);
+    in.remove(0, remote_header + (int)size);
+    serve(socket, id, type, flags, payload);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::disconnected
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RemoteServer::disconnected()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  if(socket == NULL)
+  {
+    return;
+  }
+  m_in.erase(socket);
+  socket->deleteLater();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer::serve
+//replies too large for one frame (2 GB) are errors
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RemoteServer::serve(QTcpSocket *socket, unsigned int id, int type, int flags, const QByteArray &payload)
+{
+  trace_t trace("remote_serve");
+  remote_reader_t rd(payload);
+  QByteArray reply;
+  int status = NC2_ERR;
+  switch(type)
+  {
+  case remote_hello:
+    //the reply is the server's own, checked in turn by the client
+    status = payload == hello() ? NC_NOERR : NC2_ERR;
+    reply = hello();
+    break;
+  case remote_meta:
+    status = serve_meta(rd, &reply);
+    break;
+  case remote_load:
+    status = serve_load(rd, &reply);
+    break;
+  case remote_att:
+    status = serve_att(rd, &reply);
+    break;
+  case remote_slab:
+    status = serve_slab(rd, &reply);
+    break;
+  case remote_reduce:
+    status = serve_reduce(rd, &reply);
+    break;
+  }
+  if(status != NC_NOERR || (unsigned int)reply.size() > remote_max_reply)
+  {
+    status = NC2_ERR;
+    reply.clear();
+  }
+
+  int flags_rpl = 0;
+  if((flags & remote_flag_compress) && reply.size() >= remote_compress_min)
+  {
+    QByteArray compressed = qCompress(reply, 1);
+    if(compressed.size() <= reply.size() - reply.size() / 8)
+    {
+      reply.swap(compressed);
+      flags_rpl = remote_flag_compressed;
+    }
+  }
+  socket->write(make_frame(id, type, flags_rpl, status, reply));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_serve
+//headless server mode; runs until killed
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int remote_serve(unsigned short port)
+{
+  RemoteServer server;
+  if(!server.listen(port))
+  {
+    fprintf(stderr, "cannot listen on port %d\n", (int)port);
+    return 1;
+  }
+  fprintf(stderr, "serving on localhost:%d\n", (int)server.port());
+  return QCoreApplication::exec();
+}
@@ -0,0 +1,159 @@
+#ifndef NETCDF_REMOTE_H
+#define NETCDF_REMOTE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+#include "netcdf_io.hpp"
+
+class QTcpServer;
+class QTcpSocket;
+class meta_store_t;
+class ncdata_t;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote files
+//a server (netcdf-explorer --serve port) runs next to the data and does all the netCDF I/O, slicing
+//and reductions; the GUI opens ncx://host:port/path and gets the metadata, variables and tiles from it
+//the server listens on the loopback interface only: a remote host is reached through an SSH tunnel
+//(ssh -L port:localhost:port host), so that the connection is authenticated and encrypted by SSH
+//protocol: frames of a 16 byte header (payload size, request ID, message type, flags, status) and a
+//payload; requests are answered in order, so that a client can send several before reading the
+//replies; a reply payload is compressed with zlib when asked for and when it is at least 1/8 smaller
+//bulk data is sent in the layout of the buffers in memory: both ends check that they agree (byte
+//order, size of size_t) when they connect
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum remote_msg_t
+{
+  remote_hello,
+  remote_meta, // metadata of a file: the meta_store_t arrays
+  remote_load, // coordinate variables and data of a variable
+  remote_att, // value of an attribute
+  remote_slab, // hyperslab of a variable
+  remote_reduce // reduction of a variable along a dimension
+};
+
+static const unsigned short remote_port = 7010;
+
+bool is_remote(const std::string &file_name);
+bool remote_parse(const std::string &url, std::string *host, unsigned short *port, std::string *path);
+void remote_set_compress(bool compress);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_connection_t
+//blocking client side of a connection; used by one thread, which creates the socket on first use
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class remote_connection_t
+{
+public:
+  remote_connection_t(const std::string &host, unsigned short port);
+  ~remote_connection_t();
+  unsigned int send(int type, const QByteArray &payload);
+  int receive(unsigned int id, QByteArray *payload, const std::atomic<bool> *cancel = NULL);
+  int request(int type, const QByteArray &payload, QByteArray *reply, const std::atomic<bool> *cancel = NULL);
+  double bytes_received() const
+  {
+    return m_bytes_received;
+  }
+
+private:
+  int connect();
+  std::string m_host;
+  unsigned short m_port;
+  QTcpSocket *m_socket;
+  QByteArray m_in; // received, not yet parsed
+  unsigned int m_id; // last request ID
+  double m_bytes_received; // on the wire
+};
+
+//connection to the server of a URL, kept open on the I/O thread; call on the I/O thread only
+remote_connection_t* remote_connection(const std::string &url);
+void remote_close_all();
+
+int remote_meta_read(const std::string &url, meta_store_t *store);
+int remote_load_item(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm,
+  std::vector<ncdata_t *> *ncvar_crd, ncdata_t *ncdata);
+int remote_load_att(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm,
+  const std::string &att_nm, nc_type nc_typ, buffer_t *buf);
+int remote_reduce_read(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm, nc_type nc_typ,
+  const std::vector<size_t> &dim, size_t dmn, int op, const std::atomic<bool> &cancel, std::vector<double> *result);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//remote_slab_source_t
+//a variable of a remote file; slabs are read by its server
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class remote_slab_source_t : public slab_source_t
+{
+public:
+  remote_slab_source_t(const std::string &url, const std::string &grp_nm_fll, const std::string &var_nm,
+    nc_type nc_typ, const std::vector<size_t> &dim) :
+    m_url(url),
+    m_grp_nm_fll(grp_nm_fll),
+    m_var_nm(var_nm),
+    m_nc_type(nc_typ),
+    m_dim(dim)
+  {
+  }
+  nc_type type() const
+  {
+    return m_nc_type;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_dim;
+  }
+  std::string key() const
+  {
+    return m_url + '\n' + m_grp_nm_fll + '\n' + m_var_nm;
+  }
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+  QByteArray slab_request(const std::vector<size_t> &start, const std::vector<size_t> &count) const;
+
+private:
+  std::string m_url;
+  std::string m_grp_nm_fll;
+  std::string m_var_nm;
+  nc_type m_nc_type;
+  std::vector<size_t> m_dim;
+};
+
+buffer_t remote_buffer(const QByteArray &payload);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//RemoteServer
+//serves the requests of its connections in the event loop of its thread, one at a time, since the
+//netCDF library is not thread-safe; files are kept open between requests
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class RemoteServer : public QObject
+{
+  Q_OBJECT
+public:
+  RemoteServer(QObject *parent = NULL);
+  ~RemoteServer();
+  bool listen(unsigned short port);
+  unsigned short port() const;
+
+private slots:
+  void new_connection();
+  void read_request();
+  void disconnected();
+
+private:
+  void serve(QTcpSocket *socket, unsigned int id, int type, int flags, const QByteArray &payload);
+  QTcpServer *m_server;
+  std::map<QTcpSocket*, QByteArray> m_in; // received, not yet parsed, by connection
+};
+
+int remote_serve(unsigned short port);
+
+#endif
@@ -0,0 +1,464 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QXmlStreamReader>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include "netcdf_explorer.hpp"
+#include "netcdf_series.hpp"
+#include "netcdf_meta.hpp"
+#include "netcdf_trace.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_t::~series_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+series_t::~series_t()
+{
+  close_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_t::find_file
+//member file that holds a record
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t series_t::find_file(size_t record) const
+{
+  return std::upper_bound(m_first.begin(), m_first.end() - 1, record) - m_first.begin() - 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_t::open
+//netCDF ID of a member file; the least recently used file is closed when m_max_open are open
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int series_t::open(size_t idx_file, int *nc_id)
+{
+  for(std::list<std::pair<size_t, int> >::iterator it = m_open.begin(); it != m_open.end(); ++it)
+  {
+    if(it->first == idx_file)
+    {
+      *nc_id = it->second;
+      m_open.splice(m_open.begin(), m_open, it);
+      return NC_NOERR;
+    }
+  }
+  if(m_open.size() >= m_max_open)
+  {
+    if(NC_TRACE("nc_close", NULL, 0, nc_close(m_open.back().second)) != NC_NOERR)
+    {
+
+    }
+    m_open.pop_back();
+  }
+  if(NC_TRACE("nc_open", m_file[idx_file].c_str(), 0, nc_open(m_file[idx_file].c_str(), NC_NOWRITE, nc_id)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  m_open.push_front(std::make_pair(idx_file, *nc_id));
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_t::close_all
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void series_t::close_all()
+{
+  for(std::list<std::pair<size_t, int> >::iterator it = m_open.begin(); it != m_open.end(); ++it)
+  {
+    if(NC_TRACE("nc_close", NULL, 0, nc_close(it->second)) != NC_NOERR)
+    {
+
+    }
+  }
+  m_open.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//list_ncml
+//member files of a NcML aggregation; supported: one <aggregation type="joinExisting" dimName="...">
+//with <netcdf location="..."/> members and <scan location="..." suffix="..."/> directories
+//relative locations are relative to the NcML file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int list_ncml(const std::string &spec, std::vector<std::string> &files, std::string &dim_nm)
+{
+  QFile file(QString::fromUtf8(spec.c_str()));
+  if(!file.open(QIODevice::ReadOnly))
+  {
+    return NC2_ERR;
+  }
+  QDir dir_ncml(QFileInfo(QString::fromUtf8(spec.c_str())).absolutePath());
+  QXmlStreamReader xml(&file);
+  bool in_aggregation = false;
+  while(!xml.atEnd())
+  {
+    xml.readNext();
+    if(xml.isEndElement() && xml.name().toString() == "aggregation")
+    {
+      in_aggregation = false;
+    }
+    if(!xml.isStartElement())
+    {
+      continue;
+    }
+    QString name = xml.name().toString();
+    QString location = xml.attributes().value("location").toString();
+    if(location.startsWith("file:"))
+    {
+      location.remove(0, 5);
+    }
+    if(name == "aggregation")
+    {
+      in_aggregation = true;
+      dim_nm = xml.attributes().value("dimName").toString().toStdString();
+    }
+    else if(in_aggregation && name == "netcdf" && !location.isEmpty())
+    {
+      files.push_back(dir_ncml.absoluteFilePath(location).toStdString());
+    }
+    else if(in_aggregation && name == "scan" && !location.isEmpty())
+    {
+      QDir dir(dir_ncml.absoluteFilePath(location));
+      QString suffix = xml.attributes().value("suffix").toString();
+      QStringList entries = dir.entryList(QStringList() << ("*" + suffix), QDir::Files, QDir::Name);
+      for(int idx = 0; idx < entries.size(); idx++)
+      {
+        files.push_back(dir.absoluteFilePath(entries[idx]).toStdString());
+      }
+    }
+  }
+  if(xml.hasError())
+  {
+    return NC2_ERR;
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_list
+//member files of a series given by a NcML file (.ncml, .xml) or a glob on file names (/data/tas_*.nc)
+//dim_nm is the series dimension named by the NcML file, empty for the record dimension
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int series_list(const std::string &spec, std::vector<std::string> &files, std::string &dim_nm)
+{
+  trace_t trace("series_list", spec.c_str());
+  files.clear();
+  dim_nm.clear();
+  QFileInfo info(QString::fromUtf8(spec.c_str()));
+  QString suffix = info.suffix().toLower();
+  if(suffix == "ncml" || suffix == "xml")
+  {
+    if(list_ncml(spec, files, dim_nm) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+  }
+  else
+  {
+    QDir dir(info.absolutePath());
+    QStringList entries = dir.entryList(QStringList() << info.fileName(), QDir::Files, QDir::Name);
+    for(int idx = 0; idx < entries.size(); idx++)
+    {
+      files.push_back(dir.absoluteFilePath(entries[idx]).toStdString());
+    }
+  }
+  return files.empty() ? NC2_ERR : NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_layout
+//type and dimension lengths of the variables of a group and its subgroups, by full name; the length of
+//the series dimension is 0, as it differs from file to file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::map<std::string, std::pair<nc_type, std::vector<size_t> > > series_layout_t;
+
+static int series_layout(int grp_id, const std::string &grp_nm_fll, const std::string &dim_nm, series_layout_t *layout)
+{
+  char var_nm[NC_MAX_NAME + 1];
+  char dmn_nm[NC_MAX_NAME + 1];
+  int nbr_var;
+  int nbr_grp;
+  if(NC_TRACE("nc_inq_nvars", NULL, 0, nc_inq_nvars(grp_id, &nbr_var)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  for(int var_id = 0; var_id < nbr_var; var_id++)
+  {
+    nc_type var_type;
+    int nbr_dmn;
+    int var_dimid[NC_MAX_VAR_DIMS];
+    if(NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, var_id, var_nm, &var_type, &nbr_dmn, var_dimid, NULL)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    std::vector<size_t> dim(nbr_dmn);
+    for(int idx_dmn = 0; idx_dmn < nbr_dmn; idx_dmn++)
+    {
+      if(NC_TRACE("nc_inq_dim", NULL, 0, nc_inq_dim(grp_id, var_dimid[idx_dmn], dmn_nm, &dim[idx_dmn])) != NC_NOERR)
+      {
+        return NC2_ERR;
+      }
+      if(dim_nm == dmn_nm)
+      {
+        dim[idx_dmn] = 0;
+      }
+    }
+    (*layout)[grp_nm_fll + '/' + var_nm] = std::make_pair(var_type, dim);
+  }
+
+  if(NC_TRACE("nc_inq_grps", NULL, 0, nc_inq_grps(grp_id, &nbr_grp, NULL)) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  std::vector<int> grp_ids(nbr_grp);
+  if(nbr_grp > 0 && NC_TRACE("nc_inq_grps", NULL, 0, nc_inq_grps(grp_id, NULL, &grp_ids[0])) != NC_NOERR)
+  {
+    return NC2_ERR;
+  }
+  for(int idx_grp = 0; idx_grp < nbr_grp; idx_grp++)
+  {
+    if(NC_TRACE("nc_inq_grpname", NULL, 0, nc_inq_grpname(grp_ids[idx_grp], var_nm)) != NC_NOERR
+      || series_layout(grp_ids[idx_grp], grp_nm_fll + '/' + var_nm, dim_nm, layout) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_open
+//first record of each member file; the series dimension defaults to the record dimension of the first
+//file, or to "time" if it has none; a member file whose variables of the first file differ in type or
+//in the length of a dimension other than the series one is rejected
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int series_open(series_t *series, const std::vector<std::string> &files, const std::string &dim_nm)
+{
+  trace_t trace("series_open", series->m_name.c_str());
+  char dmn_nm[NC_MAX_NAME + 1];
+  series->close_all();
+  series->m_file = files;
+  series->m_first.assign(1, 0);
+  series->m_dim_nm = dim_nm;
+  series_layout_t layout_first;
+
+  for(size_t idx_file = 0; idx_file < files.size(); idx_file++)
+  {
+    int nc_id;
+    int dmn_id = -1;
+    size_t dmn_sz;
+    if(series->open(idx_file, &nc_id) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    if(series->m_dim_nm.empty())
+    {
+      if(NC_TRACE("nc_inq_unlimdim", NULL, 0, nc_inq_unlimdim(nc_id, &dmn_id)) != NC_NOERR)
+      {
+
+      }
+      if(dmn_id >= 0 && NC_TRACE("nc_inq_dimname", NULL, 0, nc_inq_dimname(nc_id, dmn_id, dmn_nm)) == NC_NOERR)
+      {
+        series->m_dim_nm = dmn_nm;
+      }
+      else
+      {
+        series->m_dim_nm = "time";
+      }
+    }
+    if(NC_TRACE("nc_inq_dimid", series->m_dim_nm.c_str(), 0, nc_inq_dimid(nc_id, series->m_dim_nm.c_str(), &dmn_id)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    if(NC_TRACE("nc_inq_dimlen", NULL, 0, nc_inq_dimlen(nc_id, dmn_id, &dmn_sz)) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+
+    series_layout_t layout;
+    if(series_layout(nc_id, "", series->m_dim_nm, idx_file == 0 ? &layout_first : &layout) != NC_NOERR)
+    {
+      return NC2_ERR;
+    }
+    for(series_layout_t::const_iterator it = layout_first.begin(); idx_file > 0 && it != layout_first.end(); ++it)
+    {
+      series_layout_t::const_iterator it_file = layout.find(it->first);
+      if(it_file == layout.end() || it_file->second != it->second)
+      {
+        return NC2_ERR;
+      }
+    }
+    series->m_first.push_back(series->m_first.back() + dmn_sz);
+  }
+  return NC_NOERR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_apply
+//resize the series dimension in the metadata store of the first file, where it is the first dimension
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void series_apply(const series_t &series, meta_store_t *store)
+{
+  unsigned int dim_nm = store->m_str.find(series.m_dim_nm.c_str());
+  if(dim_nm == meta_none)
+  {
+    return;
+  }
+  for(unsigned int idx = 0; idx < store->size(); idx++)
+  {
+    const meta_item_t &item = store->item(idx);
+    if(item.m_kind == ItemData::Variable && item.m_nbr_dim > 0 && store->m_dim_nm[item.m_dim] == dim_nm)
+    {
+      store->m_dim[item.m_dim] = series.records();
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_slab_source_t::inq_split
+//whether the variable is along the series dimension, from the first file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void series_slab_source_t::inq_split()
+{
+  int nc_id;
+  int grp_id;
+  int var_id;
+  int nbr_dmn;
+  int var_dimid[NC_MAX_VAR_DIMS];
+  char dmn_nm[NC_MAX_NAME + 1];
+  m_split = 0;
+  if(m_series->open(0, &nc_id) != NC_NOERR)
+  {
+    return;
+  }
+  if(inq_grp_id(nc_id, m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+    return;
+  }
+  if(NC_TRACE("nc_inq_varid", m_var_nm.c_str(), 0, nc_inq_varid(grp_id, m_var_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+    return;
+  }
+  if(NC_TRACE("nc_inq_var", NULL, 0, nc_inq_var(grp_id, var_id, NULL, NULL, &nbr_dmn, var_dimid, NULL)) != NC_NOERR || nbr_dmn == 0)
+  {
+    return;
+  }
+  if(NC_TRACE("nc_inq_dimname", NULL, 0, nc_inq_dimname(grp_id, var_dimid[0], dmn_nm)) != NC_NOERR)
+  {
+    return;
+  }
+  m_split = (m_series->m_dim_nm == dmn_nm);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_slab_source_t::read_file
+//hyperslab of the variable in one member file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t series_slab_source_t::read_file(size_t idx_file, const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  int nc_id;
+  int grp_id;
+  int var_id;
+  if(m_series->open(idx_file, &nc_id) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+  if(inq_grp_id(nc_id, m_grp_nm_fll, &grp_id) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+  if(NC_TRACE("nc_inq_varid", m_var_nm.c_str(), 0, nc_inq_varid(grp_id, m_var_nm.c_str(), &var_id)) != NC_NOERR)
+  {
+    return buffer_t();
+  }
+
+  std::vector<ptrdiff_t> stride(count.size(), 1);
+  return load_variable_slab(grp_id, var_id, m_nc_type, start, count, stride);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_slab_source_t::read
+//a slab across member files is read by parts, copied at their record in the result; records are the
+//outer dimension, so each part is contiguous; empty if a part cannot be read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t series_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  if(m_split < 0)
+  {
+    inq_split();
+  }
+  if(!m_split || count.empty())
+  {
+    return read_file(0, start, count);
+  }
+  //an empty box has no last record
+  for(size_t idx_dmn = 0; idx_dmn < count.size(); idx_dmn++)
+  {
+    if(count[idx_dmn] == 0)
+    {
+      return buffer_t();
+    }
+  }
+
+  size_t idx_first = m_series->find_file(start[0]);
+  size_t idx_last = m_series->find_file(start[0] + count[0] - 1);
+  if(idx_first == idx_last)
+  {
+    std::vector<size_t> start_file(start);
+    start_file[0] -= m_series->m_first[idx_first];
+    return read_file(idx_first, start_file, count);
+  }
+
+  //NC_STRING data is a string arena per read, that is not concatenated
+  size_t type_sz = get_type_size(m_nc_type);
+  if(m_nc_type == NC_STRING || type_sz == 0)
+  {
+    return buffer_t();
+  }
+  size_t record_sz = type_sz;
+  for(size_t idx_dmn = 1; idx_dmn < count.size(); idx_dmn++)
+  {
+    record_sz *= count[idx_dmn];
+  }
+  buffer_t buf(count[0] * record_sz);
+  if(buf.empty())
+  {
+    return buf;
+  }
+  for(size_t idx_file = idx_first; idx_file <= idx_last; idx_file++)
+  {
+    size_t rec_first = std::max(start[0], m_series->m_first[idx_file]);
+    size_t rec_last = std::min(start[0] + count[0], m_series->m_first[idx_file + 1]);
+    if(rec_first >= rec_last)
+    {
+      continue;
+    }
+    std::vector<size_t> start_file(start);
+    std::vector<size_t> count_file(count);
+    start_file[0] = rec_first - m_series->m_first[idx_file];
+    count_file[0] = rec_last - rec_first;
+    buffer_t part = read_file(idx_file, start_file, count_file);
+    size_t part_sz = count_file[0] * record_sz;
+    if(part.size() != part_sz)
+    {
+      return buffer_t();
+    }
+    memcpy(buf.as<char>() + (rec_first - start[0]) * record_sz, part.data(), part_sz);
+  }
+  return buf;
+}
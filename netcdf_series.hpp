@@ -0,0 +1,111 @@
+#ifndef NETCDF_SERIES_H
+#define NETCDF_SERIES_H
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_io.hpp"
+
+class meta_store_t;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//file series
+//files split along their first dimension (the record dimension, one file per month...) opened as one
+//dataset; the metadata is the one of the first file, with the series dimension resized to the total
+//only the number of records of each file is read at open; slab reads go to the files that hold them
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_t
+//member files and their first records; the open member files are a bounded LRU, used on the I/O
+//thread only (closed at destruction, after the I/O thread stopped)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class series_t
+{
+public:
+  series_t() :
+    m_max_open(16)
+  {
+  }
+  ~series_t();
+  series_t(const series_t&) = delete;
+  series_t& operator=(const series_t&) = delete;
+  size_t size() const
+  {
+    return m_file.size();
+  }
+  size_t records() const
+  {
+    return m_first.empty() ? 0 : m_first.back();
+  }
+  size_t find_file(size_t record) const;
+  int open(size_t idx_file, int *nc_id);
+  void close_all();
+
+  std::string m_name; // as given by the user: glob or NcML file
+  std::vector<std::string> m_file; // member files, in series order
+  std::vector<size_t> m_first; // first record of each member file in the series, then the total
+  std::string m_dim_nm; // series dimension
+  size_t m_max_open; // maximum of member files kept open
+
+private:
+  std::list<std::pair<size_t, int> > m_open; // open member files and netCDF IDs, most recent first
+};
+
+int series_list(const std::string &spec, std::vector<std::string> &files, std::string &dim_nm);
+int series_open(series_t *series, const std::vector<std::string> &files, const std::string &dim_nm);
+void series_apply(const series_t &series, meta_store_t *store);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//series_slab_source_t
+//a variable of a series; variables along the series dimension are read from the member files that
+//hold the requested records, the others from the first file
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class series_slab_source_t : public slab_source_t
+{
+public:
+  series_slab_source_t(const std::shared_ptr<series_t> &series, const std::string &grp_nm_fll, const std::string &var_nm,
+    nc_type nc_typ, const std::vector<size_t> &dim) :
+    m_series(series),
+    m_grp_nm_fll(grp_nm_fll),
+    m_var_nm(var_nm),
+    m_nc_type(nc_typ),
+    m_dim(dim),
+    m_split(-1)
+  {
+  }
+  nc_type type() const
+  {
+    return m_nc_type;
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_dim;
+  }
+  //starts with the first file, the file name of the store of the series, so that its slabs leave the
+  //compressed cache with that file
+  std::string key() const
+  {
+    return (m_series->m_file.empty() ? std::string() : m_series->m_file[0]) + "\nseries\n" + m_series->m_name + '\n'
+      + m_grp_nm_fll + '\n' + m_var_nm;
+  }
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+
+private:
+  void inq_split();
+  buffer_t read_file(size_t idx_file, const std::vector<size_t> &start, const std::vector<size_t> &count);
+  std::shared_ptr<series_t> m_series;
+  std::string m_grp_nm_fll;
+  std::string m_var_nm;
+  nc_type m_nc_type;
+  std::vector<size_t> m_dim;
+  int m_split; // 1 if the first dimension is the series dimension, -1 until the first read
+};
+
+#endif
@@ -0,0 +1,331 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include "netcdf_sort.hpp"
+
+//cells per thread, below which the work is not split
+static const size_t sort_part_cells = (size_t)1 << 16;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_key
+//unsigned key in the order of the values; floating point by their bits, negative numbers reversed
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned long long sort_key(signed char val)
+{
+  return (unsigned long long)(unsigned char)(val ^ 0x80);
+}
+
+static inline unsigned long long sort_key(unsigned char val)
+{
+  return val;
+}
+
+static inline unsigned long long sort_key(short val)
+{
+  return (unsigned long long)(unsigned short)(val ^ 0x8000);
+}
+
+static inline unsigned long long sort_key(unsigned short val)
+{
+  return val;
+}
+
+static inline unsigned long long sort_key(int val)
+{
+  return (unsigned long long)((unsigned int)val ^ 0x80000000u);
+}
+
+static inline unsigned long long sort_key(unsigned int val)
+{
+  return val;
+}
+
+static inline unsigned long long sort_key(long long val)
+{
+  return (unsigned long long)val ^ 0x8000000000000000ull;
+}
+
+static inline unsigned long long sort_key(unsigned long long val)
+{
+  return val;
+}
+
+static inline unsigned long long sort_key(float val)
+{
+  unsigned int bits;
+  memcpy(&bits, &val, sizeof(bits));
+  return (bits & 0x80000000u) ? (unsigned long long)~bits : (unsigned long long)(bits | 0x80000000u);
+}
+
+static inline unsigned long long sort_key(double val)
+{
+  unsigned long long bits;
+  memcpy(&bits, &val, sizeof(bits));
+  return (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//classify_part
+//rows first to first + nbr into numbers kept by the filter, NaN and fill values, in file order
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+static void classify_part(const T *buf, size_t stride, size_t first, size_t nbr, bool has_fill, double fill,
+  const sort_filter_t *filter, std::vector<int> *row_num, std::vector<int> *row_nan, std::vector<int> *row_fill)
+{
+  row_num->reserve(nbr);
+  for(size_t row = first; row < first + nbr; row++)
+  {
+    T val = buf[row * stride];
+    if(val != val)
+    {
+      if(!filter->m_active)
+      {
+        row_nan->push_back((int)row);
+      }
+    }
+    else if(has_fill && (double)val == fill)
+    {
+      if(!filter->m_active)
+      {
+        row_fill->push_back((int)row);
+      }
+    }
+    else if(!filter->m_active || ((double)val >= filter->m_min && (double)val <= filter->m_max))
+    {
+      row_num->push_back((int)row);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//radix_sort
+//stable sort of words by their upper 32 bits, a byte at a time, tmp of the same size as scratch; words
+//of the same upper half keep their order; passes where all words have the same byte are skipped
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void radix_sort(unsigned long long *word, unsigned long long *tmp, size_t nbr)
+{
+  for(int shift = 32; shift < 64; shift += 8)
+  {
+    size_t count[256] = { 0 };
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      count[(word[idx] >> shift) & 0xFF]++;
+    }
+    if(nbr == 0 || count[(word[0] >> shift) & 0xFF] == nbr)
+    {
+      continue;
+    }
+    size_t offset = 0;
+    for(int digit = 0; digit < 256; digit++)
+    {
+      size_t nbr_digit = count[digit];
+      count[digit] = offset;
+      offset += nbr_digit;
+    }
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      tmp[count[(word[idx] >> shift) & 0xFF]++] = word[idx];
+    }
+    memcpy(word, tmp, nbr * sizeof(unsigned long long));
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_parallel
+//words in row order sorted by their upper half: parts sorted on their own thread, then merged pairwise,
+//the merges of a round in parallel
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void sort_parallel(std::vector<unsigned long long> &word)
+{
+  size_t nbr = word.size();
+  size_t nbr_part = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), nbr / sort_part_cells));
+  std::vector<size_t> bound(nbr_part + 1);
+  for(size_t idx_part = 0; idx_part <= nbr_part; idx_part++)
+  {
+    bound[idx_part] = nbr * idx_part / nbr_part;
+  }
+
+  std::vector<unsigned long long> merged(nbr);
+  std::vector<std::thread> threads;
+  for(size_t idx_part = 0; idx_part < nbr_part; idx_part++)
+  {
+    size_t first = bound[idx_part];
+    threads.push_back(std::thread(radix_sort, word.data() + first, merged.data() + first, bound[idx_part + 1] - first));
+  }
+  for(size_t idx_thread = 0; idx_thread < threads.size(); idx_thread++)
+  {
+    threads[idx_thread].join();
+  }
+
+  for(size_t width = 1; width < nbr_part; width *= 2)
+  {
+    threads.clear();
+    for(size_t idx_part = 0; idx_part < nbr_part; idx_part += 2 * width)
+    {
+      size_t first = bound[idx_part];
+      size_t middle = bound[std::min(idx_part + width, nbr_part)];
+      size_t last = bound[std::min(idx_part + 2 * width, nbr_part)];
+      threads.push_back(std::thread([&word, &merged, first, middle, last]()
+      {
+        std::merge(word.begin() + first, word.begin() + middle, word.begin() + middle, word.begin() + last,
+          merged.begin() + first);
+      }));
+    }
+    for(size_t idx_thread = 0; idx_thread < threads.size(); idx_thread++)
+    {
+      threads[idx_thread].join();
+    }
+    word.swap(merged);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_rows
+//each row is sorted as one 64 bit word, 32 bits of its key above the row, so that the sort moves and
+//compares words without reading the buffer, and equal values stay in row order; descending order
+//inverts the key; 8 byte values are sorted by the upper half of their key, then each run of the same
+//upper half by the lower half
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+static void sort_rows(const T *buf, size_t stride, bool descending, std::vector<int> &rows)
+{
+  size_t nbr = rows.size();
+  int shift = sizeof(T) == 8 ? 0 : 32;
+  unsigned long long mask = descending ? ~0ull : 0;
+  std::vector<unsigned long long> word(nbr);
+  for(size_t idx = 0; idx < nbr; idx++)
+  {
+    unsigned long long key = sort_key(buf[(size_t)rows[idx] * stride]) ^ mask;
+    word[idx] = ((key << shift) & 0xFFFFFFFF00000000ull) | (unsigned int)rows[idx];
+  }
+  sort_parallel(word);
+
+  if(sizeof(T) == 8)
+  {
+    unsigned long long upper_prv = 0;
+    size_t first = 0;
+    for(size_t idx = 0; idx <= nbr; idx++)
+    {
+      bool run_end = idx == nbr || (idx > 0 && (word[idx] >> 32) != upper_prv);
+      if(run_end && idx - first > 1)
+      {
+        std::sort(word.begin() + first, word.begin() + idx);
+      }
+      if(idx == nbr)
+      {
+        break;
+      }
+      if(run_end)
+      {
+        first = idx;
+      }
+      upper_prv = word[idx] >> 32;
+      unsigned int row = (unsigned int)(word[idx] & 0xFFFFFFFFull);
+      unsigned long long key = sort_key(buf[(size_t)row * stride]) ^ mask;
+      word[idx] = (key << 32) | row;
+    }
+  }
+
+  for(size_t idx = 0; idx < nbr; idx++)
+  {
+    rows[idx] = (int)(word[idx] & 0xFFFFFFFFull);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_typed
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+static void sort_typed(const T *buf, size_t nbr, size_t stride, bool has_fill, double fill, int order,
+  const sort_filter_t &filter, std::vector<int> *index)
+{
+  size_t nbr_thread = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), nbr / sort_part_cells));
+  std::vector<std::vector<int> > row_num(nbr_thread);
+  std::vector<std::vector<int> > row_nan(nbr_thread);
+  std::vector<std::vector<int> > row_fill(nbr_thread);
+  std::vector<std::thread> threads;
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    size_t first = nbr * idx_thread / nbr_thread;
+    size_t nbr_part = nbr * (idx_thread + 1) / nbr_thread - first;
+    threads.push_back(std::thread(classify_part<T>, buf, stride, first, nbr_part, has_fill, fill, &filter,
+      &row_num[idx_thread], &row_nan[idx_thread], &row_fill[idx_thread]));
+  }
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    threads[idx_thread].join();
+  }
+
+  index->clear();
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    index->insert(index->end(), row_num[idx_thread].begin(), row_num[idx_thread].end());
+    std::vector<int>().swap(row_num[idx_thread]);
+  }
+  if(order != sort_none)
+  {
+    sort_rows(buf, stride, order == sort_descending, *index);
+  }
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    index->insert(index->end(), row_nan[idx_thread].begin(), row_nan[idx_thread].end());
+  }
+  for(size_t idx_thread = 0; idx_thread < nbr_thread; idx_thread++)
+  {
+    index->insert(index->end(), row_fill[idx_thread].begin(), row_fill[idx_thread].end());
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_index
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int sort_index(const void *buf, nc_type nc_typ, size_t nbr, size_t stride, bool has_fill, double fill, int order,
+  const sort_filter_t &filter, std::vector<int> *index)
+{
+  switch(nc_typ)
+  {
+  case NC_BYTE:
+    sort_typed(static_cast<const signed char*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_UBYTE:
+    sort_typed(static_cast<const unsigned char*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_SHORT:
+    sort_typed(static_cast<const short*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_USHORT:
+    sort_typed(static_cast<const unsigned short*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_INT:
+    sort_typed(static_cast<const int*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_UINT:
+    sort_typed(static_cast<const unsigned int*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_INT64:
+    sort_typed(static_cast<const long long*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_UINT64:
+    sort_typed(static_cast<const unsigned long long*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_FLOAT:
+    sort_typed(static_cast<const float*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  case NC_DOUBLE:
+    sort_typed(static_cast<const double*> (buf), nbr, stride, has_fill, fill, order, filter, index);
+    break;
+  default:
+    return NC2_ERR;
+  }
+  return NC_NOERR;
+}
@@ -0,0 +1,53 @@
+#ifndef NETCDF_SORT_H
+#define NETCDF_SORT_H
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "netcdf.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort and filter of a table column
+//a permutation of the rows computed on the typed buffer of the column, without converting cells or
+//going through the model: the rows are split by value class in parallel, the numbers sorted in parallel
+//parts merged pairwise; the table shows its rows through the permutation
+//numbers come first in the order asked, then NaN, then fill values, each class in file order; equal
+//numbers keep their file order
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum sort_order_t
+{
+  sort_none, // file order, filter only
+  sort_ascending,
+  sort_descending
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_filter_t
+//keeps the numbers in [m_min, m_max]; NaN and fill values are dropped when active
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class sort_filter_t
+{
+public:
+  sort_filter_t() :
+    m_active(false),
+    m_min(-std::numeric_limits<double>::infinity()),
+    m_max(std::numeric_limits<double>::infinity())
+  {
+  }
+  bool m_active;
+  double m_min;
+  double m_max;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//sort_index
+//nbr cells of type nc_typ, stride cells apart in buf; index gets the row of each row shown
+//returns NC2_ERR for types that are not numbers
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int sort_index(const void *buf, nc_type nc_typ, size_t nbr, size_t stride, bool has_fill, double fill, int order,
+  const sort_filter_t &filter, std::vector<int> *index);
+
+#endif
@@ -0,0 +1,94 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include "netcdf.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include "netcdf_string.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_arena_t::string_arena_t
+//the offset table is allocated for all the strings up front; the characters grow geometrically
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+string_arena_t::string_arena_t(size_t nbr_str) :
+  m_buf((nbr_str + 2) * sizeof(size_t) + nbr_str * 16),
+  m_nbr_str(nbr_str),
+  m_idx(0),
+  m_len(0)
+{
+  size_t *off = m_buf.as<size_t>();
+  off[0] = nbr_str;
+  off[1] = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_arena_t::append
+//NULL strings (unwritten elements of a string variable) are stored as empty strings
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void string_arena_t::append(char **str, size_t nbr_str)
+{
+  size_t hdr = (m_nbr_str + 2) * sizeof(size_t);
+  size_t len = 0;
+  for(size_t idx = 0; idx < nbr_str; idx++)
+  {
+    len += (str[idx] ? strlen(str[idx]) : 0) + 1;
+  }
+
+  if(hdr + m_len + len > m_buf.capacity())
+  {
+    m_buf.resize(std::max(hdr + m_len + len, 2 * m_buf.capacity()));
+  }
+  else
+  {
+    m_buf.resize(hdr + m_len + len);
+  }
+
+  size_t *off = m_buf.as<size_t>() + 1;
+  char *chr = m_buf.as<char>() + hdr;
+  for(size_t idx = 0; idx < nbr_str && m_idx < m_nbr_str; idx++, m_idx++)
+  {
+    size_t len_str = str[idx] ? strlen(str[idx]) : 0;
+    memcpy(chr + m_len, str[idx] ? str[idx] : "", len_str);
+    m_len += len_str;
+    chr[m_len++] = '\0';
+    off[m_idx + 1] = m_len;
+  }
+
+  nc_free_string(nbr_str, str);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_arena_t::release
+//returns the arena, moved out of the builder
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t string_arena_t::release()
+{
+  size_t hdr = (m_nbr_str + 2) * sizeof(size_t);
+  //strings never appended (failed read) are empty strings
+  m_buf.resize(hdr + m_len + (m_nbr_str - m_idx));
+  size_t *off = m_buf.as<size_t>() + 1;
+  char *chr = m_buf.as<char>() + hdr;
+  for(; m_idx < m_nbr_str; m_idx++)
+  {
+    chr[m_len++] = '\0';
+    off[m_idx + 1] = m_len;
+  }
+  return std::move(m_buf);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//load_string_arena
+//one batch arena from an array of netCDF strings; releases the strings, not the array
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t load_string_arena(char **str, size_t nbr_str)
+{
+  string_arena_t arena(nbr_str);
+  arena.append(str, nbr_str);
+  return arena.release();
+}
@@ -0,0 +1,65 @@
+#ifndef NETCDF_STRING_H
+#define NETCDF_STRING_H
+
+#include <cstddef>
+#include "netcdf_buffer.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string arena
+//NC_STRING data is stored in one pooled buffer, like the other ncdata_t buffers
+//layout: number of strings N, N + 1 offsets, then the characters; each string is NUL terminated
+//offsets are relative to the start of the characters, so the buffer can grow while it is built
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_view_t
+//pointer and length of one string in an arena; valid while the arena is
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class string_view_t
+{
+public:
+  string_view_t(const char *ptr, size_t len) :
+    m_ptr(ptr),
+    m_len(len)
+  {
+  }
+  const char *m_ptr; // NUL terminated
+  size_t m_len; // without the NUL
+};
+
+inline size_t string_count(const void *buf)
+{
+  return static_cast<const size_t*> (buf)[0];
+}
+
+inline string_view_t string_at(const void *buf, size_t idx)
+{
+  const size_t *off = static_cast<const size_t*> (buf) + 1;
+  const char *chr = reinterpret_cast<const char*> (off + off[-1] + 1);
+  return string_view_t(chr + off[idx], off[idx + 1] - off[idx] - 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//string_arena_t
+//builds an arena from netCDF strings, in one or more batches
+//append() copies a batch and releases the netCDF owned strings with nc_free_string
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class string_arena_t
+{
+public:
+  string_arena_t(size_t nbr_str);
+  void append(char **str, size_t nbr_str);
+  buffer_t release();
+
+private:
+  buffer_t m_buf;
+  size_t m_nbr_str; // strings in the arena when complete
+  size_t m_idx; // strings appended
+  size_t m_len; // characters used
+};
+
+buffer_t load_string_arena(char **str, size_t nbr_str);
+
+#endif
@@ -0,0 +1,246 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "netcdf_explorer.hpp"
+#include "netcdf_subset.hpp"
+#include "netcdf_time.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trim
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::string trim(const std::string &str)
+{
+  size_t beg = 0;
+  size_t end = str.size();
+  while(beg < end && isspace((unsigned char)str[beg]))
+  {
+    beg++;
+  }
+  while(end > beg && isspace((unsigned char)str[end - 1]))
+  {
+    end--;
+  }
+  return str.substr(beg, end - beg);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//parse_index
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool parse_index(const std::string &text, unsigned long long *val)
+{
+  std::string str = trim(text);
+  if(str.empty() || !isdigit((unsigned char)str[0]))
+  {
+    return false;
+  }
+  char *end;
+  *val = strtoull(str.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//parse_value
+//a number, or a date if cf_time is not NULL
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool parse_value(const std::string &text, const cf_time_t *cf_time, double *val)
+{
+  std::string str = trim(text);
+  if(str.empty())
+  {
+    return false;
+  }
+  char *end;
+  *val = strtod(str.c_str(), &end);
+  if(*end == '\0')
+  {
+    return true;
+  }
+  return cf_time != NULL && cf_time->value(str, val);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//subset_parse
+//a value range takes the first to the last index of the values in it, so that the indices between
+//are read too when the coordinate variable is not monotonic
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool subset_parse(const std::string &text, size_t dim_sz, const ncdata_t *ncvar_crd,
+  size_t *start, size_t *count, ptrdiff_t *stride, std::string *error)
+{
+  std::string str = trim(text);
+  *start = 0;
+  *count = dim_sz;
+  *stride = 1;
+  if(str.empty() || str == ":")
+  {
+    return true;
+  }
+
+  //range of coordinate values
+  size_t pos = str.find("..");
+  if(pos != std::string::npos)
+  {
+    if(ncvar_crd == NULL)
+    {
+      *error = "no coordinate variable for '" + str + "'";
+      return false;
+    }
+    if(ncvar_crd->m_nc_type == NC_CHAR || ncvar_crd->m_nc_type == NC_STRING)
+    {
+      *error = "text coordinate variable for '" + str + "'";
+      return false;
+    }
+    cf_time_t cf_time;
+    bool is_time = !ncvar_crd->m_units.empty() && cf_time.parse(ncvar_crd->m_units, ncvar_crd->m_calendar);
+    double lo;
+    double hi;
+    if(!parse_value(str.substr(0, pos), is_time ? &cf_time : NULL, &lo)
+      || !parse_value(str.substr(pos + 2), is_time ? &cf_time : NULL, &hi))
+    {
+      *error = "invalid value range '" + str + "'";
+      return false;
+    }
+    if(lo > hi)
+    {
+      std::swap(lo, hi);
+    }
+    size_t nbr = std::min(dim_sz, ncvar_crd->m_dim[0]);
+    size_t first = nbr;
+    size_t last = 0;
+    for(size_t idx = 0; idx < nbr; idx++)
+    {
+      double val = get_double(ncvar_crd->m_nc_type, ncvar_crd->m_buf.data(), idx);
+      if(val >= lo && val <= hi)
+      {
+        first = std::min(first, idx);
+        last = idx;
+      }
+    }
+    if(first == nbr)
+    {
+      *error = "no coordinate value in '" + str + "'";
+      return false;
+    }
+    *start = first;
+    *count = last - first + 1;
+    return true;
+  }
+
+  //index range
+  std::vector<std::string> token;
+  for(pos = 0; pos <= str.size();)
+  {
+    size_t end = str.find(':', pos);
+    if(end == std::string::npos)
+    {
+      end = str.size();
+    }
+    token.push_back(trim(str.substr(pos, end - pos)));
+    pos = end + 1;
+  }
+  unsigned long long beg = 0;
+  unsigned long long end = dim_sz;
+  unsigned long long srd = 1;
+  bool ok = token.size() <= 3;
+  if(token.size() == 1)
+  {
+    ok = parse_index(token[0], &beg);
+    end = beg + 1;
+  }
+  else if(ok)
+  {
+    if(!token[0].empty())
+    {
+      ok = parse_index(token[0], &beg);
+    }
+    if(ok && !token[1].empty())
+    {
+      ok = parse_index(token[1], &end);
+    }
+    if(ok && token.size() == 3 && !token[2].empty())
+    {
+      ok = parse_index(token[2], &srd);
+    }
+  }
+  if(!ok || srd < 1 || beg >= end || end > dim_sz)
+  {
+    *error = "invalid index range '" + str + "'";
+    return false;
+  }
+  *start = (size_t)beg;
+  *count = (size_t)((end - beg + srd - 1) / srd);
+  *stride = (ptrdiff_t)srd;
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//subset_crd
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ncdata_t* subset_crd(const ncdata_t *ncvar_crd, const std::string &dim_nm, size_t start, size_t count, ptrdiff_t stride)
+{
+  std::vector<size_t> dim(1, count);
+  size_t last = count ? start + (count - 1) * stride : start;
+  if(ncvar_crd == NULL || ncvar_crd->m_nc_type == NC_STRING || (count && last >= ncvar_crd->m_dim[0]))
+  {
+    ncdata_t *ncvar = new ncdata_t(dim_nm.c_str(), NC_UINT64, dim);
+    buffer_t buf(count * sizeof(unsigned long long));
+    for(size_t idx = 0; idx < count; idx++)
+    {
+      buf.as<unsigned long long>()[idx] = start + idx * stride + 1;
+    }
+    ncvar->store(std::move(buf));
+    return ncvar;
+  }
+  size_t type_sz = get_type_size(ncvar_crd->m_nc_type);
+  ncdata_t *ncvar = new ncdata_t(ncvar_crd->m_name.c_str(), ncvar_crd->m_nc_type, dim);
+  ncvar->m_units = ncvar_crd->m_units;
+  ncvar->m_calendar = ncvar_crd->m_calendar;
+  buffer_t buf(count * type_sz);
+  const char *src = static_cast<const char*> (ncvar_crd->m_buf.data());
+  for(size_t idx = 0; idx < count; idx++)
+  {
+    memcpy(buf.as<char>() + idx * type_sz, src + (start + idx * stride) * type_sz, type_sz);
+  }
+  ncvar->store(std::move(buf));
+  return ncvar;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//subset_slab_source_t::key
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string subset_slab_source_t::key() const
+{
+  std::string key = m_source->key() + "\nsubset";
+  char str[80];
+  for(size_t idx_dmn = 0; idx_dmn < m_count.size(); idx_dmn++)
+  {
+    snprintf(str, sizeof(str), " %llu:%llu:%lld", (unsigned long long)m_start[idx_dmn],
+      (unsigned long long)m_count[idx_dmn], (long long)m_stride[idx_dmn]);
+    key += str;
+  }
+  return key;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//subset_slab_source_t::read
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+buffer_t subset_slab_source_t::read(const std::vector<size_t> &start, const std::vector<size_t> &count)
+{
+  std::vector<size_t> start_var(start.size());
+  for(size_t idx_dmn = 0; idx_dmn < start.size(); idx_dmn++)
+  {
+    start_var[idx_dmn] = m_start[idx_dmn] + start[idx_dmn] * m_stride[idx_dmn];
+  }
+  return m_source->read_strided(start_var, count, m_stride);
+}
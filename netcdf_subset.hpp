@@ -0,0 +1,68 @@
+#ifndef NETCDF_SUBSET_H
+#define NETCDF_SUBSET_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "netcdf.h"
+#include "netcdf_buffer.hpp"
+#include "netcdf_io.hpp"
+
+class ncdata_t;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//subsets
+//a hyperslab of a variable, given per dimension as an index range or a range of the values of its
+//coordinate variable; the subset is a variable of its own, read by strided reads of the variable
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//largest subset read whole when it is opened; larger ones are read by tiles
+static const size_t subset_max_load = (size_t)256 << 20;
+
+//range of one dimension: empty or ':' the whole dimension, 'i' one index, 'a:b' indices a to b-1,
+//'a:b:s' with stride s, 'x..y' the indices of the coordinate values from x to y (dates for CF time)
+bool subset_parse(const std::string &text, size_t dim_sz, const ncdata_t *ncvar_crd,
+  size_t *start, size_t *count, ptrdiff_t *stride, std::string *error);
+
+//coordinate variable of a subset dimension; the index from 1 in the variable if it has none
+ncdata_t* subset_crd(const ncdata_t *ncvar_crd, const std::string &dim_nm, size_t start, size_t count, ptrdiff_t stride);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//subset_slab_source_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class subset_slab_source_t : public slab_source_t
+{
+public:
+  subset_slab_source_t(const std::shared_ptr<slab_source_t> &source, const std::vector<size_t> &start,
+    const std::vector<size_t> &count, const std::vector<ptrdiff_t> &stride) :
+    m_source(source),
+    m_start(start),
+    m_count(count),
+    m_stride(stride)
+  {
+  }
+  nc_type type() const
+  {
+    return m_source->type();
+  }
+  const std::vector<size_t>& dim() const
+  {
+    return m_count;
+  }
+  std::string key() const;
+  buffer_t read(const std::vector<size_t> &start, const std::vector<size_t> &count);
+  bool fill_value(double *fill)
+  {
+    return m_source->fill_value(fill);
+  }
+
+private:
+  std::shared_ptr<slab_source_t> m_source;
+  std::vector<size_t> m_start; // in the variable
+  std::vector<size_t> m_count;
+  std::vector<ptrdiff_t> m_stride;
+};
+
+#endif
@@ -0,0 +1,281 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include "netcdf_time.hpp"
+
+static const int month_days[2][12] =
+{
+  { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 },
+  { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//floor_div
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long floor_div(long long a, long long b)
+{
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//day_number
+//days of a date since the day 0 of the calendar: the Julian day number in the Gregorian and Julian
+//calendars, day 0 of year 0 in the others
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long day_number(int calendar, long long year, int month, int day)
+{
+  if(calendar == cf_gregorian || calendar == cf_julian)
+  {
+    long long a = (14 - month) / 12;
+    long long y = year + 4800 - a;
+    long long m = month + 12 * a - 3;
+    long long jdn = day + (153 * m + 2) / 5 + 365 * y + floor_div(y, 4) - 32083;
+    if(calendar == cf_gregorian)
+    {
+      jdn += floor_div(y, 400) - floor_div(y, 100) + 38;
+    }
+    return jdn;
+  }
+  if(calendar == cf_360_day)
+  {
+    return year * 360 + (month - 1) * 30 + day - 1;
+  }
+  int leap = (calendar == cf_all_leap);
+  long long days = year * (365 + leap);
+  for(int idx = 0; idx < month - 1; idx++)
+  {
+    days += month_days[leap][idx];
+  }
+  return days + day - 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//civil_date
+//inverse of day_number; Julian day numbers from 0 (4713 BC)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void civil_date(int calendar, long long days, long long *year, int *month, int *day)
+{
+  if(calendar == cf_gregorian || calendar == cf_julian)
+  {
+    long long f = days + 1401;
+    if(calendar == cf_gregorian)
+    {
+      f += (((4 * days + 274277) / 146097) * 3) / 4 - 38;
+    }
+    long long e = 4 * f + 3;
+    long long h = 5 * ((e % 1461) / 4) + 2;
+    *day = (int)((h % 153) / 5) + 1;
+    *month = (int)((h / 153 + 2) % 12) + 1;
+    *year = e / 1461 - 4716 + (14 - *month) / 12;
+    return;
+  }
+  if(calendar == cf_360_day)
+  {
+    *year = floor_div(days, 360);
+    long long doy = days - *year * 360;
+    *month = (int)(doy / 30) + 1;
+    *day = (int)(doy % 30) + 1;
+    return;
+  }
+  int leap = (calendar == cf_all_leap);
+  *year = floor_div(days, 365 + leap);
+  int doy = (int)(days - *year * (365 + leap));
+  int idx = 0;
+  while(idx < 11 && doy >= month_days[leap][idx])
+  {
+    doy -= month_days[leap][idx];
+    idx++;
+  }
+  *month = idx + 1;
+  *day = doy + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//month_length
+//days of a month; the Gregorian calendar is proleptic, as in day_number
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int month_length(int calendar, long long year, int month)
+{
+  if(calendar == cf_360_day)
+  {
+    return 30;
+  }
+  int leap = (calendar == cf_all_leap);
+  if(calendar == cf_julian)
+  {
+    leap = (year % 4 == 0);
+  }
+  else if(calendar == cf_gregorian)
+  {
+    leap = (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+  }
+  return month_days[leap][month - 1];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//parse_date
+//"YYYY-MM-DD", then optionally "hh:mm:ss" after a space or 'T', as seconds since the day 0 of the calendar
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool parse_date(const std::string &text, int calendar, double *sec)
+{
+  const char *str = text.c_str();
+  while(isspace((unsigned char)*str))
+  {
+    str++;
+  }
+  long long year;
+  int month;
+  int day;
+  int hour = 0;
+  int minute = 0;
+  double second = 0;
+  int nbr_chr = 0;
+  if(sscanf(str, "%lld-%d-%d%n", &year, &month, &day, &nbr_chr) < 3)
+  {
+    return false;
+  }
+  str += nbr_chr;
+  if(*str == ' ' || *str == 'T')
+  {
+    sscanf(str + 1, "%d:%d:%lf", &hour, &minute, &second);
+  }
+  if(month < 1 || month > 12 || day < 1 || day > month_length(calendar, year, month) || hour < 0 || hour > 24 || minute < 0 || minute > 59
+    || second < 0 || second >= 61)
+  {
+    return false;
+  }
+  *sec = day_number(calendar, year, month, day) * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cf_time_t::parse
+//units of seconds, minutes, hours or days; months and years have no fixed length and are refused
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool cf_time_t::parse(const std::string &units, const std::string &calendar)
+{
+  std::string cal;
+  for(size_t idx = 0; idx < calendar.size(); idx++)
+  {
+    cal += (char)tolower((unsigned char)calendar[idx]);
+  }
+  if(cal.empty() || cal == "standard" || cal == "gregorian" || cal == "proleptic_gregorian")
+  {
+    m_calendar = cf_gregorian;
+  }
+  else if(cal == "julian")
+  {
+    m_calendar = cf_julian;
+  }
+  else if(cal == "noleap" || cal == "365_day")
+  {
+    m_calendar = cf_noleap;
+  }
+  else if(cal == "all_leap" || cal == "366_day")
+  {
+    m_calendar = cf_all_leap;
+  }
+  else if(cal == "360_day")
+  {
+    m_calendar = cf_360_day;
+  }
+  else
+  {
+    return false;
+  }
+
+  size_t pos = units.find(" since ");
+  if(pos == std::string::npos)
+  {
+    return false;
+  }
+  std::string unit;
+  for(size_t idx = 0; idx < pos; idx++)
+  {
+    if(!isspace((unsigned char)units[idx]))
+    {
+      unit += (char)tolower((unsigned char)units[idx]);
+    }
+  }
+  if(unit == "seconds" || unit == "second" || unit == "secs" || unit == "sec" || unit == "s")
+  {
+    m_unit = 1;
+  }
+  else if(unit == "minutes" || unit == "minute" || unit == "mins" || unit == "min")
+  {
+    m_unit = 60;
+  }
+  else if(unit == "hours" || unit == "hour" || unit == "hrs" || unit == "hr" || unit == "h")
+  {
+    m_unit = 3600;
+  }
+  else if(unit == "days" || unit == "day" || unit == "d")
+  {
+    m_unit = 86400;
+  }
+  else
+  {
+    return false;
+  }
+  return parse_date(units.substr(pos + 7), m_calendar, &m_epoch);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cf_time_t::format
+//to the nearest second; empty for NaN and values out of range
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string cf_time_t::format(double value) const
+{
+  double sec = m_epoch + value * m_unit;
+  if(sec != sec || fabs(sec) > 1.0e17)
+  {
+    return std::string();
+  }
+  double days = floor(sec / 86400);
+  long long sod = llround(sec - days * 86400);
+  if(sod >= 86400)
+  {
+    days += 1;
+    sod -= 86400;
+  }
+  long long year;
+  int month;
+  int day;
+  civil_date(m_calendar, (long long)days, &year, &month, &day);
+  char str[64];
+  if(sod == 0)
+  {
+    snprintf(str, sizeof(str), "%04lld-%02d-%02d", year, month, day);
+  }
+  else
+  {
+    snprintf(str, sizeof(str), "%04lld-%02d-%02d %02d:%02d:%02d", year, month, day,
+      (int)(sod / 3600), (int)(sod / 60 % 60), (int)(sod % 60));
+  }
+  return str;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cf_time_t::value
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool cf_time_t::value(const std::string &date, double *value) const
+{
+  double sec;
+  if(!parse_date(date, m_calendar, &sec))
+  {
+    return false;
+  }
+  *value = (sec - m_epoch) / m_unit;
+  return true;
+}
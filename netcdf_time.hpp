@@ -0,0 +1,44 @@
+#ifndef NETCDF_TIME_H
+#define NETCDF_TIME_H
+
+#include <string>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//CF time
+//values of a coordinate variable with units "<unit> since <date>" (CF conventions) as dates, in the
+//calendar of its calendar attribute; standard and gregorian are taken as proleptic Gregorian, so that
+//dates before 1582-10-15 differ from the mixed Julian/Gregorian calendar; time zones are ignored
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum cf_calendar_t
+{
+  cf_gregorian,
+  cf_julian,
+  cf_noleap,
+  cf_all_leap,
+  cf_360_day
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//cf_time_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class cf_time_t
+{
+public:
+  cf_time_t() :
+    m_calendar(cf_gregorian),
+    m_unit(1),
+    m_epoch(0)
+  {
+  }
+  bool parse(const std::string &units, const std::string &calendar);
+  std::string format(double value) const; // "YYYY-MM-DD hh:mm:ss", the date only at midnight
+  bool value(const std::string &date, double *value) const; // value of a date in the format above
+
+  int m_calendar; // cf_calendar_t
+  double m_unit; // seconds
+  double m_epoch; // seconds of the reference date since the day 0 of the calendar
+};
+
+#endif
@@ -0,0 +1,180 @@
+//Copyright (C) 2016 Pedro Vicente
+//GNU General Public License (GPL) Version 3 described in the LICENSE file
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include "netcdf_trace.hpp"
+
+std::atomic<bool> trace_on(false);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_event_t
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class trace_event_t
+{
+public:
+  const char *m_name;
+  std::string m_var;
+  size_t m_bytes;
+  unsigned long long m_tid;
+  long long m_start; // nanoseconds since trace_enable
+  long long m_duration; // nanoseconds
+};
+
+//events past this limit are counted, not stored (about 100 MB of events)
+static const size_t max_events = 1000000;
+static std::vector<trace_event_t> events;
+static size_t nbr_dropped = 0;
+static QMutex mutex;
+static QElapsedTimer timer;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_enable
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void trace_enable(bool enable)
+{
+  QMutexLocker locker(&mutex);
+  if(enable && !timer.isValid())
+  {
+    timer.start();
+  }
+  trace_on.store(enable, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_clear
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void trace_clear()
+{
+  QMutexLocker locker(&mutex);
+  events.clear();
+  nbr_dropped = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_size
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t trace_size()
+{
+  QMutexLocker locker(&mutex);
+  return events.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_t::begin
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void trace_t::begin(const char *name, const char *var, size_t bytes)
+{
+  //pairs with the release store of trace_enable: the timer started before tracing was on is seen
+  std::atomic_thread_fence(std::memory_order_acquire);
+  m_name = name;
+  if(var != NULL)
+  {
+    m_var = var;
+  }
+  m_bytes = bytes;
+  m_start = timer.nsecsElapsed();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_t::end
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void trace_t::end()
+{
+  trace_event_t eve;
+  eve.m_name = m_name;
+  eve.m_var = m_var;
+  eve.m_bytes = m_bytes;
+  eve.m_tid = (unsigned long long)(quintptr)QThread::currentThreadId();
+  eve.m_start = m_start;
+  eve.m_duration = timer.nsecsElapsed() - m_start;
+
+  QMutexLocker locker(&mutex);
+  if(events.size() < max_events)
+  {
+    events.push_back(eve);
+  }
+  else
+  {
+    nbr_dropped++;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//write_escaped
+//JSON string, without the quotes
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void write_escaped(FILE *fp, const char *str)
+{
+  for(const char *chr = str; *chr; chr++)
+  {
+    if(*chr == '"' || *chr == '\\')
+    {
+      fputc('\\', fp);
+      fputc(*chr, fp);
+    }
+    else if((unsigned char)*chr < 0x20)
+    {
+      fprintf(fp, "\\u%04x", (unsigned char)*chr);
+    }
+    else
+    {
+      fputc(*chr, fp);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_save
+//Chrome trace-event format: complete events ("ph":"X"), time stamps and durations in microseconds
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool trace_save(const char *file_name)
+{
+  FILE *fp = fopen(file_name, "w");
+  if(fp == NULL)
+  {
+    return false;
+  }
+
+  QMutexLocker locker(&mutex);
+
+  //small thread numbers, in order of appearance
+  std::vector<unsigned long long> tids;
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%zu},\"traceEvents\":[\n", nbr_dropped);
+  for(size_t idx = 0; idx < events.size(); idx++)
+  {
+    const trace_event_t &eve = events[idx];
+    size_t tid = std::find(tids.begin(), tids.end(), eve.m_tid) - tids.begin();
+    if(tid == tids.size())
+    {
+      tids.push_back(eve.m_tid);
+    }
+    fprintf(fp, "{\"name\":\"%s\",\"cat\":\"netcdf\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"var\":\"",
+      eve.m_name, tid, eve.m_start / 1000.0, eve.m_duration / 1000.0);
+    write_escaped(fp, eve.m_var.c_str());
+    fprintf(fp, "\",\"bytes\":%zu}},\n", eve.m_bytes);
+  }
+
+  //thread names
+  for(size_t tid = 0; tid < tids.size(); tid++)
+  {
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"thread %zu\"}}%s\n",
+      tid, tid, tid + 1 < tids.size() ? "," : "");
+  }
+  fprintf(fp, "]}\n");
+
+  return fclose(fp) == 0;
+}
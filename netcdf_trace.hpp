@@ -0,0 +1,68 @@
+#ifndef NETCDF_TRACE_H
+#define NETCDF_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//tracing of netCDF calls and of the table paint path
+//events are recorded only when tracing is on; when off, a trace_t costs one test of trace_on, a relaxed
+//load, as it is set by the GUI thread and read by all threads
+//the events are saved in the Chrome trace-event JSON format (chrome://tracing, Perfetto)
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern std::atomic<bool> trace_on;
+
+void trace_enable(bool enable);
+void trace_clear();
+size_t trace_size();
+bool trace_save(const char *file_name);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//trace_t
+//scoped timer; records one complete event with call name, variable name, bytes and thread at destruction
+//the name must be a string literal; the variable name is copied only when tracing is on
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class trace_t
+{
+public:
+  trace_t(const char *name, const char *var = NULL, size_t bytes = 0) :
+    m_name(NULL)
+  {
+    if(trace_on.load(std::memory_order_relaxed))
+    {
+      begin(name, var, bytes);
+    }
+  }
+  ~trace_t()
+  {
+    if(m_name != NULL)
+    {
+      end();
+    }
+  }
+  void set_bytes(size_t bytes)
+  {
+    m_bytes = bytes;
+  }
+
+private:
+  void begin(const char *name, const char *var, size_t bytes);
+  void end();
+  const char *m_name; // call name, NULL if tracing was off at construction
+  std::string m_var; // variable or attribute name
+  size_t m_bytes; // bytes read
+  long long m_start; // start time in nanoseconds
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//NC_TRACE
+//time one netCDF call inside an expression, e.g. if(NC_TRACE("nc_open", file_name, 0, nc_open(...)) != NC_NOERR)
+//the temporary trace_t lives until the end of the full expression, so it times the call
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define NC_TRACE(name, var, bytes, call) (trace_t(name, var, bytes), (call))
+
+#endif